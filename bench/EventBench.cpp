@@ -0,0 +1,95 @@
+// Event dispatch and input queries, without a window: events are built by
+// hand and fed straight to EventHandler::HandleEvent
+
+#include "EventHandler.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+SDL_Event KeyEvent(SDL_Keycode key, bool down) {
+  SDL_Event event = {};
+  event.type = down ? SDL_EVENT_KEY_DOWN : SDL_EVENT_KEY_UP;
+  event.key.key = key;
+  return event;
+}
+
+SDL_Event MotionEvent(float x, float y) {
+  SDL_Event event = {};
+  event.type = SDL_EVENT_MOUSE_MOTION;
+  event.motion.x = x;
+  event.motion.y = y;
+  return event;
+}
+
+// Key presses and releases through many registered key callbacks
+void BM_HandleEvent_Key(benchmark::State &state) {
+  const int callbacks = static_cast<int>(state.range(0));
+  EventHandler handler;
+  uint64_t calls = 0;
+  for (int i = 0; i < callbacks; ++i) {
+    handler.RegisterKeyCallback(
+        [&calls](SDL_Keycode key, bool pressed) { calls += key + pressed; });
+  }
+  const SDL_Event events[2] = {KeyEvent(SDLK_W, true),
+                               KeyEvent(SDLK_W, false)};
+  size_t next = 0;
+  for (auto _ : state) {
+    handler.HandleEvent(events[next]);
+    next ^= 1;
+  }
+  benchmark::DoNotOptimize(calls);
+  state.SetItemsProcessed(state.iterations());
+  state.counters["callbacks"] = callbacks;
+}
+BENCHMARK(BM_HandleEvent_Key)->Arg(1)->Arg(16)->Arg(256);
+
+// Mouse motion, the most frequent event, through many motion callbacks
+void BM_HandleEvent_Motion(benchmark::State &state) {
+  const int callbacks = static_cast<int>(state.range(0));
+  EventHandler handler;
+  int64_t sum = 0;
+  for (int i = 0; i < callbacks; ++i) {
+    handler.RegisterMouseMotionCallback([&sum](int x, int y) { sum += x + y; });
+  }
+  std::vector<SDL_Event> events;
+  for (int i = 0; i < 256; ++i) {
+    events.push_back(MotionEvent(static_cast<float>(i * 7 % 1280),
+                                 static_cast<float>(i * 13 % 800)));
+  }
+  size_t next = 0;
+  for (auto _ : state) {
+    handler.HandleEvent(events[next]);
+    next = (next + 1) % events.size();
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+  state.counters["callbacks"] = callbacks;
+}
+BENCHMARK(BM_HandleEvent_Motion)->Arg(1)->Arg(16)->Arg(256);
+
+// Per-frame camera input polls a handful of keys, some never pressed
+void BM_IsKeyPressed(benchmark::State &state) {
+  const int pressed = static_cast<int>(state.range(0));
+  EventHandler handler;
+  for (int i = 0; i < pressed; ++i) {
+    handler.HandleEvent(KeyEvent(SDLK_A + i, (i & 1) == 0));
+  }
+  std::mt19937 rng(42);
+  std::vector<SDL_Keycode> queries(1024);
+  for (SDL_Keycode &key : queries) {
+    // Half of the lookups miss
+    key = SDLK_A + rng() % (2 * pressed);
+  }
+  size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(handler.IsKeyPressed(queries[next]));
+    next = (next + 1) % queries.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["known_keys"] = pressed;
+}
+BENCHMARK(BM_IsKeyPressed)->Arg(8)->Arg(64);
+
+} // namespace
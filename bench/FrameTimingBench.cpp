@@ -0,0 +1,76 @@
+// Frame pacing helpers: how close FPSLimiter wakes to its schedule, and what
+// FPSCounter costs per frame
+
+#include "utilities/FPSCounter.h"
+#include "utilities/FPSLimiter.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Each iteration is one limited frame with no work in it. Lateness is the
+// wake-up time against the limiter's fixed schedule; jitter is the standard
+// deviation of the frame interval.
+void BM_FPSLimiter_Wake(benchmark::State &state) {
+  const int fps = static_cast<int>(state.range(0));
+  const double targetUs = 1e6 / fps;
+  std::vector<double> wakes;
+  wakes.reserve(static_cast<size_t>(state.max_iterations));
+
+  const Clock::time_point start = Clock::now();
+  FPSLimiter limiter(fps);
+  for (auto _ : state) {
+    limiter.limit();
+    wakes.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+  }
+
+  double lateSum = 0.0;
+  double lateMax = 0.0;
+  double intervalSum = 0.0;
+  double intervalSqSum = 0.0;
+  for (size_t i = 0; i < wakes.size(); ++i) {
+    const double late = wakes[i] - targetUs * static_cast<double>(i + 1);
+    lateSum += late;
+    lateMax = std::max(lateMax, late);
+    if (i > 0) {
+      const double interval = wakes[i] - wakes[i - 1];
+      intervalSum += interval;
+      intervalSqSum += interval * interval;
+    }
+  }
+  const double frames = static_cast<double>(wakes.size());
+  const double intervals = std::max(frames - 1.0, 1.0);
+  const double intervalMean = intervalSum / intervals;
+  state.counters["late_us_mean"] = lateSum / std::max(frames, 1.0);
+  state.counters["late_us_max"] = lateMax;
+  state.counters["interval_us_mean"] = intervalMean;
+  state.counters["jitter_us"] = std::sqrt(std::max(
+      intervalSqSum / intervals - intervalMean * intervalMean, 0.0));
+}
+BENCHMARK(BM_FPSLimiter_Wake)
+    ->Arg(60)
+    ->Arg(144)
+    ->Arg(1000)
+    ->Iterations(200)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Per-frame cost when no report is due; the output goes nowhere
+void BM_FPSCounter_Frame(benchmark::State &state) {
+  std::ostream discard(nullptr);
+  FPSCounter counter("bench", discard);
+  for (auto _ : state) {
+    counter.frame();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FPSCounter_Frame);
+
+} // namespace
@@ -0,0 +1,112 @@
+// UI construction: NewFrame, a widget-heavy window and Render into draw
+// lists, with no platform or renderer backend attached
+
+#include "imgui.h"
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+namespace {
+
+// A headless context: ImGui owns the font atlas texture data but nothing
+// uploads it
+struct HeadlessContext {
+  HeadlessContext() {
+    context = ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1920.0f, 1080.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+  }
+  ~HeadlessContext() { ImGui::DestroyContext(context); }
+
+  ImGuiContext *context = nullptr;
+};
+
+// One row of the kind of controls the application's windows are made of
+void BuildRow(int row, float values[2], bool &flag) {
+  ImGui::PushID(row);
+  ImGui::Text("Row %d: %.3f ms", row, values[0]);
+  ImGui::SameLine();
+  ImGui::Checkbox("Enabled", &flag);
+  ImGui::SliderFloat("Value", &values[0], 0.0f, 1.0f);
+  ImGui::DragFloat("Scale", &values[1], 0.01f);
+  if (ImGui::Button("Reset")) {
+    values[0] = 0.0f;
+  }
+  ImGui::PopID();
+}
+
+void BM_ImGui_BuildFrame(benchmark::State &state) {
+  const int rows = static_cast<int>(state.range(0));
+  HeadlessContext headless;
+  float values[2] = {0.5f, 1.0f};
+  bool flag = true;
+  for (auto _ : state) {
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+    ImGui::SetNextWindowSize(ImVec2(800.0f, 1000.0f));
+    ImGui::Begin("Widgets");
+    for (int i = 0; i < rows; ++i) {
+      BuildRow(i, values, flag);
+    }
+    ImGui::End();
+    ImGui::Render();
+    benchmark::DoNotOptimize(ImGui::GetDrawData());
+  }
+  const ImDrawData *drawData = ImGui::GetDrawData();
+  state.SetItemsProcessed(state.iterations() * rows);
+  state.counters["vertices"] = drawData->TotalVtxCount;
+  state.counters["indices"] = drawData->TotalIdxCount;
+}
+BENCHMARK(BM_ImGui_BuildFrame)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMicrosecond);
+
+// The same rows laid out as a table, with clipping to the visible rows
+void BM_ImGui_BuildTable(benchmark::State &state) {
+  const int rows = static_cast<int>(state.range(0));
+  HeadlessContext headless;
+  float values[2] = {0.5f, 1.0f};
+  bool flag = true;
+  char label[32];
+  for (auto _ : state) {
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+    ImGui::SetNextWindowSize(ImVec2(800.0f, 1000.0f));
+    ImGui::Begin("Table");
+    if (ImGui::BeginTable("rows", 3,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY)) {
+      ImGuiListClipper clipper;
+      clipper.Begin(rows);
+      while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+          ImGui::PushID(i);
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          snprintf(label, sizeof(label), "Object %d", i);
+          ImGui::TextUnformatted(label);
+          ImGui::TableNextColumn();
+          ImGui::Checkbox("##visible", &flag);
+          ImGui::TableNextColumn();
+          ImGui::SliderFloat("##value", &values[0], 0.0f, 1.0f);
+          ImGui::PopID();
+        }
+      }
+      ImGui::EndTable();
+    }
+    ImGui::End();
+    ImGui::Render();
+    benchmark::DoNotOptimize(ImGui::GetDrawData());
+  }
+  state.SetItemsProcessed(state.iterations() * rows);
+  state.counters["vertices"] = ImGui::GetDrawData()->TotalVtxCount;
+}
+BENCHMARK(BM_ImGui_BuildTable)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,67 @@
+// LOD generation: quadric simplification of a UV sphere at several
+// tessellations
+//
+// Counters report the triangles and object-space error (relative to the
+// radius) of each generated level, so quality regressions show up next to
+// the timing.
+
+#include "scene/MeshSimplifier.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <string>
+
+namespace {
+
+MeshData MakeSphere(uint32_t segments, uint32_t rings) {
+  MeshData sphere;
+  for (uint32_t r = 0; r <= rings; ++r) {
+    const float theta = kPi * r / rings;
+    for (uint32_t s = 0; s <= segments; ++s) {
+      const float phi = 2.0f * kPi * s / segments;
+      Vertex vertex;
+      vertex.normal = {std::sin(theta) * std::cos(phi), std::cos(theta),
+                       std::sin(theta) * std::sin(phi)};
+      vertex.position = vertex.normal;
+      vertex.uv[0] = static_cast<float>(s) / segments;
+      vertex.uv[1] = static_cast<float>(r) / rings;
+      sphere.vertices.push_back(vertex);
+    }
+  }
+  for (uint32_t r = 0; r < rings; ++r) {
+    for (uint32_t s = 0; s < segments; ++s) {
+      const uint32_t a = r * (segments + 1) + s;
+      const uint32_t b = a + segments + 1;
+      if (r != 0) {
+        sphere.indices.insert(sphere.indices.end(), {a, a + 1, b});
+      }
+      if (r != rings - 1) {
+        sphere.indices.insert(sphere.indices.end(), {a + 1, b + 1, b});
+      }
+    }
+  }
+  return sphere;
+}
+
+void BM_GenerateLods(benchmark::State &state) {
+  const uint32_t segments = static_cast<uint32_t>(state.range(0));
+  const MeshData source = MakeSphere(segments, segments / 2);
+  MeshData mesh;
+  for (auto _ : state) {
+    mesh = source;
+    GenerateLods(mesh);
+    benchmark::DoNotOptimize(mesh.indices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * (source.indices.size() / 3));
+  for (size_t i = 0; i < mesh.lods.size(); ++i) {
+    const std::string lod = "lod" + std::to_string(i);
+    state.counters[lod + "_tris"] = mesh.lods[i].indexCount / 3;
+    state.counters[lod + "_error"] = mesh.lods[i].error;
+  }
+}
+BENCHMARK(BM_GenerateLods)
+    ->Arg(48)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
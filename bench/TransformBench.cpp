@@ -0,0 +1,167 @@
+// Transform propagation: SoA hierarchy versus a naive AoS node tree
+//
+// The naive version is what a straightforward port of assimp's aiNode graph
+// looks like: one heap node per transform, children vectors, recursive
+// world-matrix evaluation of every node every frame.
+
+#include "scene/TransformHierarchy.h"
+#include "utilities/ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kNodeCount = 1 << 20;
+
+struct NaiveNode {
+  Vec3 position;
+  Quat rotation;
+  Vec3 scale{1.0f};
+  Mat4 world;
+  std::vector<NaiveNode *> children;
+};
+
+// Parent of node i is a uniformly random earlier node (a random recursive
+// tree): bushy and a few dozen levels deep, like a large imported assembly
+std::vector<int> MakeParents(int count) {
+  std::mt19937 rng(1234);
+  std::vector<int> parents(count, -1);
+  for (int i = 1; i < count; ++i) {
+    parents[i] = static_cast<int>(rng() % static_cast<unsigned>(i));
+    if (rng() % 1024 == 0) {
+      parents[i] = -1;
+    }
+  }
+  return parents;
+}
+
+Quat RandomRotation(std::mt19937 &rng) {
+  std::uniform_real_distribution<float> angle(-kPi, kPi);
+  return Quat::FromEuler(angle(rng), angle(rng), angle(rng));
+}
+
+struct NaiveScene {
+  std::vector<std::unique_ptr<NaiveNode>> nodes;
+  std::vector<NaiveNode *> roots;
+
+  explicit NaiveScene(const std::vector<int> &parents) {
+    std::mt19937 rng(42);
+    nodes.reserve(parents.size());
+    for (size_t i = 0; i < parents.size(); ++i) {
+      auto node = std::make_unique<NaiveNode>();
+      node->position = {static_cast<float>(i % 17), 1.0f, 0.5f};
+      node->rotation = RandomRotation(rng);
+      if (parents[i] < 0) {
+        roots.push_back(node.get());
+      } else {
+        nodes[parents[i]]->children.push_back(node.get());
+      }
+      nodes.push_back(std::move(node));
+    }
+  }
+
+  static void Propagate(NaiveNode *node, const Mat4 &parent) {
+    node->world =
+        parent * Mat4::FromTRS(node->position, node->rotation, node->scale);
+    for (NaiveNode *child : node->children) {
+      Propagate(child, node->world);
+    }
+  }
+
+  void Update() {
+    for (NaiveNode *root : roots) {
+      Propagate(root, Mat4::Identity());
+    }
+  }
+};
+
+struct SoAScene {
+  TransformHierarchy hierarchy;
+  std::vector<TransformHandle> handles;
+
+  explicit SoAScene(const std::vector<int> &parents) {
+    std::mt19937 rng(42);
+    hierarchy.Reserve(parents.size());
+    handles.reserve(parents.size());
+    for (size_t i = 0; i < parents.size(); ++i) {
+      TransformHandle parent =
+          parents[i] < 0 ? kInvalidTransform : handles[parents[i]];
+      TransformHandle h = hierarchy.Create(parent);
+      hierarchy.SetLocal(h, {static_cast<float>(i % 17), 1.0f, 0.5f},
+                         RandomRotation(rng), Vec3(1.0f));
+      handles.push_back(h);
+    }
+    hierarchy.Update();
+  }
+
+  // Late nodes sit near the leaves, so touching from the back keeps the
+  // dirty subtrees small
+  void Touch(size_t stride) {
+    for (size_t i = 0; i < handles.size(); i += stride) {
+      hierarchy.SetLocalScale(handles[handles.size() - 1 - i], Vec3(1.0f));
+    }
+  }
+};
+
+const std::vector<int> &Parents() {
+  static const std::vector<int> parents = MakeParents(kNodeCount);
+  return parents;
+}
+
+ThreadPool &Pool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void BM_NaiveAoS_FullUpdate(benchmark::State &state) {
+  NaiveScene scene(Parents());
+  for (auto _ : state) {
+    scene.Update();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kNodeCount);
+}
+BENCHMARK(BM_NaiveAoS_FullUpdate)->Unit(benchmark::kMillisecond);
+
+// Every node dirty: worst case for the SoA path
+void BM_SoA_FullUpdate(benchmark::State &state) {
+  SoAScene scene(Parents());
+  const bool parallel = state.range(0) != 0;
+  for (auto _ : state) {
+    scene.Touch(1);
+    scene.hierarchy.Update(parallel ? &Pool() : nullptr);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kNodeCount);
+  state.SetLabel(parallel ? "parallel" : "serial");
+}
+BENCHMARK(BM_SoA_FullUpdate)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// A sparse set of moving nodes, the common case at runtime
+void BM_SoA_SparseUpdate(benchmark::State &state) {
+  SoAScene scene(Parents());
+  const size_t stride = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    scene.Touch(stride);
+    scene.hierarchy.Update(&Pool());
+    benchmark::ClobberMemory();
+  }
+  state.counters["updated"] = scene.hierarchy.GetStats().updatedCount;
+}
+BENCHMARK(BM_SoA_SparseUpdate)
+    ->Arg(100)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_SoA_NoChanges(benchmark::State &state) {
+  SoAScene scene(Parents());
+  for (auto _ : state) {
+    scene.hierarchy.Update(&Pool());
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_SoA_NoChanges)->Unit(benchmark::kMicrosecond);
+
+} // namespace
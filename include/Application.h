@@ -1,12 +1,24 @@
 #pragma once
 
 #include "EventHandler.h"
+#include "FontLibrary.h"
+#include "HotReload.h"
 #include "Renderer.h"
+#include "Simulation.h"
+#include "TimeSeriesPlot.h"
+#include "scene/Bvh.h"
+#include "scene/Camera.h"
+#include "scene/Scene.h"
+#include "utilities/ThreadPool.h"
 #include <SDL3/SDL.h>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 
 class Application {
@@ -18,6 +30,10 @@ public:
   bool Initialize(int width = 1280, int height = 800,
                   const char *title = "Renderer");
 
+  // Load a model through assimp, or a procedural test grid when path is
+  // null. Must be called after Initialize and before Run.
+  bool LoadScene(const char *path);
+
   // Run the main loop
   void Run();
 
@@ -27,7 +43,16 @@ public:
 private:
   void SetupCallbacks();
   void UpdateImGui();
+  void UpdateScene();
+  void UpdateCamera(float dt);
   void RenderFrame();
+  void ToggleCapture();
+  // Hand the freshly loaded m_Scene to the simulation, renderer and watcher.
+  // `previousMeshes` maps its meshes to the scene it replaces, if any.
+  bool SetupScene(const std::vector<std::string> &modelFiles,
+                  const std::vector<uint32_t> *previousMeshes = nullptr);
+  // Swap in finished hot reloads; between frames on the render thread
+  void ApplyReloads();
 
   // Callback handlers
   void OnQuit();
@@ -41,9 +66,14 @@ private:
   SDL_Window *m_Window = nullptr;
   std::unique_ptr<EventHandler> m_EventHandler;
   std::unique_ptr<Renderer> m_Renderer;
+  std::unique_ptr<ThreadPool> m_JobPool;
+  std::unique_ptr<Simulation> m_Simulation;
+  std::unique_ptr<HotReload> m_HotReload;
+  std::unique_ptr<FontLibrary> m_Fonts; // outlives the ImGui context
+  std::unique_ptr<TimeSeriesPlot> m_Telemetry;
 
   // Threading
-  std::thread m_RenderThread;
+  std::thread m_RenderThread; // the simulation runs on a third thread
   std::atomic<bool> m_Running{false};
   std::atomic<bool> m_RenderThreadReady{false};
   std::mutex m_StateMutex;
@@ -55,9 +85,48 @@ private:
   int m_PendingWidth = 1280;
   int m_PendingHeight = 800;
 
+  // F12 on the event thread; handled on the render thread
+  std::atomic<bool> m_CaptureToggleRequested{false};
+
   // Demo UI state (accessed from render thread)
   bool m_ShowDemoWindow = true;
   bool m_ShowAnotherWindow = false;
   float m_ClearColor[4] = {0.45f, 0.55f, 0.60f, 1.00f};
   int m_Counter = 0;
+  int m_UiStressLines = 0;
+
+  // Synthetic telemetry streamed into m_Telemetry (render thread)
+  bool m_StreamTelemetry = false;
+  int m_TelemetryRate = 20000; // samples per frame
+  uint64_t m_TelemetryTick = 0;
+  uint32_t m_TelemetryNoise = 1;
+  std::vector<float> m_TelemetrySamples;
+
+  // Scene state (accessed from render thread)
+  Scene m_Scene;
+  std::string m_ScenePath; // empty for the procedural scene
+  double m_SceneReloadMs = 0.0;
+  Bvh m_Bvh;
+  uint64_t m_BvhTopologyVersion = UINT64_MAX;
+  Camera m_Camera;
+  Mat4 m_ViewProj;
+  std::vector<uint32_t> m_VisibleObjects;
+  bool m_EnableCulling = true;
+  bool m_GpuCulling = false;
+  bool m_EnableBatching = true;
+  bool m_OcclusionCulling = true;
+  bool m_RegenerateScene = false;
+  int m_ProceduralObjectCount = 20000;
+  bool m_AnimateObjects = false;
+  float m_TickRate = 60.0f;
+  // Objects driven by the simulation, in snapshot order
+  std::vector<TransformHandle> m_SimObjects;
+  uint64_t m_SimGeneration = 0;
+  int m_TextureBudgetMb = 256;
+  bool m_EnableLods = true;
+  float m_LodPixelError = 1.0f;
+  int m_CaptureFormat = 1; // FrameCapture::Format
+  char m_CaptureDirectory[256] = "captures";
+  float m_CameraSpeed = 20.0f;
+  std::chrono::high_resolution_clock::time_point m_LastFrameTime;
 };
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Sort-key draw submission. Callers submit one item per object; Build() sorts
+// the items by a 64-bit key and merges runs that share pipeline, material and
+// mesh into instanced draws, whose instances are contiguous in sorted order.
+//
+// Key layout, most significant first:
+//   pipeline (4 bits) | material (16) | mesh (20) | depth (24)
+// so state changes are minimised first and batches are drawn front to back.
+class DrawQueue {
+public:
+  static constexpr uint32_t kPipelineBits = 4;
+  static constexpr uint32_t kMaterialBits = 16;
+  static constexpr uint32_t kMeshBits = 20;
+  static constexpr uint32_t kDepthBits = 24;
+
+  struct Item {
+    uint64_t key;
+    uint32_t object;
+  };
+
+  struct Batch {
+    uint32_t pipeline;
+    uint32_t material;
+    uint32_t mesh;
+    uint32_t firstInstance; // index into GetItems()
+    uint32_t instanceCount;
+  };
+
+  struct Stats {
+    uint32_t items = 0;
+    // Submission order with one draw per item
+    uint32_t drawCallsBefore = 0;
+    uint32_t stateChangesBefore = 0;
+    // Sorted and merged
+    uint32_t drawCallsAfter = 0;
+    uint32_t stateChangesAfter = 0;
+    double sortMs = 0.0;
+  };
+
+  // Whether ids below these counts fit their key fields. MakeKey masks each
+  // field, so larger ids alias and unrelated objects would share a batch.
+  static constexpr bool Fits(uint32_t pipelines, uint32_t materials,
+                             uint32_t meshes) {
+    return pipelines <= (1u << kPipelineBits) &&
+           materials <= (1u << kMaterialBits) && meshes <= (1u << kMeshBits);
+  }
+
+  // `depth` is view-space distance; negative values sort first
+  static uint64_t MakeKey(uint32_t pipeline, uint32_t material, uint32_t mesh,
+                          float depth);
+
+  void Clear();
+  void Reserve(size_t count) { m_Items.reserve(count); }
+  void Submit(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth,
+              uint32_t object) {
+    m_Items.push_back({MakeKey(pipeline, material, mesh, depth), object});
+  }
+
+  // Sort the submitted items and build batches. Splits the sort across the
+  // pool when one is given.
+  void Build(ThreadPool *pool = nullptr);
+
+  const std::vector<Item> &GetItems() const { return m_Items; }
+  const std::vector<Batch> &GetBatches() const { return m_Batches; }
+  const Stats &GetStats() const { return m_Stats; }
+
+private:
+  std::vector<Item> m_Items;
+  std::vector<Item> m_Scratch;
+  std::vector<Batch> m_Batches;
+  Stats m_Stats;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks the scene's render scale (fraction of the surface size on each axis)
+// from measured frame times. Cost is modelled as proportional to pixel count,
+// so the ideal scale is scale * sqrt(budget / measured). To stay stable with
+// timings that lag a few frames behind:
+//  - measurements are smoothed, and reset whenever the scale changes
+//  - the scale moves in fixed steps and holds for a few frames after each
+//    change, so the targets aren't reallocated every frame
+//  - it drops straight to the ideal scale but climbs a fraction of the way,
+//    and only with some headroom below the budget
+class DynamicResolution {
+public:
+  struct Settings {
+    bool enabled = true;
+    float budgetMs = 16.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+  };
+
+  static constexpr uint32_t kHistorySize = 240;
+
+  // Feed the latest frame time and return the scale for the next frame.
+  // `frameMs` should come from timestamp queries; without them pass the CPU
+  // frame interval with `gpuTimed` false. That includes waiting for vsync, so
+  // the budget is given some slack and only missed frames lower the scale.
+  float Update(double frameMs, bool gpuTimed);
+
+  float GetScale() const { return m_Scale; }
+
+  // Hold the current scale whatever the timings or settings, e.g. while a
+  // capture needs every frame the same size
+  void SetPinned(bool pinned) { m_Pinned = pinned; }
+  bool IsPinned() const { return m_Pinned; }
+  Settings &GetSettings() { return m_Settings; }
+  const Settings &GetSettings() const { return m_Settings; }
+
+  // Ring buffers for ImGui::PlotLines; the oldest sample is at GetHistoryOffset
+  const float *GetScaleHistory() const { return m_ScaleHistory; }
+  const float *GetFrameMsHistory() const { return m_FrameMsHistory; }
+  uint32_t GetHistoryOffset() const { return m_HistoryOffset; }
+
+private:
+  Settings m_Settings;
+  float m_Scale = 1.0f;
+  double m_SmoothedMs = 0.0;
+  uint32_t m_HoldFrames = 0;
+  bool m_Pinned = false;
+
+  float m_ScaleHistory[kHistorySize] = {};
+  float m_FrameMsHistory[kHistorySize] = {};
+  uint32_t m_HistoryOffset = 0;
+};
@@ -29,13 +29,15 @@ public:
   void RegisterMouseMotionCallback(MouseMotionCallback callback);
   void RegisterWindowResizeCallback(WindowResizeCallback callback);
 
+  // Update input state and run the callbacks for one event; ProcessEvents
+  // calls this for everything it polls
+  void HandleEvent(const SDL_Event &event);
+
   // Check current input state (query-based, not event-based)
   bool IsKeyPressed(SDL_Keycode key) const;
   void GetMousePosition(int &x, int &y) const;
 
 private:
-  void HandleEvent(const SDL_Event &event);
-
   // Callbacks
   std::vector<QuitCallback> m_QuitCallbacks;
   std::vector<KeyCallback> m_KeyCallbacks;
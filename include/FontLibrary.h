@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ImFontAtlas;
+
+// UI fonts for ImGui's dynamic font atlas. Glyphs are rasterised on first use,
+// at the size and DPI scale they are drawn at, into free atlas space, and the
+// WebGPU backend uploads only the rectangles that changed; nothing is baked
+// up front, however large the fonts' glyph ranges. Font files are mapped into
+// memory rather than read, so a CJK or icon font only costs the pages its
+// glyph lookups touch. The mappings live as long as this object, which must
+// outlive the ImGui context.
+class FontLibrary {
+public:
+  struct Stats {
+    uint32_t files = 0;
+    uint64_t fileBytes = 0; // mapped, not necessarily resident
+    double loadMs = 0.0;
+  };
+
+  // Atlas texture as last built, which grows as glyphs are added
+  struct AtlasStats {
+    int width = 0;
+    int height = 0;
+    uint64_t bytes = 0;
+  };
+
+  FontLibrary();
+  ~FontLibrary();
+
+  FontLibrary(const FontLibrary &) = delete;
+  FontLibrary &operator=(const FontLibrary &) = delete;
+
+  // Fonts listed in RENDERER_UI_FONTS, separated by ';'. The first is the
+  // main font and the rest are merged into it for the glyphs it lacks (CJK,
+  // icons). Without the variable ImGui's default font is used.
+  static std::vector<std::string> GetConfiguredFonts();
+
+  // Add `files` to the atlas at the style's base size; fonts that can't be
+  // opened are skipped. Returns false if none could be added.
+  bool Load(ImFontAtlas *atlas, const std::vector<std::string> &files);
+
+  const Stats &GetStats() const { return m_Stats; }
+  static AtlasStats GetAtlasStats(const ImFontAtlas *atlas);
+
+private:
+  struct Mapping {
+    void *data = nullptr;
+    size_t size = 0;
+  };
+
+  std::vector<Mapping> m_Mappings;
+  Stats m_Stats;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+// Records rendered frames to disk without stalling the frame:
+//  - Capture() copies the frame into a free buffer of a small readback ring.
+//    When every buffer is still in flight the frame is dropped, never waited
+//    for.
+//  - Submitted() maps it asynchronously; the map completes a frame or two
+//    later, once the GPU has finished the copy, and hands the buffer to the
+//    writer threads.
+//  - A writer copies the pixels out of the mapped buffer, which the render
+//    thread then unmaps for reuse, and encodes them to a PNG sequence or a
+//    single Y4M (4:2:0) video while the next frames are captured.
+// Only 8-bit RGBA/BGRA sources are supported.
+class FrameCapture {
+public:
+  enum class Format { Png, Y4m };
+
+  struct Settings {
+    Format format = Format::Y4m;
+    std::filesystem::path directory = "captures";
+    uint32_t frameRate = 60; // Y4M header only
+  };
+
+  struct Stats {
+    uint32_t captured = 0; // copies recorded
+    uint32_t written = 0;
+    uint32_t dropped = 0; // no free buffer, or Y4M size changes
+    uint32_t queued = 0;  // mapped, waiting for a writer
+    double writeMs = 0.0; // last frame's encode and write, on a writer
+  };
+
+  FrameCapture();
+  ~FrameCapture();
+
+  void Initialize(WGPUDevice device);
+  void Shutdown();
+
+  static bool IsSupportedFormat(WGPUTextureFormat format);
+
+  // Open the output and start the writers
+  bool Start(const Settings &settings);
+  // Stop capturing; frames already captured are still written, after which
+  // the output is closed from Submitted()
+  void Stop();
+  bool IsRecording() const { return m_Recording; }
+  bool IsBusy() const { return m_Recording || m_Stopping; }
+
+  // Copy `texture` (CopySrc usage) into the readback ring, if a buffer is free
+  void Capture(WGPUCommandEncoder encoder, WGPUTexture texture,
+               WGPUTextureFormat format, uint32_t width, uint32_t height);
+
+  // Once per frame after the submit, whether or not anything was captured
+  void Submitted();
+
+  Stats GetStats() const;
+
+private:
+  static constexpr uint32_t kSlots = 4;
+
+  enum class SlotState : uint32_t {
+    Free,
+    Recorded, // copy recorded, mapped after the submit
+    Mapping,
+    Queued,   // mapped, waiting for a writer
+    Writing,  // a writer is copying the pixels out
+    Released, // the writer is done with the mapping
+  };
+
+  struct Slot {
+    WGPUBuffer buffer = nullptr;
+    uint64_t size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t bytesPerRow = 0;
+    bool bgra = false;
+    uint32_t frameIndex = 0;
+    std::atomic<SlotState> state{SlotState::Free};
+  };
+
+  struct Frame {
+    std::vector<uint8_t> rgba; // tightly packed
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t index = 0;
+  };
+
+  static void OnSlotMapped(WGPUMapAsyncStatus status, WGPUStringView message,
+                           void *userdata1, void *userdata2);
+  void WriterLoop();
+  void CopyOut(Slot &slot, Frame &frame);
+  bool WritePng(const Frame &frame);
+  bool WriteY4m(const Frame &frame, std::vector<uint8_t> &yuv);
+  void JoinWriters();
+
+  WGPUDevice m_Device = nullptr;
+  Slot m_Slots[kSlots];
+  uint32_t m_NextSlot = 0;
+
+  Settings m_Settings;
+  std::atomic<bool> m_Recording{false};
+  std::atomic<bool> m_Stopping{false};
+  uint32_t m_FrameIndex = 0;
+  FILE *m_Video = nullptr;
+  uint32_t m_VideoWidth = 0;
+  uint32_t m_VideoHeight = 0;
+
+  std::vector<std::thread> m_Writers;
+  std::mutex m_QueueMutex;
+  std::condition_variable m_QueueCondition;
+  std::deque<Slot *> m_Queue;
+  bool m_ExitWriters = false;
+  std::atomic<uint32_t> m_ActiveWriters{0};
+
+  std::atomic<uint32_t> m_Captured{0};
+  std::atomic<uint32_t> m_Written{0};
+  std::atomic<uint32_t> m_Dropped{0};
+  std::atomic<double> m_WriteMs{0.0};
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "math/Math.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+class GpuTimer;
+class Scene;
+
+// Argument layout consumed by wgpuRenderPassEncoderDrawIndexedIndirect
+struct IndirectDrawArgs {
+  uint32_t indexCount = 0;
+  uint32_t instanceCount = 0;
+  uint32_t firstIndex = 0;
+  int32_t baseVertex = 0;
+  uint32_t firstInstance = 0;
+};
+
+// Screen-space error LOD selection, shared by the CPU and GPU paths. An
+// object draws the coarsest level whose error, projected at its distance,
+// stays within `threshold` pixels; moving to a coarser level than the current
+// one must clear threshold * (1 - hysteresis).
+struct LodSelection {
+  bool enabled = true;
+  float pixelsPerUnit = 0.0f; // screen pixels per world unit at distance 1
+  float threshold = 1.0f;
+  float hysteresis = 0.25f;
+};
+
+// GPU-driven visibility. Object bounds and per-object draw data live in
+// storage buffers; a compute pass tests every object against the frustum and
+// a hierarchical-Z pyramid built from the previous frame's depth buffer, picks
+// a LOD for the survivors and appends them to per-bucket instance ranges while
+// bumping the instance count of one indirect draw per bucket. A bucket is one
+// LOD of a mesh/material pair in use by at least one object. CPU cost per
+// frame is proportional to the number of buckets and moved objects, not to
+// the object count.
+class GpuCuller {
+public:
+  struct Stats {
+    uint32_t visibleObjects = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t occlusionCulled = 0;
+    uint32_t objectsWritten = 0; // rows uploaded this frame
+    uint32_t triangles = 0;      // drawn by the visible objects
+    bool occlusionActive = false;
+  };
+
+  GpuCuller();
+  ~GpuCuller();
+
+  bool Initialize(WGPUDevice device, WGPUQueue queue);
+  void Shutdown();
+
+  // Allocate per-object buffers for the scene, group objects into buckets and
+  // upload every object. meshDraws holds the index range of every LOD of each
+  // mesh (instance fields ignored); LOD errors come from the scene meshes.
+  bool Upload(const Scene &scene,
+              const std::vector<std::vector<IndirectDrawArgs>> &meshDraws);
+
+  // Upload the rows of objects that moved in the last Scene::Update, or
+  // everything when `all` is set
+  void UpdateObjects(const Scene &scene, bool all);
+
+  // Depth buffer the main pass renders into; the hi-Z pyramid is rebuilt
+  // from it at the start of every Cull. Resets occlusion history.
+  void SetDepthTexture(WGPUTexture depth, uint32_t width, uint32_t height);
+
+  // Build the hi-Z pyramid from last frame's depth, then cull and fill the
+  // indirect arguments. Records into its own command buffer and submits it,
+  // so it must be called before the frame that draws is submitted. The hi-Z
+  // build is timed as `timer` scope firstScope, the cull as firstScope + 1.
+  void Cull(const Mat4 &viewProj, Vec3 cameraPos, const LodSelection &lod,
+            bool frustumCulling, bool occlusionCulling,
+            GpuTimer *timer = nullptr, uint32_t firstScope = 0);
+
+  // Forget last frame's camera, e.g. when a frame was drawn without Cull
+  void ResetHistory() { m_DepthHistoryValid = false; }
+
+  WGPUBuffer GetObjectDataBuffer() const { return m_ObjectDataBuffer; }
+  WGPUBuffer GetVisibleIdBuffer() const { return m_VisibleIdBuffer; }
+  WGPUBuffer GetDrawArgsBuffer() const { return m_DrawArgsBuffer; }
+  uint64_t GetObjectDataSize() const { return m_ObjectCapacity * sizeof(ObjectData); }
+  uint64_t GetVisibleIdSize() const { return m_VisibleIdCapacity * sizeof(uint32_t); }
+  uint32_t GetObjectCount() const { return m_ObjectCount; }
+  // Indirect draw i of the args buffer belongs to bucket i. The LODs of a
+  // mesh/material pair are consecutive buckets, finest first.
+  uint32_t GetBucketCount() const { return static_cast<uint32_t>(m_Buckets.size()); }
+  uint32_t GetBucketMesh(uint32_t bucket) const { return m_BucketMesh[bucket]; }
+  uint32_t GetBucketMaterial(uint32_t bucket) const { return m_BucketMaterial[bucket]; }
+  uint32_t GetBucketLod(uint32_t bucket) const { return m_BucketLod[bucket]; }
+  uint32_t GetBucketInstanceBase(uint32_t bucket) const {
+    return m_Buckets[bucket].instanceBase;
+  }
+
+  // Counters are read back asynchronously and lag the GPU by a frame or two
+  Stats GetStats() const;
+
+private:
+  // Layouts must match the WGSL structs
+  struct alignas(16) ObjectBounds {
+    Vec4 min; // w holds the bits of the first bucket of the object's LODs
+    Vec4 max; // w holds the world matrix's largest axis scale
+  };
+
+  struct BucketInfo {
+    uint32_t instanceBase;
+    uint32_t lodCount; // LODs of the bucket's mesh
+    float lodError;    // object-space error of this bucket's LOD
+    uint32_t triangles;
+  };
+
+  struct alignas(16) ObjectData {
+    Mat4 model;
+    Vec4 color;
+  };
+
+  struct alignas(16) CullUniforms {
+    Mat4 prevViewProj;
+    Vec4 planes[6];
+    Vec4 cameraPos;
+    float hizSize[2];
+    uint32_t objectCount;
+    uint32_t hizMipCount;
+    uint32_t flags;
+    float lodPixelsPerUnit;
+    float lodThreshold;
+    float lodHysteresis;
+  };
+
+  static constexpr uint32_t kReadbackSlots = 3;
+
+  struct Readback {
+    WGPUBuffer buffer = nullptr;
+    std::atomic<bool> busy{false};
+  };
+
+  bool CreatePipelines();
+  void CreateHiZ();
+  void ReleaseHiZ();
+  void ReleaseObjects();
+  void CreateCullBindGroup();
+  void BuildHiZ(WGPUCommandEncoder encoder, GpuTimer *timer, uint32_t scope);
+  void FillObjectRow(const Scene &scene, uint32_t object);
+  static void OnReadbackMapped(WGPUMapAsyncStatus status, WGPUStringView message,
+                               void *userdata1, void *userdata2);
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+
+  WGPUComputePipeline m_CullPipeline = nullptr;
+  WGPUComputePipeline m_HiZFromDepthPipeline = nullptr;
+  WGPUComputePipeline m_HiZDownsamplePipeline = nullptr;
+  WGPUBindGroupLayout m_CullLayout = nullptr;
+  WGPUBindGroupLayout m_HiZFromDepthLayout = nullptr;
+  WGPUBindGroupLayout m_HiZDownsampleLayout = nullptr;
+  WGPUBindGroup m_CullBindGroup = nullptr;
+
+  // Per-object and per-bucket buffers
+  WGPUBuffer m_BoundsBuffer = nullptr;
+  WGPUBuffer m_ObjectDataBuffer = nullptr;
+  WGPUBuffer m_VisibleIdBuffer = nullptr;
+  WGPUBuffer m_BucketBuffer = nullptr;
+  WGPUBuffer m_ObjectLodBuffer = nullptr; // last LOD picked, for hysteresis
+  WGPUBuffer m_DrawArgsBuffer = nullptr;
+  WGPUBuffer m_DrawArgsTemplate = nullptr; // instance counts zeroed
+  WGPUBuffer m_UniformBuffer = nullptr;
+  WGPUBuffer m_StatsBuffer = nullptr;
+  uint32_t m_ObjectCount = 0;
+  uint32_t m_ObjectCapacity = 0;
+  uint32_t m_VisibleIdCapacity = 0;
+  std::vector<BucketInfo> m_Buckets;
+  std::vector<uint32_t> m_BucketMesh;
+  std::vector<uint32_t> m_BucketMaterial;
+  std::vector<uint32_t> m_BucketLod;
+  std::vector<uint32_t> m_ObjectBucket;
+  std::vector<ObjectBounds> m_BoundsStaging;
+  std::vector<ObjectData> m_DataStaging;
+  std::vector<uint32_t> m_Moved; // sorted copy of the scene's moved list
+
+  // Hi-Z pyramid: power-of-two r32float, max depth per texel
+  WGPUTexture m_DepthTexture = nullptr;
+  WGPUTextureView m_DepthView = nullptr;
+  WGPUTexture m_HiZTexture = nullptr;
+  WGPUTextureView m_HiZView = nullptr;
+  std::vector<WGPUTextureView> m_HiZMipViews;
+  std::vector<WGPUBindGroup> m_HiZBindGroups;
+  uint32_t m_HiZWidth = 0;
+  uint32_t m_HiZHeight = 0;
+  bool m_DepthHistoryValid = false;
+  Mat4 m_PrevViewProj;
+
+  Readback m_Readback[kReadbackSlots];
+  uint32_t m_ReadbackIndex = 0;
+  std::atomic<uint32_t> m_GpuCounts[4] = {};
+  Stats m_Stats;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <webgpu/webgpu.h>
+
+// GPU pass timing through timestamp queries. Each scope is a pair of queries
+// written at the start and end of one pass. Once per frame the written scopes
+// are resolved into a free slot of a small readback ring and mapped
+// asynchronously, so results lag the GPU by a frame or two and reading them
+// never stalls. Without the TimestampQuery feature every call is a no-op and
+// every scope reads as zero.
+class GpuTimer {
+public:
+  static constexpr uint32_t kMaxScopes = 16;
+
+  GpuTimer();
+  ~GpuTimer();
+
+  bool Initialize(WGPUDevice device, WGPUQueue queue);
+  void Shutdown();
+
+  bool IsSupported() const { return m_QuerySet != nullptr; }
+
+  // Timestamp writes for the pass measuring `scope`, or nullptr when
+  // unsupported. Valid until the next call for the same scope.
+  const WGPUPassTimestampWrites *GetPassWrites(uint32_t scope);
+
+  // Resolve the scopes written since the last Resolve into a free readback
+  // slot. Skips the frame when every slot is still in flight.
+  void Resolve(WGPUCommandEncoder encoder);
+
+  // Start mapping the slot resolved this frame; call after the submit
+  void ReadBack();
+
+  // Latest measurement; zero for scopes that weren't written that frame
+  double GetMilliseconds(uint32_t scope) const;
+
+private:
+  static constexpr uint32_t kReadbackSlots = 3;
+
+  struct Readback {
+    WGPUBuffer buffer = nullptr;
+    uint32_t scopeMask = 0;
+    std::atomic<bool> busy{false};
+  };
+
+  static void OnReadbackMapped(WGPUMapAsyncStatus status, WGPUStringView message,
+                               void *userdata1, void *userdata2);
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+  WGPUQuerySet m_QuerySet = nullptr;
+  WGPUBuffer m_ResolveBuffer = nullptr;
+  WGPUPassTimestampWrites m_Writes[kMaxScopes] = {};
+  uint32_t m_FrameMask = 0;
+
+  Readback m_Readback[kReadbackSlots];
+  Readback *m_Pending = nullptr;
+  uint32_t m_ReadbackIndex = 0;
+  std::atomic<uint64_t> m_Nanoseconds[kMaxScopes] = {};
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "scene/Scene.h"
+#include "utilities/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Reloads the files a scene was built from while it runs, through Linux
+// inotify. A dependency graph maps every watched file to what was derived
+// from it:
+//  - the model and each side file its importer read (.mtl, .bin, ...) to the
+//    whole scene, which is re-imported here on a worker, LODs and world
+//    bounds included;
+//  - image files to their scene texture, which the texture streamer re-reads
+//    on its own decode threads.
+// A file counts as changed once a writer closes it or it is renamed into
+// place, so partial writes are never picked up. The render thread collects
+// the results between frames and swaps them in, so a frame never sees half a
+// reload.
+class HotReload {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct TextureChange {
+    uint32_t texture = 0;
+    Clock::time_point changed;
+  };
+
+  // A re-imported scene, ready to swap in
+  struct ImportedScene {
+    std::unique_ptr<Scene> scene;
+    std::vector<std::string> files; // what the importer read
+    Clock::time_point changed;      // first change it includes
+    double importMs = 0.0;
+  };
+
+  struct Stats {
+    uint32_t watchedFiles = 0;
+    uint32_t sceneReloads = 0;
+    double importMs = 0.0; // last re-import, on the worker
+  };
+
+  HotReload();
+  ~HotReload();
+
+  // False where file watching isn't available
+  bool Start();
+  void Stop();
+  bool IsRunning() const { return m_Thread.joinable(); }
+
+  // Replace the dependency graph with the files `scene` was built from.
+  // `modelPath` is empty for generated scenes, which only have texture files
+  // to watch (if any). Changes not yet taken are dropped.
+  void Track(const Scene &scene, const std::string &modelPath,
+             const std::vector<std::string> &modelFiles);
+
+  // Render thread, between frames: textures whose files changed since the
+  // last call, and the newest finished re-import of the tracked model
+  std::vector<TextureChange> TakeTextureChanges();
+  bool TakeImportedScene(ImportedScene &out);
+
+  Stats GetStats() const;
+
+private:
+  enum class Target { Scene, Texture };
+
+  struct Dependent {
+    Target target = Target::Scene;
+    uint32_t texture = 0;
+  };
+
+  void ThreadFunc();
+  void OnFileChanged(const std::string &path, Clock::time_point time);
+  void RequestImport(Clock::time_point time);
+  void ImportLoop(ThreadPool *pool, std::string path,
+                  Clock::time_point changed);
+
+  int m_Inotify = -1;
+  int m_WakeFd = -1; // signalled by Stop
+  std::thread m_Thread;
+
+  // Dependency graph, keyed by canonical path, and the directories watched
+  // for it (watching directories keeps working across rename-on-save)
+  mutable std::mutex m_Mutex;
+  std::unordered_map<std::string, std::vector<Dependent>> m_Dependents;
+  std::unordered_map<int, std::string> m_Directories;
+  std::string m_ModelPath;
+  std::vector<TextureChange> m_TextureChanges;
+
+  // Re-imports run one at a time; changes arriving meanwhile queue one more
+  std::unique_ptr<ThreadPool> m_Importer;
+  bool m_Importing = false;
+  bool m_ImportQueued = false;
+  Clock::time_point m_QueuedChange;
+  std::unique_ptr<ImportedScene> m_Imported;
+
+  uint32_t m_SceneReloads = 0;
+  std::atomic<double> m_ImportMs{0.0};
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+struct ImDrawCmd;
+struct ImDrawData;
+struct ImDrawList;
+
+// Draws ImGui's draw data in place of ImGui_ImplWGPU_RenderDrawData, for
+// UIs with hundreds of thousands of vertices:
+//  - The frame's uniforms, vertices and indices are packed into one staging
+//    block and sent with a single wgpuQueueWriteBuffer into one persistent
+//    buffer, which grows geometrically and is otherwise never recreated.
+//  - Indices are widened to 32 bits and rebased while packing, so every draw
+//    uses base vertex 0 and consecutive commands with the same texture and
+//    clip rect merge into one draw, across draw lists too.
+//  - Bind groups are cached per texture; the bind group and scissor are only
+//    set when they change.
+// Texture creation and updates (the font atlas) still go through the stock
+// backend's ImGui_ImplWGPU_UpdateTexture, so it must be initialised, and
+// user callbacks get the same ImGui_ImplWGPU_RenderState.
+class ImGuiRenderer {
+public:
+  struct Stats {
+    uint32_t vertices = 0;
+    uint32_t indices = 0;
+    uint32_t commands = 0;  // ImGui draw commands
+    uint32_t drawCalls = 0; // after merging
+    uint32_t bindGroups = 0; // cached
+    uint64_t bufferBytes = 0;
+    double cpuMs = 0.0; // packing and recording
+  };
+
+  ImGuiRenderer();
+  ~ImGuiRenderer();
+
+  bool Initialize(WGPUDevice device, WGPUQueue queue,
+                  WGPUTextureFormat targetFormat);
+  void Shutdown();
+
+  // Record `drawData` into `pass`. At most once per submit: the single
+  // buffer write would overwrite an earlier call's geometry.
+  void Render(ImDrawData *drawData, WGPURenderPassEncoder pass);
+
+  // Drop a user texture's cached bind group before its view is released
+  void ForgetTexture(WGPUTextureView view);
+
+  const Stats &GetStats() const { return m_Stats; }
+
+private:
+  // Layout must match the WGSL struct
+  struct alignas(16) Uniforms {
+    float mvp[4][4];
+    float gamma;
+    float padding[3];
+  };
+
+  // A run of merged commands, or a user callback
+  struct Batch {
+    WGPUTextureView texture = nullptr;
+    uint32_t clip[4] = {}; // x, y, width, height in framebuffer pixels
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    const ImDrawList *list = nullptr; // set for callbacks
+    const ImDrawCmd *callback = nullptr;
+  };
+
+  // Uniforms sit at the start of the buffer, vertices and indices after
+  static constexpr uint64_t kGeometryOffset = 256;
+
+  bool CreatePipeline(WGPUTextureFormat targetFormat);
+  void UpdateTextures(ImDrawData *drawData);
+  uint64_t Pack(const ImDrawData *drawData, uint64_t &indexOffset);
+  void EnsureCapacity(uint64_t size);
+  void SetupRenderState(WGPURenderPassEncoder pass, uint32_t width,
+                        uint32_t height, uint64_t indexOffset,
+                        uint64_t size);
+  WGPUBindGroup GetTextureBindGroup(WGPUTextureView view);
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+  WGPURenderPipeline m_Pipeline = nullptr;
+  WGPUBindGroupLayout m_CommonLayout = nullptr;
+  WGPUBindGroupLayout m_TextureLayout = nullptr;
+  WGPUSampler m_Sampler = nullptr;
+  float m_Gamma = 1.0f;
+
+  WGPUBuffer m_Buffer = nullptr;
+  uint64_t m_BufferSize = 0;
+  WGPUBindGroup m_CommonBindGroup = nullptr;
+  std::unordered_map<WGPUTextureView, WGPUBindGroup> m_TextureBindGroups;
+
+  // Reused every frame; only grows
+  std::vector<uint8_t> m_Staging;
+  std::vector<Batch> m_Batches;
+  Stats m_Stats;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "DrawQueue.h"
+#include "GpuCuller.h"
+#include "TextureStreamer.h"
+#include "math/Math.h"
+#include <cstdint>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+class GpuTimer;
+class Scene;
+class ThreadPool;
+
+// Draws scene objects into the renderer's main pass. All meshes share one
+// vertex and one index buffer, LODs included. Both paths pick every visible
+// object's LOD by projected screen-space error (see LodSelection). Two paths:
+//  - Draw(): per-object data for the objects that survived CPU culling is
+//    packed into a storage buffer each frame. With batching, objects are
+//    sorted through a DrawQueue and each LOD/material run becomes one
+//    instanced draw; without it, or when the scene has more materials or
+//    LODs than the sort key can hold, every object is its own draw call.
+//  - DrawGpuDriven(): per-object data stays resident on the GPU, GpuCuller
+//    fills one indirect draw per LOD/material bucket, and the vertex shader
+//    looks objects up through the compacted visible id list.
+// Base color textures come from a TextureStreamer. The CPU path feeds it the
+// screen size of every visible textured object; the GPU path has no per-object
+// visibility on the CPU, so it keeps the residency it last had.
+class MeshRenderer {
+public:
+  struct Stats {
+    uint32_t drawCalls = 0;
+    // The GPU path reads its triangle count back a frame or two late and
+    // has no full-detail figure
+    uint64_t triangles = 0;
+    uint64_t fullDetailTriangles = 0; // had every object drawn LOD 0
+    double cpuMs = 0.0;     // time spent recording the scene draws
+  };
+
+  MeshRenderer();
+  ~MeshRenderer();
+
+  bool Initialize(WGPUDevice device, WGPUQueue queue,
+                  WGPUTextureFormat colorFormat, WGPUTextureFormat depthFormat);
+  void Shutdown();
+
+  // Copy the scene's geometry to the GPU, replacing the previous upload.
+  // With `previousMeshes` (see MatchMeshes) meshes matched in the previously
+  // uploaded scene keep their place in the shared buffers and only the rest
+  // are written; a full upload happens when too much space would be wasted.
+  bool Upload(const Scene &scene,
+              const std::vector<uint32_t> *previousMeshes = nullptr);
+
+  // Record draws for `visible` (indices into scene.GetObjects())
+  void Draw(WGPURenderPassEncoder pass, const Scene &scene,
+            const Mat4 &viewProj, Vec3 cameraPos,
+            const std::vector<uint32_t> &visible, bool batching = true,
+            ThreadPool *pool = nullptr);
+
+  // Cull on the GPU and record one indirect draw per bucket. Uploads the rows
+  // of objects that moved in the last Scene::Update. The culling passes are
+  // timed as in GpuCuller::Cull.
+  void DrawGpuDriven(WGPURenderPassEncoder pass, const Scene &scene,
+                     const Mat4 &viewProj, Vec3 cameraPos, bool frustumCulling,
+                     bool occlusionCulling, GpuTimer *timer = nullptr,
+                     uint32_t firstScope = 0);
+
+  // Depth buffer of the main pass, source of the hi-Z pyramid. Its height
+  // also scales the texture streaming feedback.
+  void SetDepthTexture(WGPUTexture depth, uint32_t width, uint32_t height);
+
+  // Disabled draws LOD 0 everywhere. `pixelError` is the screen-space error
+  // allowed before a finer level is needed.
+  void SetLodSettings(bool enabled, float pixelError);
+
+  TextureStreamer &GetTextureStreamer() { return m_Textures; }
+  const TextureStreamer &GetTextureStreamer() const { return m_Textures; }
+
+  const Stats &GetStats() const { return m_Stats; }
+  const DrawQueue::Stats &GetBatchStats() const { return m_DrawQueue.GetStats(); }
+  GpuCuller::Stats GetGpuCullStats() const { return m_Culler.GetStats(); }
+
+private:
+  struct GpuMesh {
+    int32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0; // of the range holding every LOD
+    uint32_t indexCount = 0;
+    uint32_t firstLod = 0; // into m_Lods
+    uint32_t lodCount = 0;
+  };
+
+  struct GpuLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f; // object space
+  };
+
+  struct alignas(16) CameraUniforms {
+    Mat4 viewProj;
+    Vec4 cameraPos;
+    Vec4 lightDir;
+  };
+
+  struct alignas(16) InstanceData {
+    Mat4 model;
+    Vec4 color;
+  };
+
+  // Rebuilt when the streamed view of its texture changes
+  struct MaterialBinding {
+    WGPUBindGroup bindGroup = nullptr;
+    uint32_t texture = kNoTexture;
+    uint32_t version = 0;
+  };
+
+  // Dynamic uniform offsets must be 256-byte aligned
+  static constexpr uint64_t kDrawInfoStride = 256;
+
+  bool CreatePipeline(WGPUTextureFormat colorFormat,
+                      WGPUTextureFormat depthFormat);
+  void CreateIndirectBindGroups();
+  void EnsureInstanceCapacity(size_t count);
+  void WriteCameraUniforms(const Mat4 &viewProj, Vec3 cameraPos);
+  void UploadInstances(const Scene &scene, const std::vector<uint32_t> &objects,
+                       ThreadPool *pool);
+  void ReleaseBindings();
+  void ReleaseGeometry();
+  bool UploadGeometry(const Scene &scene);
+  bool UpdateGeometry(const Scene &scene,
+                      const std::vector<uint32_t> &previousMeshes);
+  bool GrowBuffer(WGPUBuffer &buffer, uint64_t &size, uint64_t needed,
+                  uint64_t used, const char *label, WGPUBufferUsage usage);
+  LodSelection GetLodSelection(const Mat4 &viewProj) const;
+  void SelectLods(const Scene &scene, Vec3 cameraPos,
+                  const LodSelection &selection,
+                  const std::vector<uint32_t> &visible, ThreadPool *pool);
+  void GatherTextureFeedback(const Scene &scene, const Mat4 &viewProj,
+                             const std::vector<uint32_t> &visible);
+  void UpdateMaterialBindGroups(const Scene &scene);
+  WGPUBindGroup GetMaterialBindGroup(uint32_t material) const;
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+  WGPURenderPipeline m_Pipeline = nullptr;
+  WGPUBindGroupLayout m_BindGroupLayout = nullptr;
+  WGPUBindGroup m_BindGroup = nullptr;
+  WGPUBindGroupLayout m_MaterialLayout = nullptr;
+  // One per scene material plus an untextured fallback at the end
+  std::vector<MaterialBinding> m_MaterialBindings;
+  TextureStreamer m_Textures;
+  float m_ViewportHeight = 0.0f;
+
+  WGPURenderPipeline m_IndirectPipeline = nullptr;
+  WGPUBindGroupLayout m_IndirectLayouts[2] = {};
+  WGPUBindGroup m_IndirectBindGroup = nullptr;
+  WGPUBindGroup m_DrawInfoBindGroup = nullptr;
+  WGPUBuffer m_DrawInfoBuffer = nullptr;
+  GpuCuller m_Culler;
+  bool m_GpuObjectsCurrent = false;
+
+  WGPUBuffer m_VertexBuffer = nullptr;
+  WGPUBuffer m_IndexBuffer = nullptr;
+  WGPUBuffer m_UniformBuffer = nullptr;
+  WGPUBuffer m_InstanceBuffer = nullptr;
+  uint64_t m_VertexBufferSize = 0;
+  uint64_t m_IndexBufferSize = 0;
+  // Elements allocated so far, including ranges of meshes a reload removed
+  uint64_t m_VertexEnd = 0;
+  uint64_t m_IndexEnd = 0;
+  size_t m_InstanceCapacity = 0;
+
+  std::vector<GpuMesh> m_Meshes;
+  std::vector<GpuLod> m_Lods;
+  // Current LOD of every object on the CPU path; the GPU path keeps its own
+  std::vector<uint8_t> m_ObjectLods;
+  bool m_KeysFit = true; // materials and LODs fit DrawQueue's key fields
+  bool m_LodEnabled = true;
+  float m_LodPixelError = 1.0f;
+  std::vector<InstanceData> m_InstanceStaging;
+  DrawQueue m_DrawQueue;
+  std::vector<uint32_t> m_SortedObjects;
+  Stats m_Stats;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+class GpuTimer;
+
+// HDR scene target and the compute chain that turns it into the displayed
+// image:
+//  - Bloom: a thresholded downsample chain and a tent-filtered upsample chain
+//    back to half resolution. Both kernels stage their source texels in
+//    workgroup memory; the threshold is fused into the first downsample.
+//  - Tonemap: bloom composite, exposure and ACES in one pass, writing
+//    sRGB-encoded LDR colour with luma in alpha for FXAA.
+//  - FXAA: reads its 3x3 luma neighbourhood from workgroup memory and only
+//    samples along the edge direction for pixels that need it.
+// Composite() then draws the result into a render pass on the surface,
+// upscaling when the target is smaller, and the UI goes on top at native
+// resolution. Every stage can be switched off and is timed as its own pass.
+class PostProcessor {
+public:
+  // Stage i is timed as GpuTimer scope firstScope + i
+  enum Stage : uint32_t { kStageBloom, kStageTonemap, kStageFxaa, kStageCount };
+
+  struct Settings {
+    bool bloom = true;
+    bool tonemap = true;
+    bool fxaa = true;
+    float exposure = 1.0f;
+    float bloomThreshold = 1.0f;
+    float bloomKnee = 0.5f;
+    float bloomIntensity = 0.08f;
+  };
+
+  static constexpr WGPUTextureFormat kHdrFormat = WGPUTextureFormat_RGBA16Float;
+  static constexpr WGPUTextureFormat kOutputFormat = WGPUTextureFormat_RGBA8Unorm;
+
+  PostProcessor();
+  ~PostProcessor();
+
+  bool Initialize(WGPUDevice device, WGPUQueue queue,
+                  WGPUTextureFormat outputFormat);
+  void Shutdown();
+
+  // (Re)create the HDR target and every intermediate for a new size
+  void Resize(uint32_t width, uint32_t height);
+
+  WGPUTextureView GetHdrView() const { return m_HdrView; }
+  uint32_t GetWidth() const { return m_Width; }
+  uint32_t GetHeight() const { return m_Height; }
+
+  Settings &GetSettings() { return m_Settings; }
+  const Settings &GetSettings() const { return m_Settings; }
+
+  // Record the enabled stages. The scene pass must have ended.
+  void Apply(WGPUCommandEncoder encoder, GpuTimer *timer, uint32_t firstScope);
+
+  // Draw the processed image over the whole of `pass`, upscaled to its size
+  void Composite(WGPURenderPassEncoder pass);
+
+  // The last Apply's final image (CopySrc usage), before compositing
+  WGPUTexture GetOutputTexture() const {
+    return m_FxaaApplied ? m_Output : m_Ldr;
+  }
+
+  // CPU time spent recording the last Apply
+  double GetCpuMs() const { return m_CpuMs; }
+
+private:
+  // Layout must match the WGSL struct
+  struct alignas(16) PostUniforms {
+    float exposure;
+    float bloomThreshold;
+    float bloomKnee;
+    float bloomIntensity;
+    uint32_t flags;
+    uint32_t padding[3];
+  };
+
+  static constexpr uint32_t kMaxBloomLevels = 6;
+
+  bool CreatePipelines(WGPUTextureFormat outputFormat);
+  void ReleaseTargets();
+  void CreateBindGroups();
+  WGPUComputePassEncoder BeginPass(WGPUCommandEncoder encoder, const char *label,
+                                   GpuTimer *timer, uint32_t scope);
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+  Settings m_Settings;
+  double m_CpuMs = 0.0;
+  bool m_FxaaApplied = false; // Composite shows m_Output rather than m_Ldr
+
+  WGPUComputePipeline m_PrefilterPipeline = nullptr;
+  WGPUComputePipeline m_DownsamplePipeline = nullptr;
+  WGPUComputePipeline m_UpsamplePipeline = nullptr;
+  WGPUComputePipeline m_TonemapPipeline = nullptr;
+  WGPUComputePipeline m_FxaaPipeline = nullptr;
+  WGPURenderPipeline m_CompositePipeline = nullptr;
+  WGPUBindGroupLayout m_DownLayout = nullptr;
+  WGPUBindGroupLayout m_UpLayout = nullptr;
+  WGPUBindGroupLayout m_TonemapLayout = nullptr;
+  WGPUBindGroupLayout m_FxaaLayout = nullptr;
+  WGPUBindGroupLayout m_CompositeLayout = nullptr;
+  WGPUSampler m_LinearSampler = nullptr;
+  WGPUBuffer m_UniformBuffer = nullptr;
+
+  // Targets
+  uint32_t m_Width = 0;
+  uint32_t m_Height = 0;
+  WGPUTexture m_Hdr = nullptr;
+  WGPUTextureView m_HdrView = nullptr;
+  WGPUTexture m_BloomDown = nullptr; // level i is 1/2^(i+1) of the target
+  WGPUTexture m_BloomUp = nullptr;   // one level fewer than m_BloomDown
+  std::vector<WGPUTextureView> m_BloomDownViews;
+  std::vector<WGPUTextureView> m_BloomUpViews;
+  WGPUTexture m_Ldr = nullptr;       // tonemapped
+  WGPUTextureView m_LdrView = nullptr;
+  WGPUTexture m_Output = nullptr;    // anti-aliased
+  WGPUTextureView m_OutputView = nullptr;
+
+  std::vector<WGPUBindGroup> m_DownBindGroups; // per bloom level
+  std::vector<WGPUBindGroup> m_UpBindGroups;   // per upsampled level
+  WGPUBindGroup m_TonemapBindGroup = nullptr;
+  WGPUBindGroup m_FxaaBindGroup = nullptr;
+  WGPUBindGroup m_CompositeLdrBindGroup = nullptr;
+  WGPUBindGroup m_CompositeOutputBindGroup = nullptr;
+};
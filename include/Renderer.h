@@ -1,11 +1,25 @@
 #pragma once
 
+#include "math/Math.h"
 #include <SDL3/SDL.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <webgpu/webgpu_cpp.h>
 
 // Forward declarations for ImGui
 struct ImDrawData;
 
+class DynamicResolution;
+class FrameCapture;
+class GpuTimer;
+class ImGuiRenderer;
+class MeshRenderer;
+class PostProcessor;
+class Scene;
+class ThreadPool;
+
 class Renderer {
 public:
   Renderer();
@@ -24,14 +38,93 @@ public:
   // End frame and present
   void EndFrame();
 
-  // Render ImGui draw data
+  // Upload scene geometry (call before the render thread starts). See
+  // MeshRenderer::Upload for `previousMeshes`.
+  bool UploadScene(const Scene &scene,
+                   const std::vector<uint32_t> *previousMeshes = nullptr);
+
+  // Draw the given scene objects into the current frame, merging objects
+  // that share mesh and material into instanced draws when batching
+  void RenderScene(const Scene &scene, const Mat4 &viewProj, Vec3 cameraPos,
+                   const std::vector<uint32_t> &visibleObjects,
+                   bool batching = true, ThreadPool *pool = nullptr);
+
+  // Cull on the GPU and draw every surviving object through indirect draws
+  void RenderSceneGpuDriven(const Scene &scene, const Mat4 &viewProj,
+                            Vec3 cameraPos, bool frustumCulling,
+                            bool occlusionCulling);
+
+  // Render ImGui draw data on top of the post-processed scene, at the
+  // surface's resolution
   void RenderImGui(ImDrawData *drawData);
 
+  // Draw the UI with ImGui_ImplWGPU_RenderDrawData instead of ImGuiRenderer,
+  // to compare the two
+  void SetStockImGuiRenderer(bool stock) { m_StockImGui = stock; }
+  bool IsStockImGuiRenderer() const { return m_StockImGui; }
+  const ImGuiRenderer *GetImGuiRenderer() const {
+    return m_ImGuiRenderer.get();
+  }
+
   // Clear color
   void SetClearColor(float r, float g, float b, float a);
 
   // Get device info
   WGPUDevice GetDevice() const { return m_Device; }
+  WGPUQueue GetQueue() const { return m_Queue; }
+  WGPUTextureFormat GetSurfaceFormat() const { return m_SurfaceConfig.format; }
+  int GetWidth() const { return m_Width; }
+  int GetHeight() const { return m_Height; }
+
+  // Size of the scene target: the surface size times the dynamic resolution
+  // scale
+  int GetRenderWidth() const { return m_RenderWidth; }
+  int GetRenderHeight() const { return m_RenderHeight; }
+
+  // Draw calls issued by the last RenderScene
+  uint32_t GetSceneDrawCalls() const;
+
+  MeshRenderer *GetMeshRenderer() { return m_MeshRenderer.get(); }
+  const MeshRenderer *GetMeshRenderer() const { return m_MeshRenderer.get(); }
+
+  PostProcessor *GetPostProcessor() { return m_PostProcessor.get(); }
+  DynamicResolution *GetDynamicResolution() {
+    return m_DynamicResolution.get();
+  }
+  FrameCapture *GetFrameCapture() { return m_FrameCapture.get(); }
+
+  // For compute work the UI submits itself, such as TimeSeriesPlot::Prepare:
+  // timed as scope kUiComputeScope and reported as FrameTimings::uiComputeMs
+  static constexpr uint32_t kUiComputeScope = 15;
+  GpuTimer *GetGpuTimer() { return m_GpuTimer.get(); }
+
+  // Whether captures include the UI: the surface can be copied from.
+  // Otherwise the post-processed scene is captured at render resolution.
+  bool CanCaptureSurface() const { return m_SurfaceCopySrc; }
+
+  // GPU pass times in milliseconds, a frame or two behind; zero without
+  // timestamp query support or for stages that were switched off
+  struct FrameTimings {
+    double sceneMs = 0.0;
+    double bloomMs = 0.0;
+    double tonemapMs = 0.0;
+    double fxaaMs = 0.0;
+    double compositeMs = 0.0;
+    double cullMs = 0.0;      // hi-Z build and culling, GPU-driven path only
+    double uiComputeMs = 0.0; // e.g. plot reductions
+    double postCpuMs = 0.0; // recording the post chain
+    double uiCpuMs = 0.0;   // recording the UI, either renderer
+    double cpuFrameMs = 0.0; // BeginFrame to BeginFrame
+    bool gpuTimestamps = false;
+
+    double GpuTotalMs() const {
+      return sceneMs + bloomMs + tonemapMs + fxaaMs + compositeMs + cullMs +
+             uiComputeMs;
+    }
+  };
+  FrameTimings GetFrameTimings() const;
+
+  static constexpr WGPUTextureFormat kDepthFormat = WGPUTextureFormat_Depth32Float;
 
 private:
   bool InitializeWebGPU(SDL_Window *window);
@@ -40,6 +133,14 @@ private:
   WGPUDevice RequestDevice(wgpu::Instance &instance, wgpu::Adapter &adapter);
   WGPUSurface CreateSurface(const WGPUInstance &instance, SDL_Window *window);
   void ConfigureSurface();
+  void CreateDepthTexture();
+
+  // Resize the scene targets when the render scale or surface changed
+  void UpdateRenderTargets();
+
+  // End the scene pass, run the post chain and begin the composite pass on
+  // the surface. Does nothing once the composite pass is open.
+  void FinishScene();
 
   // WebGPU handles
   WGPUInstance m_Instance = nullptr;
@@ -48,17 +149,34 @@ private:
   WGPUSurface m_Surface = nullptr;
   WGPUQueue m_Queue = nullptr;
   WGPUSurfaceConfiguration m_SurfaceConfig = {};
+  bool m_SurfaceCopySrc = false;
+  WGPUTexture m_DepthTexture = nullptr;
+  WGPUTextureView m_DepthView = nullptr;
+
+  std::unique_ptr<MeshRenderer> m_MeshRenderer;
+  std::unique_ptr<PostProcessor> m_PostProcessor;
+  std::unique_ptr<GpuTimer> m_GpuTimer;
+  std::unique_ptr<DynamicResolution> m_DynamicResolution;
+  std::unique_ptr<FrameCapture> m_FrameCapture;
+  std::unique_ptr<ImGuiRenderer> m_ImGuiRenderer;
+  bool m_StockImGui = false;
 
   // Rendering state
   int m_Width = 0;
   int m_Height = 0;
+  int m_RenderWidth = 0;
+  int m_RenderHeight = 0;
+  std::chrono::high_resolution_clock::time_point m_LastFrameStart;
+  double m_CpuFrameMs = 0.0;
+  double m_UiCpuMs = 0.0;
   float m_ClearColor[4] = {0.45f, 0.55f, 0.60f, 1.00f};
 
   // Current frame resources
   WGPUSurfaceTexture m_CurrentSurfaceTexture = {};
   WGPUTextureView m_CurrentTextureView = nullptr;
   WGPUCommandEncoder m_CurrentEncoder = nullptr;
-  WGPURenderPassEncoder m_CurrentRenderPass = nullptr;
+  WGPURenderPassEncoder m_CurrentRenderPass = nullptr; // scene, into HDR
+  WGPURenderPassEncoder m_CompositePass = nullptr;     // surface, with UI
 
   bool m_IsFrameStarted = false;
 };
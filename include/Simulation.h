@@ -0,0 +1,104 @@
+#pragma once
+
+#include "math/Math.h"
+#include "utilities/ThreadPool.h"
+#include "utilities/TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-timestep simulation on its own thread. Each tick advances the
+// animated objects by exactly 1 / tickRate seconds, with the per-object work
+// spread over a private thread pool, then publishes an immutable snapshot of
+// the last two ticks through a triple buffer. The render thread picks up the
+// newest snapshot without waiting and interpolates between its two states, so
+// neither thread's rate affects the other. Ticks are scheduled against the
+// wall clock; a simulation that falls behind catches up a few ticks at a
+// time and then skips ahead rather than spiralling.
+class Simulation {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Snapshot {
+    uint64_t generation = 0; // which Reset this state belongs to
+    uint64_t tick = 0;
+    Clock::time_point tickTime; // wall-clock time `current` belongs to
+    double tickSeconds = 0.0;   // simulated time between the two states
+    std::vector<Vec3> previous;
+    std::vector<Vec3> current;
+  };
+
+  struct Stats {
+    uint64_t ticks = 0;
+    uint32_t skippedTicks = 0; // dropped after falling too far behind
+    double tickMs = 0.0;       // last tick's work
+  };
+
+  Simulation();
+  ~Simulation();
+
+  void Start();
+  void Stop();
+
+  // Replace the simulated objects: each bobs vertically from its position
+  // with its own phase. Applied by the simulation thread before its next
+  // tick; returns the generation its snapshots will carry.
+  uint64_t Reset(std::vector<Vec3> positions, std::vector<float> phases);
+
+  void SetTickRate(float hz) { m_TickRate = hz; }
+  float GetTickRate() const { return m_TickRate; }
+  void SetPaused(bool paused) { m_Paused = paused; }
+
+  // Render thread: pick up the newest snapshot, if any was published
+  bool Acquire() { return m_Snapshots.acquire(); }
+  const Snapshot &GetSnapshot() const { return m_Snapshots.read_buffer(); }
+
+  // Interpolation factor between the snapshot's states for rendering at
+  // `now`, one tick behind the simulation
+  static float GetBlend(const Snapshot &snapshot, Clock::time_point now);
+
+  Stats GetStats() const;
+
+private:
+  // Catch up at most this many ticks before skipping ahead
+  static constexpr uint32_t kMaxCatchUpTicks = 4;
+
+  void ThreadFunc();
+  void ApplyPendingReset();
+  void Step(double dt);
+  void Publish(Clock::time_point tickTime, double dt);
+
+  std::thread m_Thread;
+  std::unique_ptr<ThreadPool> m_Pool;
+  std::atomic<bool> m_Running{false};
+  std::atomic<float> m_TickRate{60.0f};
+  std::atomic<bool> m_Paused{false};
+  std::mutex m_WakeMutex;
+  std::condition_variable m_Wake;
+
+  // Handed from Reset to the simulation thread
+  std::mutex m_ResetMutex;
+  std::vector<Vec3> m_PendingPositions;
+  std::vector<float> m_PendingPhases;
+  uint64_t m_PendingGeneration = 0;
+  bool m_ResetPending = false;
+
+  // Simulation thread state
+  uint64_t m_Generation = 0;
+  uint64_t m_Tick = 0;
+  double m_Time = 0.0;
+  std::vector<Vec3> m_Previous;
+  std::vector<Vec3> m_Current;
+  std::vector<float> m_Phases;
+
+  TripleBuffer<Snapshot> m_Snapshots;
+
+  std::atomic<uint64_t> m_Ticks{0};
+  std::atomic<uint32_t> m_SkippedTicks{0};
+  std::atomic<double> m_TickMs{0.0};
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "scene/Scene.h"
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+// Block layout of a texture format; uncompressed formats are 1x1 blocks
+struct TextureFormatInfo {
+  uint32_t blockWidth = 1;
+  uint32_t blockHeight = 1;
+  uint32_t bytesPerBlock = 4;
+};
+
+TextureFormatInfo GetTextureFormatInfo(WGPUTextureFormat format);
+
+// Block-compressed formats the device can sample, which decide what KTX2
+// textures are transcoded to, and where transcoded chains are cached
+struct TextureDecodeOptions {
+  bool bc = false;
+  bool etc2 = false;
+  bool astc = false;
+  std::filesystem::path cacheDirectory; // empty disables the cache
+};
+
+// Levels in a full chain down to 1x1
+uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+// Bytes of one level with tightly packed block rows
+uint64_t GetMipSize(WGPUTextureFormat format, uint32_t width, uint32_t height);
+
+// Bytes of levels [firstMip, mipCount) of a width x height texture
+uint64_t GetMipChainSize(WGPUTextureFormat format, uint32_t width,
+                         uint32_t height, uint32_t firstMip);
+
+// Coarsest level a texture can be allocated from. Block-compressed textures
+// need whole blocks at their base level, so this stops at the first level
+// that isn't a multiple of the block size.
+uint32_t GetMaxBaseMip(WGPUTextureFormat format, uint32_t width,
+                       uint32_t height);
+
+struct TextureMip {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> data; // tightly packed block rows
+};
+
+// The tail of a mip chain, finest level first
+struct DecodedTexture {
+  WGPUTextureFormat format = WGPUTextureFormat_RGBA8UnormSrgb;
+  uint32_t width = 0; // size of level 0, which may not be included
+  uint32_t height = 0;
+  uint32_t firstMip = 0; // level of mips[0]
+  std::vector<TextureMip> mips;
+};
+
+// Read the level 0 size and the format DecodeTexture will produce, without
+// decoding pixels
+bool ProbeTexture(const TextureSource &source,
+                  const TextureDecodeOptions &options, uint32_t &width,
+                  uint32_t &height, WGPUTextureFormat &format);
+
+// Decode the image and build its chain from `firstMip` down to 1x1. KTX2
+// files are transcoded to the best block format in `options`; other images
+// are filtered with an sRGB-correct box filter into RGBA8. Safe to call from
+// several threads at once.
+bool DecodeTexture(const TextureSource &source,
+                   const TextureDecodeOptions &options, uint32_t firstMip,
+                   DecodedTexture &out);
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "TextureLoader.h"
+#include "utilities/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+class Scene;
+
+// Keeps part of every scene texture's mip chain resident under a memory
+// budget. Each frame the renderer reports how many pixels each texture covers
+// on screen; the streamer turns that into a wanted mip, drops the same number
+// of levels from every texture until the wanted set fits the budget, and then
+// raises or lowers residency towards it:
+//  - Raising decodes the image on a worker thread, then uploads the new levels
+//    coarsest first through a ring of staging buffers. A level becomes
+//    visible as soon as it is uploaded.
+//  - Lowering copies the levels that stay into a smaller texture on the GPU.
+// The small tail of each chain is always resident and is what gets loaded
+// first. KTX2 textures stay block-compressed in whatever format the device
+// supports, with transcoded chains cached on disk. Nothing here waits on the
+// GPU or on a worker; work that can't proceed is retried on the next frame.
+class TextureStreamer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    uint32_t textures = 0;
+    uint64_t residentBytes = 0; // allocated texture memory
+    uint64_t wantedBytes = 0;   // what the feedback asks for, before the budget
+    uint64_t budgetBytes = 0;
+    uint32_t budgetBias = 0;      // levels dropped from every texture to fit
+    uint32_t pendingRequests = 0; // decodes queued or running
+    uint32_t pendingUploads = 0;  // decoded textures still being uploaded
+    uint32_t mipBiasMisses = 0;   // textures drawn coarser than they wanted
+    uint64_t uploadedBytes = 0;   // this frame
+    uint32_t compressedTextures = 0;
+    uint64_t uncompressedBytes = 0; // residentBytes if everything were RGBA8
+    uint32_t reloads = 0;
+    double reloadMs = 0.0; // last reload, file change to new image on screen
+  };
+
+  TextureStreamer();
+  ~TextureStreamer();
+
+  // Block formats are enabled from the device's features. Transcoded KTX2
+  // chains are cached under RENDERER_TEXTURE_CACHE, or a temp directory.
+  bool Initialize(WGPUDevice device, WGPUQueue queue);
+  void Shutdown();
+
+  // Stream the scene's textures. Those whose source is unchanged from the
+  // previous set keep their residency and any work in flight, under their new
+  // index; the rest of the previous set is dropped.
+  void SetTextures(const Scene &scene);
+
+  // Re-read a texture whose file changed at `changed`. The old image stays
+  // bound until the new one's whole tail is uploaded, which may take a few
+  // Updates; if the new file can't be read the old image is kept.
+  void Reload(uint32_t texture, Clock::time_point changed);
+
+  // Feedback: `texture` is drawn about `pixels` texels wide on screen. The
+  // finest request since the last Update wins.
+  void RequestSize(uint32_t texture, float pixels);
+
+  // Once per frame, before any bind group is built from GetView. Without
+  // feedback (e.g. the GPU-driven path) the last wanted mips are kept.
+  void Update(bool feedbackValid);
+
+  // Resident levels of a texture, or a 1x1 white texture while nothing is
+  // resident. The version changes whenever the view does.
+  WGPUTextureView GetView(uint32_t texture) const;
+  uint32_t GetVersion(uint32_t texture) const;
+  WGPUSampler GetSampler() const { return m_Sampler; }
+
+  void SetBudget(uint64_t bytes) { m_Budget = bytes; }
+  uint64_t GetBudget() const { return m_Budget; }
+  const Stats &GetStats() const { return m_Stats; }
+
+private:
+  // Levels no larger than this are always resident
+  static constexpr uint32_t kTailSize = 64;
+  static constexpr uint32_t kStagingBuffers = 4;
+  static constexpr uint64_t kStagingSize = 4 << 20;
+  static constexpr uint64_t kMaxUploadBytesPerFrame = 8 << 20;
+  static constexpr uint32_t kMaxDecodesInFlight = 4;
+  // Frames a texture keeps its wanted mip after it was last seen
+  static constexpr uint64_t kFeedbackHoldFrames = 120;
+
+  struct Entry {
+    std::shared_ptr<const TextureSource> source;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    WGPUTextureFormat format = WGPUTextureFormat_RGBA8UnormSrgb;
+    uint32_t mipCount = 0; // 0 when the image couldn't be read
+    uint32_t tailMip = 0;
+    WGPUTexture texture = nullptr;
+    WGPUTextureView view = nullptr;
+    uint32_t allocatedMip = 0; // level 0 of `texture`
+    uint32_t residentMip = 0;  // finest uploaded level; mipCount when none
+    uint32_t frameMip = 0;     // finest level asked for since the last Update
+    uint32_t wantedMip = 0;
+    uint32_t targetMip = 0;
+    uint64_t lastSeen = 0;
+    bool busy = false; // decode or upload in progress
+    uint32_t version = 0;
+    uint32_t serial = 0; // bumped by Reload; older decodes are dropped
+    bool reloading = false; // until the reloaded image's tail is up
+    Clock::time_point reloadTime;
+    // The image a reload replaces, bound instead of the new one until then
+    WGPUTexture oldTexture = nullptr;
+    WGPUTextureView oldView = nullptr;
+  };
+
+  struct DecodeResult {
+    // Identifies the entry, which SetTextures may have moved or dropped
+    std::shared_ptr<const TextureSource> source;
+    uint32_t texture = 0;
+    uint32_t serial = 0;
+    bool reload = false; // probed afresh; the entry is reset to its size
+    bool ok = false;
+    DecodedTexture data;
+  };
+
+  // A decoded texture being copied into its new allocation level by level
+  struct Upload {
+    uint32_t texture = 0;
+    DecodedTexture data;
+    int level = -1; // index into data.mips, counts down to 0
+    uint32_t row = 0; // next block row of that level
+  };
+
+  struct Staging {
+    WGPUBuffer buffer = nullptr;
+    std::atomic<bool> mapped{false};
+    std::atomic<bool> failed{false}; // last map failed; retried next Update
+  };
+
+  static uint32_t GetTailMip(WGPUTextureFormat format, uint32_t width,
+                             uint32_t height);
+  static void ResetEntry(Entry &entry, uint32_t width, uint32_t height,
+                         WGPUTextureFormat format);
+  void ReleaseTextures();
+  void CollectDecodes(WGPUCommandEncoder encoder);
+  void PumpUploads(WGPUCommandEncoder encoder, std::vector<Staging *> &used);
+  void ChooseTargets();
+  void RequestDecode(uint32_t index, uint32_t firstMip);
+  void Reallocate(WGPUCommandEncoder encoder, Entry &entry, uint32_t firstMip);
+  void UpdateView(Entry &entry);
+  void FinishReload(Entry &entry);
+  static void ReleaseImages(Entry &entry);
+  uint64_t ResidentBytes(const Entry &entry) const;
+  static void OnStagingMapped(WGPUMapAsyncStatus status, WGPUStringView message,
+                              void *userdata1, void *userdata2);
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+  WGPUSampler m_Sampler = nullptr;
+  WGPUTexture m_DefaultTexture = nullptr;
+  WGPUTextureView m_DefaultView = nullptr;
+  TextureDecodeOptions m_DecodeOptions;
+
+  std::vector<Entry> m_Entries;
+  std::deque<Upload> m_Uploads;
+  Staging m_Staging[kStagingBuffers];
+  uint32_t m_StagingIndex = 0;
+
+  // Decodes run on their own threads so a long decode can never hold up a
+  // parallel_for on the shared job pool
+  std::unique_ptr<ThreadPool> m_Decoder;
+  std::mutex m_ResultMutex;
+  std::vector<DecodeResult> m_Results;
+  uint32_t m_DecodesInFlight = 0;
+
+  uint64_t m_Budget = 256ull << 20;
+  uint64_t m_Frame = 0;
+  Stats m_Stats;
+};
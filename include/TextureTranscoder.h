@@ -0,0 +1,28 @@
+#pragma once
+
+#include "TextureLoader.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+// KTX2 containers holding Basis Universal (ETC1S or UASTC) data. Only the
+// first layer and face are used.
+
+// True when `data` starts with the KTX2 file identifier
+bool IsKtx2(const uint8_t *data, size_t size);
+
+// Level 0 size and the format TranscodeKtx2 will produce: the best block
+// format in `options`, or RGBA8 when none is supported, the chain is
+// incomplete or level 0 isn't whole blocks
+bool ProbeKtx2(const std::string &name, const std::vector<uint8_t> &data,
+               const TextureDecodeOptions &options, uint32_t &width,
+               uint32_t &height, WGPUTextureFormat &format);
+
+// Transcode levels `firstMip` and coarser. Block formats go through the disk
+// cache in `options`, which holds whole chains. For RGBA8 only level 0 is
+// returned, for the caller to filter into a chain.
+bool TranscodeKtx2(const std::string &name, const std::vector<uint8_t> &data,
+                   const TextureDecodeOptions &options, uint32_t firstMip,
+                   DecodedTexture &out);
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <webgpu/webgpu.h>
+
+class GpuTimer;
+struct ImDrawCmd;
+struct ImDrawList;
+
+// An ImGui plot widget for series too long for ImGui's CPU draw lists. The
+// samples live in a GPU storage buffer that grows geometrically and becomes
+// a ring of the newest kMaxSamples once full; Append only copies to the GPU
+// what is new. When the visible range or pixel width changes, a compute pass
+// reduces the visible samples to a min/max pair per pixel column and folds
+// those into the range the plot is scaled to. A draw callback inside the UI
+// pass fills each column's span, so drawing costs the same for a thousand
+// samples as for ten million. The mouse wheel zooms,
+// dragging pans and double-clicking goes back to showing everything.
+class TimeSeriesPlot {
+public:
+  // 128 MB of floats, the default storage buffer binding limit
+  static constexpr uint32_t kMaxSamples = 32u << 20;
+  static constexpr uint32_t kMaxColumns = 4096;
+
+  struct Stats {
+    uint64_t appended = 0; // ever, including overwritten samples
+    uint32_t stored = 0;
+    uint32_t visible = 0;
+    uint32_t columns = 0;
+    uint32_t reductions = 0; // compute dispatches so far
+    uint64_t bufferBytes = 0;
+  };
+
+  TimeSeriesPlot();
+  ~TimeSeriesPlot();
+
+  TimeSeriesPlot(const TimeSeriesPlot &) = delete;
+  TimeSeriesPlot &operator=(const TimeSeriesPlot &) = delete;
+
+  bool Initialize(WGPUDevice device, WGPUQueue queue,
+                  WGPUTextureFormat targetFormat);
+  void Shutdown();
+
+  // Queue samples for the next Prepare; safe from any thread
+  void Append(const float *values, size_t count);
+  // Drop every sample, queued ones included
+  void Clear();
+
+  // The widget, once per frame at most; a size of 0 fills the available
+  // width or uses a default height. Samples appended since the last Prepare
+  // show up next frame.
+  void Plot(const char *label, float width = 0.0f, float height = 0.0f);
+
+  // Upload queued samples and run the reduction; after the UI is built and
+  // before its draw data is rendered. Submits its own commands, timing the
+  // reduction as `timer` scope `scope` when given.
+  void Prepare(GpuTimer *timer = nullptr, uint32_t scope = 0);
+
+  void SetColor(float r, float g, float b, float a);
+  const Stats &GetStats() const { return m_Stats; }
+
+private:
+  // Layouts must match the WGSL structs
+  struct ReduceParams {
+    uint32_t base; // ring index of the oldest sample
+    uint32_t first; // relative to the oldest
+    uint32_t count;
+    uint32_t columns;
+    uint32_t capacity;
+    uint32_t padding[3];
+  };
+  struct alignas(16) DrawParams {
+    float rect[4]; // x0, y0, x1, y1 in clip space
+    float color[4];
+    uint32_t columns;
+    float height; // pixels
+  };
+
+  // What the last Plot showed, for Prepare and the draw callback
+  struct Frame {
+    bool visible = false; // plotted since the last Prepare
+    bool ready = false;   // reduced and safe to draw
+    float rect[4] = {};   // framebuffer pixels
+    float framebuffer[2] = {};
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t columns = 0;
+  };
+
+  static void DrawCallback(const ImDrawList *list, const ImDrawCmd *cmd);
+  static void OnRangeMapped(WGPUMapAsyncStatus status, WGPUStringView message,
+                            void *userdata1, void *userdata2);
+
+  bool CreatePipelines(WGPUTextureFormat targetFormat);
+  // Grow to hold `samples` (at most kMaxSamples), keeping what is stored
+  void EnsureCapacity(uint32_t samples);
+  void Upload(const std::vector<float> &values);
+  void Draw(WGPURenderPassEncoder pass, const ImDrawCmd *cmd);
+
+  WGPUDevice m_Device = nullptr;
+  WGPUQueue m_Queue = nullptr;
+  WGPUComputePipeline m_ReducePipeline = nullptr;
+  WGPUComputePipeline m_RangePipeline = nullptr;
+  WGPURenderPipeline m_DrawPipeline = nullptr;
+  WGPUBindGroupLayout m_ReduceLayout = nullptr;
+  WGPUBindGroupLayout m_DrawLayout = nullptr;
+  WGPUBuffer m_ReduceUniforms = nullptr;
+  WGPUBuffer m_DrawUniforms = nullptr;
+  WGPUBuffer m_Columns = nullptr; // vec2f min/max per column
+  WGPUBuffer m_Range = nullptr;   // vec2f min/max over every column
+  WGPUBindGroup m_ReduceBindGroup = nullptr;
+  WGPUBindGroup m_DrawBindGroup = nullptr;
+  float m_Gamma = 1.0f;
+
+  // Sample ring; linear until it first reaches kMaxSamples
+  WGPUBuffer m_Samples = nullptr;
+  uint32_t m_Capacity = 0;
+  uint32_t m_Stored = 0;
+  uint32_t m_Head = 0; // next write
+
+  // The range read back for the labels, a frame or two behind the plot
+  WGPUBuffer m_RangeReadback = nullptr;
+  std::atomic<bool> m_ReadbackBusy{false};
+  bool m_RangeStale = false; // reduced since the last readback was started
+  std::atomic<float> m_LabelMin{0.0f};
+  std::atomic<float> m_LabelMax{0.0f};
+
+  // Appended from any thread, taken by Prepare
+  std::mutex m_PendingMutex;
+  std::vector<float> m_Pending;
+  std::vector<float> m_Uploading;
+  bool m_ClearRequested = false;
+
+  // View: a window of m_ViewCount samples starting at m_ViewFirst, or the
+  // newest ones while following; a count of 0 shows everything
+  double m_ViewFirst = 0.0;
+  double m_ViewCount = 0.0;
+  bool m_Follow = true;
+
+  Frame m_Frame;
+  ReduceParams m_LastReduce = {};
+  float m_Color[4] = {0.35f, 0.75f, 1.0f, 1.0f};
+  Stats m_Stats;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "math/Mat4.h"
+#include "math/Vec.h"
+#include <cfloat>
+#include <cmath>
+
+// Axis-aligned bounding box. Default-constructed boxes are empty (inverted)
+// so they can be grown with Expand().
+struct Aabb {
+  Vec3 min{FLT_MAX};
+  Vec3 max{-FLT_MAX};
+
+  bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+  Vec3 Center() const { return (min + max) * 0.5f; }
+  Vec3 Extent() const { return (max - min) * 0.5f; }
+
+  void Expand(Vec3 p) {
+    min = Min(min, p);
+    max = Max(max, p);
+  }
+  void Expand(const Aabb &b) {
+    min = Min(min, b.min);
+    max = Max(max, b.max);
+  }
+
+  float SurfaceArea() const {
+    if (IsEmpty())
+      return 0.0f;
+    Vec3 d = max - min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+};
+
+// Bounds of a box after an affine transform (Arvo's method): the new extent
+// is the old extent multiplied by the absolute value of the 3x3 part
+inline Aabb TransformAabb(const Mat4 &m, const Aabb &box) {
+  if (box.IsEmpty())
+    return box;
+  Vec3 c = TransformPoint(m, box.Center());
+  Vec3 e = box.Extent();
+  Vec3 r{std::fabs(m(0, 0)) * e.x + std::fabs(m(0, 1)) * e.y +
+             std::fabs(m(0, 2)) * e.z,
+         std::fabs(m(1, 0)) * e.x + std::fabs(m(1, 1)) * e.y +
+             std::fabs(m(1, 2)) * e.z,
+         std::fabs(m(2, 0)) * e.x + std::fabs(m(2, 1)) * e.y +
+             std::fabs(m(2, 2)) * e.z};
+  return {c - r, c + r};
+}
+
+// Six inward-facing planes (xyz = normal, w = distance), a point p is inside
+// when dot(normal, p) + w >= 0 for every plane
+struct Frustum {
+  enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+  Vec4 planes[Count];
+
+  // Gribb/Hartmann extraction for a [0, 1] depth range view-projection
+  static Frustum FromViewProjection(const Mat4 &vp) {
+    auto row = [&](int r) { return Vec4(vp(r, 0), vp(r, 1), vp(r, 2), vp(r, 3)); };
+    Vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+    Frustum f;
+    f.planes[Left] = r3 + r0;
+    f.planes[Right] = r3 - r0;
+    f.planes[Bottom] = r3 + r1;
+    f.planes[Top] = r3 - r1;
+    f.planes[Near] = r2;
+    f.planes[Far] = r3 - r2;
+    for (Vec4 &p : f.planes) {
+      float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+      if (len > 0.0f)
+        p = p * (1.0f / len);
+    }
+    return f;
+  }
+
+  bool Intersects(const Aabb &box) const {
+    for (const Vec4 &p : planes) {
+      Vec3 v{p.x > 0.0f ? box.max.x : box.min.x,
+             p.y > 0.0f ? box.max.y : box.min.y,
+             p.z > 0.0f ? box.max.z : box.min.z};
+      if (p.x * v.x + p.y * v.y + p.z * v.z + p.w < 0.0f)
+        return false;
+    }
+    return true;
+  }
+};
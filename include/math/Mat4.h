@@ -0,0 +1,216 @@
+#pragma once
+
+#include "math/Quat.h"
+#include "math/Vec.h"
+#include <algorithm>
+#include <cmath>
+
+// Column-major 4x4 matrix matching WGSL's mat4x4<f32> layout, so it can be
+// copied into uniform and storage buffers without conversion.
+struct alignas(16) Mat4 {
+  float m[16] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+
+  simd::f4 Col(int c) const { return simd::Load(m + c * 4); }
+  void SetCol(int c, simd::f4 v) { simd::Store(m + c * 4, v); }
+
+  float operator()(int row, int col) const { return m[col * 4 + row]; }
+  float &operator()(int row, int col) { return m[col * 4 + row]; }
+
+  static Mat4 Identity() { return {}; }
+  static Mat4 Translation(Vec3 t);
+  static Mat4 Scale(Vec3 s);
+  static Mat4 Rotation(const Quat &q);
+  // Translation * Rotation * Scale
+  static Mat4 FromTRS(Vec3 t, const Quat &r, Vec3 s);
+  // Right-handed, depth mapped to [0, 1] as WebGPU expects
+  static Mat4 Perspective(float fovY, float aspect, float zNear, float zFar);
+  static Mat4 LookAt(Vec3 eye, Vec3 target, Vec3 up);
+};
+
+// Column c of the result is a's columns weighted by column c of b
+inline simd::f4 TransformColumn(const Mat4 &a, simd::f4 v) {
+  simd::f4 r = simd::Mul(a.Col(0), simd::SplatLane<0>(v));
+  r = simd::MulAdd(a.Col(1), simd::SplatLane<1>(v), r);
+  r = simd::MulAdd(a.Col(2), simd::SplatLane<2>(v), r);
+  return simd::MulAdd(a.Col(3), simd::SplatLane<3>(v), r);
+}
+
+inline Mat4 operator*(const Mat4 &a, const Mat4 &b) {
+  Mat4 r;
+  r.SetCol(0, TransformColumn(a, b.Col(0)));
+  r.SetCol(1, TransformColumn(a, b.Col(1)));
+  r.SetCol(2, TransformColumn(a, b.Col(2)));
+  r.SetCol(3, TransformColumn(a, b.Col(3)));
+  return r;
+}
+
+inline Vec4 operator*(const Mat4 &a, const Vec4 &v) {
+  return Vec4(TransformColumn(a, v.Simd()));
+}
+
+inline Vec3 TransformPoint(const Mat4 &a, Vec3 p) {
+  return (a * Vec4(p, 1.0f)).XYZ();
+}
+
+inline Vec3 TransformVector(const Mat4 &a, Vec3 v) {
+  return (a * Vec4(v, 0.0f)).XYZ();
+}
+
+// Largest length of the basis vectors, i.e. how much the matrix can stretch a
+// distance at most (exact for rotation and scale)
+inline float MaxAxisScale(const Mat4 &a) {
+  const float x = Length(TransformVector(a, {1.0f, 0.0f, 0.0f}));
+  const float y = Length(TransformVector(a, {0.0f, 1.0f, 0.0f}));
+  const float z = Length(TransformVector(a, {0.0f, 0.0f, 1.0f}));
+  return std::max(x, std::max(y, z));
+}
+
+inline Mat4 Transpose(const Mat4 &a) {
+  simd::f4 c0 = a.Col(0), c1 = a.Col(1), c2 = a.Col(2), c3 = a.Col(3);
+  simd::Transpose(c0, c1, c2, c3);
+  Mat4 r;
+  r.SetCol(0, c0);
+  r.SetCol(1, c1);
+  r.SetCol(2, c2);
+  r.SetCol(3, c3);
+  return r;
+}
+
+inline Mat4 Mat4::Translation(Vec3 t) {
+  Mat4 r;
+  r.m[12] = t.x;
+  r.m[13] = t.y;
+  r.m[14] = t.z;
+  return r;
+}
+
+inline Mat4 Mat4::Scale(Vec3 s) {
+  Mat4 r;
+  r.m[0] = s.x;
+  r.m[5] = s.y;
+  r.m[10] = s.z;
+  return r;
+}
+
+inline Mat4 Mat4::Rotation(const Quat &q) {
+  return FromTRS({}, q, Vec3(1.0f));
+}
+
+inline Mat4 Mat4::FromTRS(Vec3 t, const Quat &q, Vec3 s) {
+  float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  Mat4 r;
+  r.SetCol(0, simd::Set((1.0f - 2.0f * (yy + zz)) * s.x,
+                        2.0f * (xy + wz) * s.x, 2.0f * (xz - wy) * s.x, 0.0f));
+  r.SetCol(1, simd::Set(2.0f * (xy - wz) * s.y,
+                        (1.0f - 2.0f * (xx + zz)) * s.y,
+                        2.0f * (yz + wx) * s.y, 0.0f));
+  r.SetCol(2, simd::Set(2.0f * (xz + wy) * s.z, 2.0f * (yz - wx) * s.z,
+                        (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f));
+  r.SetCol(3, simd::Set(t.x, t.y, t.z, 1.0f));
+  return r;
+}
+
+inline Mat4 Mat4::Perspective(float fovY, float aspect, float zNear,
+                              float zFar) {
+  float f = 1.0f / std::tan(fovY * 0.5f);
+  Mat4 r;
+  r.SetCol(0, simd::Set(f / aspect, 0.0f, 0.0f, 0.0f));
+  r.SetCol(1, simd::Set(0.0f, f, 0.0f, 0.0f));
+  r.SetCol(2, simd::Set(0.0f, 0.0f, zFar / (zNear - zFar), -1.0f));
+  r.SetCol(3, simd::Set(0.0f, 0.0f, zNear * zFar / (zNear - zFar), 0.0f));
+  return r;
+}
+
+inline Mat4 Mat4::LookAt(Vec3 eye, Vec3 target, Vec3 up) {
+  Vec3 f = Normalize(target - eye);
+  Vec3 s = Normalize(Cross(f, up));
+  Vec3 u = Cross(s, f);
+  Mat4 r;
+  r.SetCol(0, simd::Set(s.x, u.x, -f.x, 0.0f));
+  r.SetCol(1, simd::Set(s.y, u.y, -f.y, 0.0f));
+  r.SetCol(2, simd::Set(s.z, u.z, -f.z, 0.0f));
+  r.SetCol(3, simd::Set(-Dot(s, eye), -Dot(u, eye), Dot(f, eye), 1.0f));
+  return r;
+}
+
+// Inverse of a matrix whose last row is (0, 0, 0, 1). Handles non-uniform
+// scale; cheaper than the general inverse and what transforms need.
+inline Mat4 AffineInverse(const Mat4 &a) {
+  // Inverse of the upper 3x3 via the cross products of its columns
+  Vec3 c0{a.m[0], a.m[1], a.m[2]};
+  Vec3 c1{a.m[4], a.m[5], a.m[6]};
+  Vec3 c2{a.m[8], a.m[9], a.m[10]};
+  Vec3 r0 = Cross(c1, c2);
+  Vec3 r1 = Cross(c2, c0);
+  Vec3 r2 = Cross(c0, c1);
+  float det = Dot(c0, r0);
+  float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+  r0 *= invDet;
+  r1 *= invDet;
+  r2 *= invDet;
+
+  Vec3 t{a.m[12], a.m[13], a.m[14]};
+  Mat4 r;
+  r.SetCol(0, simd::Set(r0.x, r1.x, r2.x, 0.0f));
+  r.SetCol(1, simd::Set(r0.y, r1.y, r2.y, 0.0f));
+  r.SetCol(2, simd::Set(r0.z, r1.z, r2.z, 0.0f));
+  r.SetCol(3, simd::Set(-Dot(r0, t), -Dot(r1, t), -Dot(r2, t), 1.0f));
+  return r;
+}
+
+// General 4x4 inverse (cofactor expansion). Returns identity if singular.
+inline Mat4 Inverse(const Mat4 &a) {
+  const float *m = a.m;
+  float inv[16];
+  inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+           m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+  inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] +
+           m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] +
+           m[12] * m[7] * m[10];
+  inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+           m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+  inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] +
+            m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] +
+            m[12] * m[6] * m[9];
+  inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] +
+           m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] +
+           m[13] * m[3] * m[10];
+  inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+           m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+  inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] +
+           m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] +
+           m[12] * m[3] * m[9];
+  inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+            m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+  inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] +
+           m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+  inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] -
+           m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+  inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] +
+            m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+  inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] +
+            m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] +
+            m[12] * m[2] * m[5];
+  inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] -
+           m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+  inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] +
+           m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+  inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] -
+            m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+  inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] +
+            m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+  float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+  if (det == 0.0f)
+    return Mat4::Identity();
+
+  Mat4 r;
+  float invDet = 1.0f / det;
+  for (int i = 0; i < 16; ++i)
+    r.m[i] = inv[i] * invDet;
+  return r;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Umbrella header for the math layer
+#include "math/Bounds.h"
+#include "math/Mat4.h"
+#include "math/Quat.h"
+#include "math/Simd.h"
+#include "math/Vec.h"
+
+inline constexpr float kPi = 3.14159265358979323846f;
+
+inline constexpr float Radians(float degrees) { return degrees * kPi / 180.0f; }
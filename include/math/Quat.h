@@ -0,0 +1,95 @@
+#pragma once
+
+#include "math/Vec.h"
+#include <cmath>
+
+// Unit quaternion (x, y, z, w) with w as the scalar part
+struct alignas(16) Quat {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+  float w = 1.0f;
+
+  constexpr Quat() = default;
+  constexpr Quat(float x_, float y_, float z_, float w_)
+      : x(x_), y(y_), z(z_), w(w_) {}
+  explicit Quat(simd::f4 v) { simd::Store(&x, v); }
+
+  simd::f4 Simd() const { return simd::Load(&x); }
+
+  static constexpr Quat Identity() { return {}; }
+
+  // Axis must be normalized
+  static Quat FromAxisAngle(Vec3 axis, float radians) {
+    float s = std::sin(radians * 0.5f);
+    return {axis.x * s, axis.y * s, axis.z * s, std::cos(radians * 0.5f)};
+  }
+
+  // Yaw about Y, then pitch about X, then roll about Z
+  static Quat FromEuler(float pitch, float yaw, float roll);
+};
+
+inline Quat operator*(const Quat &a, const Quat &b) {
+  // Hamilton product expressed as four lane-broadcast multiply-adds
+  simd::f4 bv = b.Simd();
+  simd::f4 ax = simd::Splat(a.x), ay = simd::Splat(a.y);
+  simd::f4 az = simd::Splat(a.z), aw = simd::Splat(a.w);
+  simd::f4 r = simd::Mul(aw, bv);
+  r = simd::MulAdd(ax, simd::Set(b.w, -b.z, b.y, -b.x), r);
+  r = simd::MulAdd(ay, simd::Set(b.z, b.w, -b.x, -b.y), r);
+  r = simd::MulAdd(az, simd::Set(-b.y, b.x, b.w, -b.z), r);
+  return Quat(r);
+}
+
+inline Quat Quat::FromEuler(float pitch, float yaw, float roll) {
+  return FromAxisAngle({0.0f, 1.0f, 0.0f}, yaw) *
+         FromAxisAngle({1.0f, 0.0f, 0.0f}, pitch) *
+         FromAxisAngle({0.0f, 0.0f, 1.0f}, roll);
+}
+
+inline float Dot(const Quat &a, const Quat &b) {
+  return simd::Dot4(a.Simd(), b.Simd());
+}
+
+inline Quat Normalize(const Quat &q) {
+  float len = std::sqrt(Dot(q, q));
+  if (len <= 0.0f)
+    return Quat::Identity();
+  return Quat(simd::Mul(q.Simd(), simd::Splat(1.0f / len)));
+}
+
+inline Quat Conjugate(const Quat &q) { return {-q.x, -q.y, -q.z, q.w}; }
+
+inline Vec3 Rotate(const Quat &q, Vec3 v) {
+  // v' = v + 2w(u x v) + 2(u x (u x v))
+  Vec3 u{q.x, q.y, q.z};
+  Vec3 t = Cross(u, v) * 2.0f;
+  return v + t * q.w + Cross(u, t);
+}
+
+// Normalized linear interpolation along the shortest arc
+inline Quat Nlerp(const Quat &a, const Quat &b, float t) {
+  float sign = Dot(a, b) < 0.0f ? -1.0f : 1.0f;
+  simd::f4 av = a.Simd();
+  simd::f4 bv = simd::Mul(b.Simd(), simd::Splat(sign));
+  return Normalize(
+      Quat(simd::MulAdd(simd::Sub(bv, av), simd::Splat(t), av)));
+}
+
+inline Quat Slerp(const Quat &a, const Quat &b, float t) {
+  float cosTheta = Dot(a, b);
+  Quat end = b;
+  if (cosTheta < 0.0f) {
+    cosTheta = -cosTheta;
+    end = {-b.x, -b.y, -b.z, -b.w};
+  }
+  // Fall back to nlerp when the arc is too small for a stable sin()
+  if (cosTheta > 0.9995f)
+    return Nlerp(a, end, t);
+  float theta = std::acos(cosTheta);
+  float invSin = 1.0f / std::sin(theta);
+  float wa = std::sin((1.0f - t) * theta) * invSin;
+  float wb = std::sin(t * theta) * invSin;
+  return Quat(simd::MulAdd(a.Simd(), simd::Splat(wa),
+                           simd::Mul(end.Simd(), simd::Splat(wb))));
+}
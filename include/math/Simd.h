@@ -0,0 +1,264 @@
+#pragma once
+
+// Thin wrappers over the platform vector units. Everything in the math layer
+// is written against these so the SSE, AVX2, NEON and scalar builds share one
+// implementation. Define RENDERER_SIMD_FORCE_SCALAR to disable intrinsics.
+
+#include <cmath>
+#include <cstdint>
+
+#if !defined(RENDERER_SIMD_FORCE_SCALAR)
+#if defined(__SSE2__) || defined(_M_X64) || defined(__x86_64__)
+#define RENDERER_SIMD_SSE 1
+#include <immintrin.h>
+#if defined(__AVX2__)
+#define RENDERER_SIMD_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define RENDERER_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if !defined(RENDERER_SIMD_SSE) && !defined(RENDERER_SIMD_NEON)
+#define RENDERER_SIMD_SCALAR 1
+#endif
+
+namespace simd {
+
+// 4-wide float register
+#if defined(RENDERER_SIMD_SSE)
+using f4 = __m128;
+#elif defined(RENDERER_SIMD_NEON)
+using f4 = float32x4_t;
+#else
+struct f4 {
+  float v[4];
+};
+#endif
+
+#if defined(RENDERER_SIMD_SSE)
+
+inline f4 Load(const float *p) { return _mm_load_ps(p); }
+inline f4 LoadU(const float *p) { return _mm_loadu_ps(p); }
+inline void Store(float *p, f4 a) { _mm_store_ps(p, a); }
+inline void StoreU(float *p, f4 a) { _mm_storeu_ps(p, a); }
+inline f4 Set(float x, float y, float z, float w) {
+  return _mm_set_ps(w, z, y, x);
+}
+inline f4 Splat(float s) { return _mm_set1_ps(s); }
+inline f4 Zero() { return _mm_setzero_ps(); }
+inline f4 Add(f4 a, f4 b) { return _mm_add_ps(a, b); }
+inline f4 Sub(f4 a, f4 b) { return _mm_sub_ps(a, b); }
+inline f4 Mul(f4 a, f4 b) { return _mm_mul_ps(a, b); }
+inline f4 Div(f4 a, f4 b) { return _mm_div_ps(a, b); }
+inline f4 Min(f4 a, f4 b) { return _mm_min_ps(a, b); }
+inline f4 Max(f4 a, f4 b) { return _mm_max_ps(a, b); }
+inline f4 Sqrt(f4 a) { return _mm_sqrt_ps(a); }
+// a * b + c
+inline f4 MulAdd(f4 a, f4 b, f4 c) {
+#if defined(__FMA__)
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+template <int I> inline f4 SplatLane(f4 a) {
+  return _mm_shuffle_ps(a, a, _MM_SHUFFLE(I, I, I, I));
+}
+inline float GetX(f4 a) { return _mm_cvtss_f32(a); }
+inline float HorizontalAdd(f4 a) {
+  f4 shuf = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+  f4 sums = _mm_add_ps(a, shuf);
+  shuf = _mm_movehl_ps(shuf, sums);
+  return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+inline f4 Cross3(f4 a, f4 b) {
+  f4 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  f4 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  f4 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+  return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+// Lane-wise comparisons return all-ones masks
+inline f4 CmpLt(f4 a, f4 b) { return _mm_cmplt_ps(a, b); }
+inline f4 CmpGt(f4 a, f4 b) { return _mm_cmpgt_ps(a, b); }
+inline f4 And(f4 a, f4 b) { return _mm_and_ps(a, b); }
+inline f4 Or(f4 a, f4 b) { return _mm_or_ps(a, b); }
+// One bit per lane, lane 0 in bit 0
+inline int MoveMask(f4 a) { return _mm_movemask_ps(a); }
+inline void Transpose(f4 &r0, f4 &r1, f4 &r2, f4 &r3) {
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+#elif defined(RENDERER_SIMD_NEON)
+
+inline f4 Load(const float *p) { return vld1q_f32(p); }
+inline f4 LoadU(const float *p) { return vld1q_f32(p); }
+inline void Store(float *p, f4 a) { vst1q_f32(p, a); }
+inline void StoreU(float *p, f4 a) { vst1q_f32(p, a); }
+inline f4 Set(float x, float y, float z, float w) {
+  const float v[4] = {x, y, z, w};
+  return vld1q_f32(v);
+}
+inline f4 Splat(float s) { return vdupq_n_f32(s); }
+inline f4 Zero() { return vdupq_n_f32(0.0f); }
+inline f4 Add(f4 a, f4 b) { return vaddq_f32(a, b); }
+inline f4 Sub(f4 a, f4 b) { return vsubq_f32(a, b); }
+inline f4 Mul(f4 a, f4 b) { return vmulq_f32(a, b); }
+inline f4 Div(f4 a, f4 b) { return vdivq_f32(a, b); }
+inline f4 Min(f4 a, f4 b) { return vminq_f32(a, b); }
+inline f4 Max(f4 a, f4 b) { return vmaxq_f32(a, b); }
+inline f4 Sqrt(f4 a) { return vsqrtq_f32(a); }
+inline f4 MulAdd(f4 a, f4 b, f4 c) { return vfmaq_f32(c, a, b); }
+template <int I> inline f4 SplatLane(f4 a) { return vdupq_laneq_f32(a, I); }
+inline float GetX(f4 a) { return vgetq_lane_f32(a, 0); }
+inline float HorizontalAdd(f4 a) { return vaddvq_f32(a); }
+inline f4 Cross3(f4 a, f4 b) {
+  const float ax = vgetq_lane_f32(a, 0), ay = vgetq_lane_f32(a, 1),
+              az = vgetq_lane_f32(a, 2);
+  const float bx = vgetq_lane_f32(b, 0), by = vgetq_lane_f32(b, 1),
+              bz = vgetq_lane_f32(b, 2);
+  return Set(ay * bz - az * by, az * bx - ax * bz, ax * by - ay * bx, 0.0f);
+}
+inline f4 CmpLt(f4 a, f4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+inline f4 CmpGt(f4 a, f4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+inline f4 And(f4 a, f4 b) {
+  return vreinterpretq_f32_u32(
+      vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+inline f4 Or(f4 a, f4 b) {
+  return vreinterpretq_f32_u32(
+      vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+inline int MoveMask(f4 a) {
+  static const int32_t shifts[4] = {0, 1, 2, 3};
+  uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(a), 31);
+  return static_cast<int>(
+      vaddvq_u32(vshlq_u32(bits, vld1q_s32(shifts))));
+}
+inline void Transpose(f4 &r0, f4 &r1, f4 &r2, f4 &r3) {
+  float32x4x2_t t0 = vtrnq_f32(r0, r1);
+  float32x4x2_t t1 = vtrnq_f32(r2, r3);
+  r0 = vcombine_f32(vget_low_f32(t0.val[0]), vget_low_f32(t1.val[0]));
+  r1 = vcombine_f32(vget_low_f32(t0.val[1]), vget_low_f32(t1.val[1]));
+  r2 = vcombine_f32(vget_high_f32(t0.val[0]), vget_high_f32(t1.val[0]));
+  r3 = vcombine_f32(vget_high_f32(t0.val[1]), vget_high_f32(t1.val[1]));
+}
+
+#else // scalar fallback
+
+inline f4 Load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline f4 LoadU(const float *p) { return Load(p); }
+inline void Store(float *p, f4 a) {
+  for (int i = 0; i < 4; ++i)
+    p[i] = a.v[i];
+}
+inline void StoreU(float *p, f4 a) { Store(p, a); }
+inline f4 Set(float x, float y, float z, float w) { return {{x, y, z, w}}; }
+inline f4 Splat(float s) { return {{s, s, s, s}}; }
+inline f4 Zero() { return Splat(0.0f); }
+#define RENDERER_SIMD_SCALAR_BINOP(name, expr)                                 \
+  inline f4 name(f4 a, f4 b) {                                                 \
+    f4 r;                                                                      \
+    for (int i = 0; i < 4; ++i) {                                              \
+      float x = a.v[i], y = b.v[i];                                            \
+      r.v[i] = (expr);                                                         \
+    }                                                                          \
+    return r;                                                                  \
+  }
+RENDERER_SIMD_SCALAR_BINOP(Add, x + y)
+RENDERER_SIMD_SCALAR_BINOP(Sub, x - y)
+RENDERER_SIMD_SCALAR_BINOP(Mul, x *y)
+RENDERER_SIMD_SCALAR_BINOP(Div, x / y)
+RENDERER_SIMD_SCALAR_BINOP(Min, y < x ? y : x)
+RENDERER_SIMD_SCALAR_BINOP(Max, x < y ? y : x)
+#undef RENDERER_SIMD_SCALAR_BINOP
+inline f4 Sqrt(f4 a) {
+  return {{std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]),
+           std::sqrt(a.v[3])}};
+}
+inline f4 MulAdd(f4 a, f4 b, f4 c) { return Add(Mul(a, b), c); }
+template <int I> inline f4 SplatLane(f4 a) { return Splat(a.v[I]); }
+inline float GetX(f4 a) { return a.v[0]; }
+inline float HorizontalAdd(f4 a) { return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]); }
+inline f4 Cross3(f4 a, f4 b) {
+  return {{a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2],
+           a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f}};
+}
+inline f4 MaskFromBools(bool x, bool y, bool z, bool w) {
+  // All-ones lanes are only ever inspected through MoveMask/And/Or
+  auto bits = [](bool b) { return b ? -1.0f : 0.0f; };
+  return {{bits(x), bits(y), bits(z), bits(w)}};
+}
+inline f4 CmpLt(f4 a, f4 b) {
+  return MaskFromBools(a.v[0] < b.v[0], a.v[1] < b.v[1], a.v[2] < b.v[2],
+                       a.v[3] < b.v[3]);
+}
+inline f4 CmpGt(f4 a, f4 b) { return CmpLt(b, a); }
+inline f4 And(f4 a, f4 b) {
+  return MaskFromBools(a.v[0] < 0 && b.v[0] < 0, a.v[1] < 0 && b.v[1] < 0,
+                       a.v[2] < 0 && b.v[2] < 0, a.v[3] < 0 && b.v[3] < 0);
+}
+inline f4 Or(f4 a, f4 b) {
+  return MaskFromBools(a.v[0] < 0 || b.v[0] < 0, a.v[1] < 0 || b.v[1] < 0,
+                       a.v[2] < 0 || b.v[2] < 0, a.v[3] < 0 || b.v[3] < 0);
+}
+inline int MoveMask(f4 a) {
+  return (a.v[0] < 0 ? 1 : 0) | (a.v[1] < 0 ? 2 : 0) | (a.v[2] < 0 ? 4 : 0) |
+         (a.v[3] < 0 ? 8 : 0);
+}
+inline void Transpose(f4 &r0, f4 &r1, f4 &r2, f4 &r3) {
+  f4 *rows[4] = {&r0, &r1, &r2, &r3};
+  for (int i = 0; i < 4; ++i) {
+    for (int j = i + 1; j < 4; ++j) {
+      float t = rows[i]->v[j];
+      rows[i]->v[j] = rows[j]->v[i];
+      rows[j]->v[i] = t;
+    }
+  }
+}
+
+#endif
+
+inline float Dot4(f4 a, f4 b) { return HorizontalAdd(Mul(a, b)); }
+inline float Dot3(f4 a, f4 b) {
+  alignas(16) float t[4];
+  Store(t, Mul(a, b));
+  return t[0] + t[1] + t[2];
+}
+
+// Widest register available, used by the structure-of-arrays kernels that
+// process one object per lane
+#if defined(RENDERER_SIMD_AVX2)
+using fw = __m256;
+inline constexpr int kWideWidth = 8;
+inline fw WideLoad(const float *p) { return _mm256_loadu_ps(p); }
+inline void WideStore(float *p, fw a) { _mm256_storeu_ps(p, a); }
+inline fw WideSplat(float s) { return _mm256_set1_ps(s); }
+inline fw WideAdd(fw a, fw b) { return _mm256_add_ps(a, b); }
+inline fw WideSub(fw a, fw b) { return _mm256_sub_ps(a, b); }
+inline fw WideMul(fw a, fw b) { return _mm256_mul_ps(a, b); }
+inline fw WideMulAdd(fw a, fw b, fw c) { return _mm256_fmadd_ps(a, b, c); }
+inline fw WideMin(fw a, fw b) { return _mm256_min_ps(a, b); }
+inline fw WideMax(fw a, fw b) { return _mm256_max_ps(a, b); }
+inline fw WideCmpLt(fw a, fw b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline fw WideOr(fw a, fw b) { return _mm256_or_ps(a, b); }
+inline int WideMoveMask(fw a) { return _mm256_movemask_ps(a); }
+#else
+using fw = f4;
+inline constexpr int kWideWidth = 4;
+inline fw WideLoad(const float *p) { return LoadU(p); }
+inline void WideStore(float *p, fw a) { StoreU(p, a); }
+inline fw WideSplat(float s) { return Splat(s); }
+inline fw WideAdd(fw a, fw b) { return Add(a, b); }
+inline fw WideSub(fw a, fw b) { return Sub(a, b); }
+inline fw WideMul(fw a, fw b) { return Mul(a, b); }
+inline fw WideMulAdd(fw a, fw b, fw c) { return MulAdd(a, b, c); }
+inline fw WideMin(fw a, fw b) { return Min(a, b); }
+inline fw WideMax(fw a, fw b) { return Max(a, b); }
+inline fw WideCmpLt(fw a, fw b) { return CmpLt(a, b); }
+inline fw WideOr(fw a, fw b) { return Or(a, b); }
+inline int WideMoveMask(fw a) { return MoveMask(a); }
+#endif
+
+} // namespace simd
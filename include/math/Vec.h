@@ -0,0 +1,89 @@
+#pragma once
+
+#include "math/Simd.h"
+#include <cmath>
+
+// Packed 3-component vector used for storage (positions, extents). Arithmetic
+// on it is scalar; convert to Vec4 for anything in a hot loop.
+struct Vec3 {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+
+  constexpr Vec3() = default;
+  constexpr Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+  explicit constexpr Vec3(float s) : x(s), y(s), z(s) {}
+
+  float operator[](int i) const { return (&x)[i]; }
+  float &operator[](int i) { return (&x)[i]; }
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3 operator-(Vec3 a) { return {-a.x, -a.y, -a.z}; }
+inline Vec3 operator*(Vec3 a, Vec3 b) { return {a.x * b.x, a.y * b.y, a.z * b.z}; }
+inline Vec3 operator*(Vec3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+inline Vec3 operator*(float s, Vec3 a) { return a * s; }
+inline Vec3 operator/(Vec3 a, float s) { return a * (1.0f / s); }
+inline Vec3 &operator+=(Vec3 &a, Vec3 b) { return a = a + b; }
+inline Vec3 &operator-=(Vec3 &a, Vec3 b) { return a = a - b; }
+inline Vec3 &operator*=(Vec3 &a, float s) { return a = a * s; }
+
+inline float Dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(Vec3 a, Vec3 b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+inline float Length(Vec3 a) { return std::sqrt(Dot(a, a)); }
+inline Vec3 Normalize(Vec3 a) {
+  float len = Length(a);
+  return len > 0.0f ? a / len : Vec3{};
+}
+inline Vec3 Min(Vec3 a, Vec3 b) {
+  return {a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z};
+}
+inline Vec3 Max(Vec3 a, Vec3 b) {
+  return {a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z};
+}
+inline Vec3 Lerp(Vec3 a, Vec3 b, float t) { return a + (b - a) * t; }
+
+// 16-byte aligned 4-component vector backed by a SIMD register on load
+struct alignas(16) Vec4 {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+  float w = 0.0f;
+
+  constexpr Vec4() = default;
+  constexpr Vec4(float x_, float y_, float z_, float w_)
+      : x(x_), y(y_), z(z_), w(w_) {}
+  constexpr Vec4(Vec3 v, float w_) : x(v.x), y(v.y), z(v.z), w(w_) {}
+  explicit Vec4(simd::f4 v) { simd::Store(&x, v); }
+
+  simd::f4 Simd() const { return simd::Load(&x); }
+  Vec3 XYZ() const { return {x, y, z}; }
+
+  float operator[](int i) const { return (&x)[i]; }
+  float &operator[](int i) { return (&x)[i]; }
+};
+
+inline Vec4 operator+(const Vec4 &a, const Vec4 &b) {
+  return Vec4(simd::Add(a.Simd(), b.Simd()));
+}
+inline Vec4 operator-(const Vec4 &a, const Vec4 &b) {
+  return Vec4(simd::Sub(a.Simd(), b.Simd()));
+}
+inline Vec4 operator*(const Vec4 &a, const Vec4 &b) {
+  return Vec4(simd::Mul(a.Simd(), b.Simd()));
+}
+inline Vec4 operator*(const Vec4 &a, float s) {
+  return Vec4(simd::Mul(a.Simd(), simd::Splat(s)));
+}
+inline float Dot(const Vec4 &a, const Vec4 &b) {
+  return simd::Dot4(a.Simd(), b.Simd());
+}
+inline Vec4 Min(const Vec4 &a, const Vec4 &b) {
+  return Vec4(simd::Min(a.Simd(), b.Simd()));
+}
+inline Vec4 Max(const Vec4 &a, const Vec4 &b) {
+  return Vec4(simd::Max(a.Simd(), b.Simd()));
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "math/Math.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 4-wide bounding volume hierarchy over object bounds, used for frustum
+// culling.
+//
+// Built top-down with binned SAH into a binary tree, then collapsed so every
+// node holds the bounds of up to four children in SoA form; one SIMD register
+// tests all four children against a frustum plane. Leaves reference a run of
+// objects whose bounds are also stored SoA so the final per-object test runs
+// kWideWidth objects at a time.
+//
+// Moving objects are handled by Refit(), which only touches the leaves that
+// contain them and their ancestors. The tree topology (and so its SAH
+// quality) stays fixed until the next Build().
+class Bvh {
+public:
+  struct CullStats {
+    uint32_t totalObjects = 0;
+    uint32_t visibleObjects = 0;
+    uint32_t nodesVisited = 0;
+    uint32_t refitObjects = 0;
+    double buildMs = 0.0;
+    double refitMs = 0.0;
+    double cullMs = 0.0;
+  };
+
+  Bvh();
+  ~Bvh();
+
+  // Build over bounds[i] for every object i
+  void Build(const std::vector<Aabb> &bounds);
+
+  // Refresh the bounds of moved objects and their ancestors
+  void Refit(const std::vector<Aabb> &bounds, const std::vector<uint32_t> &moved);
+
+  // Write the indices of objects intersecting the frustum into `visible`
+  // (compacted, in BVH leaf order). Splits traversal across the pool when
+  // one is given.
+  void Cull(const Frustum &frustum, std::vector<uint32_t> &visible,
+            ThreadPool *pool = nullptr);
+
+  bool IsEmpty() const { return m_ObjectCount == 0; }
+  size_t GetNodeCount() const { return m_Nodes.size(); }
+  const CullStats &GetStats() const { return m_Stats; }
+
+private:
+  static constexpr int32_t kEmptyChild = INT32_MIN;
+  static constexpr uint32_t kMaxLeafSize = 8;
+
+  struct alignas(16) Node {
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    // >= 0: inner node index; kEmptyChild: unused; otherwise ~leaf index
+    int32_t child[4];
+    uint32_t parent;
+    uint32_t slotInParent;
+  };
+
+  struct Leaf {
+    uint32_t first; // into the leaf-ordered object arrays
+    uint32_t count;
+    uint32_t node; // owning node and child slot, for refit
+    uint32_t slot;
+  };
+
+  // Binary build tree, discarded after collapsing
+  struct BuildNode {
+    Aabb bounds;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    int32_t left = -1;
+    int32_t right = -1;
+  };
+
+  struct TraversalItem {
+    uint32_t node;
+    bool fullyInside;
+  };
+
+  void BuildBinary(std::vector<BuildNode> &tree, std::vector<uint32_t> &ids,
+                   const std::vector<Aabb> &bounds,
+                   const std::vector<Vec3> &centroids);
+  int32_t Collapse(const std::vector<BuildNode> &tree, int32_t root,
+                   uint32_t parent, uint32_t slot);
+  void SetChildBounds(Node &node, int slot, const Aabb &box);
+  Aabb LeafBounds(const Leaf &leaf) const;
+  static Aabb NodeBounds(const Node &node);
+
+  void Traverse(const Frustum &frustum, TraversalItem start,
+                std::vector<uint32_t> &out, uint32_t &nodesVisited) const;
+  void EmitLeaf(const Frustum &frustum, const Leaf &leaf, bool fullyInside,
+                std::vector<uint32_t> &out) const;
+
+  std::vector<Node> m_Nodes;
+  std::vector<Leaf> m_Leaves;
+
+  // Object data in leaf order
+  std::vector<uint32_t> m_ObjectIds;
+  std::vector<float> m_ObjMinX, m_ObjMinY, m_ObjMinZ;
+  std::vector<float> m_ObjMaxX, m_ObjMaxY, m_ObjMaxZ;
+  // object id -> (leaf index, position in leaf order)
+  std::vector<uint32_t> m_ObjectLeaf;
+  std::vector<uint32_t> m_ObjectPosition;
+
+  std::vector<uint8_t> m_NodeDirty;
+  std::vector<std::vector<uint32_t>> m_TaskResults;
+  uint32_t m_ObjectCount = 0;
+  CullStats m_Stats;
+};
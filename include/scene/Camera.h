@@ -0,0 +1,45 @@
+#pragma once
+
+#include "math/Math.h"
+#include <algorithm>
+#include <cmath>
+
+// Free-fly perspective camera. Yaw rotates about +Y, pitch about the camera's
+// right axis; yaw = pitch = 0 looks down -Z.
+struct Camera {
+  Vec3 position{0.0f, 5.0f, 20.0f};
+  float yaw = 0.0f;   // radians
+  float pitch = 0.0f; // radians
+  float fovY = Radians(60.0f);
+  float zNear = 0.1f;
+  float zFar = 5000.0f;
+
+  Vec3 Forward() const {
+    return {-std::sin(yaw) * std::cos(pitch), std::sin(pitch),
+            -std::cos(yaw) * std::cos(pitch)};
+  }
+  Vec3 Right() const { return {std::cos(yaw), 0.0f, -std::sin(yaw)}; }
+
+  Mat4 View() const {
+    return Mat4::LookAt(position, position + Forward(), {0.0f, 1.0f, 0.0f});
+  }
+  Mat4 Projection(float aspect) const {
+    return Mat4::Perspective(fovY, aspect, zNear, zFar);
+  }
+  Mat4 ViewProjection(float aspect) const { return Projection(aspect) * View(); }
+
+  void Rotate(float deltaYaw, float deltaPitch) {
+    yaw += deltaYaw;
+    pitch = std::clamp(pitch + deltaPitch, -1.55f, 1.55f);
+  }
+
+  // Back off along the current view direction until the bounds fit
+  void Frame(const Aabb &bounds) {
+    if (bounds.IsEmpty())
+      return;
+    const float radius = Length(bounds.Extent());
+    const float distance = radius / std::sin(fovY * 0.5f);
+    position = bounds.Center() - Forward() * distance;
+    zFar = std::max(zFar, distance + radius * 2.0f);
+  }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "scene/Scene.h"
+#include <cstdint>
+
+struct LodSettings {
+  uint32_t maxLods = 6; // including the full-detail level
+  // Each level aims for this fraction of the previous level's triangles
+  float reduction = 0.5f;
+  // Error bound of the first simplified level as a fraction of the mesh's
+  // bounding box diagonal; every further level doubles it
+  float firstError = 0.002f;
+  // A level that removes less than this fraction of the previous level's
+  // triangles is dropped; the next, looser error bound tries again
+  float minReduction = 0.1f;
+  uint32_t minTriangles = 16;
+};
+
+// Build a chain of simplified levels for `mesh` by quadric error metric edge
+// collapse and append their triangles to mesh.indices, one MeshLod per level.
+// Collapses move a vertex onto a neighbour, so every level shares the mesh's
+// vertices. Open borders and attribute seams only collapse along themselves.
+// A level stops at its triangle target or its error bound, whichever comes
+// first; each MeshLod records the largest object-space error it reached.
+// Returns the number of levels, including level 0.
+uint32_t GenerateLods(MeshData &mesh, const LodSettings &settings = {});
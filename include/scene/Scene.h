@@ -0,0 +1,131 @@
+#pragma once
+
+#include "math/Math.h"
+#include "scene/TransformHierarchy.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Interleaved vertex layout shared by every mesh (32 bytes)
+struct Vertex {
+  Vec3 position;
+  Vec3 normal;
+  float uv[2] = {0.0f, 0.0f};
+};
+
+// A level of detail: a range of MeshData::indices over the mesh's vertices
+struct MeshLod {
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  float error = 0.0f; // largest object-space deviation from level 0
+};
+
+struct MeshData {
+  std::string name;
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  Aabb bounds; // object space
+  // Finest first. AddMesh fills in a single level covering all indices when
+  // none were generated.
+  std::vector<MeshLod> lods;
+};
+
+constexpr uint32_t kNoTexture = UINT32_MAX;
+
+// Image data referenced by materials. Only the source is kept here; pixels are
+// decoded on demand by the texture streamer. One of the three is set:
+//  - path: image file on disk
+//  - encoded: a whole image file in memory (textures embedded in a model)
+//  - pixels: raw RGBA8, width * height * 4 bytes
+struct TextureSource {
+  std::string name;
+  std::string path;
+  std::vector<uint8_t> encoded;
+  std::vector<uint8_t> pixels;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+struct Material {
+  std::string name;
+  Vec4 baseColor{1.0f, 1.0f, 1.0f, 1.0f};
+  uint32_t baseColorTexture = kNoTexture; // index into Scene::GetTextures()
+};
+
+// A drawable instance: one mesh placed by one transform
+struct SceneObject {
+  TransformHandle transform = kInvalidTransform;
+  uint32_t mesh = 0;
+  uint32_t material = 0;
+};
+
+// CPU-side scene: geometry, materials and the objects that place them.
+// Update() propagates transforms and keeps the world-space bounds of every
+// object current, recording which objects moved so spatial structures can be
+// refit instead of rebuilt.
+class Scene {
+public:
+  Scene();
+  ~Scene();
+  // Movable so a scene imported on a worker can be swapped in whole
+  Scene(Scene &&) = default;
+  Scene &operator=(Scene &&) = default;
+
+  uint32_t AddMesh(MeshData mesh);
+  uint32_t AddMaterial(Material material);
+  uint32_t AddTexture(TextureSource texture);
+  uint32_t AddObject(TransformHandle transform, uint32_t mesh,
+                     uint32_t material = 0);
+  void Clear();
+
+  // Propagate transforms and refresh world bounds of moved objects
+  void Update(ThreadPool *pool = nullptr);
+
+  TransformHierarchy &GetTransforms() { return m_Transforms; }
+  const TransformHierarchy &GetTransforms() const { return m_Transforms; }
+
+  const std::vector<MeshData> &GetMeshes() const { return m_Meshes; }
+  const std::vector<Material> &GetMaterials() const { return m_Materials; }
+  const std::vector<TextureSource> &GetTextures() const { return m_Textures; }
+  const std::vector<SceneObject> &GetObjects() const { return m_Objects; }
+  const std::vector<Aabb> &GetWorldBounds() const { return m_WorldBounds; }
+
+  // Objects whose world bounds changed in the last Update
+  const std::vector<uint32_t> &GetMovedObjects() const { return m_MovedObjects; }
+
+  // Bumped whenever objects or meshes are added/removed; spatial structures
+  // compare it to decide between a refit and a full rebuild
+  uint64_t GetTopologyVersion() const { return m_TopologyVersion; }
+
+  Aabb ComputeBounds() const;
+
+private:
+  TransformHierarchy m_Transforms;
+  std::vector<MeshData> m_Meshes;
+  std::vector<Material> m_Materials;
+  std::vector<TextureSource> m_Textures;
+  std::vector<SceneObject> m_Objects;
+  std::vector<Aabb> m_WorldBounds;
+  std::vector<uint32_t> m_MovedObjects;
+  uint64_t m_TopologyVersion = 0;
+};
+
+// Import a model file through assimp, appending to the scene. Every mesh gets
+// a LOD chain; `pool` spreads their generation across workers. `files`, when
+// given, receives every file the importer read: the model itself and any
+// side files such as .mtl or .bin (referenced images are texture paths).
+// Returns false (and leaves the scene untouched) on failure.
+bool ImportScene(const char *path, Scene &scene, ThreadPool *pool = nullptr,
+                 std::vector<std::string> *files = nullptr);
+
+// Grid of cubes and spheres for stress testing when no model is given. The
+// spheres carry a LOD chain. The materials use generated checker textures so
+// texture streaming has something to do.
+void BuildProceduralScene(Scene &scene, int objectCount);
+
+// For every mesh of `next`, the mesh of `previous` with the same name,
+// geometry and LODs, or UINT32_MAX. A reload uses it to keep what is already
+// on the GPU; each previous mesh is matched at most once.
+std::vector<uint32_t> MatchMeshes(const Scene &previous, const Scene &next);
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "math/Math.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+using TransformHandle = uint32_t;
+inline constexpr TransformHandle kInvalidTransform = UINT32_MAX;
+
+// Structure-of-arrays transform hierarchy.
+//
+// Local TRS components live in separate float arrays sorted by depth, so a
+// parent is always stored before its children and every depth level is a
+// contiguous slot range. Update() walks the levels in order, propagates dirty
+// flags from parents, and recomputes only the dirty world matrices, several
+// nodes per SIMD register. Nodes within a level are independent, which lets
+// large levels be split across a ThreadPool.
+//
+// Handles stay stable across the re-sorting done when the topology changes.
+class TransformHierarchy {
+public:
+  struct Stats {
+    uint32_t nodeCount = 0;
+    uint32_t levelCount = 0;
+    uint32_t updatedCount = 0; // world matrices recomputed by last Update
+    bool rebuilt = false;      // topology changed and slots were re-sorted
+  };
+
+  TransformHierarchy();
+  ~TransformHierarchy();
+  TransformHierarchy(TransformHierarchy &&) = default;
+  TransformHierarchy &operator=(TransformHierarchy &&) = default;
+
+  // Create a node with identity local transform
+  TransformHandle Create(TransformHandle parent = kInvalidTransform);
+
+  // Destroy a node and its whole subtree (takes effect on next Update)
+  void Destroy(TransformHandle handle);
+
+  bool IsValid(TransformHandle handle) const;
+
+  // Reparent a node; returns false if it would create a cycle
+  bool SetParent(TransformHandle handle, TransformHandle parent);
+  TransformHandle GetParent(TransformHandle handle) const;
+
+  // Local transform
+  void SetLocal(TransformHandle handle, Vec3 position, const Quat &rotation,
+                Vec3 scale);
+  void SetLocalPosition(TransformHandle handle, Vec3 position);
+  void SetLocalRotation(TransformHandle handle, const Quat &rotation);
+  void SetLocalScale(TransformHandle handle, Vec3 scale);
+  Vec3 GetLocalPosition(TransformHandle handle) const;
+  Quat GetLocalRotation(TransformHandle handle) const;
+  Vec3 GetLocalScale(TransformHandle handle) const;
+
+  // World transform as of the last Update
+  const Mat4 &GetWorldMatrix(TransformHandle handle) const;
+
+  // Recompute world matrices of dirty nodes and their descendants
+  void Update(ThreadPool *pool = nullptr);
+
+  // Whether the node's world matrix was recomputed by the last Update
+  bool WasUpdated(TransformHandle handle) const;
+
+  void Reserve(size_t count);
+  size_t Size() const { return m_SlotToHandle.size(); }
+  const Stats &GetStats() const { return m_Stats; }
+
+private:
+  static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+
+  void Rebuild();
+  void MarkDirty(TransformHandle handle);
+  uint32_t UpdateRange(size_t begin, size_t end);
+
+  // Handle-indexed bookkeeping
+  std::vector<uint32_t> m_HandleToSlot;
+  std::vector<TransformHandle> m_HandleParent;
+  std::vector<uint8_t> m_HandleAlive;
+  std::vector<TransformHandle> m_FreeHandles;
+
+  // Slot-indexed data, depth-sorted after Rebuild
+  std::vector<TransformHandle> m_SlotToHandle;
+  std::vector<uint32_t> m_ParentSlot;
+  std::vector<float> m_PosX, m_PosY, m_PosZ;
+  std::vector<float> m_RotX, m_RotY, m_RotZ, m_RotW;
+  std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+  std::vector<Mat4> m_World;
+  std::vector<uint8_t> m_Dirty;   // set by setters, consumed by Update
+  std::vector<uint8_t> m_Updated; // dirty set of the last Update
+
+  // m_LevelOffsets[d]..m_LevelOffsets[d + 1] is the slot range of depth d
+  std::vector<uint32_t> m_LevelOffsets;
+
+  bool m_NeedsRebuild = false;
+  bool m_AnyDirty = false;
+  Stats m_Stats;
+};
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <ostream>
+#include <string>
 
 class FPSCounter {
 public:
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "utilities/ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stable LSD radix sort of `items` by a 64-bit key, 8 bits per pass.
+//
+// The input is split into one chunk per thread. Each pass counts digits per
+// chunk in parallel, turns the counts into per-chunk scatter offsets (digit
+// major, chunk minor, which keeps the sort stable) and scatters every chunk in
+// parallel. Passes whose digit is the same for every key are skipped, so
+// keys that only use a few bytes cost only a few passes.
+//
+// `scratch` is resized to match `items` and can be kept between calls to
+// avoid reallocating.
+template <class T, class KeyFn>
+void radix_sort(std::vector<T> &items, std::vector<T> &scratch, KeyFn key,
+                ThreadPool *pool = nullptr) {
+  constexpr size_t kRadix = 256;
+  constexpr size_t kSmallSort = 512;
+  constexpr size_t kMinChunk = 8192;
+
+  const size_t n = items.size();
+  if (n < 2) {
+    return;
+  }
+  if (n <= kSmallSort) {
+    std::stable_sort(items.begin(), items.end(), [&](const T &a, const T &b) {
+      return key(a) < key(b);
+    });
+    return;
+  }
+  scratch.resize(n);
+
+  size_t chunks = 1;
+  if (pool && pool->size() > 0) {
+    chunks = std::clamp<size_t>(n / kMinChunk, 1, pool->size() + 1);
+  }
+  const size_t chunk_size = (n + chunks - 1) / chunks;
+  auto for_each_chunk = [&](auto &&fn) {
+    if (chunks == 1) {
+      fn(0, 0, n);
+      return;
+    }
+    pool->parallel_for(0, chunks, 1, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        fn(c, c * chunk_size, std::min(n, (c + 1) * chunk_size));
+      }
+    });
+  };
+
+  // Bits that differ from the first key anywhere in the input
+  std::vector<uint64_t> chunk_diff(chunks, 0);
+  const uint64_t first_key = key(items[0]);
+  for_each_chunk([&](size_t c, size_t begin, size_t end) {
+    uint64_t diff = 0;
+    for (size_t i = begin; i < end; ++i) {
+      diff |= key(items[i]) ^ first_key;
+    }
+    chunk_diff[c] = diff;
+  });
+  uint64_t diff = 0;
+  for (uint64_t d : chunk_diff) {
+    diff |= d;
+  }
+
+  std::vector<std::array<size_t, kRadix>> counts(chunks);
+  std::vector<T> *src = &items;
+  std::vector<T> *dst = &scratch;
+
+  for (unsigned shift = 0; shift < 64; shift += 8) {
+    if (((diff >> shift) & 0xFF) == 0) {
+      continue;
+    }
+
+    for_each_chunk([&](size_t c, size_t begin, size_t end) {
+      std::array<size_t, kRadix> &count = counts[c];
+      count.fill(0);
+      for (size_t i = begin; i < end; ++i) {
+        count[(key((*src)[i]) >> shift) & 0xFF]++;
+      }
+    });
+
+    // Exclusive prefix over (digit, chunk) gives each chunk its write cursor
+    size_t offset = 0;
+    for (size_t digit = 0; digit < kRadix; ++digit) {
+      for (size_t c = 0; c < chunks; ++c) {
+        size_t count = counts[c][digit];
+        counts[c][digit] = offset;
+        offset += count;
+      }
+    }
+
+    for_each_chunk([&](size_t c, size_t begin, size_t end) {
+      std::array<size_t, kRadix> &cursor = counts[c];
+      for (size_t i = begin; i < end; ++i) {
+        const T &item = (*src)[i];
+        (*dst)[cursor[(key(item) >> shift) & 0xFF]++] = item;
+      }
+    });
+
+    std::swap(src, dst);
+  }
+
+  if (src != &items) {
+    items.swap(scratch);
+  }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned thread_count = default_thread_count()) {
+    workers_.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+      workers_.emplace_back([this] { worker_loop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Leave one core for the thread that owns the pool
+  static unsigned default_thread_count() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 1 ? hw - 1 : 1;
+  }
+
+  size_t size() const { return workers_.size(); }
+
+  template <class F> auto submit(F &&fn) -> std::future<decltype(fn())> {
+    using Result = decltype(fn());
+    auto task =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+    std::future<Result> future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace([task] { (*task)(); });
+    }
+    cv_.notify_one();
+    return future;
+  }
+
+  // Calls fn(begin, end) over [first, last) in chunks of at most `grain`.
+  // The calling thread takes part and keeps draining the queue while it
+  // waits, so nested calls from inside a task cannot deadlock the pool.
+  template <class F>
+  void parallel_for(size_t first, size_t last, size_t grain, F &&fn) {
+    if (first >= last) {
+      return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = (last - first + grain - 1) / grain;
+    if (chunks == 1 || workers_.empty()) {
+      fn(first, last);
+      return;
+    }
+
+    std::atomic<size_t> next{first};
+    std::atomic<size_t> pending{0};
+    auto run_chunks = [&] {
+      for (;;) {
+        size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+        if (begin >= last) {
+          break;
+        }
+        fn(begin, std::min(begin + grain, last));
+      }
+    };
+
+    const size_t helpers = std::min(chunks - 1, workers_.size());
+    pending.store(helpers, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < helpers; ++i) {
+        tasks_.emplace([&] {
+          run_chunks();
+          pending.fetch_sub(1, std::memory_order_release);
+        });
+      }
+    }
+    cv_.notify_all();
+
+    run_chunks();
+    while (pending.load(std::memory_order_acquire) != 0) {
+      if (!run_one_task()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+  bool run_one_task() {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (tasks_.empty()) {
+        return false;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+    return true;
+  }
+
+  void worker_loop() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (stopping_ && tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+};
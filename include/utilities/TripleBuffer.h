@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer, single-consumer triple buffer. The writer fills
+// write_buffer() and publishes it; the reader picks up the newest published
+// value with acquire(). Neither side ever waits for the other: the writer
+// always has a free buffer, and values the reader didn't get to in time are
+// overwritten.
+template <class T> class TripleBuffer {
+public:
+  // Writer side
+  T &write_buffer() { return buffers_[back_]; }
+
+  void publish() {
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+            kIndexMask;
+  }
+
+  // Reader side. Returns true if a newer value was published since the last
+  // call; read_buffer() is unchanged otherwise.
+  bool acquire() {
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  const T &read_buffer() const { return buffers_[front_]; }
+
+private:
+  static constexpr uint8_t kIndexMask = 3;
+  static constexpr uint8_t kFresh = 4;
+
+  T buffers_[3] = {};
+  uint8_t back_ = 0;
+  std::atomic<uint8_t> middle_{1};
+  uint8_t front_ = 2;
+};
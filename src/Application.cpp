@@ -1,7 +1,15 @@
 #include "Application.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "ImGuiRenderer.h"
 #include "imgui.h"
 #include "imgui_impl_sdl3.h"
 #include "imgui_impl_wgpu.h"
+#include "MeshRenderer.h"
+#include "PostProcessor.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 #include <stdio.h>
 
 Application::Application() {}
@@ -45,6 +53,16 @@ bool Application::Initialize(int width, int height, const char *title) {
   style.ScaleAllSizes(mainScale);
   style.FontScaleDpi = mainScale;
 
+  // Glyphs are rasterised as they are first drawn, so this only maps the
+  // font files
+  m_Fonts = std::make_unique<FontLibrary>();
+  const std::vector<std::string> fonts = FontLibrary::GetConfiguredFonts();
+  if (!fonts.empty() && m_Fonts->Load(io.Fonts, fonts)) {
+    const FontLibrary::Stats &fontStats = m_Fonts->GetStats();
+    printf("UI fonts: %u files (%.1f MB mapped) in %.2f ms\n", fontStats.files,
+           fontStats.fileBytes / (1024.0 * 1024.0), fontStats.loadMs);
+  }
+
   // Setup Platform backend
   ImGui_ImplSDL3_InitForOther(m_Window);
 
@@ -56,6 +74,24 @@ bool Application::Initialize(int width, int height, const char *title) {
     return false;
   }
 
+  // Drawn by the UI pass, so after the renderer
+  m_Telemetry = std::make_unique<TimeSeriesPlot>();
+  if (!m_Telemetry->Initialize(m_Renderer->GetDevice(), m_Renderer->GetQueue(),
+                               m_Renderer->GetSurfaceFormat())) {
+    fprintf(stderr, "Failed to initialize telemetry plot\n");
+    return false;
+  }
+
+  // Worker threads for scene update and culling
+  m_JobPool = std::make_unique<ThreadPool>();
+
+  // Started by Run; scenes can be loaded before that
+  m_Simulation = std::make_unique<Simulation>();
+
+  // Watches the files each loaded scene came from
+  m_HotReload = std::make_unique<HotReload>();
+  m_HotReload->Start();
+
   // Setup event callbacks
   SetupCallbacks();
 
@@ -65,9 +101,83 @@ bool Application::Initialize(int width, int height, const char *title) {
   return true;
 }
 
+bool Application::LoadScene(const char *path) {
+  m_Scene.Clear();
+  std::vector<std::string> files;
+  if (path) {
+    if (!ImportScene(path, m_Scene, m_JobPool.get(), &files)) {
+      return false;
+    }
+  } else {
+    BuildProceduralScene(m_Scene, m_ProceduralObjectCount);
+  }
+  m_ScenePath = path ? path : "";
+
+  // Resolve world bounds once so the camera can frame the scene
+  m_Scene.Update(m_JobPool.get());
+  m_Camera.Frame(m_Scene.ComputeBounds());
+  return SetupScene(files);
+}
+
+bool Application::SetupScene(const std::vector<std::string> &modelFiles,
+                             const std::vector<uint32_t> *previousMeshes) {
+  // Bob every 64th object so the BVH has moving objects to refit
+  TransformHierarchy &transforms = m_Scene.GetTransforms();
+  const auto &objects = m_Scene.GetObjects();
+  std::vector<Vec3> positions;
+  std::vector<float> phases;
+  m_SimObjects.clear();
+  for (size_t i = 0; i < objects.size(); i += 64) {
+    m_SimObjects.push_back(objects[i].transform);
+    positions.push_back(transforms.GetLocalPosition(objects[i].transform));
+    phases.push_back(static_cast<float>(i));
+  }
+  m_SimGeneration =
+      m_Simulation->Reset(std::move(positions), std::move(phases));
+
+  // A new scene may reuse the old topology version
+  m_BvhTopologyVersion = UINT64_MAX;
+  m_HotReload->Track(m_Scene, m_ScenePath, modelFiles);
+
+  if (!m_Renderer->UploadScene(m_Scene, previousMeshes)) {
+    fprintf(stderr, "Failed to upload scene\n");
+    return false;
+  }
+  return true;
+}
+
+void Application::ApplyReloads() {
+  HotReload::ImportedScene imported;
+  if (m_HotReload->TakeImportedScene(imported)) {
+    // Imported and updated on a worker; only the GPU upload is left, and
+    // only for the meshes the edit changed
+    const std::vector<uint32_t> previousMeshes =
+        MatchMeshes(m_Scene, *imported.scene);
+    m_Scene = std::move(*imported.scene);
+    if (SetupScene(imported.files, &previousMeshes)) {
+      m_SceneReloadMs = std::chrono::duration<double, std::milli>(
+                            HotReload::Clock::now() - imported.changed)
+                            .count();
+      printf("Reloaded %s in %.1f ms (import %.1f ms)\n", m_ScenePath.c_str(),
+             m_SceneReloadMs, imported.importMs);
+    }
+  }
+
+  // Re-read by the streamer's decode threads; each swaps in the Update that
+  // receives it
+  TextureStreamer &textures =
+      m_Renderer->GetMeshRenderer()->GetTextureStreamer();
+  for (const HotReload::TextureChange &change :
+       m_HotReload->TakeTextureChanges()) {
+    textures.Reload(change.texture, change.changed);
+  }
+}
+
 void Application::Run() {
   m_Running = true;
 
+  m_Simulation->Start();
+
   // Start render thread
   m_RenderThread = std::thread(&Application::RenderThreadFunc, this);
 
@@ -104,16 +214,22 @@ void Application::Shutdown() {
   if (m_RenderThread.joinable()) {
     m_RenderThread.join();
   }
+  m_Simulation.reset();
+  m_HotReload.reset();
 
   // Shutdown ImGui backends in correct order:
   // 1. Platform backend (SDL3)
   ImGui_ImplSDL3_Shutdown();
 
   // 2. Renderer backend (WGPU) - called by Renderer destructor
+  m_Telemetry.reset();
   m_Renderer.reset();
 
+  m_JobPool.reset();
+
   // 3. Destroy ImGui context
   ImGui::DestroyContext();
+  m_Fonts.reset();
 
   m_EventHandler.reset();
 
@@ -180,6 +296,10 @@ void Application::UpdateImGui() {
     ImGuiIO &io = ImGui::GetIO();
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                 1000.0f / io.Framerate, io.Framerate);
+    const FontLibrary::AtlasStats atlas = FontLibrary::GetAtlasStats(io.Fonts);
+    ImGui::Text("Font atlas: %dx%d (%.2f MB), fonts loaded in %.2f ms",
+                atlas.width, atlas.height, atlas.bytes / (1024.0 * 1024.0),
+                m_Fonts->GetStats().loadMs);
 
     // Display mouse position from event handler
     int mouseX, mouseY;
@@ -189,6 +309,274 @@ void Application::UpdateImGui() {
     ImGui::End();
   }
 
+  // Scene and culling statistics
+  {
+    MeshRenderer *meshRenderer = m_Renderer->GetMeshRenderer();
+    ImGui::Begin("Scene");
+    if (m_GpuCulling) {
+      GpuCuller::Stats gpu = meshRenderer->GetGpuCullStats();
+      ImGui::Text("Objects: %u visible / %zu total", gpu.visibleObjects,
+                  m_Scene.GetObjects().size());
+      ImGui::Text("Frustum culled: %u, occluded: %u%s", gpu.frustumCulled,
+                  gpu.occlusionCulled,
+                  gpu.occlusionActive ? "" : " (no depth history)");
+      ImGui::Text("Object rows uploaded: %u", gpu.objectsWritten);
+    } else {
+      const Bvh::CullStats &stats = m_Bvh.GetStats();
+      ImGui::Text("Objects: %zu visible / %zu total", m_VisibleObjects.size(),
+                  m_Scene.GetObjects().size());
+      ImGui::Text("BVH nodes: %zu", m_Bvh.GetNodeCount());
+      ImGui::Text("Cull: %.3f ms (%u nodes visited)", stats.cullMs,
+                  stats.nodesVisited);
+      ImGui::Text("Refit: %.3f ms (%u objects)", stats.refitMs,
+                  stats.refitObjects);
+      ImGui::Text("Build: %.2f ms", stats.buildMs);
+
+      const DrawQueue::Stats &batch = meshRenderer->GetBatchStats();
+      if (m_EnableBatching) {
+        ImGui::Text("Batching: %u draws -> %u, %u state changes -> %u",
+                    batch.drawCallsBefore, batch.drawCallsAfter,
+                    batch.stateChangesBefore, batch.stateChangesAfter);
+        ImGui::Text("Sort: %.3f ms (%u items)", batch.sortMs, batch.items);
+      }
+    }
+    const MeshRenderer::Stats &drawStats = meshRenderer->GetStats();
+    ImGui::Text("Draw calls: %u (%.3f ms CPU)", drawStats.drawCalls,
+                drawStats.cpuMs);
+    if (drawStats.fullDetailTriangles > 0) {
+      ImGui::Text("Triangles: %llu (%llu at full detail)",
+                  static_cast<unsigned long long>(drawStats.triangles),
+                  static_cast<unsigned long long>(drawStats.fullDetailTriangles));
+    } else {
+      ImGui::Text("Triangles: %llu",
+                  static_cast<unsigned long long>(drawStats.triangles));
+    }
+    ImGui::Text("Transforms updated: %u / %u",
+                m_Scene.GetTransforms().GetStats().updatedCount,
+                m_Scene.GetTransforms().GetStats().nodeCount);
+
+    TextureStreamer &textures = meshRenderer->GetTextureStreamer();
+    const TextureStreamer::Stats &texStats = textures.GetStats();
+    ImGui::Text("Textures: %u, %.1f / %.1f MB resident (%.1f MB wanted)",
+                texStats.textures, texStats.residentBytes / (1024.0 * 1024.0),
+                texStats.budgetBytes / (1024.0 * 1024.0),
+                texStats.wantedBytes / (1024.0 * 1024.0));
+    ImGui::Text("Streaming: %u decodes, %u uploads pending, %.2f MB this frame",
+                texStats.pendingRequests, texStats.pendingUploads,
+                texStats.uploadedBytes / (1024.0 * 1024.0));
+    ImGui::Text("Mip bias: %u levels, %u textures below wanted mip",
+                texStats.budgetBias, texStats.mipBiasMisses);
+    ImGui::Text("Compressed: %u textures, %.1f MB saved vs RGBA8",
+                texStats.compressedTextures,
+                (texStats.uncompressedBytes - texStats.residentBytes) /
+                    (1024.0 * 1024.0));
+    if (m_HotReload->IsRunning()) {
+      const HotReload::Stats reload = m_HotReload->GetStats();
+      ImGui::Text("Hot reload: %u files watched", reload.watchedFiles);
+      ImGui::Text("Last scene reload: %.1f ms (import %.1f ms)",
+                  m_SceneReloadMs, reload.importMs);
+      ImGui::Text("Last texture reload: %.1f ms (%u so far)",
+                  texStats.reloadMs, texStats.reloads);
+    }
+    ImGui::SliderInt("Texture budget (MB)", &m_TextureBudgetMb, 1, 4096, "%d",
+                     ImGuiSliderFlags_Logarithmic);
+    textures.SetBudget(uint64_t(m_TextureBudgetMb) << 20);
+    ImGui::Checkbox("GPU-driven culling", &m_GpuCulling);
+    ImGui::Checkbox("Frustum culling", &m_EnableCulling);
+    if (m_GpuCulling) {
+      ImGui::Checkbox("Occlusion culling (hi-Z)", &m_OcclusionCulling);
+    }
+    if (!m_GpuCulling) {
+      ImGui::Checkbox("Instanced batching", &m_EnableBatching);
+    }
+    ImGui::Checkbox("Mesh LODs", &m_EnableLods);
+    if (m_EnableLods) {
+      ImGui::SliderFloat("LOD error (px)", &m_LodPixelError, 0.25f, 16.0f,
+                         "%.2f", ImGuiSliderFlags_Logarithmic);
+    }
+    meshRenderer->SetLodSettings(m_EnableLods, m_LodPixelError);
+    ImGui::Checkbox("Animate objects", &m_AnimateObjects);
+    if (m_AnimateObjects) {
+      const Simulation::Stats sim = m_Simulation->GetStats();
+      ImGui::SliderFloat("Tick rate (Hz)", &m_TickRate, 10.0f, 240.0f, "%.0f");
+      ImGui::Text("Simulation: %llu ticks, %.3f ms/tick, %u skipped",
+                  static_cast<unsigned long long>(sim.ticks), sim.tickMs,
+                  sim.skippedTicks);
+    }
+    ImGui::InputInt("Procedural objects", &m_ProceduralObjectCount, 10000,
+                    100000);
+    m_ProceduralObjectCount = std::clamp(m_ProceduralObjectCount, 1, 4000000);
+    if (ImGui::Button("Regenerate")) {
+      m_RegenerateScene = true;
+    }
+    ImGui::SameLine();
+    ImGui::SliderFloat("Camera speed", &m_CameraSpeed, 1.0f, 500.0f, "%.1f",
+                       ImGuiSliderFlags_Logarithmic);
+    if (ImGui::Button("Frame scene")) {
+      m_Camera.Frame(m_Scene.ComputeBounds());
+    }
+    ImGui::TextDisabled("WASD/QE to move, right mouse to look");
+    ImGui::End();
+  }
+
+  // Post-processing stages and their GPU cost
+  {
+    PostProcessor::Settings &post = m_Renderer->GetPostProcessor()->GetSettings();
+    const Renderer::FrameTimings timings = m_Renderer->GetFrameTimings();
+    ImGui::Begin("Post-processing");
+    ImGui::Checkbox("Bloom", &post.bloom);
+    if (post.bloom) {
+      ImGui::SliderFloat("Threshold", &post.bloomThreshold, 0.0f, 4.0f);
+      ImGui::SliderFloat("Intensity", &post.bloomIntensity, 0.0f, 1.0f);
+    }
+    ImGui::Checkbox("Tonemap (ACES)", &post.tonemap);
+    ImGui::SliderFloat("Exposure", &post.exposure, 0.1f, 8.0f, "%.2f",
+                       ImGuiSliderFlags_Logarithmic);
+    ImGui::Checkbox("FXAA", &post.fxaa);
+    if (timings.gpuTimestamps) {
+      ImGui::Text("Scene: %.3f ms", timings.sceneMs);
+      ImGui::Text("Bloom: %.3f ms, tonemap: %.3f ms, FXAA: %.3f ms",
+                  timings.bloomMs, timings.tonemapMs, timings.fxaaMs);
+      ImGui::Text("Composite + UI: %.3f ms", timings.compositeMs);
+      ImGui::Text("GPU culling: %.3f ms, UI compute: %.3f ms", timings.cullMs,
+                  timings.uiComputeMs);
+      ImGui::Text("GPU total: %.3f ms", timings.GpuTotalMs());
+    } else {
+      ImGui::TextDisabled("GPU timings unavailable (no timestamp queries)");
+    }
+    ImGui::Text("Post recording: %.3f ms CPU", timings.postCpuMs);
+
+    DynamicResolution *resolution = m_Renderer->GetDynamicResolution();
+    DynamicResolution::Settings &scaling = resolution->GetSettings();
+    ImGui::SeparatorText("Resolution");
+    ImGui::Checkbox("Dynamic resolution", &scaling.enabled);
+    if (resolution->IsPinned()) {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(held while recording)");
+    }
+    ImGui::SliderFloat("Frame budget (ms)", &scaling.budgetMs, 4.0f, 50.0f,
+                       "%.1f");
+    ImGui::SliderFloat("Min scale", &scaling.minScale, 0.25f, 1.0f, "%.2f");
+    ImGui::SliderFloat("Max scale", &scaling.maxScale, scaling.minScale, 1.0f,
+                       "%.2f");
+    ImGui::Text("Render %dx%d for %dx%d (%.0f%%), %s",
+                m_Renderer->GetRenderWidth(), m_Renderer->GetRenderHeight(),
+                m_Renderer->GetWidth(), m_Renderer->GetHeight(),
+                resolution->GetScale() * 100.0f,
+                timings.gpuTimestamps ? "GPU timed" : "CPU frame interval");
+    ImGui::PlotLines("Scale", resolution->GetScaleHistory(),
+                     DynamicResolution::kHistorySize,
+                     resolution->GetHistoryOffset(), nullptr, 0.0f, 1.0f,
+                     ImVec2(0.0f, 60.0f));
+    ImGui::PlotLines("Frame (ms)", resolution->GetFrameMsHistory(),
+                     DynamicResolution::kHistorySize,
+                     resolution->GetHistoryOffset(), nullptr, 0.0f,
+                     scaling.budgetMs * 2.0f, ImVec2(0.0f, 60.0f));
+    ImGui::End();
+  }
+
+  // Frame capture to disk
+  {
+    FrameCapture *capture = m_Renderer->GetFrameCapture();
+    ImGui::Begin("Capture");
+    ImGui::BeginDisabled(capture->IsBusy());
+    ImGui::Combo("Format", &m_CaptureFormat, "PNG sequence\0Y4M video\0");
+    ImGui::InputText("Directory", m_CaptureDirectory,
+                     sizeof(m_CaptureDirectory));
+    ImGui::EndDisabled();
+    if (ImGui::Button(capture->IsRecording() ? "Stop" : "Record")) {
+      ToggleCapture();
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(F12)");
+    const FrameCapture::Stats stats = capture->GetStats();
+    ImGui::Text("Frames: %u captured, %u written, %u dropped", stats.captured,
+                stats.written, stats.dropped);
+    ImGui::Text("Writer: %.2f ms/frame, %u waiting", stats.writeMs,
+                stats.queued);
+    ImGui::TextDisabled("%s", m_Renderer->CanCaptureSurface()
+                                  ? "Captures the window, UI included"
+                                  : "Captures the scene (no surface copies)");
+    ImGui::End();
+  }
+
+  // UI rendering, with a synthetic load to compare the two renderers
+  {
+    const Renderer::FrameTimings timings = m_Renderer->GetFrameTimings();
+    ImGui::Begin("UI renderer");
+    bool stock = m_Renderer->IsStockImGuiRenderer();
+    if (ImGui::Checkbox("Stock ImGui renderer", &stock)) {
+      m_Renderer->SetStockImGuiRenderer(stock);
+    }
+    ImGui::SliderInt("Stress (lines)", &m_UiStressLines, 0, 200000, "%d",
+                     ImGuiSliderFlags_Logarithmic);
+    ImGui::Text("Recording: %.3f ms CPU", timings.uiCpuMs);
+    if (const ImGuiRenderer *uiRenderer = m_Renderer->GetImGuiRenderer();
+        uiRenderer && !stock) {
+      const ImGuiRenderer::Stats &stats = uiRenderer->GetStats();
+      ImGui::Text("%u vertices, %u indices", stats.vertices, stats.indices);
+      ImGui::Text("%u commands in %u draws, %u bind groups", stats.commands,
+                  stats.drawCalls, stats.bindGroups);
+      ImGui::Text("Buffer: %.2f MB", stats.bufferBytes / (1024.0 * 1024.0));
+    }
+    ImGui::End();
+
+    if (m_UiStressLines > 0) {
+      ImGui::SetNextWindowSize(ImVec2(400.0f, 300.0f), ImGuiCond_FirstUseEver);
+      ImGui::Begin("UI stress");
+      const ImVec2 origin = ImGui::GetCursorScreenPos();
+      const ImVec2 size = ImGui::GetContentRegionAvail();
+      ImDrawList *drawList = ImGui::GetWindowDrawList();
+      for (int i = 0; i < m_UiStressLines; ++i) {
+        const float t = static_cast<float>(i) / m_UiStressLines;
+        const ImVec2 from(origin.x + t * size.x, origin.y);
+        const ImVec2 to(origin.x + size.x - t * size.x, origin.y + size.y);
+        drawList->AddLine(from, to, IM_COL32(255, 255 * (i & 1), 128, 96));
+      }
+      ImGui::End();
+    }
+  }
+
+  // Telemetry: a long synthetic series plotted through GPU reduction
+  {
+    if (m_StreamTelemetry) {
+      // Slow drift, a faster wobble, noise and a spike every 250k samples
+      m_TelemetrySamples.resize(static_cast<size_t>(m_TelemetryRate));
+      for (float &sample : m_TelemetrySamples) {
+        const double t = static_cast<double>(m_TelemetryTick++);
+        m_TelemetryNoise ^= m_TelemetryNoise << 13;
+        m_TelemetryNoise ^= m_TelemetryNoise >> 17;
+        m_TelemetryNoise ^= m_TelemetryNoise << 5;
+        const float noise = (m_TelemetryNoise >> 8) / 16777216.0f;
+        sample = static_cast<float>(std::sin(t * 1e-5) +
+                                    0.25 * std::sin(t * 0.013)) +
+                 0.1f * noise + (m_TelemetryTick % 250000 == 0 ? 2.0f : 0.0f);
+      }
+      m_Telemetry->Append(m_TelemetrySamples.data(),
+                          m_TelemetrySamples.size());
+    }
+
+    ImGui::Begin("Telemetry");
+    ImGui::Checkbox("Stream", &m_StreamTelemetry);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+      m_Telemetry->Clear();
+      m_TelemetryTick = 0;
+    }
+    ImGui::SliderInt("Samples per frame", &m_TelemetryRate, 1, 1000000, "%d",
+                     ImGuiSliderFlags_Logarithmic);
+    m_Telemetry->Plot("signal");
+    const TimeSeriesPlot::Stats &stats = m_Telemetry->GetStats();
+    ImGui::Text("%u samples stored (%.1f MB), %u visible in %u columns",
+                stats.stored, stats.bufferBytes / (1024.0 * 1024.0),
+                stats.visible, stats.columns);
+    ImGui::Text("%llu appended, %u reductions",
+                static_cast<unsigned long long>(stats.appended),
+                stats.reductions);
+    ImGui::TextDisabled("Wheel to zoom, drag to pan, double-click to reset");
+    ImGui::End();
+  }
+
   // 3. Show another simple window
   if (m_ShowAnotherWindow) {
     ImGui::Begin("Another Window", &m_ShowAnotherWindow);
@@ -202,7 +590,101 @@ void Application::UpdateImGui() {
   ImGui::Render();
 }
 
+void Application::UpdateCamera(float dt) {
+  ImGuiIO &io = ImGui::GetIO();
+
+  if (!io.WantCaptureMouse && ImGui::IsMouseDown(ImGuiMouseButton_Right)) {
+    m_Camera.Rotate(-io.MouseDelta.x * 0.005f, -io.MouseDelta.y * 0.005f);
+  }
+
+  if (io.WantCaptureKeyboard) {
+    return;
+  }
+  Vec3 move;
+  if (ImGui::IsKeyDown(ImGuiKey_W))
+    move += m_Camera.Forward();
+  if (ImGui::IsKeyDown(ImGuiKey_S))
+    move -= m_Camera.Forward();
+  if (ImGui::IsKeyDown(ImGuiKey_D))
+    move += m_Camera.Right();
+  if (ImGui::IsKeyDown(ImGuiKey_A))
+    move -= m_Camera.Right();
+  if (ImGui::IsKeyDown(ImGuiKey_E))
+    move += Vec3{0.0f, 1.0f, 0.0f};
+  if (ImGui::IsKeyDown(ImGuiKey_Q))
+    move -= Vec3{0.0f, 1.0f, 0.0f};
+  float speed =
+      m_CameraSpeed * (ImGui::IsKeyDown(ImGuiKey_LeftShift) ? 4.0f : 1.0f);
+  m_Camera.position += move * (speed * dt);
+}
+
+void Application::UpdateScene() {
+  if (m_RegenerateScene) {
+    m_RegenerateScene = false;
+    LoadScene(nullptr);
+  }
+
+  auto now = std::chrono::high_resolution_clock::now();
+  float dt = std::chrono::duration<float>(now - m_LastFrameTime).count();
+  m_LastFrameTime = now;
+  dt = std::clamp(dt, 0.0f, 0.1f);
+
+  UpdateCamera(dt);
+
+  // Blend the simulation's two latest ticks; nothing here waits for it
+  m_Simulation->SetPaused(!m_AnimateObjects);
+  m_Simulation->SetTickRate(m_TickRate);
+  m_Simulation->Acquire();
+  const Simulation::Snapshot &snapshot = m_Simulation->GetSnapshot();
+  if (m_AnimateObjects && snapshot.generation == m_SimGeneration &&
+      snapshot.current.size() == m_SimObjects.size()) {
+    const float blend =
+        Simulation::GetBlend(snapshot, Simulation::Clock::now());
+    TransformHierarchy &transforms = m_Scene.GetTransforms();
+    for (size_t i = 0; i < m_SimObjects.size(); ++i) {
+      transforms.SetLocalPosition(
+          m_SimObjects[i],
+          Lerp(snapshot.previous[i], snapshot.current[i], blend));
+    }
+  }
+
+  m_Scene.Update(m_JobPool.get());
+
+  float aspect = m_Height > 0 ? static_cast<float>(m_Width) / m_Height : 1.0f;
+  m_ViewProj = m_Camera.ViewProjection(aspect);
+
+  if (m_GpuCulling) {
+    // Visibility is resolved on the GPU; rebuild the BVH when switching back
+    m_BvhTopologyVersion = UINT64_MAX;
+    m_VisibleObjects.clear();
+    return;
+  }
+
+  // New or removed objects invalidate the tree; plain motion only refits it
+  if (m_BvhTopologyVersion != m_Scene.GetTopologyVersion()) {
+    m_Bvh.Build(m_Scene.GetWorldBounds());
+    m_BvhTopologyVersion = m_Scene.GetTopologyVersion();
+  } else {
+    m_Bvh.Refit(m_Scene.GetWorldBounds(), m_Scene.GetMovedObjects());
+  }
+
+  if (m_EnableCulling) {
+    m_Bvh.Cull(Frustum::FromViewProjection(m_ViewProj), m_VisibleObjects,
+               m_JobPool.get());
+  } else {
+    m_VisibleObjects.resize(m_Scene.GetObjects().size());
+    std::iota(m_VisibleObjects.begin(), m_VisibleObjects.end(), 0u);
+  }
+}
+
 void Application::RenderFrame() {
+  // Advance camera, transforms and culling before recording any GPU work
+  UpdateScene();
+
+  if (m_CaptureToggleRequested.exchange(false)) {
+    ToggleCapture();
+  }
+
   // Update clear color
   m_Renderer->SetClearColor(m_ClearColor[0], m_ClearColor[1], m_ClearColor[2],
                             m_ClearColor[3]);
@@ -210,9 +692,22 @@ void Application::RenderFrame() {
   // Begin rendering
   m_Renderer->BeginFrame();
 
+  // Draw the objects that survived culling
+  if (m_GpuCulling) {
+    m_Renderer->RenderSceneGpuDriven(m_Scene, m_ViewProj, m_Camera.position,
+                                     m_EnableCulling, m_OcclusionCulling);
+  } else {
+    m_Renderer->RenderScene(m_Scene, m_ViewProj, m_Camera.position,
+                            m_VisibleObjects, m_EnableBatching,
+                            m_JobPool.get());
+  }
+
   // Update ImGui
   UpdateImGui();
 
+  // Reduce plotted series before the UI pass draws them
+  m_Telemetry->Prepare(m_Renderer->GetGpuTimer(), Renderer::kUiComputeScope);
+
   // Render ImGui
   m_Renderer->RenderImGui(ImGui::GetDrawData());
 
@@ -220,6 +715,20 @@ void Application::RenderFrame() {
   m_Renderer->EndFrame();
 }
 
+void Application::ToggleCapture() {
+  FrameCapture *capture = m_Renderer->GetFrameCapture();
+  if (capture->IsRecording()) {
+    capture->Stop();
+    return;
+  }
+  FrameCapture::Settings settings;
+  settings.format = static_cast<FrameCapture::Format>(m_CaptureFormat);
+  settings.directory = m_CaptureDirectory;
+  if (!capture->Start(settings)) {
+    fprintf(stderr, "Failed to start frame capture\n");
+  }
+}
+
 // Callback implementations
 void Application::OnQuit() {
   printf("Quit requested\n");
@@ -236,6 +745,8 @@ void Application::OnKey(SDL_Keycode key, bool pressed) {
       bool isFullscreen = SDL_GetWindowFlags(m_Window) & SDL_WINDOW_FULLSCREEN;
       SDL_SetWindowFullscreen(m_Window, !isFullscreen);
       printf("Toggled fullscreen\n");
+    } else if (key == SDLK_F12) {
+      m_CaptureToggleRequested = true;
     } else if (key == SDLK_SPACE) {
       printf("Space key pressed\n");
     }
@@ -263,6 +774,7 @@ void Application::OnWindowResize(int width, int height) {
 
 void Application::RenderThreadFunc() {
   printf("Render thread started\n");
+  m_LastFrameTime = std::chrono::high_resolution_clock::now();
 
   // Render first frame immediately
   RenderFrame();
@@ -278,6 +790,9 @@ void Application::RenderThreadFunc() {
       m_ResizePending = false;
     }
 
+    // Frame boundary: nothing of the last frame is still being recorded
+    ApplyReloads();
+
     // Render frame at full speed
     RenderFrame();
   }
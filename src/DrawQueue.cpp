@@ -0,0 +1,97 @@
+#include "DrawQueue.h"
+#include "utilities/RadixSort.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+namespace {
+
+constexpr uint32_t kDepthShift = 0;
+constexpr uint32_t kMeshShift = kDepthShift + DrawQueue::kDepthBits;
+constexpr uint32_t kMaterialShift = kMeshShift + DrawQueue::kMeshBits;
+constexpr uint32_t kPipelineShift = kMaterialShift + DrawQueue::kMaterialBits;
+constexpr uint64_t kStateMask = ~((uint64_t(1) << kMeshShift) - 1);
+
+static_assert(kPipelineShift + DrawQueue::kPipelineBits == 64,
+              "sort key fields must fill 64 bits");
+
+uint32_t Field(uint64_t key, uint32_t shift, uint32_t bits) {
+  return static_cast<uint32_t>((key >> shift) & ((uint64_t(1) << bits) - 1));
+}
+
+// Pipeline, material and mesh switches between two consecutive draws
+uint32_t CountStateChanges(uint64_t previous, uint64_t current) {
+  uint32_t changes = 0;
+  changes += Field(previous, kPipelineShift, DrawQueue::kPipelineBits) !=
+             Field(current, kPipelineShift, DrawQueue::kPipelineBits);
+  changes += Field(previous, kMaterialShift, DrawQueue::kMaterialBits) !=
+             Field(current, kMaterialShift, DrawQueue::kMaterialBits);
+  changes += Field(previous, kMeshShift, DrawQueue::kMeshBits) !=
+             Field(current, kMeshShift, DrawQueue::kMeshBits);
+  return changes;
+}
+
+} // namespace
+
+uint64_t DrawQueue::MakeKey(uint32_t pipeline, uint32_t material, uint32_t mesh,
+                            float depth) {
+  // Non-negative floats order the same as their bit patterns
+  const uint32_t depthBits =
+      std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> (32 - kDepthBits);
+  auto mask = [](uint32_t value, uint32_t bits) {
+    return uint64_t(value) & ((uint64_t(1) << bits) - 1);
+  };
+  return (mask(pipeline, kPipelineBits) << kPipelineShift) |
+         (mask(material, kMaterialBits) << kMaterialShift) |
+         (mask(mesh, kMeshBits) << kMeshShift) | uint64_t(depthBits);
+}
+
+void DrawQueue::Clear() {
+  m_Items.clear();
+  m_Batches.clear();
+  m_Stats = {};
+}
+
+void DrawQueue::Build(ThreadPool *pool) {
+  m_Batches.clear();
+  m_Stats = {};
+  m_Stats.items = static_cast<uint32_t>(m_Items.size());
+  if (m_Items.empty()) {
+    return;
+  }
+
+  // Cost of drawing in submission order: the first draw binds everything
+  m_Stats.drawCallsBefore = m_Stats.items;
+  m_Stats.stateChangesBefore = 3;
+  for (size_t i = 1; i < m_Items.size(); ++i) {
+    m_Stats.stateChangesBefore +=
+        CountStateChanges(m_Items[i - 1].key, m_Items[i].key);
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  radix_sort(m_Items, m_Scratch, [](const Item &item) { return item.key; },
+             pool);
+  m_Stats.sortMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::high_resolution_clock::now() - start)
+                       .count();
+
+  // Merge runs with equal state bits into one instanced draw each
+  uint64_t previous = 0;
+  for (uint32_t i = 0; i < m_Items.size(); ++i) {
+    const uint64_t state = m_Items[i].key & kStateMask;
+    if (m_Batches.empty() || state != (previous & kStateMask)) {
+      m_Stats.stateChangesAfter +=
+          m_Batches.empty() ? 3 : CountStateChanges(previous, state);
+      Batch batch;
+      batch.pipeline = Field(state, kPipelineShift, kPipelineBits);
+      batch.material = Field(state, kMaterialShift, kMaterialBits);
+      batch.mesh = Field(state, kMeshShift, kMeshBits);
+      batch.firstInstance = i;
+      batch.instanceCount = 0;
+      m_Batches.push_back(batch);
+      previous = state;
+    }
+    m_Batches.back().instanceCount++;
+  }
+  m_Stats.drawCallsAfter = static_cast<uint32_t>(m_Batches.size());
+}
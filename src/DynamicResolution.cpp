@@ -0,0 +1,69 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Scales are multiples of this, so small timing noise can't reallocate the
+// render targets
+constexpr float kScaleStep = 1.0f / 32.0f;
+// Frames to hold a new scale: timestamp readback lags by up to three frames,
+// and the smoothed time needs a few samples at the new scale
+constexpr uint32_t kHoldFrames = 8;
+constexpr double kSmoothing = 0.2;
+// Climb only while this far under budget, and only part of the way
+constexpr double kRaiseHeadroom = 0.9;
+constexpr float kRaiseRate = 0.25f;
+// A CPU frame interval includes the wait for vsync
+constexpr double kCpuBudgetSlack = 1.25;
+
+} // namespace
+
+float DynamicResolution::Update(double frameMs, bool gpuTimed) {
+  m_ScaleHistory[m_HistoryOffset] = m_Scale;
+  m_FrameMsHistory[m_HistoryOffset] = static_cast<float>(frameMs);
+  m_HistoryOffset = (m_HistoryOffset + 1) % kHistorySize;
+  if (m_Pinned) {
+    m_SmoothedMs = 0.0;
+    return m_Scale;
+  }
+
+  const float minScale = std::clamp(m_Settings.minScale, kScaleStep, 1.0f);
+  const float maxScale = std::clamp(m_Settings.maxScale, minScale, 1.0f);
+  if (!m_Settings.enabled) {
+    m_Scale = maxScale;
+    m_SmoothedMs = 0.0;
+    return m_Scale;
+  }
+  if (frameMs <= 0.0) {
+    return m_Scale;
+  }
+
+  m_SmoothedMs = m_SmoothedMs > 0.0
+                     ? m_SmoothedMs + (frameMs - m_SmoothedMs) * kSmoothing
+                     : frameMs;
+  if (m_HoldFrames > 0) {
+    --m_HoldFrames;
+    return m_Scale;
+  }
+
+  const double budget =
+      m_Settings.budgetMs * (gpuTimed ? 1.0 : kCpuBudgetSlack);
+  const float ideal =
+      m_Scale * static_cast<float>(std::sqrt(budget / m_SmoothedMs));
+  float next = m_Scale;
+  if (ideal < m_Scale) {
+    next = std::floor(ideal / kScaleStep) * kScaleStep;
+  } else if (m_SmoothedMs < budget * kRaiseHeadroom) {
+    next = std::ceil((m_Scale + (ideal - m_Scale) * kRaiseRate) / kScaleStep) *
+           kScaleStep;
+  }
+  next = std::clamp(next, minScale, maxScale);
+
+  if (next != m_Scale) {
+    m_Scale = next;
+    m_SmoothedMs = 0.0;
+    m_HoldFrames = kHoldFrames;
+  }
+  return m_Scale;
+}
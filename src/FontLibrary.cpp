@@ -0,0 +1,107 @@
+#include "FontLibrary.h"
+#include "imgui.h"
+#include <chrono>
+#include <cstdlib>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RENDERER_MAP_FONTS 1
+#endif
+
+FontLibrary::FontLibrary() {}
+
+FontLibrary::~FontLibrary() {
+#ifdef RENDERER_MAP_FONTS
+  for (const Mapping &mapping : m_Mappings) {
+    munmap(mapping.data, mapping.size);
+  }
+#endif
+}
+
+std::vector<std::string> FontLibrary::GetConfiguredFonts() {
+  std::vector<std::string> files;
+  const char *list = std::getenv("RENDERER_UI_FONTS");
+  if (!list) {
+    return files;
+  }
+  std::string current;
+  for (const char *c = list;; ++c) {
+    if (*c == ';' || *c == '\0') {
+      if (!current.empty()) {
+        files.push_back(std::move(current));
+        current.clear();
+      }
+      if (*c == '\0') {
+        break;
+      }
+    } else {
+      current += *c;
+    }
+  }
+  return files;
+}
+
+bool FontLibrary::Load(ImFontAtlas *atlas,
+                       const std::vector<std::string> &files) {
+  const auto start = std::chrono::steady_clock::now();
+  for (const std::string &file : files) {
+    ImFontConfig config;
+    // Size 0 follows style.FontSizeBase; later files fill in missing glyphs
+    config.MergeMode = m_Stats.files > 0;
+    ImFont *font = nullptr;
+#ifdef RENDERER_MAP_FONTS
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info = {};
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size <= 0) {
+      fprintf(stderr, "Failed to open font %s\n", file.c_str());
+      if (fd >= 0) {
+        close(fd);
+      }
+      continue;
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      fprintf(stderr, "Failed to map font %s\n", file.c_str());
+      continue;
+    }
+    // The atlas reads the mapping in place and never writes to it
+    config.FontDataOwnedByAtlas = false;
+    font = atlas->AddFontFromMemoryTTF(data, static_cast<int>(size), 0.0f,
+                                       &config);
+    if (!font) {
+      munmap(data, size);
+    } else {
+      m_Mappings.push_back({data, size});
+      m_Stats.fileBytes += size;
+    }
+#else
+    font = atlas->AddFontFromFileTTF(file.c_str(), 0.0f, &config);
+#endif
+    if (!font) {
+      fprintf(stderr, "Failed to load font %s\n", file.c_str());
+      continue;
+    }
+    m_Stats.files++;
+  }
+  m_Stats.loadMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return m_Stats.files > 0;
+}
+
+FontLibrary::AtlasStats FontLibrary::GetAtlasStats(const ImFontAtlas *atlas) {
+  AtlasStats stats;
+  if (const ImTextureData *texture = atlas->TexData) {
+    stats.width = texture->Width;
+    stats.height = texture->Height;
+    stats.bytes = uint64_t(texture->Width) * texture->Height *
+                  texture->BytesPerPixel;
+  }
+  return stats;
+}
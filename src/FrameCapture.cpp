@@ -0,0 +1,396 @@
+#include "FrameCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace {
+
+constexpr uint32_t kRowAlignment = 256; // bytesPerRow of texture copies
+
+std::string Timestamp() {
+  const std::time_t now = std::time(nullptr);
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", std::localtime(&now));
+  return buffer;
+}
+
+// Full-range BT.601 (the Y4M "C420jpeg" colour space) in 8.8 fixed point
+uint8_t Luma(int r, int g, int b) {
+  return static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+uint8_t ChromaBlue(int r, int g, int b) {
+  return static_cast<uint8_t>(
+      std::clamp(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128, 0, 255));
+}
+
+uint8_t ChromaRed(int r, int g, int b) {
+  return static_cast<uint8_t>(
+      std::clamp(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128, 0, 255));
+}
+
+} // namespace
+
+FrameCapture::FrameCapture() {}
+
+FrameCapture::~FrameCapture() { Shutdown(); }
+
+void FrameCapture::Initialize(WGPUDevice device) { m_Device = device; }
+
+void FrameCapture::Shutdown() {
+  m_Recording = false;
+  m_Stopping = false;
+  JoinWriters();
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_Queue.clear();
+  }
+  for (Slot &slot : m_Slots) {
+    if (slot.buffer) {
+      // Aborts a pending map so its callback can't outlive this object
+      wgpuBufferDestroy(slot.buffer);
+      wgpuBufferRelease(slot.buffer);
+      slot.buffer = nullptr;
+    }
+    slot.size = 0;
+    slot.state = SlotState::Free;
+  }
+  if (m_Video) {
+    fclose(m_Video);
+    m_Video = nullptr;
+  }
+}
+
+bool FrameCapture::IsSupportedFormat(WGPUTextureFormat format) {
+  return format == WGPUTextureFormat_RGBA8Unorm ||
+         format == WGPUTextureFormat_RGBA8UnormSrgb ||
+         format == WGPUTextureFormat_BGRA8Unorm ||
+         format == WGPUTextureFormat_BGRA8UnormSrgb;
+}
+
+bool FrameCapture::Start(const Settings &settings) {
+  if (IsBusy() || !m_Device) {
+    return false;
+  }
+  m_Settings = settings;
+
+  const std::string name = "capture-" + Timestamp();
+  std::error_code error;
+  if (m_Settings.format == Format::Png) {
+    m_Settings.directory /= name;
+  }
+  std::filesystem::create_directories(m_Settings.directory, error);
+  if (error) {
+    fprintf(stderr, "Failed to create capture directory %s: %s\n",
+            m_Settings.directory.string().c_str(), error.message().c_str());
+    return false;
+  }
+
+  uint32_t writers = 1;
+  if (m_Settings.format == Format::Y4m) {
+    const std::filesystem::path path = m_Settings.directory / (name + ".y4m");
+    m_Video = fopen(path.string().c_str(), "wb");
+    if (!m_Video) {
+      fprintf(stderr, "Failed to open %s\n", path.string().c_str());
+      return false;
+    }
+    m_VideoWidth = 0;
+    m_VideoHeight = 0;
+    printf("Capturing video to %s\n", path.string().c_str());
+  } else {
+    // PNG frames are independent, so deflate can run on several threads.
+    // Fast compression keeps the writers ahead of the frame rate.
+    stbi_write_png_compression_level = 1;
+    writers = std::clamp(std::thread::hardware_concurrency() / 4, 1u, 4u);
+    printf("Capturing PNG frames to %s\n",
+           m_Settings.directory.string().c_str());
+  }
+
+  m_FrameIndex = 0;
+  m_Captured = 0;
+  m_Written = 0;
+  m_Dropped = 0;
+  m_WriteMs = 0.0;
+  for (uint32_t i = 0; i < writers; ++i) {
+    m_Writers.emplace_back(&FrameCapture::WriterLoop, this);
+  }
+  m_Recording = true;
+  return true;
+}
+
+void FrameCapture::Stop() {
+  if (m_Recording) {
+    m_Recording = false;
+    m_Stopping = true;
+  }
+}
+
+void FrameCapture::Capture(WGPUCommandEncoder encoder, WGPUTexture texture,
+                           WGPUTextureFormat format, uint32_t width,
+                           uint32_t height) {
+  if (!m_Recording || !IsSupportedFormat(format) || width == 0 ||
+      height == 0) {
+    return;
+  }
+
+  Slot *slot = nullptr;
+  for (uint32_t i = 0; i < kSlots && !slot; ++i) {
+    Slot &candidate = m_Slots[(m_NextSlot + i) % kSlots];
+    if (candidate.state == SlotState::Free) {
+      slot = &candidate;
+      m_NextSlot = (m_NextSlot + i + 1) % kSlots;
+    }
+  }
+  if (!slot) {
+    ++m_Dropped;
+    return;
+  }
+
+  const uint32_t bytesPerRow =
+      (width * 4 + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+  const uint64_t size = uint64_t(bytesPerRow) * height;
+  if (slot->size < size) {
+    if (slot->buffer) {
+      wgpuBufferRelease(slot->buffer);
+    }
+    WGPUBufferDescriptor desc = {};
+    desc.label = {"Frame capture readback", WGPU_STRLEN};
+    desc.size = size;
+    desc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    slot->buffer = wgpuDeviceCreateBuffer(m_Device, &desc);
+    slot->size = slot->buffer ? size : 0;
+    if (!slot->buffer) {
+      ++m_Dropped;
+      return;
+    }
+  }
+
+  WGPUTexelCopyTextureInfo source = {};
+  source.texture = texture;
+  source.aspect = WGPUTextureAspect_All;
+  WGPUTexelCopyBufferInfo destination = {};
+  destination.buffer = slot->buffer;
+  destination.layout.bytesPerRow = bytesPerRow;
+  destination.layout.rowsPerImage = height;
+  const WGPUExtent3D extent = {width, height, 1};
+  wgpuCommandEncoderCopyTextureToBuffer(encoder, &source, &destination,
+                                        &extent);
+
+  slot->width = width;
+  slot->height = height;
+  slot->bytesPerRow = bytesPerRow;
+  slot->bgra = format == WGPUTextureFormat_BGRA8Unorm ||
+               format == WGPUTextureFormat_BGRA8UnormSrgb;
+  slot->frameIndex = m_FrameIndex++;
+  slot->state = SlotState::Recorded;
+  ++m_Captured;
+}
+
+void FrameCapture::Submitted() {
+  bool idle = true;
+  for (Slot &slot : m_Slots) {
+    if (slot.state == SlotState::Released) {
+      wgpuBufferUnmap(slot.buffer);
+      slot.state = SlotState::Free;
+    } else if (slot.state == SlotState::Recorded) {
+      slot.state = SlotState::Mapping;
+      WGPUBufferMapCallbackInfo callbackInfo = {};
+      callbackInfo.mode = WGPUCallbackMode_AllowSpontaneous;
+      callbackInfo.callback = OnSlotMapped;
+      callbackInfo.userdata1 = this;
+      callbackInfo.userdata2 = &slot;
+      wgpuBufferMapAsync(slot.buffer, WGPUMapMode_Read, 0,
+                         uint64_t(slot.bytesPerRow) * slot.height,
+                         callbackInfo);
+    }
+    idle = idle && slot.state == SlotState::Free;
+  }
+
+  // Every captured frame has been written, so joining doesn't wait
+  if (m_Stopping && idle && m_ActiveWriters == 0) {
+    JoinWriters();
+    if (m_Video) {
+      fclose(m_Video);
+      m_Video = nullptr;
+    }
+    m_Stopping = false;
+    printf("Capture finished: %u frames written, %u dropped\n",
+           m_Written.load(), m_Dropped.load());
+  }
+}
+
+void FrameCapture::OnSlotMapped(WGPUMapAsyncStatus status, WGPUStringView,
+                                void *userdata1, void *userdata2) {
+  auto *self = static_cast<FrameCapture *>(userdata1);
+  auto *slot = static_cast<Slot *>(userdata2);
+  if (status != WGPUMapAsyncStatus_Success) {
+    ++self->m_Dropped;
+    slot->state = SlotState::Free;
+    return;
+  }
+  slot->state = SlotState::Queued;
+  {
+    std::lock_guard<std::mutex> lock(self->m_QueueMutex);
+    self->m_Queue.push_back(slot);
+  }
+  self->m_QueueCondition.notify_one();
+}
+
+void FrameCapture::WriterLoop() {
+  Frame frame;
+  std::vector<uint8_t> yuv;
+  for (;;) {
+    Slot *slot = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_QueueMutex);
+      m_QueueCondition.wait(
+          lock, [this] { return m_ExitWriters || !m_Queue.empty(); });
+      if (m_ExitWriters) {
+        return;
+      }
+      slot = m_Queue.front();
+      m_Queue.pop_front();
+      ++m_ActiveWriters;
+    }
+
+    CopyOut(*slot, frame);
+    auto start = std::chrono::high_resolution_clock::now();
+    const bool ok = m_Settings.format == Format::Png ? WritePng(frame)
+                                                       : WriteY4m(frame, yuv);
+    m_WriteMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - start)
+                    .count();
+    ++(ok ? m_Written : m_Dropped);
+    --m_ActiveWriters;
+  }
+}
+
+void FrameCapture::CopyOut(Slot &slot, Frame &frame) {
+  slot.state = SlotState::Writing;
+  frame.width = slot.width;
+  frame.height = slot.height;
+  frame.index = slot.frameIndex;
+  frame.rgba.resize(size_t(slot.width) * slot.height * 4);
+
+  const auto *mapped = static_cast<const uint8_t *>(wgpuBufferGetConstMappedRange(
+      slot.buffer, 0, uint64_t(slot.bytesPerRow) * slot.height));
+  if (mapped) {
+    for (uint32_t y = 0; y < slot.height; ++y) {
+      const uint8_t *src = mapped + size_t(y) * slot.bytesPerRow;
+      uint8_t *dst = frame.rgba.data() + size_t(y) * slot.width * 4;
+      std::memcpy(dst, src, size_t(slot.width) * 4);
+      // Swizzle to RGBA; alpha is whatever the UI blended, so make it opaque
+      for (uint32_t x = 0; x < slot.width; ++x, dst += 4) {
+        if (slot.bgra) {
+          std::swap(dst[0], dst[2]);
+        }
+        dst[3] = 255;
+      }
+    }
+  } else {
+    std::fill(frame.rgba.begin(), frame.rgba.end(), uint8_t(0));
+  }
+  // The render thread unmaps it on its next Submitted()
+  slot.state = SlotState::Released;
+}
+
+bool FrameCapture::WritePng(const Frame &frame) {
+  char name[32];
+  snprintf(name, sizeof(name), "frame_%06u.png", frame.index);
+  const std::string path = (m_Settings.directory / name).string();
+  if (!stbi_write_png(path.c_str(), static_cast<int>(frame.width),
+                      static_cast<int>(frame.height), 4, frame.rgba.data(),
+                      static_cast<int>(frame.width * 4))) {
+    fprintf(stderr, "Failed to write %s\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool FrameCapture::WriteY4m(const Frame &frame, std::vector<uint8_t> &yuv) {
+  if (!m_Video) {
+    return false;
+  }
+  // The stream's size is fixed by its first frame
+  if (m_VideoWidth == 0) {
+    m_VideoWidth = frame.width;
+    m_VideoHeight = frame.height;
+    fprintf(m_Video, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n",
+            m_VideoWidth, m_VideoHeight, m_Settings.frameRate);
+  }
+  if (frame.width != m_VideoWidth || frame.height != m_VideoHeight) {
+    return false;
+  }
+
+  const uint32_t width = frame.width;
+  const uint32_t height = frame.height;
+  const uint32_t chromaWidth = (width + 1) / 2;
+  const uint32_t chromaHeight = (height + 1) / 2;
+  const size_t lumaSize = size_t(width) * height;
+  const size_t chromaSize = size_t(chromaWidth) * chromaHeight;
+  yuv.resize(lumaSize + chromaSize * 2);
+  uint8_t *lumaPlane = yuv.data();
+  uint8_t *bluePlane = lumaPlane + lumaSize;
+  uint8_t *redPlane = bluePlane + chromaSize;
+
+  const uint8_t *rgba = frame.rgba.data();
+  for (size_t i = 0; i < lumaSize; ++i) {
+    lumaPlane[i] = Luma(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+  }
+  // Chroma from the average of each 2x2 block, clamped at odd edges
+  for (uint32_t cy = 0; cy < chromaHeight; ++cy) {
+    const uint32_t y0 = cy * 2;
+    const uint32_t y1 = std::min(y0 + 1, height - 1);
+    for (uint32_t cx = 0; cx < chromaWidth; ++cx) {
+      const uint32_t x0 = cx * 2;
+      const uint32_t x1 = std::min(x0 + 1, width - 1);
+      int sum[3] = {};
+      for (uint32_t y : {y0, y1}) {
+        for (uint32_t x : {x0, x1}) {
+          const uint8_t *p = rgba + (size_t(y) * width + x) * 4;
+          sum[0] += p[0];
+          sum[1] += p[1];
+          sum[2] += p[2];
+        }
+      }
+      const int r = (sum[0] + 2) >> 2;
+      const int g = (sum[1] + 2) >> 2;
+      const int b = (sum[2] + 2) >> 2;
+      bluePlane[size_t(cy) * chromaWidth + cx] = ChromaBlue(r, g, b);
+      redPlane[size_t(cy) * chromaWidth + cx] = ChromaRed(r, g, b);
+    }
+  }
+
+  return fputs("FRAME\n", m_Video) >= 0 &&
+         fwrite(yuv.data(), 1, yuv.size(), m_Video) == yuv.size();
+}
+
+void FrameCapture::JoinWriters() {
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_ExitWriters = true;
+  }
+  m_QueueCondition.notify_all();
+  for (std::thread &writer : m_Writers) {
+    writer.join();
+  }
+  m_Writers.clear();
+  m_ExitWriters = false;
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const {
+  Stats stats;
+  stats.captured = m_Captured;
+  stats.written = m_Written;
+  stats.dropped = m_Dropped;
+  stats.writeMs = m_WriteMs;
+  for (const Slot &slot : m_Slots) {
+    stats.queued += slot.state == SlotState::Queued ? 1 : 0;
+  }
+  return stats;
+}
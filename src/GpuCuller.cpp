@@ -0,0 +1,886 @@
+#include "GpuCuller.h"
+#include "GpuTimer.h"
+#include "scene/Scene.h"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <stdio.h>
+
+namespace {
+
+constexpr uint32_t kCullWorkgroupSize = 64;
+constexpr uint32_t kMaxWorkgroupsPerDimension = 65535;
+constexpr uint32_t kFlagFrustum = 1;
+constexpr uint32_t kFlagOcclusion = 2;
+constexpr uint32_t kFlagLod = 4;
+
+const char *kCullShader = R"(
+struct CullUniforms {
+  prevViewProj : mat4x4<f32>,
+  planes : array<vec4<f32>, 6>,
+  cameraPos : vec4<f32>,
+  hizSize : vec2<f32>,
+  objectCount : u32,
+  hizMipCount : u32,
+  flags : u32,
+  lodPixelsPerUnit : f32,
+  lodThreshold : f32,
+  lodHysteresis : f32,
+};
+
+struct ObjectBounds {
+  bmin : vec4<f32>, // w = first bucket bits
+  bmax : vec4<f32>, // w = world scale
+};
+
+struct Bucket {
+  instanceBase : u32,
+  lodCount : u32,
+  lodError : f32,
+  triangles : u32,
+};
+
+struct DrawArgs {
+  indexCount : u32,
+  instanceCount : atomic<u32>,
+  firstIndex : u32,
+  baseVertex : i32,
+  firstInstance : u32,
+};
+
+struct CullCounters {
+  // visible, frustum culled, occluded, triangles
+  counts : array<atomic<u32>, 4>,
+};
+
+@group(0) @binding(0) var<uniform> cull : CullUniforms;
+@group(0) @binding(1) var<storage, read> bounds : array<ObjectBounds>;
+@group(0) @binding(2) var<storage, read> buckets : array<Bucket>;
+@group(0) @binding(3) var<storage, read_write> draws : array<DrawArgs>;
+@group(0) @binding(4) var<storage, read_write> visibleIds : array<u32>;
+@group(0) @binding(5) var<storage, read_write> counters : CullCounters;
+@group(0) @binding(6) var hiz : texture_2d<f32>;
+@group(0) @binding(7) var<storage, read_write> objectLods : array<u32>;
+
+const kFlagFrustum = 1u;
+const kFlagOcclusion = 2u;
+const kFlagLod = 4u;
+const kVisible = 0u;
+const kFrustumCulled = 1u;
+const kOccluded = 2u;
+const kNoObject = 3u;
+
+var<workgroup> groupCounts : array<atomic<u32>, 4>;
+
+fn outsideFrustum(center : vec3<f32>, extent : vec3<f32>) -> bool {
+  for (var i = 0u; i < 6u; i++) {
+    let p = cull.planes[i];
+    if (dot(p.xyz, center) + dot(abs(p.xyz), extent) + p.w < 0.0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Project the box with last frame's camera and compare its nearest depth with
+// the farthest depth stored in the hi-Z texels covering its screen rectangle
+fn occluded(bmin : vec3<f32>, bmax : vec3<f32>) -> bool {
+  var uvMin = vec2<f32>(1.0);
+  var uvMax = vec2<f32>(0.0);
+  var zMin = 1.0;
+  for (var i = 0u; i < 8u; i++) {
+    let corner = select(bmin, bmax, vec3<bool>((i & 1u) != 0u, (i & 2u) != 0u,
+                                               (i & 4u) != 0u));
+    let clip = cull.prevViewProj * vec4<f32>(corner, 1.0);
+    if (clip.w <= 1e-4) {
+      return false; // crosses the near plane
+    }
+    let ndc = clip.xyz / clip.w;
+    let uv = ndc.xy * vec2<f32>(0.5, -0.5) + 0.5;
+    uvMin = min(uvMin, uv);
+    uvMax = max(uvMax, uv);
+    zMin = min(zMin, ndc.z);
+  }
+  // Last frame's hi-Z knows nothing beyond its edges, so a box reaching
+  // past them may be visible now however close the edge texels are
+  if (any(uvMin < vec2<f32>(0.0)) || any(uvMax > vec2<f32>(1.0))) {
+    return false;
+  }
+
+  // Pick the level where the rectangle spans at most 2x2 texels
+  let extent = (uvMax - uvMin) * cull.hizSize;
+  let level = min(u32(ceil(log2(max(max(extent.x, extent.y), 1.0)))),
+                  cull.hizMipCount - 1u);
+  let size = vec2<i32>(textureDimensions(hiz, level));
+  let p0 = clamp(vec2<i32>(uvMin * vec2<f32>(size)), vec2<i32>(0), size - 1);
+  let p1 = clamp(vec2<i32>(uvMax * vec2<f32>(size)), vec2<i32>(0), size - 1);
+  let d = max(max(textureLoad(hiz, p0, level).r,
+                  textureLoad(hiz, vec2<i32>(p1.x, p0.y), level).r),
+              max(textureLoad(hiz, vec2<i32>(p0.x, p1.y), level).r,
+                  textureLoad(hiz, p1, level).r));
+  return zMin > d;
+}
+
+// Coarsest LOD whose error, projected at the distance to the box, stays
+// within the threshold. Errors grow with the level, so the first failure ends
+// the search.
+fn selectLod(index : u32, b : ObjectBounds, first : u32) -> u32 {
+  let lodCount = buckets[first].lodCount;
+  if ((cull.flags & kFlagLod) == 0u || lodCount <= 1u) {
+    return 0u;
+  }
+  let eye = cull.cameraPos.xyz;
+  let outside = max(max(b.bmin.xyz - eye, eye - b.bmax.xyz), vec3<f32>(0.0));
+  let distance = length(outside);
+  let pixelsPerUnit = cull.lodPixelsPerUnit * b.bmax.w / max(distance, 1e-4);
+  let current = objectLods[index];
+  var lod = 0u;
+  for (var l = 1u; l < lodCount; l++) {
+    var threshold = cull.lodThreshold;
+    if (l > current) {
+      threshold *= 1.0 - cull.lodHysteresis;
+    }
+    if (buckets[first + l].lodError * pixelsPerUnit > threshold) {
+      break;
+    }
+    lod = l;
+  }
+  objectLods[index] = lod;
+  return lod;
+}
+
+fn cullObject(index : u32) -> u32 {
+  let b = bounds[index];
+  let center = (b.bmin.xyz + b.bmax.xyz) * 0.5;
+  let extent = (b.bmax.xyz - b.bmin.xyz) * 0.5;
+  if ((cull.flags & kFlagFrustum) != 0u && outsideFrustum(center, extent)) {
+    return kFrustumCulled;
+  }
+  if ((cull.flags & kFlagOcclusion) != 0u && occluded(b.bmin.xyz, b.bmax.xyz)) {
+    return kOccluded;
+  }
+  let first = bitcast<u32>(b.bmin.w);
+  let bucket = first + selectLod(index, b, first);
+  let slot = atomicAdd(&draws[bucket].instanceCount, 1u);
+  visibleIds[buckets[bucket].instanceBase + slot] = index;
+  atomicAdd(&groupCounts[3], buckets[bucket].triangles);
+  return kVisible;
+}
+
+@compute @workgroup_size(64)
+fn cull_main(@builtin(workgroup_id) group : vec3<u32>,
+             @builtin(num_workgroups) groupCount : vec3<u32>,
+             @builtin(local_invocation_index) local : u32) {
+  let index = (group.y * groupCount.x + group.x) * 64u + local;
+  var result = kNoObject;
+  if (index < cull.objectCount) {
+    result = cullObject(index);
+  }
+
+  // Reduce the counters per workgroup before touching the global ones
+  if (result != kNoObject) {
+    atomicAdd(&groupCounts[result], 1u);
+  }
+  workgroupBarrier();
+  if (local < 4u) {
+    let n = atomicLoad(&groupCounts[local]);
+    if (n > 0u) {
+      atomicAdd(&counters.counts[local], n);
+    }
+  }
+}
+)";
+
+// First pyramid level: max over the depth texels each hi-Z texel covers. The
+// pyramid is rounded down to a power of two, so that is at most 3x3 texels.
+const char *kHiZFromDepthShader = R"(
+@group(0) @binding(0) var depth : texture_depth_2d;
+@group(0) @binding(1) var dst : texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+  let dstSize = textureDimensions(dst);
+  if (any(id.xy >= dstSize)) {
+    return;
+  }
+  let srcSize = textureDimensions(depth);
+  let lo = (id.xy * srcSize) / dstSize;
+  let hi = min(((id.xy + 1u) * srcSize + dstSize - 1u) / dstSize, srcSize);
+  var d = 0.0;
+  for (var y = lo.y; y < hi.y; y++) {
+    for (var x = lo.x; x < hi.x; x++) {
+      d = max(d, textureLoad(depth, vec2<u32>(x, y), 0));
+    }
+  }
+  textureStore(dst, id.xy, vec4<f32>(d, 0.0, 0.0, 0.0));
+}
+)";
+
+const char *kHiZDownsampleShader = R"(
+@group(0) @binding(0) var src : texture_2d<f32>;
+@group(0) @binding(1) var dst : texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+  let dstSize = textureDimensions(dst);
+  if (any(id.xy >= dstSize)) {
+    return;
+  }
+  let srcMax = vec2<i32>(textureDimensions(src)) - 1;
+  let p = vec2<i32>(id.xy) * 2;
+  let d = max(max(textureLoad(src, min(p, srcMax), 0).r,
+                  textureLoad(src, min(p + vec2<i32>(1, 0), srcMax), 0).r),
+              max(textureLoad(src, min(p + vec2<i32>(0, 1), srcMax), 0).r,
+                  textureLoad(src, min(p + vec2<i32>(1, 1), srcMax), 0).r));
+  textureStore(dst, id.xy, vec4<f32>(d, 0.0, 0.0, 0.0));
+}
+)";
+
+WGPUBuffer CreateBuffer(WGPUDevice device, const char *label, uint64_t size,
+                        WGPUBufferUsage usage) {
+  WGPUBufferDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.size = std::max<uint64_t>((size + 3) & ~uint64_t(3), 16);
+  desc.usage = usage;
+  desc.mappedAtCreation = false;
+  return wgpuDeviceCreateBuffer(device, &desc);
+}
+
+WGPUComputePipeline CreateComputePipeline(WGPUDevice device, const char *label,
+                                          const char *source,
+                                          const char *entryPoint,
+                                          WGPUBindGroupLayout layout) {
+  WGPUShaderSourceWGSL wgsl = {};
+  wgsl.chain.sType = WGPUSType_ShaderSourceWGSL;
+  wgsl.code = {source, WGPU_STRLEN};
+  WGPUShaderModuleDescriptor moduleDesc = {};
+  moduleDesc.nextInChain = &wgsl.chain;
+  moduleDesc.label = {label, WGPU_STRLEN};
+  WGPUShaderModule module = wgpuDeviceCreateShaderModule(device, &moduleDesc);
+  if (!module) {
+    return nullptr;
+  }
+
+  WGPUPipelineLayoutDescriptor layoutDesc = {};
+  layoutDesc.bindGroupLayoutCount = 1;
+  layoutDesc.bindGroupLayouts = &layout;
+  WGPUPipelineLayout pipelineLayout =
+      wgpuDeviceCreatePipelineLayout(device, &layoutDesc);
+
+  WGPUComputePipelineDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.layout = pipelineLayout;
+  desc.compute.module = module;
+  desc.compute.entryPoint = {entryPoint, WGPU_STRLEN};
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(device, &desc);
+
+  wgpuPipelineLayoutRelease(pipelineLayout);
+  wgpuShaderModuleRelease(module);
+  return pipeline;
+}
+
+WGPUBindGroupLayoutEntry BufferEntry(uint32_t binding, WGPUBufferBindingType type) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = WGPUShaderStage_Compute;
+  entry.buffer.type = type;
+  return entry;
+}
+
+WGPUBindGroupLayoutEntry TextureEntry(uint32_t binding,
+                                      WGPUTextureSampleType sampleType) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = WGPUShaderStage_Compute;
+  entry.texture.sampleType = sampleType;
+  entry.texture.viewDimension = WGPUTextureViewDimension_2D;
+  return entry;
+}
+
+WGPUBindGroupLayoutEntry StorageTextureEntry(uint32_t binding) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = WGPUShaderStage_Compute;
+  entry.storageTexture.access = WGPUStorageTextureAccess_WriteOnly;
+  entry.storageTexture.format = WGPUTextureFormat_R32Float;
+  entry.storageTexture.viewDimension = WGPUTextureViewDimension_2D;
+  return entry;
+}
+
+WGPUBindGroupLayout CreateLayout(WGPUDevice device, const char *label,
+                                 const WGPUBindGroupLayoutEntry *entries,
+                                 size_t count) {
+  WGPUBindGroupLayoutDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.entryCount = count;
+  desc.entries = entries;
+  return wgpuDeviceCreateBindGroupLayout(device, &desc);
+}
+
+template <typename T> void Release(T &handle, void (*release)(T)) {
+  if (handle) {
+    release(handle);
+    handle = nullptr;
+  }
+}
+
+} // namespace
+
+GpuCuller::GpuCuller() {}
+
+GpuCuller::~GpuCuller() { Shutdown(); }
+
+bool GpuCuller::Initialize(WGPUDevice device, WGPUQueue queue) {
+  m_Device = device;
+  m_Queue = queue;
+
+  if (!CreatePipelines()) {
+    fprintf(stderr, "Failed to create GPU culling pipelines\n");
+    return false;
+  }
+
+  m_UniformBuffer =
+      CreateBuffer(m_Device, "Cull uniforms", sizeof(CullUniforms),
+                   WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst);
+  m_StatsBuffer = CreateBuffer(m_Device, "Cull counters", 16,
+                               WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc |
+                                   WGPUBufferUsage_CopyDst);
+  for (Readback &readback : m_Readback) {
+    readback.buffer = CreateBuffer(m_Device, "Cull counter readback", 16,
+                                   WGPUBufferUsage_MapRead |
+                                       WGPUBufferUsage_CopyDst);
+  }
+  return true;
+}
+
+void GpuCuller::Shutdown() {
+  ReleaseObjects();
+  ReleaseHiZ();
+
+  for (Readback &readback : m_Readback) {
+    if (readback.buffer && readback.busy) {
+      // Aborts the pending map so its callback can't outlive this object
+      wgpuBufferDestroy(readback.buffer);
+    }
+    Release(readback.buffer, wgpuBufferRelease);
+    readback.busy = false;
+  }
+  Release(m_StatsBuffer, wgpuBufferRelease);
+  Release(m_UniformBuffer, wgpuBufferRelease);
+  Release(m_CullPipeline, wgpuComputePipelineRelease);
+  Release(m_HiZFromDepthPipeline, wgpuComputePipelineRelease);
+  Release(m_HiZDownsamplePipeline, wgpuComputePipelineRelease);
+  Release(m_CullLayout, wgpuBindGroupLayoutRelease);
+  Release(m_HiZFromDepthLayout, wgpuBindGroupLayoutRelease);
+  Release(m_HiZDownsampleLayout, wgpuBindGroupLayoutRelease);
+}
+
+bool GpuCuller::CreatePipelines() {
+  // Explicit layouts: the hi-Z texture is r32float, which auto layouts would
+  // expect to be filterable
+  const WGPUBindGroupLayoutEntry cullEntries[] = {
+      BufferEntry(0, WGPUBufferBindingType_Uniform),
+      BufferEntry(1, WGPUBufferBindingType_ReadOnlyStorage),
+      BufferEntry(2, WGPUBufferBindingType_ReadOnlyStorage),
+      BufferEntry(3, WGPUBufferBindingType_Storage),
+      BufferEntry(4, WGPUBufferBindingType_Storage),
+      BufferEntry(5, WGPUBufferBindingType_Storage),
+      TextureEntry(6, WGPUTextureSampleType_UnfilterableFloat),
+      BufferEntry(7, WGPUBufferBindingType_Storage),
+  };
+  const WGPUBindGroupLayoutEntry fromDepthEntries[] = {
+      TextureEntry(0, WGPUTextureSampleType_Depth),
+      StorageTextureEntry(1),
+  };
+  const WGPUBindGroupLayoutEntry downsampleEntries[] = {
+      TextureEntry(0, WGPUTextureSampleType_UnfilterableFloat),
+      StorageTextureEntry(1),
+  };
+  m_CullLayout = CreateLayout(m_Device, "Cull layout", cullEntries,
+                              std::size(cullEntries));
+  m_HiZFromDepthLayout = CreateLayout(m_Device, "Hi-Z from depth layout",
+                                      fromDepthEntries,
+                                      std::size(fromDepthEntries));
+  m_HiZDownsampleLayout = CreateLayout(m_Device, "Hi-Z downsample layout",
+                                       downsampleEntries,
+                                       std::size(downsampleEntries));
+
+  m_CullPipeline = CreateComputePipeline(m_Device, "Cull pipeline", kCullShader,
+                                         "cull_main", m_CullLayout);
+  m_HiZFromDepthPipeline =
+      CreateComputePipeline(m_Device, "Hi-Z from depth pipeline",
+                            kHiZFromDepthShader, "main", m_HiZFromDepthLayout);
+  m_HiZDownsamplePipeline =
+      CreateComputePipeline(m_Device, "Hi-Z downsample pipeline",
+                            kHiZDownsampleShader, "main", m_HiZDownsampleLayout);
+  return m_CullPipeline && m_HiZFromDepthPipeline && m_HiZDownsamplePipeline;
+}
+
+void GpuCuller::ReleaseObjects() {
+  Release(m_CullBindGroup, wgpuBindGroupRelease);
+  Release(m_BoundsBuffer, wgpuBufferRelease);
+  Release(m_ObjectDataBuffer, wgpuBufferRelease);
+  Release(m_VisibleIdBuffer, wgpuBufferRelease);
+  Release(m_BucketBuffer, wgpuBufferRelease);
+  Release(m_ObjectLodBuffer, wgpuBufferRelease);
+  Release(m_DrawArgsBuffer, wgpuBufferRelease);
+  Release(m_DrawArgsTemplate, wgpuBufferRelease);
+  m_ObjectCount = 0;
+  m_ObjectCapacity = 0;
+  m_VisibleIdCapacity = 0;
+  m_Buckets.clear();
+  m_BucketMesh.clear();
+  m_BucketMaterial.clear();
+  m_BucketLod.clear();
+  m_ObjectBucket.clear();
+}
+
+bool GpuCuller::Upload(
+    const Scene &scene,
+    const std::vector<std::vector<IndirectDrawArgs>> &meshDraws) {
+  ReleaseObjects();
+
+  const auto &objects = scene.GetObjects();
+  m_ObjectCount = static_cast<uint32_t>(objects.size());
+  m_ObjectCapacity = std::max<uint32_t>(m_ObjectCount, 1);
+
+  // One group of buckets per mesh/material pair in use, ordered by material
+  // so the draws switch materials as rarely as possible
+  std::vector<uint64_t> pairs;
+  pairs.reserve(objects.size());
+  for (const SceneObject &object : objects) {
+    pairs.push_back((uint64_t(object.material) << 32) | object.mesh);
+  }
+  std::vector<uint64_t> groups = pairs;
+  std::sort(groups.begin(), groups.end());
+  groups.erase(std::unique(groups.begin(), groups.end()), groups.end());
+
+  std::vector<uint32_t> perGroup(groups.size(), 0);
+  std::vector<uint32_t> objectGroup(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    objectGroup[i] = static_cast<uint32_t>(
+        std::lower_bound(groups.begin(), groups.end(), pairs[i]) -
+        groups.begin());
+    perGroup[objectGroup[i]]++;
+  }
+
+  // Each LOD of a group is its own bucket. Any object of the group may pick
+  // any LOD, so every bucket's instance range holds all of the group's
+  // objects.
+  const auto &meshes = scene.GetMeshes();
+  std::vector<uint32_t> groupFirstBucket(groups.size());
+  std::vector<IndirectDrawArgs> args;
+  uint32_t base = 0;
+  for (size_t g = 0; g < groups.size(); ++g) {
+    const uint32_t mesh = static_cast<uint32_t>(groups[g]);
+    const uint32_t material = static_cast<uint32_t>(groups[g] >> 32);
+    const auto &lods = meshDraws[mesh];
+    groupFirstBucket[g] = static_cast<uint32_t>(m_Buckets.size());
+    for (uint32_t lod = 0; lod < lods.size(); ++lod) {
+      BucketInfo bucket;
+      bucket.instanceBase = base;
+      bucket.lodCount = static_cast<uint32_t>(lods.size());
+      bucket.lodError = lod < meshes[mesh].lods.size()
+                            ? meshes[mesh].lods[lod].error
+                            : 0.0f;
+      bucket.triangles = lods[lod].indexCount / 3;
+      m_Buckets.push_back(bucket);
+      m_BucketMesh.push_back(mesh);
+      m_BucketMaterial.push_back(material);
+      m_BucketLod.push_back(lod);
+      base += perGroup[g];
+
+      IndirectDrawArgs draw = lods[lod];
+      draw.instanceCount = 0;
+      draw.firstInstance = 0; // instance ranges are offset in the shader
+      args.push_back(draw);
+    }
+  }
+  m_VisibleIdCapacity = std::max<uint32_t>(base, 1);
+
+  m_ObjectBucket.resize(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    m_ObjectBucket[i] = groupFirstBucket[objectGroup[i]];
+  }
+
+  const uint64_t argsSize = std::max<size_t>(args.size(), 1) * sizeof(IndirectDrawArgs);
+  m_BoundsBuffer =
+      CreateBuffer(m_Device, "Object bounds",
+                   uint64_t(m_ObjectCapacity) * sizeof(ObjectBounds),
+                   WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst);
+  m_ObjectDataBuffer =
+      CreateBuffer(m_Device, "Object data",
+                   uint64_t(m_ObjectCapacity) * sizeof(ObjectData),
+                   WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst);
+  m_VisibleIdBuffer =
+      CreateBuffer(m_Device, "Visible object ids",
+                   uint64_t(m_VisibleIdCapacity) * sizeof(uint32_t),
+                   WGPUBufferUsage_Storage);
+  m_ObjectLodBuffer =
+      CreateBuffer(m_Device, "Object LODs",
+                   uint64_t(m_ObjectCapacity) * sizeof(uint32_t),
+                   WGPUBufferUsage_Storage);
+  m_BucketBuffer =
+      CreateBuffer(m_Device, "Cull buckets",
+                   std::max<size_t>(m_Buckets.size(), 1) * sizeof(BucketInfo),
+                   WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst);
+  m_DrawArgsBuffer =
+      CreateBuffer(m_Device, "Indirect draw args", argsSize,
+                   WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect |
+                       WGPUBufferUsage_CopyDst);
+  m_DrawArgsTemplate = CreateBuffer(m_Device, "Indirect draw args template",
+                                    argsSize,
+                                    WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst);
+  if (!m_BoundsBuffer || !m_ObjectDataBuffer || !m_VisibleIdBuffer ||
+      !m_ObjectLodBuffer || !m_BucketBuffer || !m_DrawArgsBuffer ||
+      !m_DrawArgsTemplate) {
+    fprintf(stderr, "Failed to allocate GPU culling buffers\n");
+    ReleaseObjects();
+    return false;
+  }
+
+  if (!args.empty()) {
+    wgpuQueueWriteBuffer(m_Queue, m_DrawArgsTemplate, 0, args.data(),
+                         args.size() * sizeof(IndirectDrawArgs));
+    wgpuQueueWriteBuffer(m_Queue, m_BucketBuffer, 0, m_Buckets.data(),
+                         m_Buckets.size() * sizeof(BucketInfo));
+  }
+
+  CreateCullBindGroup();
+  UpdateObjects(scene, true);
+  return true;
+}
+
+void GpuCuller::FillObjectRow(const Scene &scene, uint32_t object) {
+  const SceneObject &o = scene.GetObjects()[object];
+  const Aabb &box = scene.GetWorldBounds()[object];
+  const auto &materials = scene.GetMaterials();
+
+  ObjectBounds &b = m_BoundsStaging[object];
+  b.min = Vec4(box.min, std::bit_cast<float>(m_ObjectBucket[object]));
+
+  ObjectData &d = m_DataStaging[object];
+  d.model = scene.GetTransforms().GetWorldMatrix(o.transform);
+  b.max = Vec4(box.max, MaxAxisScale(d.model));
+  d.color = o.material < materials.size() ? materials[o.material].baseColor
+                                          : Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+void GpuCuller::UpdateObjects(const Scene &scene, bool all) {
+  m_Stats.objectsWritten = 0;
+  if (m_ObjectCount == 0 || !m_BoundsBuffer) {
+    return;
+  }
+
+  // The staging copies mirror the GPU buffers so rows can be written in place
+  if (m_BoundsStaging.size() != m_ObjectCount) {
+    m_BoundsStaging.resize(m_ObjectCount);
+    m_DataStaging.resize(m_ObjectCount);
+    all = true;
+  }
+
+  const std::vector<uint32_t> &moved = scene.GetMovedObjects();
+  if (all || moved.size() * 4 > m_ObjectCount) {
+    for (uint32_t i = 0; i < m_ObjectCount; ++i) {
+      FillObjectRow(scene, i);
+    }
+    wgpuQueueWriteBuffer(m_Queue, m_BoundsBuffer, 0, m_BoundsStaging.data(),
+                         m_ObjectCount * sizeof(ObjectBounds));
+    wgpuQueueWriteBuffer(m_Queue, m_ObjectDataBuffer, 0, m_DataStaging.data(),
+                         m_ObjectCount * sizeof(ObjectData));
+    m_Stats.objectsWritten = m_ObjectCount;
+    return;
+  }
+
+  // Scene::Update merges its chunks' lists in whatever order they finish, so
+  // sort before coalescing contiguous runs into one write each
+  m_Moved.assign(moved.begin(), moved.end());
+  std::sort(m_Moved.begin(), m_Moved.end());
+  size_t i = 0;
+  while (i < m_Moved.size()) {
+    uint32_t first = m_Moved[i];
+    uint32_t last = first;
+    FillObjectRow(scene, first);
+    while (++i < m_Moved.size() && m_Moved[i] == last + 1) {
+      last = m_Moved[i];
+      FillObjectRow(scene, last);
+    }
+    uint32_t count = last - first + 1;
+    wgpuQueueWriteBuffer(m_Queue, m_BoundsBuffer, first * sizeof(ObjectBounds),
+                         &m_BoundsStaging[first], count * sizeof(ObjectBounds));
+    wgpuQueueWriteBuffer(m_Queue, m_ObjectDataBuffer, first * sizeof(ObjectData),
+                         &m_DataStaging[first], count * sizeof(ObjectData));
+  }
+  m_Stats.objectsWritten = static_cast<uint32_t>(moved.size());
+}
+
+void GpuCuller::SetDepthTexture(WGPUTexture depth, uint32_t width,
+                                uint32_t height) {
+  ReleaseHiZ();
+  m_DepthTexture = depth;
+  if (!depth || width == 0 || height == 0) {
+    return;
+  }
+
+  // Largest power of two not above the depth size, so every level halves
+  // exactly and screen UVs map to the same texel at every level
+  m_HiZWidth = std::bit_floor(width);
+  m_HiZHeight = std::bit_floor(height);
+  CreateHiZ();
+}
+
+void GpuCuller::CreateHiZ() {
+  const uint32_t mipCount =
+      std::bit_width(std::max(m_HiZWidth, m_HiZHeight));
+
+  WGPUTextureDescriptor desc = {};
+  desc.label = {"Hi-Z pyramid", WGPU_STRLEN};
+  desc.usage = WGPUTextureUsage_StorageBinding | WGPUTextureUsage_TextureBinding;
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.size = {m_HiZWidth, m_HiZHeight, 1};
+  desc.format = WGPUTextureFormat_R32Float;
+  desc.mipLevelCount = mipCount;
+  desc.sampleCount = 1;
+  m_HiZTexture = wgpuDeviceCreateTexture(m_Device, &desc);
+  m_HiZView = wgpuTextureCreateView(m_HiZTexture, nullptr);
+  m_DepthView = wgpuTextureCreateView(m_DepthTexture, nullptr);
+
+  for (uint32_t level = 0; level < mipCount; ++level) {
+    WGPUTextureViewDescriptor viewDesc = {};
+    viewDesc.format = WGPUTextureFormat_R32Float;
+    viewDesc.dimension = WGPUTextureViewDimension_2D;
+    viewDesc.baseMipLevel = level;
+    viewDesc.mipLevelCount = 1;
+    viewDesc.arrayLayerCount = 1;
+    viewDesc.aspect = WGPUTextureAspect_All;
+    m_HiZMipViews.push_back(wgpuTextureCreateView(m_HiZTexture, &viewDesc));
+  }
+
+  // One bind group per level: level 0 reads the depth buffer, the rest read
+  // the level above
+  for (uint32_t level = 0; level < mipCount; ++level) {
+    WGPUBindGroupEntry entries[2] = {};
+    entries[0].binding = 0;
+    entries[0].textureView = level == 0 ? m_DepthView : m_HiZMipViews[level - 1];
+    entries[1].binding = 1;
+    entries[1].textureView = m_HiZMipViews[level];
+
+    WGPUBindGroupDescriptor bgDesc = {};
+    bgDesc.label = {"Hi-Z bind group", WGPU_STRLEN};
+    bgDesc.layout = level == 0 ? m_HiZFromDepthLayout : m_HiZDownsampleLayout;
+    bgDesc.entryCount = 2;
+    bgDesc.entries = entries;
+    m_HiZBindGroups.push_back(wgpuDeviceCreateBindGroup(m_Device, &bgDesc));
+  }
+
+  m_DepthHistoryValid = false;
+  CreateCullBindGroup();
+}
+
+void GpuCuller::ReleaseHiZ() {
+  for (WGPUBindGroup group : m_HiZBindGroups) {
+    wgpuBindGroupRelease(group);
+  }
+  m_HiZBindGroups.clear();
+  for (WGPUTextureView view : m_HiZMipViews) {
+    wgpuTextureViewRelease(view);
+  }
+  m_HiZMipViews.clear();
+  Release(m_CullBindGroup, wgpuBindGroupRelease);
+  Release(m_HiZView, wgpuTextureViewRelease);
+  Release(m_DepthView, wgpuTextureViewRelease);
+  if (m_HiZTexture) {
+    wgpuTextureDestroy(m_HiZTexture);
+    wgpuTextureRelease(m_HiZTexture);
+    m_HiZTexture = nullptr;
+  }
+  m_DepthTexture = nullptr;
+  m_HiZWidth = 0;
+  m_HiZHeight = 0;
+  m_DepthHistoryValid = false;
+}
+
+void GpuCuller::CreateCullBindGroup() {
+  Release(m_CullBindGroup, wgpuBindGroupRelease);
+  if (!m_BoundsBuffer || !m_HiZView) {
+    return;
+  }
+
+  WGPUBindGroupEntry entries[8] = {};
+  entries[0].binding = 0;
+  entries[0].buffer = m_UniformBuffer;
+  entries[0].size = sizeof(CullUniforms);
+  entries[1].binding = 1;
+  entries[1].buffer = m_BoundsBuffer;
+  entries[1].size = WGPU_WHOLE_SIZE;
+  entries[2].binding = 2;
+  entries[2].buffer = m_BucketBuffer;
+  entries[2].size = WGPU_WHOLE_SIZE;
+  entries[3].binding = 3;
+  entries[3].buffer = m_DrawArgsBuffer;
+  entries[3].size = WGPU_WHOLE_SIZE;
+  entries[4].binding = 4;
+  entries[4].buffer = m_VisibleIdBuffer;
+  entries[4].size = WGPU_WHOLE_SIZE;
+  entries[5].binding = 5;
+  entries[5].buffer = m_StatsBuffer;
+  entries[5].size = WGPU_WHOLE_SIZE;
+  entries[6].binding = 6;
+  entries[6].textureView = m_HiZView;
+  entries[7].binding = 7;
+  entries[7].buffer = m_ObjectLodBuffer;
+  entries[7].size = WGPU_WHOLE_SIZE;
+
+  WGPUBindGroupDescriptor desc = {};
+  desc.label = {"Cull bind group", WGPU_STRLEN};
+  desc.layout = m_CullLayout;
+  desc.entryCount = 8;
+  desc.entries = entries;
+  m_CullBindGroup = wgpuDeviceCreateBindGroup(m_Device, &desc);
+}
+
+void GpuCuller::BuildHiZ(WGPUCommandEncoder encoder, GpuTimer *timer,
+                         uint32_t scope) {
+  WGPUComputePassDescriptor passDesc = {};
+  passDesc.label = {"Hi-Z build", WGPU_STRLEN};
+  passDesc.timestampWrites = timer ? timer->GetPassWrites(scope) : nullptr;
+  WGPUComputePassEncoder pass =
+      wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+
+  for (uint32_t level = 0; level < m_HiZBindGroups.size(); ++level) {
+    uint32_t width = std::max(m_HiZWidth >> level, 1u);
+    uint32_t height = std::max(m_HiZHeight >> level, 1u);
+    wgpuComputePassEncoderSetPipeline(pass, level == 0 ? m_HiZFromDepthPipeline
+                                                       : m_HiZDownsamplePipeline);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, m_HiZBindGroups[level], 0,
+                                       nullptr);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, (width + 7) / 8,
+                                             (height + 7) / 8, 1);
+  }
+
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+}
+
+void GpuCuller::Cull(const Mat4 &viewProj, Vec3 cameraPos,
+                     const LodSelection &lod, bool frustumCulling,
+                     bool occlusionCulling, GpuTimer *timer,
+                     uint32_t firstScope) {
+  if (!m_CullBindGroup || m_ObjectCount == 0) {
+    return;
+  }
+
+  // Occlusion needs a depth buffer rendered by a previous frame
+  const bool occlusion = occlusionCulling && m_DepthHistoryValid;
+
+  CullUniforms uniforms = {};
+  uniforms.prevViewProj = m_PrevViewProj;
+  Frustum frustum = Frustum::FromViewProjection(viewProj);
+  std::copy(std::begin(frustum.planes), std::end(frustum.planes),
+            uniforms.planes);
+  uniforms.cameraPos = Vec4(cameraPos, 1.0f);
+  uniforms.hizSize[0] = static_cast<float>(m_HiZWidth);
+  uniforms.hizSize[1] = static_cast<float>(m_HiZHeight);
+  uniforms.objectCount = m_ObjectCount;
+  uniforms.hizMipCount = static_cast<uint32_t>(m_HiZMipViews.size());
+  uniforms.flags = (frustumCulling ? kFlagFrustum : 0u) |
+                   (occlusion ? kFlagOcclusion : 0u) |
+                   (lod.enabled ? kFlagLod : 0u);
+  uniforms.lodPixelsPerUnit = lod.pixelsPerUnit;
+  uniforms.lodThreshold = lod.threshold;
+  uniforms.lodHysteresis = lod.hysteresis;
+  wgpuQueueWriteBuffer(m_Queue, m_UniformBuffer, 0, &uniforms, sizeof(uniforms));
+
+  WGPUCommandEncoderDescriptor encDesc = {};
+  encDesc.label = {"GPU culling", WGPU_STRLEN};
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_Device, &encDesc);
+
+  if (occlusion) {
+    BuildHiZ(encoder, timer, firstScope);
+  }
+
+  // Reset instance counts and counters
+  const uint64_t argsSize = m_Buckets.size() * sizeof(IndirectDrawArgs);
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, m_DrawArgsTemplate, 0,
+                                       m_DrawArgsBuffer, 0, argsSize);
+  wgpuCommandEncoderClearBuffer(encoder, m_StatsBuffer, 0, 16);
+
+  // Workgroups beyond the per-dimension limit spill into y
+  const uint32_t groups =
+      (m_ObjectCount + kCullWorkgroupSize - 1) / kCullWorkgroupSize;
+  const uint32_t groupsX = std::min(groups, kMaxWorkgroupsPerDimension);
+  const uint32_t groupsY = (groups + groupsX - 1) / groupsX;
+
+  WGPUComputePassDescriptor passDesc = {};
+  passDesc.label = {"Object culling", WGPU_STRLEN};
+  passDesc.timestampWrites =
+      timer ? timer->GetPassWrites(firstScope + 1) : nullptr;
+  WGPUComputePassEncoder pass =
+      wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+  wgpuComputePassEncoderSetPipeline(pass, m_CullPipeline);
+  wgpuComputePassEncoderSetBindGroup(pass, 0, m_CullBindGroup, 0, nullptr);
+  wgpuComputePassEncoderDispatchWorkgroups(pass, groupsX, groupsY, 1);
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+
+  // Copy counters into a free readback slot; skip a frame if all are in flight
+  Readback *readback = nullptr;
+  for (uint32_t i = 0; i < kReadbackSlots && !readback; ++i) {
+    Readback &slot = m_Readback[(m_ReadbackIndex + i) % kReadbackSlots];
+    if (!slot.busy) {
+      readback = &slot;
+      m_ReadbackIndex = (m_ReadbackIndex + i + 1) % kReadbackSlots;
+    }
+  }
+  if (readback) {
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, m_StatsBuffer, 0,
+                                         readback->buffer, 0, 16);
+  }
+
+  WGPUCommandBufferDescriptor cmdDesc = {};
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, &cmdDesc);
+  wgpuQueueSubmit(m_Queue, 1, &commands);
+  wgpuCommandBufferRelease(commands);
+  wgpuCommandEncoderRelease(encoder);
+
+  if (readback) {
+    readback->busy = true;
+    WGPUBufferMapCallbackInfo callbackInfo = {};
+    callbackInfo.mode = WGPUCallbackMode_AllowSpontaneous;
+    callbackInfo.callback = OnReadbackMapped;
+    callbackInfo.userdata1 = this;
+    callbackInfo.userdata2 = readback;
+    wgpuBufferMapAsync(readback->buffer, WGPUMapMode_Read, 0, 16, callbackInfo);
+  }
+
+  m_Stats.occlusionActive = occlusion;
+  m_PrevViewProj = viewProj;
+  // The frame about to be drawn leaves a depth buffer for the next cull
+  m_DepthHistoryValid = true;
+}
+
+void GpuCuller::OnReadbackMapped(WGPUMapAsyncStatus status, WGPUStringView,
+                                 void *userdata1, void *userdata2) {
+  auto *self = static_cast<GpuCuller *>(userdata1);
+  auto *readback = static_cast<Readback *>(userdata2);
+  if (status == WGPUMapAsyncStatus_Success) {
+    const auto *counts = static_cast<const uint32_t *>(
+        wgpuBufferGetConstMappedRange(readback->buffer, 0, 16));
+    if (counts) {
+      for (int i = 0; i < 4; ++i) {
+        self->m_GpuCounts[i].store(counts[i], std::memory_order_relaxed);
+      }
+    }
+    wgpuBufferUnmap(readback->buffer);
+  }
+  readback->busy = false;
+}
+
+GpuCuller::Stats GpuCuller::GetStats() const {
+  Stats stats = m_Stats;
+  stats.visibleObjects = m_GpuCounts[0].load(std::memory_order_relaxed);
+  stats.frustumCulled = m_GpuCounts[1].load(std::memory_order_relaxed);
+  stats.occlusionCulled = m_GpuCounts[2].load(std::memory_order_relaxed);
+  stats.triangles = m_GpuCounts[3].load(std::memory_order_relaxed);
+  return stats;
+}
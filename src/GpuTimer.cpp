@@ -0,0 +1,154 @@
+#include "GpuTimer.h"
+#include <stdio.h>
+
+namespace {
+
+constexpr uint64_t kQueryBytes = GpuTimer::kMaxScopes * 2 * sizeof(uint64_t);
+
+WGPUBuffer CreateBuffer(WGPUDevice device, const char *label, uint64_t size,
+                        WGPUBufferUsage usage) {
+  WGPUBufferDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.size = size;
+  desc.usage = usage;
+  desc.mappedAtCreation = false;
+  return wgpuDeviceCreateBuffer(device, &desc);
+}
+
+template <typename T> void Release(T &handle, void (*release)(T)) {
+  if (handle) {
+    release(handle);
+    handle = nullptr;
+  }
+}
+
+} // namespace
+
+GpuTimer::GpuTimer() {}
+
+GpuTimer::~GpuTimer() { Shutdown(); }
+
+bool GpuTimer::Initialize(WGPUDevice device, WGPUQueue queue) {
+  m_Device = device;
+  m_Queue = queue;
+  if (!wgpuDeviceHasFeature(m_Device, WGPUFeatureName_TimestampQuery)) {
+    printf("Timestamp queries unsupported; GPU pass timings disabled\n");
+    return true;
+  }
+
+  WGPUQuerySetDescriptor desc = {};
+  desc.label = {"Pass timestamps", WGPU_STRLEN};
+  desc.type = WGPUQueryType_Timestamp;
+  desc.count = kMaxScopes * 2;
+  m_QuerySet = wgpuDeviceCreateQuerySet(m_Device, &desc);
+  m_ResolveBuffer =
+      CreateBuffer(m_Device, "Timestamp resolve", kQueryBytes,
+                   WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc);
+  for (Readback &readback : m_Readback) {
+    readback.buffer =
+        CreateBuffer(m_Device, "Timestamp readback", kQueryBytes,
+                     WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst);
+  }
+  if (!m_QuerySet || !m_ResolveBuffer) {
+    fprintf(stderr, "Failed to create timestamp queries\n");
+    Shutdown();
+    return false;
+  }
+
+  for (uint32_t i = 0; i < kMaxScopes; ++i) {
+    m_Writes[i].querySet = m_QuerySet;
+    m_Writes[i].beginningOfPassWriteIndex = i * 2;
+    m_Writes[i].endOfPassWriteIndex = i * 2 + 1;
+  }
+  return true;
+}
+
+void GpuTimer::Shutdown() {
+  for (Readback &readback : m_Readback) {
+    if (readback.buffer && readback.busy) {
+      // Aborts the pending map so its callback can't outlive this object
+      wgpuBufferDestroy(readback.buffer);
+    }
+    Release(readback.buffer, wgpuBufferRelease);
+    readback.busy = false;
+  }
+  Release(m_ResolveBuffer, wgpuBufferRelease);
+  Release(m_QuerySet, wgpuQuerySetRelease);
+  m_Pending = nullptr;
+  m_FrameMask = 0;
+}
+
+const WGPUPassTimestampWrites *GpuTimer::GetPassWrites(uint32_t scope) {
+  if (!m_QuerySet || scope >= kMaxScopes) {
+    return nullptr;
+  }
+  m_FrameMask |= 1u << scope;
+  return &m_Writes[scope];
+}
+
+void GpuTimer::Resolve(WGPUCommandEncoder encoder) {
+  m_Pending = nullptr;
+  if (!m_QuerySet) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < kReadbackSlots && !m_Pending; ++i) {
+    Readback &slot = m_Readback[(m_ReadbackIndex + i) % kReadbackSlots];
+    if (!slot.busy) {
+      m_Pending = &slot;
+      m_ReadbackIndex = (m_ReadbackIndex + i + 1) % kReadbackSlots;
+    }
+  }
+  if (m_Pending) {
+    wgpuCommandEncoderResolveQuerySet(encoder, m_QuerySet, 0, kMaxScopes * 2,
+                                      m_ResolveBuffer, 0);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, m_ResolveBuffer, 0,
+                                         m_Pending->buffer, 0, kQueryBytes);
+    m_Pending->scopeMask = m_FrameMask;
+  }
+  m_FrameMask = 0;
+}
+
+void GpuTimer::ReadBack() {
+  if (!m_Pending) {
+    return;
+  }
+  m_Pending->busy = true;
+  WGPUBufferMapCallbackInfo callbackInfo = {};
+  callbackInfo.mode = WGPUCallbackMode_AllowSpontaneous;
+  callbackInfo.callback = OnReadbackMapped;
+  callbackInfo.userdata1 = this;
+  callbackInfo.userdata2 = m_Pending;
+  wgpuBufferMapAsync(m_Pending->buffer, WGPUMapMode_Read, 0, kQueryBytes,
+                     callbackInfo);
+  m_Pending = nullptr;
+}
+
+void GpuTimer::OnReadbackMapped(WGPUMapAsyncStatus status, WGPUStringView,
+                                void *userdata1, void *userdata2) {
+  auto *self = static_cast<GpuTimer *>(userdata1);
+  auto *readback = static_cast<Readback *>(userdata2);
+  if (status == WGPUMapAsyncStatus_Success) {
+    const auto *ticks = static_cast<const uint64_t *>(
+        wgpuBufferGetConstMappedRange(readback->buffer, 0, kQueryBytes));
+    if (ticks) {
+      for (uint32_t i = 0; i < kMaxScopes; ++i) {
+        // Timestamps are in nanoseconds; a reordered pair reads as zero
+        const uint64_t begin = ticks[i * 2];
+        const uint64_t end = ticks[i * 2 + 1];
+        const bool written = (readback->scopeMask & (1u << i)) != 0;
+        self->m_Nanoseconds[i].store(written && end > begin ? end - begin : 0,
+                                     std::memory_order_relaxed);
+      }
+    }
+    wgpuBufferUnmap(readback->buffer);
+  }
+  readback->busy = false;
+}
+
+double GpuTimer::GetMilliseconds(uint32_t scope) const {
+  if (scope >= kMaxScopes) {
+    return 0.0;
+  }
+  return m_Nanoseconds[scope].load(std::memory_order_relaxed) * 1e-6;
+}
@@ -0,0 +1,288 @@
+#include "HotReload.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Completed writes, and files renamed into place by editors that save
+// through a temporary
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO;
+#endif
+
+// Graph keys; inotify reports names relative to the canonical directory
+std::string Canonical(const std::string &path) {
+  std::error_code error;
+  const std::filesystem::path canonical =
+      std::filesystem::weakly_canonical(path, error);
+  return error ? path : canonical.string();
+}
+
+} // namespace
+
+HotReload::HotReload() {}
+
+HotReload::~HotReload() { Stop(); }
+
+bool HotReload::Start() {
+#ifdef __linux__
+  if (IsRunning()) {
+    return true;
+  }
+  m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  m_WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_Inotify < 0 || m_WakeFd < 0) {
+    fprintf(stderr, "Failed to start file watching; hot reload disabled\n");
+    Stop();
+    return false;
+  }
+  // Half the cores, so a re-import leaves the rest to the frame
+  m_Importer = std::make_unique<ThreadPool>(
+      std::max(1u, ThreadPool::default_thread_count() / 2));
+  m_Thread = std::thread(&HotReload::ThreadFunc, this);
+  return true;
+#else
+  fprintf(stderr, "Hot reload needs inotify (Linux); disabled\n");
+  return false;
+#endif
+}
+
+void HotReload::Stop() {
+#ifdef __linux__
+  if (m_Thread.joinable()) {
+    const uint64_t wake = 1;
+    if (write(m_WakeFd, &wake, sizeof(wake)) != sizeof(wake)) {
+      fprintf(stderr, "Failed to wake the file watcher\n");
+    }
+    m_Thread.join();
+  }
+  // Joins a re-import still running; its result is dropped below
+  m_Importer.reset();
+  // Closing the inotify descriptor removes every watch
+  if (m_Inotify >= 0) {
+    close(m_Inotify);
+    m_Inotify = -1;
+  }
+  if (m_WakeFd >= 0) {
+    close(m_WakeFd);
+    m_WakeFd = -1;
+  }
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Directories.clear();
+  m_TextureChanges.clear();
+  m_Imported.reset();
+  m_Importing = false;
+  m_ImportQueued = false;
+#endif
+}
+
+void HotReload::Track(const Scene &scene, const std::string &modelPath,
+                      const std::vector<std::string> &modelFiles) {
+  std::unordered_map<std::string, std::vector<Dependent>> dependents;
+  for (const std::string &file : modelFiles) {
+    dependents[Canonical(file)].push_back({Target::Scene, 0});
+  }
+  if (!modelPath.empty()) {
+    std::vector<Dependent> &model = dependents[Canonical(modelPath)];
+    if (model.empty()) {
+      model.push_back({Target::Scene, 0});
+    }
+  }
+  // Embedded textures come with the model file
+  const auto &textures = scene.GetTextures();
+  for (uint32_t i = 0; i < textures.size(); ++i) {
+    if (!textures[i].path.empty()) {
+      dependents[Canonical(textures[i].path)].push_back({Target::Texture, i});
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Dependents = std::move(dependents);
+  m_ModelPath = modelPath;
+  m_TextureChanges.clear();
+
+#ifdef __linux__
+  if (m_Inotify < 0) {
+    return;
+  }
+  // Re-adding a watched directory hands back its existing descriptor
+  std::unordered_set<std::string> wanted;
+  std::unordered_map<int, std::string> directories;
+  for (const auto &[path, targets] : m_Dependents) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (!wanted.insert(directory).second) {
+      continue;
+    }
+    const int wd = inotify_add_watch(m_Inotify, directory.c_str(), kWatchMask);
+    if (wd < 0) {
+      fprintf(stderr, "Failed to watch %s\n", directory.c_str());
+      continue;
+    }
+    directories[wd] = std::move(directory);
+  }
+  for (const auto &[wd, directory] : m_Directories) {
+    if (!directories.contains(wd)) {
+      inotify_rm_watch(m_Inotify, wd);
+    }
+  }
+  m_Directories = std::move(directories);
+#endif
+}
+
+std::vector<HotReload::TextureChange> HotReload::TakeTextureChanges() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::vector<TextureChange> changes;
+  changes.swap(m_TextureChanges);
+  return changes;
+}
+
+bool HotReload::TakeImportedScene(ImportedScene &out) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (!m_Imported) {
+    return false;
+  }
+  out = std::move(*m_Imported);
+  m_Imported.reset();
+  m_SceneReloads++;
+  return true;
+}
+
+HotReload::Stats HotReload::GetStats() const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Stats stats;
+  stats.watchedFiles = static_cast<uint32_t>(m_Dependents.size());
+  stats.sceneReloads = m_SceneReloads;
+  stats.importMs = m_ImportMs;
+  return stats;
+}
+
+void HotReload::ThreadFunc() {
+#ifdef __linux__
+  // Events are variable length; the buffer is aligned for their header
+  alignas(inotify_event) char buffer[16 * 1024];
+  pollfd fds[2] = {{m_Inotify, POLLIN, 0}, {m_WakeFd, POLLIN, 0}};
+  for (;;) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "File watching stopped: poll failed\n");
+      return;
+    }
+    if (fds[1].revents) {
+      return;
+    }
+
+    const ssize_t length = read(m_Inotify, buffer, sizeof(buffer));
+    const Clock::time_point now = Clock::now();
+    for (ssize_t offset = 0; offset < length;) {
+      const auto *event =
+          reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        fprintf(stderr, "File watch queue overflowed; changes were missed\n");
+        continue;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+      std::filesystem::path path;
+      {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Directories.find(event->wd);
+        if (it == m_Directories.end()) {
+          continue;
+        }
+        path = it->second;
+      }
+      OnFileChanged((path / event->name).string(), now);
+    }
+  }
+#endif
+}
+
+void HotReload::OnFileChanged(const std::string &path, Clock::time_point time) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto it = m_Dependents.find(path);
+  if (it == m_Dependents.end()) {
+    return;
+  }
+  for (const Dependent &dependent : it->second) {
+    if (dependent.target == Target::Scene) {
+      RequestImport(time);
+      continue;
+    }
+    // Several writes before the next frame make one reload
+    auto pending = std::find_if(
+        m_TextureChanges.begin(), m_TextureChanges.end(),
+        [&](const TextureChange &c) { return c.texture == dependent.texture; });
+    if (pending == m_TextureChanges.end()) {
+      m_TextureChanges.push_back({dependent.texture, time});
+    }
+  }
+}
+
+void HotReload::RequestImport(Clock::time_point time) {
+  // m_Mutex is held
+  if (m_ModelPath.empty() || !m_Importer) {
+    return;
+  }
+  if (m_Importing) {
+    if (!m_ImportQueued) {
+      m_ImportQueued = true;
+      m_QueuedChange = time;
+    }
+    return;
+  }
+  m_Importing = true;
+  ThreadPool *pool = m_Importer.get();
+  m_Importer->submit([this, pool, path = m_ModelPath, time] {
+    ImportLoop(pool, path, time);
+  });
+}
+
+void HotReload::ImportLoop(ThreadPool *pool, std::string path,
+                           Clock::time_point changed) {
+  for (;;) {
+    const Clock::time_point start = Clock::now();
+    auto imported = std::make_unique<ImportedScene>();
+    imported->scene = std::make_unique<Scene>();
+    imported->changed = changed;
+    // The import's own parallel_for runs on the rest of this pool
+    const bool ok =
+        ImportScene(path.c_str(), *imported->scene, pool, &imported->files);
+    if (ok) {
+      // World bounds too, so the swap is all the render thread has left
+      imported->scene->Update(pool);
+      imported->importMs =
+          std::chrono::duration<double, std::milli>(Clock::now() - start)
+              .count();
+      m_ImportMs = imported->importMs;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // A failed import keeps the current scene; ImportScene said why
+    if (ok && path == m_ModelPath) {
+      m_Imported = std::move(imported);
+    }
+    if (!m_ImportQueued || m_ModelPath.empty()) {
+      m_ImportQueued = false;
+      m_Importing = false;
+      return;
+    }
+    m_ImportQueued = false;
+    changed = m_QueuedChange;
+    path = m_ModelPath;
+  }
+}
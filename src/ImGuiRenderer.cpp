@@ -0,0 +1,466 @@
+#include "ImGuiRenderer.h"
+#include "imgui.h"
+#include "imgui_impl_wgpu.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <stdio.h>
+
+namespace {
+
+const char *kImGuiShader = R"(
+struct Uniforms {
+  mvp : mat4x4<f32>,
+  gamma : f32,
+};
+
+@group(0) @binding(0) var<uniform> uniforms : Uniforms;
+@group(0) @binding(1) var uiSampler : sampler;
+@group(1) @binding(0) var uiTexture : texture_2d<f32>;
+
+struct VertexOutput {
+  @builtin(position) position : vec4<f32>,
+  @location(0) color : vec4<f32>,
+  @location(1) uv : vec2<f32>,
+};
+
+@vertex
+fn vs_main(@location(0) position : vec2<f32>, @location(1) uv : vec2<f32>,
+           @location(2) color : vec4<f32>) -> VertexOutput {
+  var out : VertexOutput;
+  out.position = uniforms.mvp * vec4<f32>(position, 0.0, 1.0);
+  out.color = color;
+  out.uv = uv;
+  return out;
+}
+
+@fragment
+fn fs_main(in : VertexOutput) -> @location(0) vec4<f32> {
+  let color = in.color * textureSample(uiTexture, uiSampler, in.uv);
+  return vec4<f32>(pow(color.rgb, vec3<f32>(uniforms.gamma)), color.a);
+}
+)";
+
+template <typename T> void Release(T &handle, void (*release)(T)) {
+  if (handle) {
+    release(handle);
+    handle = nullptr;
+  }
+}
+
+// The WebGPU backend stores texture views as texture ids
+WGPUTextureView ToView(ImTextureID id) {
+  return reinterpret_cast<WGPUTextureView>(static_cast<intptr_t>(id));
+}
+
+} // namespace
+
+ImGuiRenderer::ImGuiRenderer() {}
+
+ImGuiRenderer::~ImGuiRenderer() { Shutdown(); }
+
+bool ImGuiRenderer::Initialize(WGPUDevice device, WGPUQueue queue,
+                               WGPUTextureFormat targetFormat) {
+  m_Device = device;
+  m_Queue = queue;
+  // ImGui colours are authored for non-sRGB targets
+  m_Gamma = targetFormat == WGPUTextureFormat_RGBA8UnormSrgb ||
+                    targetFormat == WGPUTextureFormat_BGRA8UnormSrgb
+                ? 2.2f
+                : 1.0f;
+
+  WGPUSamplerDescriptor samplerDesc = {};
+  samplerDesc.label = {"ImGui sampler", WGPU_STRLEN};
+  samplerDesc.addressModeU = WGPUAddressMode_ClampToEdge;
+  samplerDesc.addressModeV = WGPUAddressMode_ClampToEdge;
+  samplerDesc.addressModeW = WGPUAddressMode_ClampToEdge;
+  samplerDesc.magFilter = WGPUFilterMode_Linear;
+  samplerDesc.minFilter = WGPUFilterMode_Linear;
+  samplerDesc.mipmapFilter = WGPUMipmapFilterMode_Linear;
+  samplerDesc.maxAnisotropy = 1;
+  m_Sampler = wgpuDeviceCreateSampler(m_Device, &samplerDesc);
+
+  if (!m_Sampler || !CreatePipeline(targetFormat)) {
+    fprintf(stderr, "Failed to create ImGui render resources\n");
+    return false;
+  }
+  return true;
+}
+
+void ImGuiRenderer::Shutdown() {
+  for (auto &[view, group] : m_TextureBindGroups) {
+    wgpuBindGroupRelease(group);
+  }
+  m_TextureBindGroups.clear();
+  Release(m_CommonBindGroup, wgpuBindGroupRelease);
+  Release(m_Buffer, wgpuBufferRelease);
+  m_BufferSize = 0;
+  Release(m_Pipeline, wgpuRenderPipelineRelease);
+  Release(m_CommonLayout, wgpuBindGroupLayoutRelease);
+  Release(m_TextureLayout, wgpuBindGroupLayoutRelease);
+  Release(m_Sampler, wgpuSamplerRelease);
+  m_Device = nullptr;
+  m_Queue = nullptr;
+}
+
+bool ImGuiRenderer::CreatePipeline(WGPUTextureFormat targetFormat) {
+  WGPUBindGroupLayoutEntry commonEntries[2] = {};
+  commonEntries[0].binding = 0;
+  commonEntries[0].visibility =
+      WGPUShaderStage_Vertex | WGPUShaderStage_Fragment;
+  commonEntries[0].buffer.type = WGPUBufferBindingType_Uniform;
+  commonEntries[0].buffer.minBindingSize = sizeof(Uniforms);
+  commonEntries[1].binding = 1;
+  commonEntries[1].visibility = WGPUShaderStage_Fragment;
+  commonEntries[1].sampler.type = WGPUSamplerBindingType_Filtering;
+  WGPUBindGroupLayoutDescriptor commonDesc = {};
+  commonDesc.label = {"ImGui common layout", WGPU_STRLEN};
+  commonDesc.entryCount = 2;
+  commonDesc.entries = commonEntries;
+  m_CommonLayout = wgpuDeviceCreateBindGroupLayout(m_Device, &commonDesc);
+
+  WGPUBindGroupLayoutEntry textureEntry = {};
+  textureEntry.binding = 0;
+  textureEntry.visibility = WGPUShaderStage_Fragment;
+  textureEntry.texture.sampleType = WGPUTextureSampleType_Float;
+  textureEntry.texture.viewDimension = WGPUTextureViewDimension_2D;
+  WGPUBindGroupLayoutDescriptor textureDesc = {};
+  textureDesc.label = {"ImGui texture layout", WGPU_STRLEN};
+  textureDesc.entryCount = 1;
+  textureDesc.entries = &textureEntry;
+  m_TextureLayout = wgpuDeviceCreateBindGroupLayout(m_Device, &textureDesc);
+
+  WGPUShaderSourceWGSL wgsl = {};
+  wgsl.chain.sType = WGPUSType_ShaderSourceWGSL;
+  wgsl.code = {kImGuiShader, WGPU_STRLEN};
+  WGPUShaderModuleDescriptor moduleDesc = {};
+  moduleDesc.nextInChain = &wgsl.chain;
+  moduleDesc.label = {"ImGui shader", WGPU_STRLEN};
+  WGPUShaderModule module = wgpuDeviceCreateShaderModule(m_Device, &moduleDesc);
+  if (!m_CommonLayout || !m_TextureLayout || !module) {
+    if (module) {
+      wgpuShaderModuleRelease(module);
+    }
+    return false;
+  }
+
+  WGPUBindGroupLayout layouts[2] = {m_CommonLayout, m_TextureLayout};
+  WGPUPipelineLayoutDescriptor layoutDesc = {};
+  layoutDesc.bindGroupLayoutCount = 2;
+  layoutDesc.bindGroupLayouts = layouts;
+  WGPUPipelineLayout pipelineLayout =
+      wgpuDeviceCreatePipelineLayout(m_Device, &layoutDesc);
+
+  WGPUVertexAttribute attributes[3] = {};
+  attributes[0].format = WGPUVertexFormat_Float32x2;
+  attributes[0].offset = offsetof(ImDrawVert, pos);
+  attributes[0].shaderLocation = 0;
+  attributes[1].format = WGPUVertexFormat_Float32x2;
+  attributes[1].offset = offsetof(ImDrawVert, uv);
+  attributes[1].shaderLocation = 1;
+  attributes[2].format = WGPUVertexFormat_Unorm8x4;
+  attributes[2].offset = offsetof(ImDrawVert, col);
+  attributes[2].shaderLocation = 2;
+  WGPUVertexBufferLayout vertexLayout = {};
+  vertexLayout.arrayStride = sizeof(ImDrawVert);
+  vertexLayout.stepMode = WGPUVertexStepMode_Vertex;
+  vertexLayout.attributeCount = 3;
+  vertexLayout.attributes = attributes;
+
+  WGPUBlendState blend = {};
+  blend.color.operation = WGPUBlendOperation_Add;
+  blend.color.srcFactor = WGPUBlendFactor_SrcAlpha;
+  blend.color.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha;
+  blend.alpha.operation = WGPUBlendOperation_Add;
+  blend.alpha.srcFactor = WGPUBlendFactor_One;
+  blend.alpha.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha;
+
+  WGPUColorTargetState colorTarget = {};
+  colorTarget.format = targetFormat;
+  colorTarget.blend = &blend;
+  colorTarget.writeMask = WGPUColorWriteMask_All;
+
+  WGPUFragmentState fragment = {};
+  fragment.module = module;
+  fragment.entryPoint = {"fs_main", WGPU_STRLEN};
+  fragment.targetCount = 1;
+  fragment.targets = &colorTarget;
+
+  WGPURenderPipelineDescriptor pipelineDesc = {};
+  pipelineDesc.label = {"ImGui pipeline", WGPU_STRLEN};
+  pipelineDesc.layout = pipelineLayout;
+  pipelineDesc.vertex.module = module;
+  pipelineDesc.vertex.entryPoint = {"vs_main", WGPU_STRLEN};
+  pipelineDesc.vertex.bufferCount = 1;
+  pipelineDesc.vertex.buffers = &vertexLayout;
+  pipelineDesc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+  pipelineDesc.primitive.cullMode = WGPUCullMode_None;
+  pipelineDesc.multisample.count = 1;
+  pipelineDesc.multisample.mask = 0xFFFFFFFF;
+  pipelineDesc.fragment = &fragment;
+  m_Pipeline = wgpuDeviceCreateRenderPipeline(m_Device, &pipelineDesc);
+
+  wgpuPipelineLayoutRelease(pipelineLayout);
+  wgpuShaderModuleRelease(module);
+  return m_Pipeline != nullptr;
+}
+
+void ImGuiRenderer::UpdateTextures(ImDrawData *drawData) {
+  if (!drawData->Textures) {
+    return;
+  }
+  for (ImTextureData *texture : *drawData->Textures) {
+    if (texture->Status == ImTextureStatus_OK) {
+      continue;
+    }
+    const WGPUTextureView view = ToView(texture->GetTexID());
+    ImGui_ImplWGPU_UpdateTexture(texture);
+    if (texture->Status == ImTextureStatus_Destroyed && view) {
+      ForgetTexture(view);
+    }
+  }
+}
+
+void ImGuiRenderer::ForgetTexture(WGPUTextureView view) {
+  auto it = m_TextureBindGroups.find(view);
+  if (it != m_TextureBindGroups.end()) {
+    wgpuBindGroupRelease(it->second);
+    m_TextureBindGroups.erase(it);
+  }
+}
+
+WGPUBindGroup ImGuiRenderer::GetTextureBindGroup(WGPUTextureView view) {
+  auto it = m_TextureBindGroups.find(view);
+  if (it != m_TextureBindGroups.end()) {
+    return it->second;
+  }
+  WGPUBindGroupEntry entry = {};
+  entry.binding = 0;
+  entry.textureView = view;
+  WGPUBindGroupDescriptor desc = {};
+  desc.label = {"ImGui texture", WGPU_STRLEN};
+  desc.layout = m_TextureLayout;
+  desc.entryCount = 1;
+  desc.entries = &entry;
+  WGPUBindGroup group = wgpuDeviceCreateBindGroup(m_Device, &desc);
+  m_TextureBindGroups.emplace(view, group);
+  return group;
+}
+
+void ImGuiRenderer::EnsureCapacity(uint64_t size) {
+  if (size <= m_BufferSize && m_Buffer) {
+    return;
+  }
+
+  // Grow geometrically so a UI that keeps getting busier settles quickly
+  uint64_t capacity = std::max<uint64_t>(m_BufferSize, 1 << 20);
+  while (capacity < size) {
+    capacity *= 2;
+  }
+
+  // Released rather than destroyed: frames in flight still read the old one
+  Release(m_CommonBindGroup, wgpuBindGroupRelease);
+  Release(m_Buffer, wgpuBufferRelease);
+  WGPUBufferDescriptor bufferDesc = {};
+  bufferDesc.label = {"ImGui geometry", WGPU_STRLEN};
+  bufferDesc.size = capacity;
+  bufferDesc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_Vertex |
+                     WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst;
+  m_Buffer = wgpuDeviceCreateBuffer(m_Device, &bufferDesc);
+  m_BufferSize = m_Buffer ? capacity : 0;
+
+  WGPUBindGroupEntry entries[2] = {};
+  entries[0].binding = 0;
+  entries[0].buffer = m_Buffer;
+  entries[0].size = sizeof(Uniforms);
+  entries[1].binding = 1;
+  entries[1].sampler = m_Sampler;
+  WGPUBindGroupDescriptor groupDesc = {};
+  groupDesc.label = {"ImGui common", WGPU_STRLEN};
+  groupDesc.layout = m_CommonLayout;
+  groupDesc.entryCount = 2;
+  groupDesc.entries = entries;
+  m_CommonBindGroup = wgpuDeviceCreateBindGroup(m_Device, &groupDesc);
+}
+
+uint64_t ImGuiRenderer::Pack(const ImDrawData *drawData,
+                             uint64_t &indexOffset) {
+  const uint64_t vertexBytes =
+      (uint64_t(drawData->TotalVtxCount) * sizeof(ImDrawVert) + 3) & ~3ull;
+  indexOffset = kGeometryOffset + vertexBytes;
+  const uint64_t size =
+      indexOffset + uint64_t(drawData->TotalIdxCount) * sizeof(uint32_t);
+  if (m_Staging.size() < size) {
+    m_Staging.resize(size);
+  }
+
+  // Orthographic projection of the display rect
+  const float l = drawData->DisplayPos.x;
+  const float r = l + drawData->DisplaySize.x;
+  const float t = drawData->DisplayPos.y;
+  const float b = t + drawData->DisplaySize.y;
+  const Uniforms uniforms = {
+      {{2.0f / (r - l), 0.0f, 0.0f, 0.0f},
+       {0.0f, 2.0f / (t - b), 0.0f, 0.0f},
+       {0.0f, 0.0f, 0.5f, 0.0f},
+       {(r + l) / (l - r), (t + b) / (b - t), 0.5f, 1.0f}},
+      m_Gamma,
+      {}};
+  std::memcpy(m_Staging.data(), &uniforms, sizeof(uniforms));
+
+  uint8_t *vertices = m_Staging.data() + kGeometryOffset;
+  auto *indices = reinterpret_cast<uint32_t *>(m_Staging.data() + indexOffset);
+  const ImVec2 clipOffset = drawData->DisplayPos;
+  const ImVec2 clipScale = drawData->FramebufferScale;
+  const float width = drawData->DisplaySize.x * clipScale.x;
+  const float height = drawData->DisplaySize.y * clipScale.y;
+
+  m_Batches.clear();
+  uint32_t vertexBase = 0;
+  uint32_t indexBase = 0;
+  for (const ImDrawList *list : drawData->CmdLists) {
+    std::memcpy(vertices + uint64_t(vertexBase) * sizeof(ImDrawVert),
+                list->VtxBuffer.Data,
+                size_t(list->VtxBuffer.Size) * sizeof(ImDrawVert));
+
+    for (const ImDrawCmd &cmd : list->CmdBuffer) {
+      m_Stats.commands++;
+      if (cmd.UserCallback) {
+        Batch batch;
+        batch.list = list;
+        batch.callback = &cmd;
+        m_Batches.push_back(batch);
+        continue;
+      }
+
+      const ImVec4 &rect = cmd.ClipRect;
+      const float x0 = std::max((rect.x - clipOffset.x) * clipScale.x, 0.0f);
+      const float y0 = std::max((rect.y - clipOffset.y) * clipScale.y, 0.0f);
+      const float x1 = std::min((rect.z - clipOffset.x) * clipScale.x, width);
+      const float y1 = std::min((rect.w - clipOffset.y) * clipScale.y, height);
+      if (x1 <= x0 || y1 <= y0 || cmd.ElemCount == 0) {
+        continue;
+      }
+
+      // Rebase onto the shared vertex range so every draw uses base vertex 0
+      const uint32_t first = indexBase + cmd.IdxOffset;
+      const uint32_t offset = vertexBase + cmd.VtxOffset;
+      const ImDrawIdx *source = list->IdxBuffer.Data + cmd.IdxOffset;
+      for (uint32_t i = 0; i < cmd.ElemCount; ++i) {
+        indices[first + i] = source[i] + offset;
+      }
+
+      Batch batch;
+      batch.texture = ToView(cmd.GetTexID());
+      batch.clip[0] = static_cast<uint32_t>(x0);
+      batch.clip[1] = static_cast<uint32_t>(y0);
+      batch.clip[2] = static_cast<uint32_t>(x1) - batch.clip[0];
+      batch.clip[3] = static_cast<uint32_t>(y1) - batch.clip[1];
+      batch.firstIndex = first;
+      batch.indexCount = cmd.ElemCount;
+
+      // Continue the previous draw when only the command boundary differs
+      if (!m_Batches.empty()) {
+        Batch &last = m_Batches.back();
+        if (!last.callback && last.texture == batch.texture &&
+            std::memcmp(last.clip, batch.clip, sizeof(batch.clip)) == 0 &&
+            last.firstIndex + last.indexCount == first) {
+          last.indexCount += cmd.ElemCount;
+          continue;
+        }
+      }
+      m_Batches.push_back(batch);
+    }
+
+    vertexBase += static_cast<uint32_t>(list->VtxBuffer.Size);
+    indexBase += static_cast<uint32_t>(list->IdxBuffer.Size);
+  }
+  return size;
+}
+
+void ImGuiRenderer::SetupRenderState(WGPURenderPassEncoder pass,
+                                     uint32_t width, uint32_t height,
+                                     uint64_t indexOffset, uint64_t size) {
+  wgpuRenderPassEncoderSetPipeline(pass, m_Pipeline);
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, m_Buffer, kGeometryOffset,
+                                       indexOffset - kGeometryOffset);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, m_Buffer, WGPUIndexFormat_Uint32,
+                                      indexOffset, size - indexOffset);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, m_CommonBindGroup, 0, nullptr);
+  wgpuRenderPassEncoderSetViewport(pass, 0.0f, 0.0f, static_cast<float>(width),
+                                   static_cast<float>(height), 0.0f, 1.0f);
+}
+
+void ImGuiRenderer::Render(ImDrawData *drawData, WGPURenderPassEncoder pass) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  m_Stats.vertices = 0;
+  m_Stats.indices = 0;
+  m_Stats.commands = 0;
+  m_Stats.drawCalls = 0;
+
+  // Textures first: the font atlas may have grown or gained glyphs
+  UpdateTextures(drawData);
+
+  const uint32_t width = static_cast<uint32_t>(drawData->DisplaySize.x *
+                                               drawData->FramebufferScale.x);
+  const uint32_t height = static_cast<uint32_t>(drawData->DisplaySize.y *
+                                                drawData->FramebufferScale.y);
+  if (!m_Pipeline || width == 0 || height == 0 ||
+      drawData->TotalVtxCount == 0) {
+    return;
+  }
+
+  uint64_t indexOffset = 0;
+  const uint64_t size = Pack(drawData, indexOffset);
+  EnsureCapacity(size);
+  if (!m_Buffer || !m_CommonBindGroup) {
+    return;
+  }
+  wgpuQueueWriteBuffer(m_Queue, m_Buffer, 0, m_Staging.data(), size);
+  SetupRenderState(pass, width, height, indexOffset, size);
+
+  // Callbacks written for the stock backend find the pass the same way
+  ImGui_ImplWGPU_RenderState renderState;
+  renderState.Device = m_Device;
+  renderState.RenderPassEncoder = pass;
+  ImGuiPlatformIO &platformIo = ImGui::GetPlatformIO();
+  platformIo.Renderer_RenderState = &renderState;
+
+  WGPUTextureView boundTexture = nullptr;
+  uint32_t boundClip[4] = {0, 0, 0, 0};
+  for (const Batch &batch : m_Batches) {
+    if (batch.callback) {
+      if (batch.callback->UserCallback != ImDrawCallback_ResetRenderState) {
+        batch.callback->UserCallback(batch.list, batch.callback);
+      }
+      // A callback may have changed any of it
+      SetupRenderState(pass, width, height, indexOffset, size);
+      boundTexture = nullptr;
+      std::memset(boundClip, 0, sizeof(boundClip));
+      continue;
+    }
+    if (batch.texture != boundTexture) {
+      wgpuRenderPassEncoderSetBindGroup(
+          pass, 1, GetTextureBindGroup(batch.texture), 0, nullptr);
+      boundTexture = batch.texture;
+    }
+    if (std::memcmp(boundClip, batch.clip, sizeof(boundClip)) != 0) {
+      wgpuRenderPassEncoderSetScissorRect(pass, batch.clip[0], batch.clip[1],
+                                          batch.clip[2], batch.clip[3]);
+      std::memcpy(boundClip, batch.clip, sizeof(boundClip));
+    }
+    wgpuRenderPassEncoderDrawIndexed(pass, batch.indexCount, 1,
+                                     batch.firstIndex, 0, 0);
+    m_Stats.drawCalls++;
+  }
+  platformIo.Renderer_RenderState = nullptr;
+
+  m_Stats.vertices = static_cast<uint32_t>(drawData->TotalVtxCount);
+  m_Stats.indices = static_cast<uint32_t>(drawData->TotalIdxCount);
+  m_Stats.bindGroups = static_cast<uint32_t>(m_TextureBindGroups.size());
+  m_Stats.bufferBytes = m_BufferSize;
+  m_Stats.cpuMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::high_resolution_clock::now() - start)
+                      .count();
+}
@@ -0,0 +1,1008 @@
+#include "MeshRenderer.h"
+#include "scene/Scene.h"
+#include "utilities/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdio.h>
+
+namespace {
+
+const char *kMeshShader = R"(
+struct Camera {
+  viewProj : mat4x4<f32>,
+  cameraPos : vec4<f32>,
+  lightDir : vec4<f32>,
+};
+
+struct Instance {
+  model : mat4x4<f32>,
+  color : vec4<f32>,
+};
+
+struct DrawInfo {
+  instanceBase : u32,
+};
+
+@group(0) @binding(0) var<uniform> camera : Camera;
+@group(0) @binding(1) var<storage, read> instances : array<Instance>;
+// GPU-driven path only: compacted visible object ids and the bucket's range
+@group(0) @binding(2) var<storage, read> visibleIds : array<u32>;
+@group(1) @binding(0) var baseColorTexture : texture_2d<f32>;
+@group(1) @binding(1) var baseColorSampler : sampler;
+@group(2) @binding(0) var<uniform> draw : DrawInfo;
+
+struct VsOut {
+  @builtin(position) position : vec4<f32>,
+  @location(0) normal : vec3<f32>,
+  @location(1) color : vec4<f32>,
+  @location(2) uv : vec2<f32>,
+};
+
+fn transform(inst : Instance, position : vec3<f32>, normal : vec3<f32>,
+             uv : vec2<f32>) -> VsOut {
+  var out : VsOut;
+  out.position = camera.viewProj * (inst.model * vec4<f32>(position, 1.0));
+  out.normal = (inst.model * vec4<f32>(normal, 0.0)).xyz;
+  out.color = inst.color;
+  out.uv = uv;
+  return out;
+}
+
+@vertex
+fn vs_main(@location(0) position : vec3<f32>,
+           @location(1) normal : vec3<f32>,
+           @location(2) uv : vec2<f32>,
+           @builtin(instance_index) instance : u32) -> VsOut {
+  return transform(instances[instance], position, normal, uv);
+}
+
+@vertex
+fn vs_indirect(@location(0) position : vec3<f32>,
+               @location(1) normal : vec3<f32>,
+               @location(2) uv : vec2<f32>,
+               @builtin(instance_index) instance : u32) -> VsOut {
+  let id = visibleIds[draw.instanceBase + instance];
+  return transform(instances[id], position, normal, uv);
+}
+
+@fragment
+fn fs_main(in : VsOut) -> @location(0) vec4<f32> {
+  let n = normalize(in.normal);
+  let diffuse = max(dot(n, -camera.lightDir.xyz), 0.0);
+  let albedo = in.color * textureSample(baseColorTexture, baseColorSampler, in.uv);
+  return vec4<f32>(albedo.rgb * (0.25 + 0.75 * diffuse), albedo.a);
+}
+)";
+
+WGPUBuffer CreateBuffer(WGPUDevice device, const char *label, uint64_t size,
+                        WGPUBufferUsage usage) {
+  WGPUBufferDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.size = (size + 3) & ~uint64_t(3);
+  desc.usage = usage;
+  desc.mappedAtCreation = false;
+  return wgpuDeviceCreateBuffer(device, &desc);
+}
+
+WGPUBindGroupLayoutEntry BufferEntry(uint32_t binding, WGPUShaderStage visibility,
+                                     WGPUBufferBindingType type,
+                                     bool dynamicOffset = false) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = visibility;
+  entry.buffer.type = type;
+  entry.buffer.hasDynamicOffset = dynamicOffset;
+  return entry;
+}
+
+WGPUBindGroupLayout CreateLayout(WGPUDevice device, const char *label,
+                                 const WGPUBindGroupLayoutEntry *entries,
+                                 size_t count) {
+  WGPUBindGroupLayoutDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.entryCount = count;
+  desc.entries = entries;
+  return wgpuDeviceCreateBindGroupLayout(device, &desc);
+}
+
+} // namespace
+
+MeshRenderer::MeshRenderer() {}
+
+MeshRenderer::~MeshRenderer() { Shutdown(); }
+
+bool MeshRenderer::Initialize(WGPUDevice device, WGPUQueue queue,
+                              WGPUTextureFormat colorFormat,
+                              WGPUTextureFormat depthFormat) {
+  m_Device = device;
+  m_Queue = queue;
+
+  if (!CreatePipeline(colorFormat, depthFormat)) {
+    fprintf(stderr, "Failed to create mesh pipeline\n");
+    return false;
+  }
+
+  m_UniformBuffer =
+      CreateBuffer(m_Device, "Mesh camera uniforms", sizeof(CameraUniforms),
+                   WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst);
+  EnsureInstanceCapacity(1024);
+
+  if (!m_Culler.Initialize(m_Device, m_Queue) ||
+      !m_Textures.Initialize(m_Device, m_Queue)) {
+    return false;
+  }
+  return true;
+}
+
+void MeshRenderer::Shutdown() {
+  ReleaseGeometry();
+  m_Culler.Shutdown();
+  m_Textures.Shutdown();
+
+  if (m_IndirectPipeline) {
+    wgpuRenderPipelineRelease(m_IndirectPipeline);
+    m_IndirectPipeline = nullptr;
+  }
+  for (WGPUBindGroupLayout &layout : m_IndirectLayouts) {
+    if (layout) {
+      wgpuBindGroupLayoutRelease(layout);
+      layout = nullptr;
+    }
+  }
+
+  if (m_BindGroup) {
+    wgpuBindGroupRelease(m_BindGroup);
+    m_BindGroup = nullptr;
+  }
+  if (m_InstanceBuffer) {
+    wgpuBufferRelease(m_InstanceBuffer);
+    m_InstanceBuffer = nullptr;
+    m_InstanceCapacity = 0;
+  }
+  if (m_UniformBuffer) {
+    wgpuBufferRelease(m_UniformBuffer);
+    m_UniformBuffer = nullptr;
+  }
+  if (m_BindGroupLayout) {
+    wgpuBindGroupLayoutRelease(m_BindGroupLayout);
+    m_BindGroupLayout = nullptr;
+  }
+  if (m_MaterialLayout) {
+    wgpuBindGroupLayoutRelease(m_MaterialLayout);
+    m_MaterialLayout = nullptr;
+  }
+  if (m_Pipeline) {
+    wgpuRenderPipelineRelease(m_Pipeline);
+    m_Pipeline = nullptr;
+  }
+}
+
+void MeshRenderer::ReleaseBindings() {
+  for (MaterialBinding &binding : m_MaterialBindings) {
+    if (binding.bindGroup) {
+      wgpuBindGroupRelease(binding.bindGroup);
+    }
+  }
+  m_MaterialBindings.clear();
+  if (m_IndirectBindGroup) {
+    wgpuBindGroupRelease(m_IndirectBindGroup);
+    m_IndirectBindGroup = nullptr;
+  }
+  if (m_DrawInfoBindGroup) {
+    wgpuBindGroupRelease(m_DrawInfoBindGroup);
+    m_DrawInfoBindGroup = nullptr;
+  }
+  if (m_DrawInfoBuffer) {
+    wgpuBufferRelease(m_DrawInfoBuffer);
+    m_DrawInfoBuffer = nullptr;
+  }
+}
+
+void MeshRenderer::ReleaseGeometry() {
+  ReleaseBindings();
+  if (m_VertexBuffer) {
+    wgpuBufferRelease(m_VertexBuffer);
+    m_VertexBuffer = nullptr;
+  }
+  if (m_IndexBuffer) {
+    wgpuBufferRelease(m_IndexBuffer);
+    m_IndexBuffer = nullptr;
+  }
+  m_VertexBufferSize = 0;
+  m_IndexBufferSize = 0;
+  m_VertexEnd = 0;
+  m_IndexEnd = 0;
+  m_Meshes.clear();
+  m_Lods.clear();
+  m_ObjectLods.clear();
+}
+
+bool MeshRenderer::CreatePipeline(WGPUTextureFormat colorFormat,
+                                  WGPUTextureFormat depthFormat) {
+  WGPUShaderSourceWGSL wgsl = {};
+  wgsl.chain.sType = WGPUSType_ShaderSourceWGSL;
+  wgsl.code = {kMeshShader, WGPU_STRLEN};
+  WGPUShaderModuleDescriptor moduleDesc = {};
+  moduleDesc.nextInChain = &wgsl.chain;
+  moduleDesc.label = {"Mesh shader", WGPU_STRLEN};
+  WGPUShaderModule module = wgpuDeviceCreateShaderModule(m_Device, &moduleDesc);
+  if (!module) {
+    return false;
+  }
+
+  WGPUVertexAttribute attributes[3] = {};
+  attributes[0].format = WGPUVertexFormat_Float32x3;
+  attributes[0].offset = offsetof(Vertex, position);
+  attributes[0].shaderLocation = 0;
+  attributes[1].format = WGPUVertexFormat_Float32x3;
+  attributes[1].offset = offsetof(Vertex, normal);
+  attributes[1].shaderLocation = 1;
+  attributes[2].format = WGPUVertexFormat_Float32x2;
+  attributes[2].offset = offsetof(Vertex, uv);
+  attributes[2].shaderLocation = 2;
+
+  WGPUVertexBufferLayout vertexLayout = {};
+  vertexLayout.arrayStride = sizeof(Vertex);
+  vertexLayout.stepMode = WGPUVertexStepMode_Vertex;
+  vertexLayout.attributeCount = 3;
+  vertexLayout.attributes = attributes;
+
+  WGPUColorTargetState colorTarget = {};
+  colorTarget.format = colorFormat;
+  colorTarget.writeMask = WGPUColorWriteMask_All;
+
+  WGPUFragmentState fragment = {};
+  fragment.module = module;
+  fragment.entryPoint = {"fs_main", WGPU_STRLEN};
+  fragment.targetCount = 1;
+  fragment.targets = &colorTarget;
+
+  WGPUStencilFaceState stencilFace = {};
+  stencilFace.compare = WGPUCompareFunction_Always;
+  stencilFace.failOp = WGPUStencilOperation_Keep;
+  stencilFace.depthFailOp = WGPUStencilOperation_Keep;
+  stencilFace.passOp = WGPUStencilOperation_Keep;
+
+  WGPUDepthStencilState depthStencil = {};
+  depthStencil.format = depthFormat;
+  depthStencil.depthWriteEnabled = WGPUOptionalBool_True;
+  depthStencil.depthCompare = WGPUCompareFunction_Less;
+  depthStencil.stencilFront = stencilFace;
+  depthStencil.stencilBack = stencilFace;
+  depthStencil.stencilReadMask = 0xFFFFFFFF;
+  depthStencil.stencilWriteMask = 0xFFFFFFFF;
+
+  // Explicit layouts so material bind groups are shared by both pipelines
+  // and the indirect variant can take a dynamic offset for the per-bucket
+  // instance base
+  const WGPUBindGroupLayoutEntry objectEntries[] = {
+      BufferEntry(0, WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+                  WGPUBufferBindingType_Uniform),
+      BufferEntry(1, WGPUShaderStage_Vertex,
+                  WGPUBufferBindingType_ReadOnlyStorage),
+      BufferEntry(2, WGPUShaderStage_Vertex,
+                  WGPUBufferBindingType_ReadOnlyStorage),
+  };
+  WGPUBindGroupLayoutEntry materialEntries[2] = {};
+  materialEntries[0].binding = 0;
+  materialEntries[0].visibility = WGPUShaderStage_Fragment;
+  materialEntries[0].texture.sampleType = WGPUTextureSampleType_Float;
+  materialEntries[0].texture.viewDimension = WGPUTextureViewDimension_2D;
+  materialEntries[1].binding = 1;
+  materialEntries[1].visibility = WGPUShaderStage_Fragment;
+  materialEntries[1].sampler.type = WGPUSamplerBindingType_Filtering;
+  const WGPUBindGroupLayoutEntry drawEntry = BufferEntry(
+      0, WGPUShaderStage_Vertex, WGPUBufferBindingType_Uniform, true);
+
+  m_BindGroupLayout =
+      CreateLayout(m_Device, "Mesh objects layout", objectEntries, 2);
+  m_MaterialLayout =
+      CreateLayout(m_Device, "Mesh material layout", materialEntries, 2);
+  m_IndirectLayouts[0] = CreateLayout(m_Device, "Mesh indirect objects layout",
+                                      objectEntries, 3);
+  m_IndirectLayouts[1] =
+      CreateLayout(m_Device, "Mesh indirect draw layout", &drawEntry, 1);
+
+  const WGPUBindGroupLayout directGroups[] = {m_BindGroupLayout,
+                                             m_MaterialLayout};
+  const WGPUBindGroupLayout indirectGroups[] = {
+      m_IndirectLayouts[0], m_MaterialLayout, m_IndirectLayouts[1]};
+  WGPUPipelineLayoutDescriptor pipelineLayoutDesc = {};
+  pipelineLayoutDesc.bindGroupLayoutCount = 2;
+  pipelineLayoutDesc.bindGroupLayouts = directGroups;
+  WGPUPipelineLayout directLayout =
+      wgpuDeviceCreatePipelineLayout(m_Device, &pipelineLayoutDesc);
+  pipelineLayoutDesc.bindGroupLayoutCount = 3;
+  pipelineLayoutDesc.bindGroupLayouts = indirectGroups;
+  WGPUPipelineLayout indirectLayout =
+      wgpuDeviceCreatePipelineLayout(m_Device, &pipelineLayoutDesc);
+
+  WGPURenderPipelineDescriptor pipelineDesc = {};
+  pipelineDesc.label = {"Mesh pipeline", WGPU_STRLEN};
+  pipelineDesc.layout = directLayout;
+  pipelineDesc.vertex.module = module;
+  pipelineDesc.vertex.entryPoint = {"vs_main", WGPU_STRLEN};
+  pipelineDesc.vertex.bufferCount = 1;
+  pipelineDesc.vertex.buffers = &vertexLayout;
+  pipelineDesc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+  pipelineDesc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
+  pipelineDesc.primitive.frontFace = WGPUFrontFace_CCW;
+  pipelineDesc.primitive.cullMode = WGPUCullMode_Back;
+  pipelineDesc.depthStencil = &depthStencil;
+  pipelineDesc.multisample.count = 1;
+  pipelineDesc.multisample.mask = 0xFFFFFFFF;
+  pipelineDesc.fragment = &fragment;
+  m_Pipeline = wgpuDeviceCreateRenderPipeline(m_Device, &pipelineDesc);
+
+  pipelineDesc.label = {"Mesh indirect pipeline", WGPU_STRLEN};
+  pipelineDesc.layout = indirectLayout;
+  pipelineDesc.vertex.entryPoint = {"vs_indirect", WGPU_STRLEN};
+  m_IndirectPipeline = wgpuDeviceCreateRenderPipeline(m_Device, &pipelineDesc);
+
+  wgpuPipelineLayoutRelease(directLayout);
+  wgpuPipelineLayoutRelease(indirectLayout);
+  wgpuShaderModuleRelease(module);
+  return m_Pipeline && m_IndirectPipeline;
+}
+
+void MeshRenderer::EnsureInstanceCapacity(size_t count) {
+  if (count <= m_InstanceCapacity && m_BindGroup) {
+    return;
+  }
+
+  // Grow geometrically so a slowly rising visible count doesn't reallocate
+  // every frame
+  size_t capacity = std::max<size_t>(m_InstanceCapacity, 1024);
+  while (capacity < count) {
+    capacity *= 2;
+  }
+
+  if (m_BindGroup) {
+    wgpuBindGroupRelease(m_BindGroup);
+    m_BindGroup = nullptr;
+  }
+  if (m_InstanceBuffer) {
+    wgpuBufferRelease(m_InstanceBuffer);
+  }
+  m_InstanceBuffer =
+      CreateBuffer(m_Device, "Mesh instances", capacity * sizeof(InstanceData),
+                   WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst);
+  m_InstanceCapacity = capacity;
+
+  WGPUBindGroupEntry entries[2] = {};
+  entries[0].binding = 0;
+  entries[0].buffer = m_UniformBuffer;
+  entries[0].size = sizeof(CameraUniforms);
+  entries[1].binding = 1;
+  entries[1].buffer = m_InstanceBuffer;
+  entries[1].size = capacity * sizeof(InstanceData);
+
+  WGPUBindGroupDescriptor desc = {};
+  desc.label = {"Mesh bind group", WGPU_STRLEN};
+  desc.layout = m_BindGroupLayout;
+  desc.entryCount = 2;
+  desc.entries = entries;
+  m_BindGroup = wgpuDeviceCreateBindGroup(m_Device, &desc);
+}
+
+bool MeshRenderer::Upload(const Scene &scene,
+                          const std::vector<uint32_t> *previousMeshes) {
+  ReleaseBindings();
+  // Keeps the residency of textures the new scene still uses
+  m_Textures.SetTextures(scene);
+
+  if (!previousMeshes || !UpdateGeometry(scene, *previousMeshes)) {
+    if (!UploadGeometry(scene)) {
+      return false;
+    }
+  }
+  if (!m_VertexBuffer) {
+    return true;
+  }
+  m_ObjectLods.assign(scene.GetObjects().size(), 0);
+
+  // Batches are keyed by material and global LOD index
+  const size_t materials = scene.GetMaterials().size();
+  m_KeysFit = DrawQueue::Fits(
+      1, static_cast<uint32_t>(std::min<size_t>(materials, UINT32_MAX)),
+      static_cast<uint32_t>(std::min<size_t>(m_Lods.size(), UINT32_MAX)));
+  if (!m_KeysFit) {
+    fprintf(stderr,
+            "%zu materials and %zu LODs exceed the draw sort key (%u and %u); "
+            "batching is disabled for this scene\n",
+            materials, m_Lods.size(), 1u << DrawQueue::kMaterialBits,
+            1u << DrawQueue::kMeshBits);
+  }
+
+  // Resident object data for the GPU-driven path
+  std::vector<std::vector<IndirectDrawArgs>> meshDraws(m_Meshes.size());
+  for (size_t i = 0; i < m_Meshes.size(); ++i) {
+    const GpuMesh &mesh = m_Meshes[i];
+    meshDraws[i].resize(mesh.lodCount);
+    for (uint32_t lod = 0; lod < mesh.lodCount; ++lod) {
+      meshDraws[i][lod].indexCount = m_Lods[mesh.firstLod + lod].indexCount;
+      meshDraws[i][lod].firstIndex = m_Lods[mesh.firstLod + lod].firstIndex;
+      meshDraws[i][lod].baseVertex = mesh.baseVertex;
+    }
+  }
+  if (!m_Culler.Upload(scene, meshDraws)) {
+    return false;
+  }
+  m_GpuObjectsCurrent = true;
+  CreateIndirectBindGroups();
+  return true;
+}
+
+bool MeshRenderer::UploadGeometry(const Scene &scene) {
+  ReleaseGeometry();
+
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+  for (const MeshData &mesh : scene.GetMeshes()) {
+    vertexCount += mesh.vertices.size();
+    indexCount += mesh.indices.size();
+  }
+  if (vertexCount == 0 || indexCount == 0) {
+    return true;
+  }
+
+  // CopySrc so a reload that outgrows them can move the contents on the GPU
+  m_VertexBufferSize = vertexCount * sizeof(Vertex);
+  m_IndexBufferSize = indexCount * sizeof(uint32_t);
+  m_VertexBuffer = CreateBuffer(m_Device, "Scene vertices", m_VertexBufferSize,
+                                WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst |
+                                    WGPUBufferUsage_CopySrc);
+  m_IndexBuffer = CreateBuffer(m_Device, "Scene indices", m_IndexBufferSize,
+                               WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst |
+                                   WGPUBufferUsage_CopySrc);
+  if (!m_VertexBuffer || !m_IndexBuffer) {
+    fprintf(stderr, "Failed to allocate scene geometry buffers\n");
+    ReleaseGeometry();
+    return false;
+  }
+
+  // Suballocate every mesh into the shared buffers
+  m_Meshes.reserve(scene.GetMeshes().size());
+  for (const MeshData &mesh : scene.GetMeshes()) {
+    GpuMesh gpu;
+    gpu.baseVertex = static_cast<int32_t>(m_VertexEnd);
+    gpu.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    gpu.firstIndex = static_cast<uint32_t>(m_IndexEnd);
+    gpu.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    gpu.firstLod = static_cast<uint32_t>(m_Lods.size());
+    gpu.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    m_Meshes.push_back(gpu);
+    for (const MeshLod &lod : mesh.lods) {
+      m_Lods.push_back({gpu.firstIndex + lod.firstIndex, lod.indexCount,
+                        lod.error});
+    }
+
+    if (!mesh.vertices.empty()) {
+      wgpuQueueWriteBuffer(m_Queue, m_VertexBuffer, m_VertexEnd * sizeof(Vertex),
+                           mesh.vertices.data(),
+                           mesh.vertices.size() * sizeof(Vertex));
+    }
+    if (!mesh.indices.empty()) {
+      wgpuQueueWriteBuffer(m_Queue, m_IndexBuffer, m_IndexEnd * sizeof(uint32_t),
+                           mesh.indices.data(),
+                           mesh.indices.size() * sizeof(uint32_t));
+    }
+    m_VertexEnd += mesh.vertices.size();
+    m_IndexEnd += mesh.indices.size();
+  }
+
+  printf("Uploaded scene geometry: %zu vertices, %zu indices in %zu LODs "
+         "(%.1f MB)\n",
+         vertexCount, indexCount, m_Lods.size(),
+         (m_VertexBufferSize + m_IndexBufferSize) / (1024.0 * 1024.0));
+  return true;
+}
+
+bool MeshRenderer::UpdateGeometry(const Scene &scene,
+                                  const std::vector<uint32_t> &previousMeshes) {
+  const auto &meshes = scene.GetMeshes();
+  if (!m_VertexBuffer || previousMeshes.size() != meshes.size()) {
+    return false;
+  }
+
+  // Matched meshes keep their ranges; the rest are appended past everything
+  // allocated so far
+  std::vector<GpuMesh> gpuMeshes(meshes.size());
+  std::vector<GpuLod> lods;
+  uint64_t vertexEnd = m_VertexEnd;
+  uint64_t indexEnd = m_IndexEnd;
+  uint64_t liveVertices = 0;
+  uint64_t liveIndices = 0;
+  size_t kept = 0;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    const MeshData &mesh = meshes[i];
+    GpuMesh &gpu = gpuMeshes[i];
+    const uint32_t previous = previousMeshes[i];
+    if (previous < m_Meshes.size()) {
+      gpu = m_Meshes[previous];
+      gpu.firstLod = static_cast<uint32_t>(lods.size());
+      lods.insert(lods.end(), m_Lods.begin() + m_Meshes[previous].firstLod,
+                  m_Lods.begin() + m_Meshes[previous].firstLod + gpu.lodCount);
+      kept++;
+    } else {
+      gpu.baseVertex = static_cast<int32_t>(vertexEnd);
+      gpu.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+      gpu.firstIndex = static_cast<uint32_t>(indexEnd);
+      gpu.indexCount = static_cast<uint32_t>(mesh.indices.size());
+      gpu.firstLod = static_cast<uint32_t>(lods.size());
+      gpu.lodCount = static_cast<uint32_t>(mesh.lods.size());
+      for (const MeshLod &lod : mesh.lods) {
+        lods.push_back({gpu.firstIndex + lod.firstIndex, lod.indexCount,
+                        lod.error});
+      }
+      vertexEnd += mesh.vertices.size();
+      indexEnd += mesh.indices.size();
+    }
+    liveVertices += gpu.vertexCount;
+    liveIndices += gpu.indexCount;
+  }
+  // Ranges of removed or edited meshes are only reclaimed by a full upload,
+  // once they would outweigh the live geometry
+  if (kept == 0 || vertexEnd > 2 * liveVertices ||
+      indexEnd > 2 * liveIndices || vertexEnd > INT32_MAX ||
+      indexEnd > UINT32_MAX) {
+    return false;
+  }
+  if (!GrowBuffer(m_VertexBuffer, m_VertexBufferSize, vertexEnd * sizeof(Vertex),
+                  m_VertexEnd * sizeof(Vertex), "Scene vertices",
+                  WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst |
+                      WGPUBufferUsage_CopySrc) ||
+      !GrowBuffer(m_IndexBuffer, m_IndexBufferSize, indexEnd * sizeof(uint32_t),
+                  m_IndexEnd * sizeof(uint32_t), "Scene indices",
+                  WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst |
+                      WGPUBufferUsage_CopySrc)) {
+    return false;
+  }
+
+  uint64_t uploaded = 0;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    if (previousMeshes[i] < m_Meshes.size()) {
+      continue;
+    }
+    const MeshData &mesh = meshes[i];
+    const GpuMesh &gpu = gpuMeshes[i];
+    if (!mesh.vertices.empty()) {
+      wgpuQueueWriteBuffer(m_Queue, m_VertexBuffer,
+                           uint64_t(gpu.baseVertex) * sizeof(Vertex),
+                           mesh.vertices.data(),
+                           mesh.vertices.size() * sizeof(Vertex));
+    }
+    if (!mesh.indices.empty()) {
+      wgpuQueueWriteBuffer(m_Queue, m_IndexBuffer,
+                           uint64_t(gpu.firstIndex) * sizeof(uint32_t),
+                           mesh.indices.data(),
+                           mesh.indices.size() * sizeof(uint32_t));
+    }
+    uploaded += mesh.vertices.size() * sizeof(Vertex) +
+                mesh.indices.size() * sizeof(uint32_t);
+  }
+
+  m_Meshes = std::move(gpuMeshes);
+  m_Lods = std::move(lods);
+  m_VertexEnd = vertexEnd;
+  m_IndexEnd = indexEnd;
+  printf("Updated scene geometry: kept %zu of %zu meshes, uploaded %.1f MB\n",
+         kept, meshes.size(), uploaded / (1024.0 * 1024.0));
+  return true;
+}
+
+bool MeshRenderer::GrowBuffer(WGPUBuffer &buffer, uint64_t &size,
+                              uint64_t needed, uint64_t used, const char *label,
+                              WGPUBufferUsage usage) {
+  if (needed <= size) {
+    return true;
+  }
+  // Headroom so the next few edits are written in place
+  const uint64_t grown = std::max(needed, size + size / 2);
+  WGPUBuffer larger = CreateBuffer(m_Device, label, grown, usage);
+  if (!larger) {
+    return false;
+  }
+  WGPUCommandEncoderDescriptor encDesc = {};
+  encDesc.label = {"Grow scene geometry", WGPU_STRLEN};
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_Device, &encDesc);
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, buffer, 0, larger, 0, used);
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuQueueSubmit(m_Queue, 1, &commands);
+  wgpuCommandBufferRelease(commands);
+  wgpuCommandEncoderRelease(encoder);
+
+  // Frames still in flight keep the old one alive
+  wgpuBufferRelease(buffer);
+  buffer = larger;
+  size = grown;
+  return true;
+}
+
+void MeshRenderer::CreateIndirectBindGroups() {
+  // One 256-byte slot per bucket holding its first index into visibleIds
+  const uint32_t buckets = std::max(m_Culler.GetBucketCount(), 1u);
+  m_DrawInfoBuffer =
+      CreateBuffer(m_Device, "Mesh draw info", buckets * kDrawInfoStride,
+                   WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst);
+  std::vector<uint8_t> drawInfo(buckets * kDrawInfoStride, 0);
+  for (uint32_t i = 0; i < m_Culler.GetBucketCount(); ++i) {
+    uint32_t base = m_Culler.GetBucketInstanceBase(i);
+    std::copy_n(reinterpret_cast<const uint8_t *>(&base), sizeof(base),
+                &drawInfo[i * kDrawInfoStride]);
+  }
+  wgpuQueueWriteBuffer(m_Queue, m_DrawInfoBuffer, 0, drawInfo.data(),
+                       drawInfo.size());
+
+  WGPUBindGroupEntry objectEntries[3] = {};
+  objectEntries[0].binding = 0;
+  objectEntries[0].buffer = m_UniformBuffer;
+  objectEntries[0].size = sizeof(CameraUniforms);
+  objectEntries[1].binding = 1;
+  objectEntries[1].buffer = m_Culler.GetObjectDataBuffer();
+  objectEntries[1].size = m_Culler.GetObjectDataSize();
+  objectEntries[2].binding = 2;
+  objectEntries[2].buffer = m_Culler.GetVisibleIdBuffer();
+  objectEntries[2].size = m_Culler.GetVisibleIdSize();
+
+  WGPUBindGroupDescriptor desc = {};
+  desc.label = {"Mesh indirect objects bind group", WGPU_STRLEN};
+  desc.layout = m_IndirectLayouts[0];
+  desc.entryCount = 3;
+  desc.entries = objectEntries;
+  m_IndirectBindGroup = wgpuDeviceCreateBindGroup(m_Device, &desc);
+
+  WGPUBindGroupEntry drawEntry = {};
+  drawEntry.binding = 0;
+  drawEntry.buffer = m_DrawInfoBuffer;
+  drawEntry.size = 16; // one DrawInfo, padded to uniform alignment
+
+  desc.label = {"Mesh indirect draw bind group", WGPU_STRLEN};
+  desc.layout = m_IndirectLayouts[1];
+  desc.entryCount = 1;
+  desc.entries = &drawEntry;
+  m_DrawInfoBindGroup = wgpuDeviceCreateBindGroup(m_Device, &desc);
+}
+
+void MeshRenderer::SetDepthTexture(WGPUTexture depth, uint32_t width,
+                                   uint32_t height) {
+  m_Culler.SetDepthTexture(depth, width, height);
+  m_ViewportHeight = static_cast<float>(height);
+}
+
+void MeshRenderer::SetLodSettings(bool enabled, float pixelError) {
+  m_LodEnabled = enabled;
+  m_LodPixelError = pixelError;
+}
+
+LodSelection MeshRenderer::GetLodSelection(const Mat4 &viewProj) const {
+  // |row 1| is the projection's y scale, as in GatherTextureFeedback
+  LodSelection selection;
+  selection.enabled = m_LodEnabled && m_ViewportHeight > 0.0f;
+  selection.pixelsPerUnit =
+      Length(Vec3{viewProj(1, 0), viewProj(1, 1), viewProj(1, 2)}) *
+      m_ViewportHeight * 0.5f;
+  selection.threshold = m_LodPixelError;
+  return selection;
+}
+
+void MeshRenderer::SelectLods(const Scene &scene, Vec3 cameraPos,
+                              const LodSelection &selection,
+                              const std::vector<uint32_t> &visible,
+                              ThreadPool *pool) {
+  const auto &objects = scene.GetObjects();
+  const auto &bounds = scene.GetWorldBounds();
+  const TransformHierarchy &transforms = scene.GetTransforms();
+
+  // Same rule as the cull shader's selectLod
+  auto select = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const uint32_t id = visible[i];
+      const GpuMesh &mesh = m_Meshes[objects[id].mesh];
+      if (!selection.enabled || mesh.lodCount <= 1) {
+        m_ObjectLods[id] = 0;
+        continue;
+      }
+      const Aabb &box = bounds[id];
+      const Vec3 outside = Max(Max(box.min - cameraPos, cameraPos - box.max),
+                               Vec3{0.0f, 0.0f, 0.0f});
+      const float pixelsPerUnit =
+          selection.pixelsPerUnit *
+          MaxAxisScale(transforms.GetWorldMatrix(objects[id].transform)) /
+          std::max(Length(outside), 1e-4f);
+      const uint32_t current = m_ObjectLods[id];
+      uint32_t lod = 0;
+      for (uint32_t l = 1; l < mesh.lodCount; ++l) {
+        float threshold = selection.threshold;
+        if (l > current) {
+          threshold *= 1.0f - selection.hysteresis;
+        }
+        if (m_Lods[mesh.firstLod + l].error * pixelsPerUnit > threshold) {
+          break;
+        }
+        lod = l;
+      }
+      m_ObjectLods[id] = static_cast<uint8_t>(std::min(lod, 255u));
+    }
+  };
+  if (pool) {
+    pool->parallel_for(0, visible.size(), 8192, select);
+  } else {
+    select(0, visible.size());
+  }
+}
+
+void MeshRenderer::GatherTextureFeedback(const Scene &scene,
+                                         const Mat4 &viewProj,
+                                         const std::vector<uint32_t> &visible) {
+  if (m_ViewportHeight <= 0.0f) {
+    return;
+  }
+  // Row 1 of the view-projection is the camera's up axis scaled by the
+  // projection's y scale, and row 3 gives clip-space w (view depth)
+  const float scaleY =
+      Length(Vec3{viewProj(1, 0), viewProj(1, 1), viewProj(1, 2)});
+  const float pixelsPerUnit = scaleY * m_ViewportHeight * 0.5f;
+  const Vec4 depthRow(viewProj(3, 0), viewProj(3, 1), viewProj(3, 2),
+                      viewProj(3, 3));
+
+  const auto &objects = scene.GetObjects();
+  const auto &materials = scene.GetMaterials();
+  const auto &bounds = scene.GetWorldBounds();
+  for (uint32_t id : visible) {
+    const uint32_t material = objects[id].material;
+    if (material >= materials.size() ||
+        materials[material].baseColorTexture == kNoTexture) {
+      continue;
+    }
+    // Assume the texture spans the object once
+    const Aabb &box = bounds[id];
+    const float depth = Dot(depthRow, Vec4(box.Center(), 1.0f));
+    const float diameter = Length(box.max - box.min);
+    const float pixels =
+        depth > 1e-3f ? diameter * pixelsPerUnit / depth : 1e9f;
+    m_Textures.RequestSize(materials[material].baseColorTexture, pixels);
+  }
+}
+
+void MeshRenderer::UpdateMaterialBindGroups(const Scene &scene) {
+  const auto &materials = scene.GetMaterials();
+  m_MaterialBindings.resize(materials.size() + 1);
+  for (size_t i = 0; i < m_MaterialBindings.size(); ++i) {
+    MaterialBinding &binding = m_MaterialBindings[i];
+    const uint32_t texture =
+        i < materials.size() ? materials[i].baseColorTexture : kNoTexture;
+    const uint32_t version = m_Textures.GetVersion(texture);
+    if (binding.bindGroup && binding.texture == texture &&
+        binding.version == version) {
+      continue;
+    }
+
+    if (binding.bindGroup) {
+      wgpuBindGroupRelease(binding.bindGroup);
+    }
+    WGPUBindGroupEntry entries[2] = {};
+    entries[0].binding = 0;
+    entries[0].textureView = m_Textures.GetView(texture);
+    entries[1].binding = 1;
+    entries[1].sampler = m_Textures.GetSampler();
+
+    WGPUBindGroupDescriptor desc = {};
+    desc.label = {"Mesh material bind group", WGPU_STRLEN};
+    desc.layout = m_MaterialLayout;
+    desc.entryCount = 2;
+    desc.entries = entries;
+    binding.bindGroup = wgpuDeviceCreateBindGroup(m_Device, &desc);
+    binding.texture = texture;
+    binding.version = version;
+  }
+}
+
+WGPUBindGroup MeshRenderer::GetMaterialBindGroup(uint32_t material) const {
+  // Out-of-range materials get the untextured fallback at the end
+  return m_MaterialBindings[std::min<size_t>(material,
+                                             m_MaterialBindings.size() - 1)]
+      .bindGroup;
+}
+
+void MeshRenderer::WriteCameraUniforms(const Mat4 &viewProj, Vec3 cameraPos) {
+  CameraUniforms uniforms;
+  uniforms.viewProj = viewProj;
+  uniforms.cameraPos = Vec4(cameraPos, 1.0f);
+  Vec3 light = Normalize(Vec3{-0.4f, -1.0f, -0.3f});
+  uniforms.lightDir = Vec4(light, 0.0f);
+  wgpuQueueWriteBuffer(m_Queue, m_UniformBuffer, 0, &uniforms, sizeof(uniforms));
+}
+
+void MeshRenderer::UploadInstances(const Scene &scene,
+                                   const std::vector<uint32_t> &objects,
+                                   ThreadPool *pool) {
+  EnsureInstanceCapacity(objects.size());
+  const auto &sceneObjects = scene.GetObjects();
+  const auto &materials = scene.GetMaterials();
+  const TransformHierarchy &transforms = scene.GetTransforms();
+  m_InstanceStaging.resize(objects.size());
+
+  auto fill = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const SceneObject &object = sceneObjects[objects[i]];
+      m_InstanceStaging[i].model = transforms.GetWorldMatrix(object.transform);
+      m_InstanceStaging[i].color = object.material < materials.size()
+                                       ? materials[object.material].baseColor
+                                       : Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+  };
+  if (pool) {
+    pool->parallel_for(0, objects.size(), 8192, fill);
+  } else {
+    fill(0, objects.size());
+  }
+
+  // All instance data for the frame goes up in one write
+  wgpuQueueWriteBuffer(m_Queue, m_InstanceBuffer, 0, m_InstanceStaging.data(),
+                       m_InstanceStaging.size() * sizeof(InstanceData));
+}
+
+void MeshRenderer::Draw(WGPURenderPassEncoder pass, const Scene &scene,
+                        const Mat4 &viewProj, Vec3 cameraPos,
+                        const std::vector<uint32_t> &visible, bool batching,
+                        ThreadPool *pool) {
+  m_Stats = {};
+  m_DrawQueue.Clear();
+  // Moved objects aren't uploaded on this path, and the next GPU cull has no
+  // matching camera history
+  m_GpuObjectsCurrent = false;
+  m_Culler.ResetHistory();
+
+  // Residency changes land before any material is bound this frame
+  GatherTextureFeedback(scene, viewProj, visible);
+  m_Textures.Update(true);
+  UpdateMaterialBindGroups(scene);
+  if (!m_Pipeline || m_Meshes.empty() || visible.empty()) {
+    return;
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+
+  WriteCameraUniforms(viewProj, cameraPos);
+  SelectLods(scene, cameraPos, GetLodSelection(viewProj), visible, pool);
+
+  const auto &objects = scene.GetObjects();
+  wgpuRenderPassEncoderSetPipeline(pass, m_Pipeline);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, m_BindGroup, 0, nullptr);
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, m_VertexBuffer, 0,
+                                       m_VertexBufferSize);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, m_IndexBuffer,
+                                      WGPUIndexFormat_Uint32, 0,
+                                      m_IndexBufferSize);
+
+  if (!batching || !m_KeysFit) {
+    // Instance i of the frame is visible[i], one draw per object
+    UploadInstances(scene, visible, pool);
+    uint32_t boundMaterial = UINT32_MAX;
+    for (size_t i = 0; i < visible.size(); ++i) {
+      const SceneObject &object = objects[visible[i]];
+      const GpuMesh &mesh = m_Meshes[object.mesh];
+      const GpuLod &lod = m_Lods[mesh.firstLod + m_ObjectLods[visible[i]]];
+      if (lod.indexCount == 0) {
+        continue;
+      }
+      if (object.material != boundMaterial) {
+        wgpuRenderPassEncoderSetBindGroup(
+            pass, 1, GetMaterialBindGroup(object.material), 0, nullptr);
+        boundMaterial = object.material;
+      }
+      wgpuRenderPassEncoderDrawIndexed(pass, lod.indexCount, 1,
+                                       lod.firstIndex, mesh.baseVertex,
+                                       static_cast<uint32_t>(i));
+      m_Stats.drawCalls++;
+      m_Stats.triangles += lod.indexCount / 3;
+      m_Stats.fullDetailTriangles += m_Lods[mesh.firstLod].indexCount / 3;
+    }
+  } else {
+    // Sort by state then depth; clip-space w is the view depth
+    const Vec4 depthRow(viewProj(3, 0), viewProj(3, 1), viewProj(3, 2),
+                        viewProj(3, 3));
+    const auto &bounds = scene.GetWorldBounds();
+    m_DrawQueue.Reserve(visible.size());
+    for (uint32_t id : visible) {
+      const SceneObject &object = objects[id];
+      float depth = Dot(depthRow, Vec4(bounds[id].Center(), 1.0f));
+      // LODs of one mesh batch separately
+      const uint32_t lod = m_Meshes[object.mesh].firstLod + m_ObjectLods[id];
+      m_DrawQueue.Submit(0, object.material, lod, depth, id);
+    }
+    m_DrawQueue.Build(pool);
+
+    const auto &items = m_DrawQueue.GetItems();
+    m_SortedObjects.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+      m_SortedObjects[i] = items[i].object;
+    }
+    UploadInstances(scene, m_SortedObjects, pool);
+
+    // Every object of a batch shares its LOD and material; instances are
+    // contiguous
+    uint32_t boundMaterial = UINT32_MAX;
+    for (const DrawQueue::Batch &batch : m_DrawQueue.GetBatches()) {
+      const SceneObject &first = objects[items[batch.firstInstance].object];
+      const GpuMesh &mesh = m_Meshes[first.mesh];
+      const GpuLod &lod = m_Lods[batch.mesh];
+      if (lod.indexCount == 0) {
+        continue;
+      }
+      if (first.material != boundMaterial) {
+        wgpuRenderPassEncoderSetBindGroup(
+            pass, 1, GetMaterialBindGroup(first.material), 0, nullptr);
+        boundMaterial = first.material;
+      }
+      wgpuRenderPassEncoderDrawIndexed(pass, lod.indexCount,
+                                       batch.instanceCount, lod.firstIndex,
+                                       mesh.baseVertex, batch.firstInstance);
+      m_Stats.drawCalls++;
+      m_Stats.triangles += uint64_t(lod.indexCount / 3) * batch.instanceCount;
+      m_Stats.fullDetailTriangles +=
+          uint64_t(m_Lods[mesh.firstLod].indexCount / 3) * batch.instanceCount;
+    }
+  }
+
+  m_Stats.cpuMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::high_resolution_clock::now() - start)
+                      .count();
+}
+
+void MeshRenderer::DrawGpuDriven(WGPURenderPassEncoder pass, const Scene &scene,
+                                 const Mat4 &viewProj, Vec3 cameraPos,
+                                 bool frustumCulling, bool occlusionCulling,
+                                 GpuTimer *timer, uint32_t firstScope) {
+  m_Stats = {};
+
+  // No per-object visibility on the CPU here, so residency is held
+  m_Textures.Update(false);
+  UpdateMaterialBindGroups(scene);
+  if (!m_IndirectPipeline || m_Meshes.empty() || !m_IndirectBindGroup) {
+    return;
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+
+  WriteCameraUniforms(viewProj, cameraPos);
+  m_Culler.UpdateObjects(scene, !m_GpuObjectsCurrent);
+  m_GpuObjectsCurrent = true;
+  m_Culler.Cull(viewProj, cameraPos, GetLodSelection(viewProj), frustumCulling,
+                occlusionCulling, timer, firstScope);
+
+  wgpuRenderPassEncoderSetPipeline(pass, m_IndirectPipeline);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, m_IndirectBindGroup, 0, nullptr);
+  wgpuRenderPassEncoderSetVertexBuffer(pass, 0, m_VertexBuffer, 0,
+                                       m_VertexBufferSize);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, m_IndexBuffer,
+                                      WGPUIndexFormat_Uint32, 0,
+                                      m_IndexBufferSize);
+
+  // One indirect draw per bucket; instance counts come from the cull.
+  // Buckets are ordered by material.
+  WGPUBuffer args = m_Culler.GetDrawArgsBuffer();
+  uint32_t boundMaterial = UINT32_MAX;
+  for (uint32_t i = 0; i < m_Culler.GetBucketCount(); ++i) {
+    const GpuMesh &mesh = m_Meshes[m_Culler.GetBucketMesh(i)];
+    if (m_Lods[mesh.firstLod + m_Culler.GetBucketLod(i)].indexCount == 0) {
+      continue;
+    }
+    const uint32_t material = m_Culler.GetBucketMaterial(i);
+    if (material != boundMaterial) {
+      wgpuRenderPassEncoderSetBindGroup(pass, 1, GetMaterialBindGroup(material),
+                                        0, nullptr);
+      boundMaterial = material;
+    }
+    uint32_t offset = static_cast<uint32_t>(i * kDrawInfoStride);
+    wgpuRenderPassEncoderSetBindGroup(pass, 2, m_DrawInfoBindGroup, 1, &offset);
+    wgpuRenderPassEncoderDrawIndexedIndirect(pass, args,
+                                             i * sizeof(IndirectDrawArgs));
+    m_Stats.drawCalls++;
+  }
+  m_Stats.triangles = m_Culler.GetStats().triangles;
+
+  m_Stats.cpuMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::high_resolution_clock::now() - start)
+                      .count();
+}
@@ -0,0 +1,873 @@
+#include "PostProcessor.h"
+#include "GpuTimer.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iterator>
+#include <stdio.h>
+
+namespace {
+
+constexpr uint32_t kFlagBloom = 1;
+constexpr uint32_t kFlagTonemap = 2;
+
+const char *kUniformsWgsl = R"(
+struct PostUniforms {
+  exposure : f32,
+  bloomThreshold : f32,
+  bloomKnee : f32,
+  bloomIntensity : f32,
+  flags : u32,
+};
+)";
+
+// 8x8 outputs cover 16x16 source texels; the 4x4 filter footprint adds one
+// texel on each side
+const char *kDownsampleShader = R"(
+@group(0) @binding(0) var<uniform> post : PostUniforms;
+@group(0) @binding(1) var src : texture_2d<f32>;
+@group(0) @binding(2) var dst : texture_storage_2d<rgba16float, write>;
+
+const kTile = 18u;
+const kLoads = (kTile * kTile + 63u) / 64u;
+var<workgroup> tile : array<vec3<f32>, 324>;
+
+// Soft knee: nothing below threshold - knee passes, everything above the
+// threshold does, with a quadratic ramp in between
+fn prefilter(c : vec3<f32>) -> vec3<f32> {
+  let brightness = max(c.r, max(c.g, c.b));
+  let knee = post.bloomKnee;
+  let soft = clamp(brightness - post.bloomThreshold + knee, 0.0, 2.0 * knee);
+  let ramp = soft * soft / (4.0 * knee + 1e-4);
+  return c * max(ramp, brightness - post.bloomThreshold) / max(brightness, 1e-4);
+}
+
+fn downsample(group : vec2<u32>, local : vec2<u32>, localIndex : u32,
+              threshold : bool) {
+  let srcSize = vec2<i32>(textureDimensions(src));
+  let origin = vec2<i32>(group * 16u) - 1;
+  // A uniform trip count keeps the barrier below in uniform control flow
+  for (var n = 0u; n < kLoads; n++) {
+    let i = localIndex + n * 64u;
+    if (i < kTile * kTile) {
+      let p = origin + vec2<i32>(i32(i % kTile), i32(i / kTile));
+      var c = textureLoad(src, clamp(p, vec2<i32>(0), srcSize - 1), 0).rgb;
+      if (threshold) {
+        c = prefilter(c);
+      }
+      tile[i] = c;
+    }
+  }
+  workgroupBarrier();
+
+  let id = group * 8u + local;
+  if (any(id >= textureDimensions(dst))) {
+    return;
+  }
+  // Texels 2*id - 1 .. 2*id + 2, weighted 1 3 3 1 on each axis
+  var weights = array<f32, 4>(1.0, 3.0, 3.0, 1.0);
+  var sum = vec3<f32>(0.0);
+  let base = local * 2u;
+  for (var y = 0u; y < 4u; y++) {
+    for (var x = 0u; x < 4u; x++) {
+      sum += tile[(base.y + y) * kTile + base.x + x] * (weights[x] * weights[y]);
+    }
+  }
+  textureStore(dst, id, vec4<f32>(sum / 64.0, 1.0));
+}
+
+@compute @workgroup_size(8, 8)
+fn prefilter_main(@builtin(workgroup_id) group : vec3<u32>,
+                  @builtin(local_invocation_id) local : vec3<u32>,
+                  @builtin(local_invocation_index) localIndex : u32) {
+  downsample(group.xy, local.xy, localIndex, true);
+}
+
+@compute @workgroup_size(8, 8)
+fn down_main(@builtin(workgroup_id) group : vec3<u32>,
+             @builtin(local_invocation_id) local : vec3<u32>,
+             @builtin(local_invocation_index) localIndex : u32) {
+  downsample(group.xy, local.xy, localIndex, false);
+}
+)";
+
+// 8x8 outputs at level i read 4x4 texels of level i + 1; the tent's taps and
+// their bilinear footprints need two more on one side and three on the other
+const char *kUpsampleShader = R"(
+@group(0) @binding(0) var low : texture_2d<f32>;
+@group(0) @binding(1) var high : texture_2d<f32>;
+@group(0) @binding(2) var dst : texture_storage_2d<rgba16float, write>;
+
+const kTile = 10u;
+const kLoads = (kTile * kTile + 63u) / 64u;
+var<workgroup> tile : array<vec3<f32>, 100>;
+
+// Bilinear fetch from the tile; `pos` is in texels of the coarser level
+fn fetch(pos : vec2<f32>, origin : vec2<i32>) -> vec3<f32> {
+  let f = floor(pos);
+  let t = pos - f;
+  let i = vec2<u32>(vec2<i32>(f) - origin);
+  let row0 = i.y * kTile + i.x;
+  let row1 = row0 + kTile;
+  return mix(mix(tile[row0], tile[row0 + 1u], t.x),
+             mix(tile[row1], tile[row1 + 1u], t.x), t.y);
+}
+
+@compute @workgroup_size(8, 8)
+fn main(@builtin(workgroup_id) group : vec3<u32>,
+        @builtin(local_invocation_id) local : vec3<u32>,
+        @builtin(local_invocation_index) localIndex : u32) {
+  let lowSize = vec2<i32>(textureDimensions(low));
+  let origin = vec2<i32>(group.xy * 4u) - 2;
+  for (var n = 0u; n < kLoads; n++) {
+    let i = localIndex + n * 64u;
+    if (i < kTile * kTile) {
+      let p = origin + vec2<i32>(i32(i % kTile), i32(i / kTile));
+      tile[i] = textureLoad(low, clamp(p, vec2<i32>(0), lowSize - 1), 0).rgb;
+    }
+  }
+  workgroupBarrier();
+
+  let id = group.xy * 8u + local.xy;
+  if (any(id >= textureDimensions(dst))) {
+    return;
+  }
+  // 3x3 tent, one coarse texel apart
+  let c = (vec2<f32>(id) + 0.5) * 0.5 - 0.5;
+  var sum = fetch(c, origin) * 4.0;
+  sum += (fetch(c + vec2<f32>(-1.0, 0.0), origin) +
+          fetch(c + vec2<f32>(1.0, 0.0), origin) +
+          fetch(c + vec2<f32>(0.0, -1.0), origin) +
+          fetch(c + vec2<f32>(0.0, 1.0), origin)) * 2.0;
+  sum += fetch(c + vec2<f32>(-1.0, -1.0), origin) +
+         fetch(c + vec2<f32>(1.0, -1.0), origin) +
+         fetch(c + vec2<f32>(-1.0, 1.0), origin) +
+         fetch(c + vec2<f32>(1.0, 1.0), origin);
+  let detail = textureLoad(high, vec2<i32>(id), 0).rgb;
+  textureStore(dst, id, vec4<f32>(detail + sum / 16.0, 1.0));
+}
+)";
+
+const char *kTonemapShader = R"(
+@group(0) @binding(0) var<uniform> post : PostUniforms;
+@group(0) @binding(1) var hdr : texture_2d<f32>;
+@group(0) @binding(2) var bloom : texture_2d<f32>;
+@group(0) @binding(3) var linearSampler : sampler;
+@group(0) @binding(4) var dst : texture_storage_2d<rgba8unorm, write>;
+
+const kFlagBloom = 1u;
+const kFlagTonemap = 2u;
+
+// Narkowicz's fit of the ACES filmic curve
+fn aces(x : vec3<f32>) -> vec3<f32> {
+  return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14),
+               vec3<f32>(0.0), vec3<f32>(1.0));
+}
+
+// The LDR target is plain RGBA8, so it is stored sRGB-encoded: 8 bits would
+// band in the shadows otherwise, and FXAA wants perceptual luma
+fn linearToSrgb(c : vec3<f32>) -> vec3<f32> {
+  return select(1.055 * pow(c, vec3<f32>(1.0 / 2.4)) - 0.055, c * 12.92,
+                c <= vec3<f32>(0.0031308));
+}
+
+@compute @workgroup_size(8, 8)
+fn main(@builtin(global_invocation_id) id : vec3<u32>) {
+  let size = textureDimensions(dst);
+  if (any(id.xy >= size)) {
+    return;
+  }
+  var c = textureLoad(hdr, id.xy, 0).rgb;
+  if ((post.flags & kFlagBloom) != 0u) {
+    let uv = (vec2<f32>(id.xy) + 0.5) / vec2<f32>(size);
+    c += textureSampleLevel(bloom, linearSampler, uv, 0.0).rgb * post.bloomIntensity;
+  }
+  c *= post.exposure;
+  if ((post.flags & kFlagTonemap) != 0u) {
+    c = aces(c);
+  } else {
+    c = clamp(c, vec3<f32>(0.0), vec3<f32>(1.0));
+  }
+  c = linearToSrgb(c);
+  textureStore(dst, id.xy, vec4<f32>(c, dot(c, vec3<f32>(0.299, 0.587, 0.114))));
+}
+)";
+
+// FXAA with the 3x3 neighbourhood (colour and luma) staged in workgroup
+// memory. Pixels below the contrast threshold, most of the image, are written
+// straight from the tile.
+const char *kFxaaShader = R"(
+@group(0) @binding(0) var src : texture_2d<f32>;
+@group(0) @binding(1) var linearSampler : sampler;
+@group(0) @binding(2) var dst : texture_storage_2d<rgba8unorm, write>;
+
+const kTile = 10u;
+const kLoads = (kTile * kTile + 63u) / 64u;
+const kEdgeThreshold = 0.125;
+const kEdgeThresholdMin = 0.0312;
+const kReduceMul = 0.125;
+const kReduceMin = 0.0078125;
+const kSpanMax = 8.0;
+var<workgroup> tile : array<vec4<f32>, 100>;
+
+fn luma(c : vec3<f32>) -> f32 {
+  return dot(c, vec3<f32>(0.299, 0.587, 0.114));
+}
+
+fn sampleAt(uv : vec2<f32>) -> vec3<f32> {
+  return textureSampleLevel(src, linearSampler, uv, 0.0).rgb;
+}
+
+@compute @workgroup_size(8, 8)
+fn main(@builtin(workgroup_id) group : vec3<u32>,
+        @builtin(local_invocation_id) local : vec3<u32>,
+        @builtin(local_invocation_index) localIndex : u32) {
+  let size = vec2<i32>(textureDimensions(src));
+  let origin = vec2<i32>(group.xy * 8u) - 1;
+  for (var n = 0u; n < kLoads; n++) {
+    let i = localIndex + n * 64u;
+    if (i < kTile * kTile) {
+      let p = origin + vec2<i32>(i32(i % kTile), i32(i / kTile));
+      tile[i] = textureLoad(src, clamp(p, vec2<i32>(0), size - 1), 0);
+    }
+  }
+  workgroupBarrier();
+
+  let id = group.xy * 8u + local.xy;
+  if (any(vec2<i32>(id) >= size)) {
+    return;
+  }
+  let t = local.xy + 1u;
+  let m = tile[t.y * kTile + t.x];
+  let nw = tile[(t.y - 1u) * kTile + t.x - 1u].a;
+  let ne = tile[(t.y - 1u) * kTile + t.x + 1u].a;
+  let sw = tile[(t.y + 1u) * kTile + t.x - 1u].a;
+  let se = tile[(t.y + 1u) * kTile + t.x + 1u].a;
+  let lumaMin = min(m.a, min(min(nw, ne), min(sw, se)));
+  let lumaMax = max(m.a, max(max(nw, ne), max(sw, se)));
+  if (lumaMax - lumaMin < max(kEdgeThresholdMin, lumaMax * kEdgeThreshold)) {
+    textureStore(dst, id, vec4<f32>(m.rgb, 1.0));
+    return;
+  }
+
+  // Blur along the edge, falling back to the shorter blur if the longer one
+  // crosses into a different feature
+  var dir = vec2<f32>(-((nw + ne) - (sw + se)), (nw + sw) - (ne + se));
+  let reduce = max((nw + ne + sw + se) * 0.25 * kReduceMul, kReduceMin);
+  let scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);
+  let texel = 1.0 / vec2<f32>(size);
+  dir = clamp(dir * scale, vec2<f32>(-kSpanMax), vec2<f32>(kSpanMax)) * texel;
+  let uv = (vec2<f32>(id) + 0.5) * texel;
+  let a = 0.5 * (sampleAt(uv + dir * (1.0 / 3.0 - 0.5)) +
+                 sampleAt(uv + dir * (2.0 / 3.0 - 0.5)));
+  let b = a * 0.5 + 0.25 * (sampleAt(uv - dir * 0.5) + sampleAt(uv + dir * 0.5));
+  let lumaB = luma(b);
+  let c = select(b, a, lumaB < lumaMin || lumaB > lumaMax);
+  textureStore(dst, id, vec4<f32>(c, 1.0));
+}
+)";
+
+// Fullscreen triangle upscaling the processed image to the surface with a
+// Catmull-Rom filter, folded into nine bilinear taps. At 1:1 the weights
+// collapse onto the centre texel. The image is sRGB-encoded; kSrgbTarget,
+// prepended at pipeline creation, decodes it for surfaces that encode on
+// store.
+const char *kCompositeShader = R"(
+@group(0) @binding(0) var image : texture_2d<f32>;
+@group(0) @binding(1) var imageSampler : sampler;
+
+struct VsOut {
+  @builtin(position) position : vec4<f32>,
+  @location(0) uv : vec2<f32>,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index : u32) -> VsOut {
+  let uv = vec2<f32>(f32((index << 1u) & 2u), f32(index & 2u));
+  var out : VsOut;
+  out.position = vec4<f32>(uv * vec2<f32>(2.0, -2.0) + vec2<f32>(-1.0, 1.0),
+                           0.0, 1.0);
+  out.uv = uv;
+  return out;
+}
+
+fn tap(x : f32, y : f32, weight : f32) -> vec3<f32> {
+  return textureSampleLevel(image, imageSampler, vec2<f32>(x, y), 0.0).rgb *
+         weight;
+}
+
+@fragment
+fn fs_main(in : VsOut) -> @location(0) vec4<f32> {
+  let size = vec2<f32>(textureDimensions(image));
+  let pos = in.uv * size;
+  let center = floor(pos - 0.5) + 0.5;
+  let f = pos - center;
+  let w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+  let w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+  let w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+  let w3 = f * f * (-0.5 + 0.5 * f);
+  // The middle two taps share one bilinear fetch
+  let w12 = w1 + w2;
+  let t0 = (center - 1.0) / size;
+  let t12 = (center + w2 / w12) / size;
+  let t3 = (center + 2.0) / size;
+
+  var c = tap(t0.x, t0.y, w0.x * w0.y) + tap(t12.x, t0.y, w12.x * w0.y) +
+          tap(t3.x, t0.y, w3.x * w0.y);
+  c += tap(t0.x, t12.y, w0.x * w12.y) + tap(t12.x, t12.y, w12.x * w12.y) +
+       tap(t3.x, t12.y, w3.x * w12.y);
+  c += tap(t0.x, t3.y, w0.x * w3.y) + tap(t12.x, t3.y, w12.x * w3.y) +
+       tap(t3.x, t3.y, w3.x * w3.y);
+  // The negative lobes can overshoot
+  c = clamp(c, vec3<f32>(0.0), vec3<f32>(1.0));
+  if (kSrgbTarget) {
+    c = select(pow((c + 0.055) / 1.055, vec3<f32>(2.4)), c / 12.92,
+               c <= vec3<f32>(0.04045));
+  }
+  return vec4<f32>(c, 1.0);
+}
+)";
+
+WGPUShaderModule CreateShaderModule(WGPUDevice device, const char *label,
+                                    const std::string &source) {
+  WGPUShaderSourceWGSL wgsl = {};
+  wgsl.chain.sType = WGPUSType_ShaderSourceWGSL;
+  wgsl.code = {source.c_str(), WGPU_STRLEN};
+  WGPUShaderModuleDescriptor desc = {};
+  desc.nextInChain = &wgsl.chain;
+  desc.label = {label, WGPU_STRLEN};
+  return wgpuDeviceCreateShaderModule(device, &desc);
+}
+
+WGPUComputePipeline CreateComputePipeline(WGPUDevice device, const char *label,
+                                          WGPUShaderModule module,
+                                          const char *entryPoint,
+                                          WGPUBindGroupLayout layout) {
+  WGPUPipelineLayoutDescriptor layoutDesc = {};
+  layoutDesc.bindGroupLayoutCount = 1;
+  layoutDesc.bindGroupLayouts = &layout;
+  WGPUPipelineLayout pipelineLayout =
+      wgpuDeviceCreatePipelineLayout(device, &layoutDesc);
+
+  WGPUComputePipelineDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.layout = pipelineLayout;
+  desc.compute.module = module;
+  desc.compute.entryPoint = {entryPoint, WGPU_STRLEN};
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(device, &desc);
+  wgpuPipelineLayoutRelease(pipelineLayout);
+  return pipeline;
+}
+
+WGPUBindGroupLayoutEntry UniformEntry(uint32_t binding) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = WGPUShaderStage_Compute;
+  entry.buffer.type = WGPUBufferBindingType_Uniform;
+  return entry;
+}
+
+WGPUBindGroupLayoutEntry TextureEntry(uint32_t binding,
+                                      WGPUShaderStage visibility) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = visibility;
+  entry.texture.sampleType = WGPUTextureSampleType_Float;
+  entry.texture.viewDimension = WGPUTextureViewDimension_2D;
+  return entry;
+}
+
+WGPUBindGroupLayoutEntry SamplerEntry(uint32_t binding,
+                                      WGPUShaderStage visibility) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = visibility;
+  entry.sampler.type = WGPUSamplerBindingType_Filtering;
+  return entry;
+}
+
+WGPUBindGroupLayoutEntry StorageTextureEntry(uint32_t binding,
+                                             WGPUTextureFormat format) {
+  WGPUBindGroupLayoutEntry entry = {};
+  entry.binding = binding;
+  entry.visibility = WGPUShaderStage_Compute;
+  entry.storageTexture.access = WGPUStorageTextureAccess_WriteOnly;
+  entry.storageTexture.format = format;
+  entry.storageTexture.viewDimension = WGPUTextureViewDimension_2D;
+  return entry;
+}
+
+WGPUBindGroupLayout CreateLayout(WGPUDevice device, const char *label,
+                                 const WGPUBindGroupLayoutEntry *entries,
+                                 size_t count) {
+  WGPUBindGroupLayoutDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.entryCount = count;
+  desc.entries = entries;
+  return wgpuDeviceCreateBindGroupLayout(device, &desc);
+}
+
+// Entries are given as (binding, view) or (binding, sampler) or
+// (binding, buffer) through the matching fields
+WGPUBindGroup CreateBindGroup(WGPUDevice device, const char *label,
+                              WGPUBindGroupLayout layout,
+                              const WGPUBindGroupEntry *entries, size_t count) {
+  WGPUBindGroupDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.layout = layout;
+  desc.entryCount = count;
+  desc.entries = entries;
+  return wgpuDeviceCreateBindGroup(device, &desc);
+}
+
+WGPUBindGroupEntry ViewEntry(uint32_t binding, WGPUTextureView view) {
+  WGPUBindGroupEntry entry = {};
+  entry.binding = binding;
+  entry.textureView = view;
+  return entry;
+}
+
+WGPUBindGroupEntry SamplerBinding(uint32_t binding, WGPUSampler sampler) {
+  WGPUBindGroupEntry entry = {};
+  entry.binding = binding;
+  entry.sampler = sampler;
+  return entry;
+}
+
+WGPUTexture CreateTexture(WGPUDevice device, const char *label, uint32_t width,
+                          uint32_t height, uint32_t mipCount,
+                          WGPUTextureFormat format, WGPUTextureUsage usage) {
+  WGPUTextureDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.usage = usage;
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.size = {width, height, 1};
+  desc.format = format;
+  desc.mipLevelCount = mipCount;
+  desc.sampleCount = 1;
+  return wgpuDeviceCreateTexture(device, &desc);
+}
+
+WGPUTextureView CreateMipView(WGPUTexture texture, WGPUTextureFormat format,
+                              uint32_t level) {
+  WGPUTextureViewDescriptor desc = {};
+  desc.format = format;
+  desc.dimension = WGPUTextureViewDimension_2D;
+  desc.baseMipLevel = level;
+  desc.mipLevelCount = 1;
+  desc.arrayLayerCount = 1;
+  desc.aspect = WGPUTextureAspect_All;
+  return wgpuTextureCreateView(texture, &desc);
+}
+
+void Dispatch(WGPUComputePassEncoder pass, WGPUComputePipeline pipeline,
+              WGPUBindGroup bindGroup, uint32_t width, uint32_t height) {
+  wgpuComputePassEncoderSetPipeline(pass, pipeline);
+  wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+  wgpuComputePassEncoderDispatchWorkgroups(pass, (width + 7) / 8,
+                                           (height + 7) / 8, 1);
+}
+
+template <typename T> void Release(T &handle, void (*release)(T)) {
+  if (handle) {
+    release(handle);
+    handle = nullptr;
+  }
+}
+
+void DestroyTexture(WGPUTexture &texture) {
+  if (texture) {
+    wgpuTextureDestroy(texture);
+    wgpuTextureRelease(texture);
+    texture = nullptr;
+  }
+}
+
+} // namespace
+
+PostProcessor::PostProcessor() {}
+
+PostProcessor::~PostProcessor() { Shutdown(); }
+
+bool PostProcessor::Initialize(WGPUDevice device, WGPUQueue queue,
+                               WGPUTextureFormat outputFormat) {
+  m_Device = device;
+  m_Queue = queue;
+
+  if (!CreatePipelines(outputFormat)) {
+    fprintf(stderr, "Failed to create post-processing pipelines\n");
+    return false;
+  }
+
+  WGPUBufferDescriptor bufferDesc = {};
+  bufferDesc.label = {"Post uniforms", WGPU_STRLEN};
+  bufferDesc.size = sizeof(PostUniforms);
+  bufferDesc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+  m_UniformBuffer = wgpuDeviceCreateBuffer(m_Device, &bufferDesc);
+
+  WGPUSamplerDescriptor samplerDesc = {};
+  samplerDesc.label = {"Post linear sampler", WGPU_STRLEN};
+  samplerDesc.addressModeU = WGPUAddressMode_ClampToEdge;
+  samplerDesc.addressModeV = WGPUAddressMode_ClampToEdge;
+  samplerDesc.addressModeW = WGPUAddressMode_ClampToEdge;
+  samplerDesc.magFilter = WGPUFilterMode_Linear;
+  samplerDesc.minFilter = WGPUFilterMode_Linear;
+  samplerDesc.mipmapFilter = WGPUMipmapFilterMode_Nearest;
+  samplerDesc.lodMinClamp = 0.0f;
+  samplerDesc.lodMaxClamp = 32.0f;
+  samplerDesc.maxAnisotropy = 1;
+  m_LinearSampler = wgpuDeviceCreateSampler(m_Device, &samplerDesc);
+  return m_UniformBuffer && m_LinearSampler;
+}
+
+void PostProcessor::Shutdown() {
+  ReleaseTargets();
+  Release(m_UniformBuffer, wgpuBufferRelease);
+  Release(m_LinearSampler, wgpuSamplerRelease);
+  Release(m_PrefilterPipeline, wgpuComputePipelineRelease);
+  Release(m_DownsamplePipeline, wgpuComputePipelineRelease);
+  Release(m_UpsamplePipeline, wgpuComputePipelineRelease);
+  Release(m_TonemapPipeline, wgpuComputePipelineRelease);
+  Release(m_FxaaPipeline, wgpuComputePipelineRelease);
+  Release(m_CompositePipeline, wgpuRenderPipelineRelease);
+  Release(m_DownLayout, wgpuBindGroupLayoutRelease);
+  Release(m_UpLayout, wgpuBindGroupLayoutRelease);
+  Release(m_TonemapLayout, wgpuBindGroupLayoutRelease);
+  Release(m_FxaaLayout, wgpuBindGroupLayoutRelease);
+  Release(m_CompositeLayout, wgpuBindGroupLayoutRelease);
+}
+
+bool PostProcessor::CreatePipelines(WGPUTextureFormat outputFormat) {
+  // Explicit layouts: the storage formats and the sampled HDR texture are
+  // shared between pipelines
+  const WGPUBindGroupLayoutEntry downEntries[] = {
+      UniformEntry(0),
+      TextureEntry(1, WGPUShaderStage_Compute),
+      StorageTextureEntry(2, kHdrFormat),
+  };
+  const WGPUBindGroupLayoutEntry upEntries[] = {
+      TextureEntry(0, WGPUShaderStage_Compute),
+      TextureEntry(1, WGPUShaderStage_Compute),
+      StorageTextureEntry(2, kHdrFormat),
+  };
+  const WGPUBindGroupLayoutEntry tonemapEntries[] = {
+      UniformEntry(0),
+      TextureEntry(1, WGPUShaderStage_Compute),
+      TextureEntry(2, WGPUShaderStage_Compute),
+      SamplerEntry(3, WGPUShaderStage_Compute),
+      StorageTextureEntry(4, kOutputFormat),
+  };
+  const WGPUBindGroupLayoutEntry fxaaEntries[] = {
+      TextureEntry(0, WGPUShaderStage_Compute),
+      SamplerEntry(1, WGPUShaderStage_Compute),
+      StorageTextureEntry(2, kOutputFormat),
+  };
+  const WGPUBindGroupLayoutEntry compositeEntries[] = {
+      TextureEntry(0, WGPUShaderStage_Fragment),
+      SamplerEntry(1, WGPUShaderStage_Fragment),
+  };
+  m_DownLayout = CreateLayout(m_Device, "Bloom downsample layout", downEntries,
+                              std::size(downEntries));
+  m_UpLayout = CreateLayout(m_Device, "Bloom upsample layout", upEntries,
+                            std::size(upEntries));
+  m_TonemapLayout = CreateLayout(m_Device, "Tonemap layout", tonemapEntries,
+                                 std::size(tonemapEntries));
+  m_FxaaLayout = CreateLayout(m_Device, "FXAA layout", fxaaEntries,
+                              std::size(fxaaEntries));
+  m_CompositeLayout = CreateLayout(m_Device, "Composite layout",
+                                   compositeEntries, std::size(compositeEntries));
+
+  const std::string uniforms = kUniformsWgsl;
+  WGPUShaderModule down = CreateShaderModule(m_Device, "Bloom downsample shader",
+                                             uniforms + kDownsampleShader);
+  WGPUShaderModule up =
+      CreateShaderModule(m_Device, "Bloom upsample shader", kUpsampleShader);
+  WGPUShaderModule tonemap = CreateShaderModule(m_Device, "Tonemap shader",
+                                                uniforms + kTonemapShader);
+  WGPUShaderModule fxaa =
+      CreateShaderModule(m_Device, "FXAA shader", kFxaaShader);
+  const bool srgbTarget = outputFormat == WGPUTextureFormat_RGBA8UnormSrgb ||
+                          outputFormat == WGPUTextureFormat_BGRA8UnormSrgb;
+  WGPUShaderModule composite = CreateShaderModule(
+      m_Device, "Composite shader",
+      std::string("const kSrgbTarget = ") + (srgbTarget ? "true" : "false") +
+          ";\n" + kCompositeShader);
+  if (!down || !up || !tonemap || !fxaa || !composite) {
+    for (WGPUShaderModule module : {down, up, tonemap, fxaa, composite}) {
+      if (module) {
+        wgpuShaderModuleRelease(module);
+      }
+    }
+    return false;
+  }
+
+  m_PrefilterPipeline = CreateComputePipeline(
+      m_Device, "Bloom prefilter pipeline", down, "prefilter_main", m_DownLayout);
+  m_DownsamplePipeline = CreateComputePipeline(
+      m_Device, "Bloom downsample pipeline", down, "down_main", m_DownLayout);
+  m_UpsamplePipeline = CreateComputePipeline(
+      m_Device, "Bloom upsample pipeline", up, "main", m_UpLayout);
+  m_TonemapPipeline = CreateComputePipeline(m_Device, "Tonemap pipeline",
+                                            tonemap, "main", m_TonemapLayout);
+  m_FxaaPipeline = CreateComputePipeline(m_Device, "FXAA pipeline", fxaa,
+                                         "main", m_FxaaLayout);
+
+  WGPUPipelineLayoutDescriptor layoutDesc = {};
+  layoutDesc.bindGroupLayoutCount = 1;
+  layoutDesc.bindGroupLayouts = &m_CompositeLayout;
+  WGPUPipelineLayout compositeLayout =
+      wgpuDeviceCreatePipelineLayout(m_Device, &layoutDesc);
+
+  WGPUColorTargetState colorTarget = {};
+  colorTarget.format = outputFormat;
+  colorTarget.writeMask = WGPUColorWriteMask_All;
+
+  WGPUFragmentState fragment = {};
+  fragment.module = composite;
+  fragment.entryPoint = {"fs_main", WGPU_STRLEN};
+  fragment.targetCount = 1;
+  fragment.targets = &colorTarget;
+
+  WGPURenderPipelineDescriptor pipelineDesc = {};
+  pipelineDesc.label = {"Composite pipeline", WGPU_STRLEN};
+  pipelineDesc.layout = compositeLayout;
+  pipelineDesc.vertex.module = composite;
+  pipelineDesc.vertex.entryPoint = {"vs_main", WGPU_STRLEN};
+  pipelineDesc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+  pipelineDesc.primitive.frontFace = WGPUFrontFace_CCW;
+  pipelineDesc.primitive.cullMode = WGPUCullMode_None;
+  pipelineDesc.multisample.count = 1;
+  pipelineDesc.multisample.mask = 0xFFFFFFFF;
+  pipelineDesc.fragment = &fragment;
+  m_CompositePipeline = wgpuDeviceCreateRenderPipeline(m_Device, &pipelineDesc);
+  wgpuPipelineLayoutRelease(compositeLayout);
+
+  for (WGPUShaderModule module : {down, up, tonemap, fxaa, composite}) {
+    wgpuShaderModuleRelease(module);
+  }
+  return m_PrefilterPipeline && m_DownsamplePipeline && m_UpsamplePipeline &&
+         m_TonemapPipeline && m_FxaaPipeline && m_CompositePipeline;
+}
+
+void PostProcessor::ReleaseTargets() {
+  for (WGPUBindGroup group : m_DownBindGroups) {
+    wgpuBindGroupRelease(group);
+  }
+  m_DownBindGroups.clear();
+  for (WGPUBindGroup group : m_UpBindGroups) {
+    wgpuBindGroupRelease(group);
+  }
+  m_UpBindGroups.clear();
+  Release(m_TonemapBindGroup, wgpuBindGroupRelease);
+  Release(m_FxaaBindGroup, wgpuBindGroupRelease);
+  Release(m_CompositeLdrBindGroup, wgpuBindGroupRelease);
+  Release(m_CompositeOutputBindGroup, wgpuBindGroupRelease);
+
+  for (WGPUTextureView view : m_BloomDownViews) {
+    wgpuTextureViewRelease(view);
+  }
+  m_BloomDownViews.clear();
+  for (WGPUTextureView view : m_BloomUpViews) {
+    wgpuTextureViewRelease(view);
+  }
+  m_BloomUpViews.clear();
+  Release(m_HdrView, wgpuTextureViewRelease);
+  Release(m_LdrView, wgpuTextureViewRelease);
+  Release(m_OutputView, wgpuTextureViewRelease);
+  DestroyTexture(m_Hdr);
+  DestroyTexture(m_BloomDown);
+  DestroyTexture(m_BloomUp);
+  DestroyTexture(m_Ldr);
+  DestroyTexture(m_Output);
+  m_Width = 0;
+  m_Height = 0;
+}
+
+void PostProcessor::Resize(uint32_t width, uint32_t height) {
+  ReleaseTargets();
+  if (width == 0 || height == 0) {
+    return;
+  }
+  m_Width = width;
+  m_Height = height;
+
+  m_Hdr = CreateTexture(m_Device, "HDR scene target", width, height, 1,
+                        kHdrFormat,
+                        WGPUTextureUsage_RenderAttachment |
+                            WGPUTextureUsage_TextureBinding);
+  m_HdrView = wgpuTextureCreateView(m_Hdr, nullptr);
+
+  // Halve down to a few texels, at most kMaxBloomLevels times
+  const uint32_t levels = std::clamp<uint32_t>(
+      std::bit_width(std::min(width, height)) - 2, 1, kMaxBloomLevels);
+  const WGPUTextureUsage bloomUsage =
+      WGPUTextureUsage_StorageBinding | WGPUTextureUsage_TextureBinding;
+  const uint32_t bloomWidth = std::max(width / 2, 1u);
+  const uint32_t bloomHeight = std::max(height / 2, 1u);
+  m_BloomDown = CreateTexture(m_Device, "Bloom downsample chain", bloomWidth,
+                              bloomHeight, levels, kHdrFormat, bloomUsage);
+  for (uint32_t i = 0; i < levels; ++i) {
+    m_BloomDownViews.push_back(CreateMipView(m_BloomDown, kHdrFormat, i));
+  }
+  if (levels > 1) {
+    m_BloomUp = CreateTexture(m_Device, "Bloom upsample chain", bloomWidth,
+                              bloomHeight, levels - 1, kHdrFormat, bloomUsage);
+    for (uint32_t i = 0; i + 1 < levels; ++i) {
+      m_BloomUpViews.push_back(CreateMipView(m_BloomUp, kHdrFormat, i));
+    }
+  }
+
+  // Copied from for frame capture
+  const WGPUTextureUsage ldrUsage = WGPUTextureUsage_StorageBinding |
+                                    WGPUTextureUsage_TextureBinding |
+                                    WGPUTextureUsage_CopySrc;
+  m_Ldr = CreateTexture(m_Device, "Tonemapped target", width, height, 1,
+                        kOutputFormat, ldrUsage);
+  m_LdrView = wgpuTextureCreateView(m_Ldr, nullptr);
+  m_Output = CreateTexture(m_Device, "Anti-aliased target", width, height, 1,
+                           kOutputFormat, ldrUsage);
+  m_OutputView = wgpuTextureCreateView(m_Output, nullptr);
+
+  CreateBindGroups();
+}
+
+void PostProcessor::CreateBindGroups() {
+  WGPUBindGroupEntry uniformEntry = {};
+  uniformEntry.binding = 0;
+  uniformEntry.buffer = m_UniformBuffer;
+  uniformEntry.size = sizeof(PostUniforms);
+
+  // Level 0 reads the HDR target through the threshold, later levels the
+  // level above
+  const uint32_t levels = static_cast<uint32_t>(m_BloomDownViews.size());
+  for (uint32_t i = 0; i < levels; ++i) {
+    const WGPUBindGroupEntry entries[] = {
+        uniformEntry,
+        ViewEntry(1, i == 0 ? m_HdrView : m_BloomDownViews[i - 1]),
+        ViewEntry(2, m_BloomDownViews[i]),
+    };
+    m_DownBindGroups.push_back(CreateBindGroup(m_Device, "Bloom downsample",
+                                               m_DownLayout, entries,
+                                               std::size(entries)));
+  }
+  // Upsampled level i adds the tent-filtered level below it to downsampled
+  // level i; the coarsest level is its own upsample
+  m_UpBindGroups.resize(m_BloomUpViews.size());
+  for (uint32_t i = 0; i < m_BloomUpViews.size(); ++i) {
+    const bool coarsest = i + 2 == levels;
+    const WGPUBindGroupEntry entries[] = {
+        ViewEntry(0, coarsest ? m_BloomDownViews[i + 1] : m_BloomUpViews[i + 1]),
+        ViewEntry(1, m_BloomDownViews[i]),
+        ViewEntry(2, m_BloomUpViews[i]),
+    };
+    m_UpBindGroups[i] = CreateBindGroup(m_Device, "Bloom upsample", m_UpLayout,
+                                        entries, std::size(entries));
+  }
+
+  const WGPUTextureView bloom =
+      m_BloomUpViews.empty() ? m_BloomDownViews[0] : m_BloomUpViews[0];
+  const WGPUBindGroupEntry tonemapEntries[] = {
+      uniformEntry,
+      ViewEntry(1, m_HdrView),
+      ViewEntry(2, bloom),
+      SamplerBinding(3, m_LinearSampler),
+      ViewEntry(4, m_LdrView),
+  };
+  m_TonemapBindGroup = CreateBindGroup(m_Device, "Tonemap", m_TonemapLayout,
+                                       tonemapEntries, std::size(tonemapEntries));
+
+  const WGPUBindGroupEntry fxaaEntries[] = {
+      ViewEntry(0, m_LdrView),
+      SamplerBinding(1, m_LinearSampler),
+      ViewEntry(2, m_OutputView),
+  };
+  m_FxaaBindGroup = CreateBindGroup(m_Device, "FXAA", m_FxaaLayout, fxaaEntries,
+                                    std::size(fxaaEntries));
+
+  for (WGPUTextureView view : {m_LdrView, m_OutputView}) {
+    const WGPUBindGroupEntry entries[] = {
+        ViewEntry(0, view),
+        SamplerBinding(1, m_LinearSampler),
+    };
+    WGPUBindGroup group = CreateBindGroup(m_Device, "Composite",
+                                          m_CompositeLayout, entries,
+                                          std::size(entries));
+    (view == m_LdrView ? m_CompositeLdrBindGroup : m_CompositeOutputBindGroup) =
+        group;
+  }
+}
+
+WGPUComputePassEncoder PostProcessor::BeginPass(WGPUCommandEncoder encoder,
+                                                const char *label,
+                                                GpuTimer *timer,
+                                                uint32_t scope) {
+  WGPUComputePassDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.timestampWrites = timer ? timer->GetPassWrites(scope) : nullptr;
+  return wgpuCommandEncoderBeginComputePass(encoder, &desc);
+}
+
+void PostProcessor::Apply(WGPUCommandEncoder encoder, GpuTimer *timer,
+                          uint32_t firstScope) {
+  m_FxaaApplied = false;
+  if (!m_Hdr) {
+    return;
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+
+  PostUniforms uniforms = {};
+  uniforms.exposure = m_Settings.exposure;
+  uniforms.bloomThreshold = m_Settings.bloomThreshold;
+  uniforms.bloomKnee = std::max(m_Settings.bloomKnee, 0.0f);
+  uniforms.bloomIntensity = m_Settings.bloomIntensity;
+  uniforms.flags = (m_Settings.bloom ? kFlagBloom : 0u) |
+                   (m_Settings.tonemap ? kFlagTonemap : 0u);
+  wgpuQueueWriteBuffer(m_Queue, m_UniformBuffer, 0, &uniforms, sizeof(uniforms));
+
+  // Dispatches within a pass are ordered, so each level sees the previous one
+  if (m_Settings.bloom) {
+    WGPUComputePassEncoder pass =
+        BeginPass(encoder, "Bloom", timer, firstScope + kStageBloom);
+    for (uint32_t i = 0; i < m_DownBindGroups.size(); ++i) {
+      Dispatch(pass, i == 0 ? m_PrefilterPipeline : m_DownsamplePipeline,
+               m_DownBindGroups[i], std::max(m_Width >> (i + 1), 1u),
+               std::max(m_Height >> (i + 1), 1u));
+    }
+    for (uint32_t i = static_cast<uint32_t>(m_UpBindGroups.size()); i-- > 0;) {
+      Dispatch(pass, m_UpsamplePipeline, m_UpBindGroups[i],
+               std::max(m_Width >> (i + 1), 1u),
+               std::max(m_Height >> (i + 1), 1u));
+    }
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+  }
+
+  WGPUComputePassEncoder pass =
+      BeginPass(encoder, "Tonemap", timer, firstScope + kStageTonemap);
+  Dispatch(pass, m_TonemapPipeline, m_TonemapBindGroup, m_Width, m_Height);
+  wgpuComputePassEncoderEnd(pass);
+  wgpuComputePassEncoderRelease(pass);
+
+  if (m_Settings.fxaa) {
+    pass = BeginPass(encoder, "FXAA", timer, firstScope + kStageFxaa);
+    Dispatch(pass, m_FxaaPipeline, m_FxaaBindGroup, m_Width, m_Height);
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+    m_FxaaApplied = true;
+  }
+
+  m_CpuMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start)
+                .count();
+}
+
+void PostProcessor::Composite(WGPURenderPassEncoder pass) {
+  if (!m_Hdr) {
+    return;
+  }
+  wgpuRenderPassEncoderSetPipeline(pass, m_CompositePipeline);
+  wgpuRenderPassEncoderSetBindGroup(
+      pass, 0, m_FxaaApplied ? m_CompositeOutputBindGroup : m_CompositeLdrBindGroup,
+      0, nullptr);
+  wgpuRenderPassEncoderDraw(pass, 3, 1, 0, 0);
+}
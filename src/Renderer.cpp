@@ -1,6 +1,14 @@
 #include "Renderer.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "GpuTimer.h"
+#include "ImGuiRenderer.h"
+#include "MeshRenderer.h"
+#include "PostProcessor.h"
 #include "imgui.h"
 #include "imgui_impl_wgpu.h"
+#include <algorithm>
+#include <cmath>
 #include <stdio.h>
 
 #if defined(SDL_PLATFORM_WIN32)
@@ -10,7 +18,24 @@
 #include <windows.h>
 #endif
 
-Renderer::Renderer() {}
+namespace {
+
+// GpuTimer scopes; the post chain uses one per PostProcessor::Stage and the
+// GPU-driven cull two, hi-Z build then culling
+constexpr uint32_t kScopeScene = 0;
+constexpr uint32_t kScopePost = 1;
+constexpr uint32_t kScopeComposite = kScopePost + PostProcessor::kStageCount;
+constexpr uint32_t kScopeCull = kScopeComposite + 1;
+
+static_assert(kScopeCull + 1 < Renderer::kUiComputeScope &&
+                  Renderer::kUiComputeScope < GpuTimer::kMaxScopes,
+              "GpuTimer scopes overlap");
+
+} // namespace
+
+Renderer::Renderer()
+    : m_DynamicResolution(std::make_unique<DynamicResolution>()),
+      m_FrameCapture(std::make_unique<FrameCapture>()) {}
 
 Renderer::~Renderer() { Shutdown(); }
 
@@ -28,14 +53,63 @@ bool Renderer::Initialize(SDL_Window *window, int width, int height) {
     return false;
   }
 
+  // Shares the stock backend's textures, so it's created after it
+  m_ImGuiRenderer = std::make_unique<ImGuiRenderer>();
+  if (!m_ImGuiRenderer->Initialize(m_Device, m_Queue, m_SurfaceConfig.format)) {
+    fprintf(stderr, "Failed to initialize ImGui renderer\n");
+    return false;
+  }
+
+  m_GpuTimer = std::make_unique<GpuTimer>();
+  if (!m_GpuTimer->Initialize(m_Device, m_Queue)) {
+    fprintf(stderr, "Failed to initialize GPU timer\n");
+    return false;
+  }
+
+  m_PostProcessor = std::make_unique<PostProcessor>();
+  if (!m_PostProcessor->Initialize(m_Device, m_Queue, m_SurfaceConfig.format)) {
+    fprintf(stderr, "Failed to initialize post-processing\n");
+    return false;
+  }
+  m_PostProcessor->Resize(m_RenderWidth, m_RenderHeight);
+  m_FrameCapture->Initialize(m_Device);
+
+  // The scene renders into the HDR target, not the surface
+  m_MeshRenderer = std::make_unique<MeshRenderer>();
+  if (!m_MeshRenderer->Initialize(m_Device, m_Queue, PostProcessor::kHdrFormat,
+                                  kDepthFormat)) {
+    fprintf(stderr, "Failed to initialize mesh renderer\n");
+    return false;
+  }
+  m_MeshRenderer->SetDepthTexture(m_DepthTexture, m_RenderWidth,
+                                  m_RenderHeight);
+
   return true;
 }
 
 void Renderer::Shutdown() {
+  if (m_FrameCapture) {
+    m_FrameCapture->Shutdown();
+  }
+  m_MeshRenderer.reset();
+  m_PostProcessor.reset();
+  m_GpuTimer.reset();
+  m_ImGuiRenderer.reset();
+
   if (m_Device) {
     ImGui_ImplWGPU_Shutdown();
   }
 
+  if (m_DepthView) {
+    wgpuTextureViewRelease(m_DepthView);
+    m_DepthView = nullptr;
+  }
+  if (m_DepthTexture) {
+    wgpuTextureDestroy(m_DepthTexture);
+    wgpuTextureRelease(m_DepthTexture);
+    m_DepthTexture = nullptr;
+  }
+
   if (m_Surface) {
     wgpuSurfaceUnconfigure(m_Surface);
     wgpuSurfaceRelease(m_Surface);
@@ -78,6 +152,15 @@ void Renderer::BeginFrame() {
     return;
   }
 
+  // Frame interval for the dynamic resolution fallback
+  auto frameStart = std::chrono::high_resolution_clock::now();
+  if (m_LastFrameStart.time_since_epoch().count() != 0) {
+    m_CpuFrameMs = std::chrono::duration<double, std::milli>(
+                       frameStart - m_LastFrameStart)
+                       .count();
+  }
+  m_LastFrameStart = frameStart;
+
   // Get current surface texture
   wgpuSurfaceGetCurrentTexture(m_Surface, &m_CurrentSurfaceTexture);
 
@@ -120,12 +203,20 @@ void Renderer::BeginFrame() {
   colorAttachment.clearValue = {
       m_ClearColor[0] * m_ClearColor[3], m_ClearColor[1] * m_ClearColor[3],
       m_ClearColor[2] * m_ClearColor[3], m_ClearColor[3]};
-  colorAttachment.view = m_CurrentTextureView;
+  colorAttachment.view = m_PostProcessor->GetHdrView();
+
+  WGPURenderPassDepthStencilAttachment depthAttachment = {};
+  depthAttachment.view = m_DepthView;
+  depthAttachment.depthLoadOp = WGPULoadOp_Clear;
+  depthAttachment.depthStoreOp = WGPUStoreOp_Store;
+  depthAttachment.depthClearValue = 1.0f;
 
   WGPURenderPassDescriptor renderPassDesc = {};
+  renderPassDesc.label = {"Scene", WGPU_STRLEN};
   renderPassDesc.colorAttachmentCount = 1;
   renderPassDesc.colorAttachments = &colorAttachment;
-  renderPassDesc.depthStencilAttachment = nullptr;
+  renderPassDesc.depthStencilAttachment = &depthAttachment;
+  renderPassDesc.timestampWrites = m_GpuTimer->GetPassWrites(kScopeScene);
 
   m_CurrentRenderPass =
       wgpuCommandEncoderBeginRenderPass(m_CurrentEncoder, &renderPassDesc);
@@ -139,13 +230,42 @@ void Renderer::EndFrame() {
   }
 
   // End render pass
-  wgpuRenderPassEncoderEnd(m_CurrentRenderPass);
+  FinishScene();
+  wgpuRenderPassEncoderEnd(m_CompositePass);
+  m_GpuTimer->Resolve(m_CurrentEncoder);
+  if (m_FrameCapture->IsRecording()) {
+    if (m_SurfaceCopySrc &&
+        FrameCapture::IsSupportedFormat(m_SurfaceConfig.format)) {
+      m_FrameCapture->Capture(m_CurrentEncoder, m_CurrentSurfaceTexture.texture,
+                              m_SurfaceConfig.format, m_Width, m_Height);
+    } else {
+      m_FrameCapture->Capture(m_CurrentEncoder,
+                              m_PostProcessor->GetOutputTexture(),
+                              PostProcessor::kOutputFormat,
+                              m_PostProcessor->GetWidth(),
+                              m_PostProcessor->GetHeight());
+    }
+  }
 
   // Submit command buffer
   WGPUCommandBufferDescriptor cmdBufferDesc = {};
   WGPUCommandBuffer cmdBuffer =
       wgpuCommandEncoderFinish(m_CurrentEncoder, &cmdBufferDesc);
   wgpuQueueSubmit(m_Queue, 1, &cmdBuffer);
+  m_GpuTimer->ReadBack();
+  m_FrameCapture->Submitted();
+
+  // Pick the next frame's render scale. Scene captures are at render
+  // resolution, and a video can't change size mid-stream.
+  const bool capturesScene =
+      !m_SurfaceCopySrc ||
+      !FrameCapture::IsSupportedFormat(m_SurfaceConfig.format);
+  m_DynamicResolution->SetPinned(m_FrameCapture->IsRecording() &&
+                                 capturesScene);
+  const FrameTimings timings = GetFrameTimings();
+  m_DynamicResolution->Update(
+      timings.gpuTimestamps ? timings.GpuTotalMs() : timings.cpuFrameMs,
+      timings.gpuTimestamps);
 
   // Present
   wgpuSurfacePresent(m_Surface);
@@ -156,22 +276,120 @@ void Renderer::EndFrame() {
   // Cleanup
   wgpuCommandBufferRelease(cmdBuffer);
   wgpuCommandEncoderRelease(m_CurrentEncoder);
-  wgpuRenderPassEncoderRelease(m_CurrentRenderPass);
+  wgpuRenderPassEncoderRelease(m_CompositePass);
   wgpuTextureViewRelease(m_CurrentTextureView);
 
   m_CurrentEncoder = nullptr;
-  m_CurrentRenderPass = nullptr;
+  m_CompositePass = nullptr;
   m_CurrentTextureView = nullptr;
   m_IsFrameStarted = false;
+
+  // The old targets stay alive until the GPU is done with this frame
+  UpdateRenderTargets();
 }
 
-void Renderer::RenderImGui(ImDrawData *drawData) {
+bool Renderer::UploadScene(const Scene &scene,
+                           const std::vector<uint32_t> *previousMeshes) {
+  return m_MeshRenderer && m_MeshRenderer->Upload(scene, previousMeshes);
+}
+
+void Renderer::RenderScene(const Scene &scene, const Mat4 &viewProj,
+                           Vec3 cameraPos,
+                           const std::vector<uint32_t> &visibleObjects,
+                           bool batching, ThreadPool *pool) {
   if (!m_IsFrameStarted || !m_CurrentRenderPass) {
+    return;
+  }
+
+  m_MeshRenderer->Draw(m_CurrentRenderPass, scene, viewProj, cameraPos,
+                       visibleObjects, batching, pool);
+}
+
+void Renderer::RenderSceneGpuDriven(const Scene &scene, const Mat4 &viewProj,
+                                    Vec3 cameraPos, bool frustumCulling,
+                                    bool occlusionCulling) {
+  if (!m_IsFrameStarted || !m_CurrentRenderPass) {
+    return;
+  }
+
+  m_MeshRenderer->DrawGpuDriven(m_CurrentRenderPass, scene, viewProj,
+                                cameraPos, frustumCulling, occlusionCulling,
+                                m_GpuTimer.get(), kScopeCull);
+}
+
+uint32_t Renderer::GetSceneDrawCalls() const {
+  return m_MeshRenderer ? m_MeshRenderer->GetStats().drawCalls : 0;
+}
+
+void Renderer::RenderImGui(ImDrawData *drawData) {
+  if (!m_IsFrameStarted) {
     fprintf(stderr, "Cannot render ImGui: frame not started\n");
     return;
   }
 
-  ImGui_ImplWGPU_RenderDrawData(drawData, m_CurrentRenderPass);
+  FinishScene();
+  const auto start = std::chrono::high_resolution_clock::now();
+  if (m_StockImGui || !m_ImGuiRenderer) {
+    ImGui_ImplWGPU_RenderDrawData(drawData, m_CompositePass);
+  } else {
+    m_ImGuiRenderer->Render(drawData, m_CompositePass);
+  }
+  m_UiCpuMs = std::chrono::duration<double, std::milli>(
+                  std::chrono::high_resolution_clock::now() - start)
+                  .count();
+}
+
+void Renderer::FinishScene() {
+  if (m_CompositePass) {
+    return;
+  }
+
+  wgpuRenderPassEncoderEnd(m_CurrentRenderPass);
+  wgpuRenderPassEncoderRelease(m_CurrentRenderPass);
+  m_CurrentRenderPass = nullptr;
+
+  m_PostProcessor->Apply(m_CurrentEncoder, m_GpuTimer.get(), kScopePost);
+
+  WGPURenderPassColorAttachment colorAttachment = {};
+  colorAttachment.depthSlice = WGPU_DEPTH_SLICE_UNDEFINED;
+  colorAttachment.loadOp = WGPULoadOp_Clear;
+  colorAttachment.storeOp = WGPUStoreOp_Store;
+  colorAttachment.clearValue = {0.0, 0.0, 0.0, 1.0};
+  colorAttachment.view = m_CurrentTextureView;
+
+  WGPURenderPassDescriptor renderPassDesc = {};
+  renderPassDesc.label = {"Composite", WGPU_STRLEN};
+  renderPassDesc.colorAttachmentCount = 1;
+  renderPassDesc.colorAttachments = &colorAttachment;
+  renderPassDesc.timestampWrites = m_GpuTimer->GetPassWrites(kScopeComposite);
+
+  m_CompositePass =
+      wgpuCommandEncoderBeginRenderPass(m_CurrentEncoder, &renderPassDesc);
+  m_PostProcessor->Composite(m_CompositePass);
+}
+
+Renderer::FrameTimings Renderer::GetFrameTimings() const {
+  FrameTimings timings;
+  if (m_GpuTimer) {
+    timings.gpuTimestamps = m_GpuTimer->IsSupported();
+    timings.sceneMs = m_GpuTimer->GetMilliseconds(kScopeScene);
+    timings.bloomMs =
+        m_GpuTimer->GetMilliseconds(kScopePost + PostProcessor::kStageBloom);
+    timings.tonemapMs =
+        m_GpuTimer->GetMilliseconds(kScopePost + PostProcessor::kStageTonemap);
+    timings.fxaaMs =
+        m_GpuTimer->GetMilliseconds(kScopePost + PostProcessor::kStageFxaa);
+    timings.compositeMs = m_GpuTimer->GetMilliseconds(kScopeComposite);
+    timings.cullMs = m_GpuTimer->GetMilliseconds(kScopeCull) +
+                     m_GpuTimer->GetMilliseconds(kScopeCull + 1);
+    timings.uiComputeMs = m_GpuTimer->GetMilliseconds(kUiComputeScope);
+  }
+  if (m_PostProcessor) {
+    timings.postCpuMs = m_PostProcessor->GetCpuMs();
+  }
+  timings.uiCpuMs = m_UiCpuMs;
+  timings.cpuFrameMs = m_CpuFrameMs;
+  return timings;
 }
 
 void Renderer::SetClearColor(float r, float g, float b, float a) {
@@ -232,6 +450,11 @@ bool Renderer::InitializeWebGPU(SDL_Window *window) {
   m_SurfaceConfig.presentMode = WGPUPresentMode_Fifo;
   m_SurfaceConfig.alphaMode = WGPUCompositeAlphaMode_Auto;
   m_SurfaceConfig.usage = WGPUTextureUsage_RenderAttachment;
+  // Frame capture copies the surface when the platform allows it
+  m_SurfaceCopySrc = (surfaceCaps.usages & WGPUTextureUsage_CopySrc) != 0;
+  if (m_SurfaceCopySrc) {
+    m_SurfaceConfig.usage |= WGPUTextureUsage_CopySrc;
+  }
   m_SurfaceConfig.width = m_Width;
   m_SurfaceConfig.height = m_Height;
   m_SurfaceConfig.device = m_Device;
@@ -250,6 +473,7 @@ bool Renderer::InitializeImGuiBackend() {
   initInfo.Device = m_Device;
   initInfo.NumFramesInFlight = 3;
   initInfo.RenderTargetFormat = m_SurfaceConfig.format;
+  // Drawn in the composite pass, which has no depth attachment
   initInfo.DepthStencilFormat = WGPUTextureFormat_Undefined;
 
   return ImGui_ImplWGPU_Init(&initInfo);
@@ -260,6 +484,14 @@ WGPUAdapter Renderer::RequestAdapter(wgpu::Instance &instance) {
   wgpu::RequestAdapterOptions adapterOptions;
   adapterOptions.powerPreference = wgpu::PowerPreference::HighPerformance;
 
+  // RENDERER_FORCE_FALLBACK_ADAPTER=1 selects Dawn's CPU adapter (SwiftShader
+  // on Vulkan) so GPU code paths can be exercised without a GPU
+  const char *forceFallback = SDL_getenv("RENDERER_FORCE_FALLBACK_ADAPTER");
+  if (forceFallback && SDL_strcmp(forceFallback, "0") != 0) {
+    adapterOptions.forceFallbackAdapter = true;
+    adapterOptions.backendType = wgpu::BackendType::Vulkan;
+  }
+
   auto onRequestAdapter = [&](wgpu::RequestAdapterStatus status,
                               wgpu::Adapter adapter, wgpu::StringView message) {
     if (status != wgpu::RequestAdapterStatus::Success) {
@@ -298,6 +530,23 @@ WGPUDevice Renderer::RequestDevice(wgpu::Instance &instance,
         fprintf(stderr, "WebGPU error (%d): %s\n", (int)type, msg.data);
       });
 
+  // Block-compressed formats are optional; enable whichever the adapter has
+  // so KTX2 textures can stay compressed on the GPU
+  std::vector<wgpu::FeatureName> features;
+  for (wgpu::FeatureName feature : {wgpu::FeatureName::TextureCompressionBC,
+                                    wgpu::FeatureName::TextureCompressionETC2,
+                                    wgpu::FeatureName::TextureCompressionASTC}) {
+    if (adapter.HasFeature(feature)) {
+      features.push_back(feature);
+    }
+  }
+  // Per-pass GPU timings for the post-processing overlay
+  if (adapter.HasFeature(wgpu::FeatureName::TimestampQuery)) {
+    features.push_back(wgpu::FeatureName::TimestampQuery);
+  }
+  deviceDesc.requiredFeatureCount = features.size();
+  deviceDesc.requiredFeatures = features.data();
+
   wgpu::Device acquiredDevice;
   auto onRequestDevice = [&](wgpu::RequestDeviceStatus status,
                              wgpu::Device device, wgpu::StringView message) {
@@ -366,4 +615,54 @@ void Renderer::ConfigureSurface() {
   m_SurfaceConfig.width = m_Width;
   m_SurfaceConfig.height = m_Height;
   wgpuSurfaceConfigure(m_Surface, &m_SurfaceConfig);
+  m_RenderWidth = 0;
+  m_RenderHeight = 0;
+  UpdateRenderTargets();
+}
+
+void Renderer::UpdateRenderTargets() {
+  const float scale = m_DynamicResolution->GetScale();
+  const int width = std::max(1, static_cast<int>(std::lround(m_Width * scale)));
+  const int height =
+      std::max(1, static_cast<int>(std::lround(m_Height * scale)));
+  if (width == m_RenderWidth && height == m_RenderHeight) {
+    return;
+  }
+
+  m_RenderWidth = width;
+  m_RenderHeight = height;
+  CreateDepthTexture();
+  if (m_PostProcessor) {
+    m_PostProcessor->Resize(m_RenderWidth, m_RenderHeight);
+  }
+}
+
+void Renderer::CreateDepthTexture() {
+  if (m_DepthView) {
+    wgpuTextureViewRelease(m_DepthView);
+    m_DepthView = nullptr;
+  }
+  if (m_DepthTexture) {
+    wgpuTextureDestroy(m_DepthTexture);
+    wgpuTextureRelease(m_DepthTexture);
+    m_DepthTexture = nullptr;
+  }
+
+  WGPUTextureDescriptor desc = {};
+  desc.label = {"Depth buffer", WGPU_STRLEN};
+  // Sampled by the GPU culler to build its hi-Z pyramid
+  desc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding;
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.size = {static_cast<uint32_t>(m_RenderWidth),
+               static_cast<uint32_t>(m_RenderHeight), 1};
+  desc.format = kDepthFormat;
+  desc.mipLevelCount = 1;
+  desc.sampleCount = 1;
+  m_DepthTexture = wgpuDeviceCreateTexture(m_Device, &desc);
+  m_DepthView = wgpuTextureCreateView(m_DepthTexture, nullptr);
+
+  if (m_MeshRenderer) {
+    m_MeshRenderer->SetDepthTexture(m_DepthTexture, m_RenderWidth,
+                                    m_RenderHeight);
+  }
 }
@@ -0,0 +1,142 @@
+#include "Simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+Simulation::Simulation() {}
+
+Simulation::~Simulation() { Stop(); }
+
+void Simulation::Start() {
+  if (m_Running) {
+    return;
+  }
+  m_Pool = std::make_unique<ThreadPool>();
+  m_Running = true;
+  m_Thread = std::thread(&Simulation::ThreadFunc, this);
+}
+
+void Simulation::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_WakeMutex);
+    m_Running = false;
+  }
+  m_Wake.notify_all();
+  if (m_Thread.joinable()) {
+    m_Thread.join();
+  }
+  m_Pool.reset();
+}
+
+uint64_t Simulation::Reset(std::vector<Vec3> positions,
+                           std::vector<float> phases) {
+  std::lock_guard<std::mutex> lock(m_ResetMutex);
+  m_PendingPositions = std::move(positions);
+  m_PendingPhases = std::move(phases);
+  m_PendingPhases.resize(m_PendingPositions.size(), 0.0f);
+  m_ResetPending = true;
+  return ++m_PendingGeneration;
+}
+
+float Simulation::GetBlend(const Snapshot &snapshot, Clock::time_point now) {
+  if (snapshot.tickSeconds <= 0.0) {
+    return 1.0f;
+  }
+  // `previous` belongs to tickTime - tickSeconds; rendering one tick behind
+  // puts `now` between the two states while the next tick is being computed
+  const double elapsed =
+      std::chrono::duration<double>(now - snapshot.tickTime).count();
+  return static_cast<float>(std::clamp(elapsed / snapshot.tickSeconds, 0.0, 1.0));
+}
+
+Simulation::Stats Simulation::GetStats() const {
+  Stats stats;
+  stats.ticks = m_Ticks;
+  stats.skippedTicks = m_SkippedTicks;
+  stats.tickMs = m_TickMs;
+  return stats;
+}
+
+void Simulation::ThreadFunc() {
+  printf("Simulation thread started\n");
+  Clock::time_point next = Clock::now();
+
+  while (m_Running) {
+    const double dt = 1.0 / std::clamp(m_TickRate.load(), 1.0f, 1000.0f);
+    const auto step = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(dt));
+    {
+      std::unique_lock<std::mutex> lock(m_WakeMutex);
+      if (m_Wake.wait_until(lock, next, [this] { return !m_Running; })) {
+        break;
+      }
+    }
+
+    // Too far behind: drop the backlog instead of running ever more ticks
+    // per wake-up. Simulated time still advances by exactly dt per tick.
+    const Clock::time_point now = Clock::now();
+    if (now - next > step * kMaxCatchUpTicks) {
+      const auto behind = (now - next) / step;
+      m_SkippedTicks += static_cast<uint32_t>(behind);
+      next += step * behind;
+    }
+
+    // A paused simulation keeps its schedule but publishes nothing, so the
+    // render thread keeps the last state it blended
+    ApplyPendingReset();
+    if (!m_Paused) {
+      auto start = Clock::now();
+      Step(dt);
+      m_TickMs =
+          std::chrono::duration<double, std::milli>(Clock::now() - start)
+              .count();
+      Publish(next, dt);
+      ++m_Ticks;
+    }
+    next += step;
+  }
+
+  printf("Simulation thread stopped\n");
+}
+
+void Simulation::ApplyPendingReset() {
+  std::lock_guard<std::mutex> lock(m_ResetMutex);
+  if (!m_ResetPending) {
+    return;
+  }
+  m_ResetPending = false;
+  m_Generation = m_PendingGeneration;
+  m_Current = std::move(m_PendingPositions);
+  m_Phases = std::move(m_PendingPhases);
+  m_Previous = m_Current;
+  m_Tick = 0;
+  m_Time = 0.0;
+}
+
+void Simulation::Step(double dt) {
+  m_Previous.swap(m_Current);
+  m_Current.resize(m_Previous.size());
+  const float time = static_cast<float>(m_Time);
+  const float step = static_cast<float>(dt);
+  m_Pool->parallel_for(0, m_Current.size(), 4096,
+                       [&](size_t begin, size_t end) {
+                         for (size_t i = begin; i < end; ++i) {
+                           Vec3 p = m_Previous[i];
+                           p.y += std::cos(time * 2.0f + m_Phases[i]) * step;
+                           m_Current[i] = p;
+                         }
+                       });
+  m_Time += dt;
+  ++m_Tick;
+}
+
+void Simulation::Publish(Clock::time_point tickTime, double dt) {
+  Snapshot &snapshot = m_Snapshots.write_buffer();
+  snapshot.generation = m_Generation;
+  snapshot.tick = m_Tick;
+  snapshot.tickTime = tickTime;
+  snapshot.tickSeconds = dt;
+  snapshot.previous.assign(m_Previous.begin(), m_Previous.end());
+  snapshot.current.assign(m_Current.begin(), m_Current.end());
+  m_Snapshots.publish();
+}
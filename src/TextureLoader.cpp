@@ -0,0 +1,270 @@
+#include "TextureLoader.h"
+#include "TextureTranscoder.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <stdio.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace {
+
+// sRGB <-> linear tables; the encode side is indexed by linear * 4095
+struct SrgbTables {
+  std::array<float, 256> toLinear;
+  std::array<uint8_t, 4096> fromLinear;
+
+  SrgbTables() {
+    for (int i = 0; i < 256; ++i) {
+      float c = i / 255.0f;
+      toLinear[i] = c <= 0.04045f ? c / 12.92f
+                                  : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < 4096; ++i) {
+      float l = i / 4095.0f;
+      float c = l <= 0.0031308f ? l * 12.92f
+                                : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+      fromLinear[i] = static_cast<uint8_t>(std::lround(c * 255.0f));
+    }
+  }
+};
+
+const SrgbTables &GetSrgbTables() {
+  static const SrgbTables tables;
+  return tables;
+}
+
+// Halve an RGBA8 sRGB level. Odd edges reuse the last row/column.
+void Downsample(const TextureMip &src, TextureMip &dst) {
+  const SrgbTables &srgb = GetSrgbTables();
+  dst.width = std::max(1u, src.width / 2);
+  dst.height = std::max(1u, src.height / 2);
+  dst.data.resize(size_t(dst.width) * dst.height * 4);
+
+  for (uint32_t y = 0; y < dst.height; ++y) {
+    const uint32_t y0 = std::min(y * 2, src.height - 1);
+    const uint32_t y1 = std::min(y * 2 + 1, src.height - 1);
+    for (uint32_t x = 0; x < dst.width; ++x) {
+      const uint32_t x0 = std::min(x * 2, src.width - 1);
+      const uint32_t x1 = std::min(x * 2 + 1, src.width - 1);
+      const uint8_t *p[4] = {
+          &src.data[(size_t(y0) * src.width + x0) * 4],
+          &src.data[(size_t(y0) * src.width + x1) * 4],
+          &src.data[(size_t(y1) * src.width + x0) * 4],
+          &src.data[(size_t(y1) * src.width + x1) * 4],
+      };
+      uint8_t *out = &dst.data[(size_t(y) * dst.width + x) * 4];
+      for (int c = 0; c < 3; ++c) {
+        float sum = srgb.toLinear[p[0][c]] + srgb.toLinear[p[1][c]] +
+                    srgb.toLinear[p[2][c]] + srgb.toLinear[p[3][c]];
+        out[c] = srgb.fromLinear[static_cast<size_t>(sum * 0.25f * 4095.0f + 0.5f)];
+      }
+      // Alpha is linear
+      out[3] = static_cast<uint8_t>((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4);
+    }
+  }
+}
+
+// Whole file, or only the first `maxBytes` of it
+bool ReadFile(const std::string &path, std::vector<uint8_t> &bytes,
+              size_t maxBytes = SIZE_MAX) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  const size_t size = std::min(static_cast<size_t>(file.tellg()), maxBytes);
+  file.seekg(0);
+  bytes.resize(size);
+  file.read(reinterpret_cast<char *>(bytes.data()),
+            static_cast<std::streamsize>(size));
+  return static_cast<bool>(file);
+}
+
+// Encoded bytes of a KTX2 source, or null for other images. File sources
+// are only read in full once the identifier matches.
+const std::vector<uint8_t> *GetKtx2Data(const TextureSource &source,
+                                        std::vector<uint8_t> &storage) {
+  if (!source.encoded.empty()) {
+    return IsKtx2(source.encoded.data(), source.encoded.size())
+               ? &source.encoded
+               : nullptr;
+  }
+  if (source.path.empty() || !ReadFile(source.path, storage, 12) ||
+      !IsKtx2(storage.data(), storage.size()) ||
+      !ReadFile(source.path, storage)) {
+    return nullptr;
+  }
+  return &storage;
+}
+
+// Filter `level` down to 1x1 into RGBA8, keeping the levels from `firstMip`
+void BuildMipChain(TextureMip level, uint32_t firstMip, DecodedTexture &out) {
+  out.format = WGPUTextureFormat_RGBA8UnormSrgb;
+  out.width = level.width;
+  out.height = level.height;
+  const uint32_t mipCount = GetMipCount(out.width, out.height);
+  out.firstMip = std::min(firstMip, mipCount - 1);
+  out.mips.clear();
+  out.mips.reserve(mipCount - out.firstMip);
+
+  // Every level is filtered from the one above it, so the finer levels are
+  // built even when only the tail is kept
+  for (uint32_t i = 0;; ++i) {
+    if (i >= out.firstMip) {
+      out.mips.push_back(level);
+    }
+    if (i + 1 == mipCount) {
+      break;
+    }
+    TextureMip next;
+    Downsample(level, next);
+    level = std::move(next);
+  }
+}
+
+} // namespace
+
+TextureFormatInfo GetTextureFormatInfo(WGPUTextureFormat format) {
+  switch (format) {
+  case WGPUTextureFormat_BC1RGBAUnorm:
+  case WGPUTextureFormat_BC1RGBAUnormSrgb:
+  case WGPUTextureFormat_ETC2RGB8Unorm:
+  case WGPUTextureFormat_ETC2RGB8UnormSrgb:
+    return {4, 4, 8};
+  case WGPUTextureFormat_BC3RGBAUnorm:
+  case WGPUTextureFormat_BC3RGBAUnormSrgb:
+  case WGPUTextureFormat_BC7RGBAUnorm:
+  case WGPUTextureFormat_BC7RGBAUnormSrgb:
+  case WGPUTextureFormat_ETC2RGBA8Unorm:
+  case WGPUTextureFormat_ETC2RGBA8UnormSrgb:
+  case WGPUTextureFormat_ASTC4x4Unorm:
+  case WGPUTextureFormat_ASTC4x4UnormSrgb:
+    return {4, 4, 16};
+  case WGPUTextureFormat_RGBA8Unorm:
+  case WGPUTextureFormat_RGBA8UnormSrgb:
+  default:
+    return {1, 1, 4};
+  }
+}
+
+uint32_t GetMipCount(uint32_t width, uint32_t height) {
+  uint32_t count = 1;
+  while (width > 1 || height > 1) {
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+    count++;
+  }
+  return count;
+}
+
+uint64_t GetMipSize(WGPUTextureFormat format, uint32_t width, uint32_t height) {
+  const TextureFormatInfo info = GetTextureFormatInfo(format);
+  const uint64_t blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+  const uint64_t blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+  return blocksX * blocksY * info.bytesPerBlock;
+}
+
+uint64_t GetMipChainSize(WGPUTextureFormat format, uint32_t width,
+                         uint32_t height, uint32_t firstMip) {
+  const uint32_t mipCount = GetMipCount(width, height);
+  uint64_t bytes = 0;
+  for (uint32_t level = firstMip; level < mipCount; ++level) {
+    bytes += GetMipSize(format, std::max(1u, width >> level),
+                        std::max(1u, height >> level));
+  }
+  return bytes;
+}
+
+uint32_t GetMaxBaseMip(WGPUTextureFormat format, uint32_t width,
+                       uint32_t height) {
+  const TextureFormatInfo info = GetTextureFormatInfo(format);
+  const uint32_t mipCount = GetMipCount(width, height);
+  uint32_t level = 0;
+  while (level + 1 < mipCount) {
+    const uint32_t w = std::max(1u, width >> (level + 1));
+    const uint32_t h = std::max(1u, height >> (level + 1));
+    if (w % info.blockWidth != 0 || h % info.blockHeight != 0) {
+      break;
+    }
+    level++;
+  }
+  return level;
+}
+
+bool ProbeTexture(const TextureSource &source,
+                  const TextureDecodeOptions &options, uint32_t &width,
+                  uint32_t &height, WGPUTextureFormat &format) {
+  format = WGPUTextureFormat_RGBA8UnormSrgb;
+  if (!source.pixels.empty()) {
+    width = source.width;
+    height = source.height;
+    return width > 0 && height > 0;
+  }
+
+  std::vector<uint8_t> storage;
+  if (const std::vector<uint8_t> *ktx2 = GetKtx2Data(source, storage)) {
+    return ProbeKtx2(source.name, *ktx2, options, width, height, format);
+  }
+
+  int w = 0, h = 0, channels = 0;
+  int ok = 0;
+  if (!source.encoded.empty()) {
+    ok = stbi_info_from_memory(source.encoded.data(),
+                               static_cast<int>(source.encoded.size()), &w, &h,
+                               &channels);
+  } else if (!source.path.empty()) {
+    ok = stbi_info(source.path.c_str(), &w, &h, &channels);
+  }
+  if (!ok || w <= 0 || h <= 0) {
+    fprintf(stderr, "Failed to read texture %s: %s\n", source.name.c_str(),
+            stbi_failure_reason());
+    return false;
+  }
+  width = static_cast<uint32_t>(w);
+  height = static_cast<uint32_t>(h);
+  return true;
+}
+
+bool DecodeTexture(const TextureSource &source,
+                   const TextureDecodeOptions &options, uint32_t firstMip,
+                   DecodedTexture &out) {
+  TextureMip level;
+  std::vector<uint8_t> storage;
+  if (!source.pixels.empty()) {
+    level.width = source.width;
+    level.height = source.height;
+    level.data = source.pixels;
+  } else if (const std::vector<uint8_t> *ktx2 = GetKtx2Data(source, storage)) {
+    if (!TranscodeKtx2(source.name, *ktx2, options, firstMip, out)) {
+      return false;
+    }
+    if (out.format != WGPUTextureFormat_RGBA8UnormSrgb) {
+      return true;
+    }
+    level = std::move(out.mips.front());
+  } else {
+    int w = 0, h = 0, channels = 0;
+    stbi_uc *pixels = nullptr;
+    if (!source.encoded.empty()) {
+      pixels = stbi_load_from_memory(source.encoded.data(),
+                                     static_cast<int>(source.encoded.size()),
+                                     &w, &h, &channels, 4);
+    } else if (!source.path.empty()) {
+      pixels = stbi_load(source.path.c_str(), &w, &h, &channels, 4);
+    }
+    if (!pixels) {
+      fprintf(stderr, "Failed to decode texture %s: %s\n", source.name.c_str(),
+              stbi_failure_reason());
+      return false;
+    }
+    level.width = static_cast<uint32_t>(w);
+    level.height = static_cast<uint32_t>(h);
+    level.data.assign(pixels, pixels + size_t(w) * h * 4);
+    stbi_image_free(pixels);
+  }
+
+  BuildMipChain(std::move(level), firstMip, out);
+  return true;
+}
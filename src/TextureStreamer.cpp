@@ -0,0 +1,724 @@
+#include "TextureStreamer.h"
+#include "scene/Scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// Worker threads for decoding; uploads are paced on the render thread
+constexpr unsigned kDecodeThreads = 2;
+
+template <typename T> void Release(T &handle, void (*release)(T)) {
+  if (handle) {
+    release(handle);
+    handle = nullptr;
+  }
+}
+
+bool SameSource(const TextureSource &a, const TextureSource &b) {
+  return a.name == b.name && a.path == b.path && a.width == b.width &&
+         a.height == b.height && a.encoded == b.encoded && a.pixels == b.pixels;
+}
+
+WGPUTexture CreateTexture(WGPUDevice device, const char *label,
+                          WGPUTextureFormat format, uint32_t width,
+                          uint32_t height, uint32_t mipCount) {
+  WGPUTextureDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  // CopySrc so the levels that stay can be moved into the next allocation
+  desc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst |
+               WGPUTextureUsage_CopySrc;
+  desc.dimension = WGPUTextureDimension_2D;
+  desc.size = {width, height, 1};
+  desc.format = format;
+  desc.mipLevelCount = mipCount;
+  desc.sampleCount = 1;
+  return wgpuDeviceCreateTexture(device, &desc);
+}
+
+// Copies of block-compressed levels cover whole blocks, even past the edge
+WGPUExtent3D GetCopyExtent(WGPUTextureFormat format, uint32_t width,
+                           uint32_t height, uint32_t level) {
+  const TextureFormatInfo info = GetTextureFormatInfo(format);
+  const uint32_t w = std::max(1u, width >> level);
+  const uint32_t h = std::max(1u, height >> level);
+  return {(w + info.blockWidth - 1) / info.blockWidth * info.blockWidth,
+          (h + info.blockHeight - 1) / info.blockHeight * info.blockHeight, 1};
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer() {}
+
+TextureStreamer::~TextureStreamer() { Shutdown(); }
+
+bool TextureStreamer::Initialize(WGPUDevice device, WGPUQueue queue) {
+  m_Device = device;
+  m_Queue = queue;
+
+  m_DecodeOptions.bc =
+      wgpuDeviceHasFeature(m_Device, WGPUFeatureName_TextureCompressionBC);
+  m_DecodeOptions.etc2 =
+      wgpuDeviceHasFeature(m_Device, WGPUFeatureName_TextureCompressionETC2);
+  m_DecodeOptions.astc =
+      wgpuDeviceHasFeature(m_Device, WGPUFeatureName_TextureCompressionASTC);
+  const char *cacheDir = std::getenv("RENDERER_TEXTURE_CACHE");
+  std::error_code error;
+  m_DecodeOptions.cacheDirectory =
+      cacheDir ? std::filesystem::path(cacheDir)
+               : std::filesystem::temp_directory_path(error) /
+                     "renderer-texture-cache";
+  if (!cacheDir && error) {
+    m_DecodeOptions.cacheDirectory.clear();
+  }
+  printf("KTX2 transcode targets:%s%s%s RGBA8\n",
+         m_DecodeOptions.bc ? " BC7/BC1" : "",
+         m_DecodeOptions.astc ? " ASTC" : "",
+         m_DecodeOptions.etc2 ? " ETC2" : "");
+
+  WGPUSamplerDescriptor samplerDesc = {};
+  samplerDesc.label = {"Material sampler", WGPU_STRLEN};
+  samplerDesc.addressModeU = WGPUAddressMode_Repeat;
+  samplerDesc.addressModeV = WGPUAddressMode_Repeat;
+  samplerDesc.addressModeW = WGPUAddressMode_Repeat;
+  samplerDesc.magFilter = WGPUFilterMode_Linear;
+  samplerDesc.minFilter = WGPUFilterMode_Linear;
+  samplerDesc.mipmapFilter = WGPUMipmapFilterMode_Linear;
+  samplerDesc.lodMinClamp = 0.0f;
+  samplerDesc.lodMaxClamp = 32.0f;
+  samplerDesc.maxAnisotropy = 8;
+  m_Sampler = wgpuDeviceCreateSampler(m_Device, &samplerDesc);
+
+  // Bound for untextured materials and for textures with nothing resident
+  m_DefaultTexture = CreateTexture(m_Device, "Default white texture",
+                                   WGPUTextureFormat_RGBA8UnormSrgb, 1, 1, 1);
+  m_DefaultView = wgpuTextureCreateView(m_DefaultTexture, nullptr);
+  const uint8_t white[4] = {255, 255, 255, 255};
+  WGPUTexelCopyTextureInfo destination = {};
+  destination.texture = m_DefaultTexture;
+  destination.aspect = WGPUTextureAspect_All;
+  WGPUTexelCopyBufferLayout layout = {};
+  layout.bytesPerRow = 4;
+  layout.rowsPerImage = 1;
+  WGPUExtent3D extent = {1, 1, 1};
+  wgpuQueueWriteTexture(m_Queue, &destination, white, sizeof(white), &layout,
+                        &extent);
+
+  // Staging buffers start out mapped so the first uploads don't wait
+  for (Staging &staging : m_Staging) {
+    WGPUBufferDescriptor desc = {};
+    desc.label = {"Texture staging", WGPU_STRLEN};
+    desc.size = kStagingSize;
+    desc.usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc;
+    desc.mappedAtCreation = true;
+    staging.buffer = wgpuDeviceCreateBuffer(m_Device, &desc);
+    staging.mapped = staging.buffer != nullptr;
+  }
+
+  m_Decoder = std::make_unique<ThreadPool>(kDecodeThreads);
+
+  if (!m_Sampler || !m_DefaultTexture || !m_DefaultView) {
+    fprintf(stderr, "Failed to create texture streaming resources\n");
+    return false;
+  }
+  return true;
+}
+
+void TextureStreamer::Shutdown() {
+  // Joins the decode threads; results still queued are dropped below
+  m_Decoder.reset();
+  {
+    std::lock_guard<std::mutex> lock(m_ResultMutex);
+    m_Results.clear();
+  }
+  m_DecodesInFlight = 0;
+
+  ReleaseTextures();
+  m_Entries.clear();
+
+  for (Staging &staging : m_Staging) {
+    if (staging.buffer && !staging.mapped) {
+      // Aborts a pending map so its callback can't outlive this object
+      wgpuBufferDestroy(staging.buffer);
+    }
+    Release(staging.buffer, wgpuBufferRelease);
+    staging.mapped = false;
+    staging.failed = false;
+  }
+  Release(m_DefaultView, wgpuTextureViewRelease);
+  Release(m_DefaultTexture, wgpuTextureRelease);
+  Release(m_Sampler, wgpuSamplerRelease);
+  m_Device = nullptr;
+  m_Queue = nullptr;
+}
+
+void TextureStreamer::ReleaseImages(Entry &entry) {
+  Release(entry.view, wgpuTextureViewRelease);
+  Release(entry.texture, wgpuTextureRelease);
+  Release(entry.oldView, wgpuTextureViewRelease);
+  Release(entry.oldTexture, wgpuTextureRelease);
+}
+
+void TextureStreamer::ReleaseTextures() {
+  m_Uploads.clear();
+  for (Entry &entry : m_Entries) {
+    ReleaseImages(entry);
+  }
+}
+
+void TextureStreamer::SetTextures(const Scene &scene) {
+  std::vector<Entry> previous = std::move(m_Entries);
+  std::unordered_multimap<std::string_view, uint32_t> byName;
+  for (size_t i = 0; i < previous.size(); ++i) {
+    byName.emplace(previous[i].source->name, static_cast<uint32_t>(i));
+  }
+
+  const auto &sources = scene.GetTextures();
+  std::vector<uint32_t> moved(previous.size(), UINT32_MAX);
+  m_Entries.clear();
+  m_Entries.resize(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    Entry &entry = m_Entries[i];
+    auto [first, last] = byName.equal_range(sources[i].name);
+    auto match = std::find_if(first, last, [&](const auto &candidate) {
+      return SameSource(*previous[candidate.second].source, sources[i]);
+    });
+    if (match != last) {
+      moved[match->second] = static_cast<uint32_t>(i);
+      entry = std::move(previous[match->second]);
+      byName.erase(match);
+      continue;
+    }
+    entry.source = std::make_shared<const TextureSource>(sources[i]);
+    uint32_t width = 0, height = 0;
+    WGPUTextureFormat format = WGPUTextureFormat_RGBA8UnormSrgb;
+    if (ProbeTexture(*entry.source, m_DecodeOptions, width, height, format)) {
+      ResetEntry(entry, width, height, format);
+    }
+  }
+
+  // Decodes still running for dropped textures are discarded when they land
+  for (size_t i = 0; i < previous.size(); ++i) {
+    if (moved[i] == UINT32_MAX) {
+      ReleaseImages(previous[i]);
+    }
+  }
+  std::erase_if(m_Uploads, [&](const Upload &upload) {
+    return moved[upload.texture] == UINT32_MAX;
+  });
+  for (Upload &upload : m_Uploads) {
+    upload.texture = moved[upload.texture];
+  }
+  m_Stats.textures = static_cast<uint32_t>(m_Entries.size());
+}
+
+uint32_t TextureStreamer::GetTailMip(WGPUTextureFormat format, uint32_t width,
+                                     uint32_t height) {
+  // Every allocation starts at the tail or finer, so capping the tail keeps
+  // block-compressed allocations whole blocks
+  const uint32_t maxBaseMip = GetMaxBaseMip(format, width, height);
+  uint32_t tailMip = 0;
+  while (tailMip < maxBaseMip &&
+         std::max(width, height) >> tailMip > kTailSize) {
+    tailMip++;
+  }
+  return tailMip;
+}
+
+void TextureStreamer::ResetEntry(Entry &entry, uint32_t width, uint32_t height,
+                                 WGPUTextureFormat format) {
+  entry.width = width;
+  entry.height = height;
+  entry.format = format;
+  entry.mipCount = GetMipCount(width, height);
+  entry.tailMip = GetTailMip(format, width, height);
+  entry.allocatedMip = entry.mipCount;
+  entry.residentMip = entry.mipCount;
+  entry.frameMip = entry.mipCount;
+  entry.wantedMip = entry.tailMip;
+  entry.targetMip = entry.tailMip;
+}
+
+void TextureStreamer::Reload(uint32_t texture, Clock::time_point changed) {
+  if (texture >= m_Entries.size() || !m_Decoder) {
+    return;
+  }
+  Entry &entry = m_Entries[texture];
+  // Decodes and uploads still in flight are for the old image
+  entry.serial++;
+  entry.busy = true;
+  std::erase_if(m_Uploads, [&](const Upload &upload) {
+    return upload.texture == texture;
+  });
+  if (!entry.reloading) {
+    entry.reloading = true;
+    entry.reloadTime = changed;
+  }
+
+  // Probed again on the worker, as the size or format may have changed
+  m_DecodesInFlight++;
+  std::shared_ptr<const TextureSource> source = entry.source;
+  const uint32_t serial = entry.serial;
+  m_Decoder->submit([this, source, texture, serial] {
+    DecodeResult result;
+    result.source = source;
+    result.texture = texture;
+    result.serial = serial;
+    result.reload = true;
+    uint32_t width = 0, height = 0;
+    WGPUTextureFormat format = WGPUTextureFormat_RGBA8UnormSrgb;
+    if (ProbeTexture(*source, m_DecodeOptions, width, height, format)) {
+      result.ok = DecodeTexture(*source, m_DecodeOptions,
+                                GetTailMip(format, width, height), result.data);
+    }
+    std::lock_guard<std::mutex> lock(m_ResultMutex);
+    m_Results.push_back(std::move(result));
+  });
+}
+
+void TextureStreamer::RequestSize(uint32_t texture, float pixels) {
+  if (texture >= m_Entries.size()) {
+    return;
+  }
+  Entry &entry = m_Entries[texture];
+  if (entry.mipCount == 0) {
+    return;
+  }
+  // One texel per pixel: each halving of the screen size drops a level
+  const float texels = static_cast<float>(std::max(entry.width, entry.height));
+  uint32_t mip = 0;
+  if (pixels < texels) {
+    mip = static_cast<uint32_t>(std::log2(texels / std::max(pixels, 1.0f)));
+  }
+  entry.frameMip = std::min(entry.frameMip, mip);
+}
+
+WGPUTextureView TextureStreamer::GetView(uint32_t texture) const {
+  if (texture < m_Entries.size()) {
+    const Entry &entry = m_Entries[texture];
+    if (entry.oldView) {
+      return entry.oldView;
+    }
+    if (entry.view) {
+      return entry.view;
+    }
+  }
+  return m_DefaultView;
+}
+
+uint32_t TextureStreamer::GetVersion(uint32_t texture) const {
+  return texture < m_Entries.size() ? m_Entries[texture].version : 0;
+}
+
+uint64_t TextureStreamer::ResidentBytes(const Entry &entry) const {
+  if (!entry.texture) {
+    return 0;
+  }
+  return GetMipChainSize(entry.format, entry.width, entry.height,
+                         entry.allocatedMip);
+}
+
+void TextureStreamer::UpdateView(Entry &entry) {
+  Release(entry.view, wgpuTextureViewRelease);
+  if (entry.texture && entry.residentMip < entry.mipCount) {
+    // Only uploaded levels are visible, so sampling never reads a level that
+    // is still in flight
+    WGPUTextureViewDescriptor desc = {};
+    desc.format = entry.format;
+    desc.dimension = WGPUTextureViewDimension_2D;
+    desc.baseMipLevel = entry.residentMip - entry.allocatedMip;
+    desc.mipLevelCount = entry.mipCount - entry.residentMip;
+    desc.arrayLayerCount = 1;
+    desc.aspect = WGPUTextureAspect_All;
+    entry.view = wgpuTextureCreateView(entry.texture, &desc);
+  }
+  entry.version++;
+}
+
+void TextureStreamer::FinishReload(Entry &entry) {
+  // The new image's tail is complete; drop the old one it was standing in for
+  Release(entry.oldView, wgpuTextureViewRelease);
+  Release(entry.oldTexture, wgpuTextureRelease);
+  entry.version++;
+  entry.reloading = false;
+  m_Stats.reloads++;
+  m_Stats.reloadMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - entry.reloadTime)
+          .count();
+  printf("Reloaded texture %s in %.1f ms\n", entry.source->name.c_str(),
+         m_Stats.reloadMs);
+}
+
+void TextureStreamer::Reallocate(WGPUCommandEncoder encoder, Entry &entry,
+                                 uint32_t firstMip) {
+  WGPUTexture texture = CreateTexture(
+      m_Device, entry.source->name.c_str(), entry.format,
+      std::max(1u, entry.width >> firstMip),
+      std::max(1u, entry.height >> firstMip), entry.mipCount - firstMip);
+  if (!texture) {
+    fprintf(stderr, "Failed to allocate texture %s\n",
+            entry.source->name.c_str());
+    return;
+  }
+
+  // Carry over the uploaded levels both allocations have in common
+  const uint32_t keepFrom = std::max(firstMip, entry.residentMip);
+  for (uint32_t level = keepFrom; entry.texture && level < entry.mipCount;
+       ++level) {
+    WGPUTexelCopyTextureInfo src = {};
+    src.texture = entry.texture;
+    src.mipLevel = level - entry.allocatedMip;
+    src.aspect = WGPUTextureAspect_All;
+    WGPUTexelCopyTextureInfo dst = {};
+    dst.texture = texture;
+    dst.mipLevel = level - firstMip;
+    dst.aspect = WGPUTextureAspect_All;
+    WGPUExtent3D extent =
+        GetCopyExtent(entry.format, entry.width, entry.height, level);
+    wgpuCommandEncoderCopyTextureToTexture(encoder, &src, &dst, &extent);
+  }
+
+  // Released rather than destroyed: this frame's earlier commands and any
+  // bind group still using it keep it alive until the GPU is done
+  Release(entry.texture, wgpuTextureRelease);
+  entry.texture = texture;
+  entry.allocatedMip = firstMip;
+  entry.residentMip = entry.residentMip < entry.mipCount ? keepFrom : entry.mipCount;
+  UpdateView(entry);
+}
+
+void TextureStreamer::RequestDecode(uint32_t index, uint32_t firstMip) {
+  Entry &entry = m_Entries[index];
+  entry.busy = true;
+  m_DecodesInFlight++;
+
+  std::shared_ptr<const TextureSource> source = entry.source;
+  const uint32_t serial = entry.serial;
+  m_Decoder->submit([this, source, index, firstMip, serial] {
+    DecodeResult result;
+    result.source = source;
+    result.texture = index;
+    result.serial = serial;
+    result.ok = DecodeTexture(*source, m_DecodeOptions, firstMip, result.data);
+    std::lock_guard<std::mutex> lock(m_ResultMutex);
+    m_Results.push_back(std::move(result));
+  });
+}
+
+void TextureStreamer::CollectDecodes(WGPUCommandEncoder encoder) {
+  std::vector<DecodeResult> results;
+  {
+    std::lock_guard<std::mutex> lock(m_ResultMutex);
+    results.swap(m_Results);
+  }
+
+  for (DecodeResult &result : results) {
+    m_DecodesInFlight--;
+    if (result.texture >= m_Entries.size() ||
+        m_Entries[result.texture].source != result.source) {
+      // Requested before the last SetTextures, which moved or dropped it
+      auto entry = std::find_if(
+          m_Entries.begin(), m_Entries.end(),
+          [&](const Entry &e) { return e.source == result.source; });
+      if (entry == m_Entries.end()) {
+        continue;
+      }
+      result.texture = static_cast<uint32_t>(entry - m_Entries.begin());
+    }
+    Entry &entry = m_Entries[result.texture];
+    if (result.serial != entry.serial) {
+      continue; // superseded by a reload
+    }
+    entry.busy = false;
+    if (result.reload) {
+      if (!result.ok || result.data.mips.empty()) {
+        // Most likely caught mid-write; keep showing the old image. If an
+        // earlier reload already set it aside, streaming finishes that
+        // reload's tail and the swap happens then.
+        entry.reloading = entry.oldTexture != nullptr;
+        continue;
+      }
+      // Set the current image aside, still bound, and stream the new one
+      // into a fresh allocation; they swap once its tail is uploaded
+      const uint32_t wantedMip = entry.wantedMip;
+      if (!entry.oldTexture) {
+        entry.oldTexture = entry.texture;
+        entry.oldView = entry.view;
+        entry.texture = nullptr;
+        entry.view = nullptr;
+      } else {
+        // Part of an earlier reload that was never shown
+        Release(entry.view, wgpuTextureViewRelease);
+        Release(entry.texture, wgpuTextureRelease);
+      }
+      ResetEntry(entry, result.data.width, result.data.height,
+                 result.data.format);
+      entry.wantedMip = std::min(wantedMip, entry.tailMip);
+    }
+    if (!result.ok || result.data.mips.empty() ||
+        result.data.width != entry.width || result.data.height != entry.height ||
+        result.data.format != entry.format) {
+      // Stop streaming it and fall back to the default texture
+      if (result.ok) {
+        fprintf(stderr, "Texture %s changed since it was probed\n",
+                entry.source->name.c_str());
+      }
+      ReleaseImages(entry);
+      entry.mipCount = 0;
+      entry.reloading = false;
+      entry.version++;
+      continue;
+    }
+
+    // Levels finer than what's resident are new; coarser ones are skipped
+    const uint32_t firstMip = result.data.firstMip;
+    const int start =
+        static_cast<int>(std::min(entry.residentMip, entry.mipCount)) - 1 -
+        static_cast<int>(firstMip);
+    if (start < 0) {
+      continue;
+    }
+    if (!entry.texture || firstMip < entry.allocatedMip) {
+      Reallocate(encoder, entry, firstMip);
+      if (entry.allocatedMip != firstMip) {
+        continue;
+      }
+    }
+
+    Upload upload;
+    upload.texture = result.texture;
+    upload.data = std::move(result.data);
+    upload.level = start;
+    entry.busy = true;
+    m_Uploads.push_back(std::move(upload));
+  }
+}
+
+void TextureStreamer::PumpUploads(WGPUCommandEncoder encoder,
+                                  std::vector<Staging *> &used) {
+  while (!m_Uploads.empty() &&
+         m_Stats.uploadedBytes < kMaxUploadBytesPerFrame) {
+    // Next staging buffer whose previous copy has retired
+    Staging *staging = nullptr;
+    for (uint32_t i = 0; i < kStagingBuffers && !staging; ++i) {
+      Staging &slot = m_Staging[(m_StagingIndex + i) % kStagingBuffers];
+      if (slot.mapped) {
+        staging = &slot;
+        m_StagingIndex = (m_StagingIndex + i + 1) % kStagingBuffers;
+      }
+    }
+    if (!staging) {
+      break;
+    }
+
+    auto *mapped = static_cast<uint8_t *>(
+        wgpuBufferGetMappedRange(staging->buffer, 0, kStagingSize));
+    uint64_t offset = 0;
+    while (!m_Uploads.empty() &&
+           m_Stats.uploadedBytes < kMaxUploadBytesPerFrame) {
+      Upload &upload = m_Uploads.front();
+      Entry &entry = m_Entries[upload.texture];
+      const TextureMip &mip = upload.data.mips[upload.level];
+      const TextureFormatInfo info = GetTextureFormatInfo(upload.data.format);
+      const uint32_t blocksX = (mip.width + info.blockWidth - 1) / info.blockWidth;
+      const uint32_t blocksY =
+          (mip.height + info.blockHeight - 1) / info.blockHeight;
+      const uint32_t rowBytes = blocksX * info.bytesPerBlock;
+      // Buffer-to-texture copies need 256-byte aligned rows
+      const uint32_t pitch = (rowBytes + 255) & ~255u;
+      const uint32_t rows = static_cast<uint32_t>(
+          std::min<uint64_t>(blocksY - upload.row, (kStagingSize - offset) / pitch));
+      if (rows == 0) {
+        break;
+      }
+
+      for (uint32_t r = 0; r < rows; ++r) {
+        std::memcpy(mapped + offset + uint64_t(r) * pitch,
+                    mip.data.data() + uint64_t(upload.row + r) * rowBytes,
+                    rowBytes);
+      }
+      WGPUTexelCopyBufferInfo src = {};
+      src.buffer = staging->buffer;
+      src.layout.offset = offset;
+      src.layout.bytesPerRow = pitch;
+      src.layout.rowsPerImage = rows;
+      WGPUTexelCopyTextureInfo dst = {};
+      dst.texture = entry.texture;
+      dst.mipLevel = upload.data.firstMip + upload.level - entry.allocatedMip;
+      dst.origin = {0, upload.row * info.blockHeight, 0};
+      dst.aspect = WGPUTextureAspect_All;
+      WGPUExtent3D extent = {blocksX * info.blockWidth, rows * info.blockHeight,
+                             1};
+      wgpuCommandEncoderCopyBufferToTexture(encoder, &src, &dst, &extent);
+
+      offset += uint64_t(rows) * pitch;
+      m_Stats.uploadedBytes += uint64_t(rows) * rowBytes;
+      upload.row += rows;
+      if (upload.row < blocksY) {
+        continue;
+      }
+
+      // Level complete: expose it and move to the next finer one
+      entry.residentMip = upload.data.firstMip + upload.level;
+      UpdateView(entry);
+      if (entry.reloading && entry.residentMip <= entry.tailMip) {
+        FinishReload(entry);
+      }
+      upload.row = 0;
+      if (--upload.level < 0) {
+        entry.busy = false;
+        m_Uploads.pop_front();
+      }
+    }
+
+    wgpuBufferUnmap(staging->buffer);
+    staging->mapped = false;
+    used.push_back(staging);
+  }
+}
+
+void TextureStreamer::ChooseTargets() {
+  auto bytesWithBias = [&](uint32_t bias) {
+    uint64_t bytes = 0;
+    for (const Entry &entry : m_Entries) {
+      if (entry.mipCount > 0) {
+        bytes += GetMipChainSize(entry.format, entry.width, entry.height,
+                                 std::min(entry.wantedMip + bias, entry.tailMip));
+      }
+    }
+    return bytes;
+  };
+
+  // Smallest uniform bias that fits; the tails alone may still exceed a tiny
+  // budget, in which case everything sits at its tail
+  uint32_t bias = 0;
+  m_Stats.wantedBytes = bytesWithBias(0);
+  uint64_t bytes = m_Stats.wantedBytes;
+  while (bytes > m_Budget && bias < 16) {
+    bytes = bytesWithBias(++bias);
+  }
+  for (Entry &entry : m_Entries) {
+    entry.targetMip = std::min(entry.wantedMip + bias, entry.tailMip);
+  }
+  m_Stats.budgetBias = bias;
+}
+
+void TextureStreamer::Update(bool feedbackValid) {
+  m_Frame++;
+  m_Stats.uploadedBytes = 0;
+  m_Stats.mipBiasMisses = 0;
+  if (!m_Device) {
+    return;
+  }
+
+  WGPUCommandEncoderDescriptor encDesc = {};
+  encDesc.label = {"Texture streaming", WGPU_STRLEN};
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_Device, &encDesc);
+
+  CollectDecodes(encoder);
+  std::vector<Staging *> used;
+  PumpUploads(encoder, used);
+
+  for (Entry &entry : m_Entries) {
+    if (entry.mipCount == 0) {
+      continue;
+    }
+    if (feedbackValid) {
+      if (entry.frameMip < entry.mipCount) {
+        entry.wantedMip = std::min(entry.frameMip, entry.tailMip);
+        entry.lastSeen = m_Frame;
+        m_Stats.mipBiasMisses += entry.residentMip > entry.wantedMip;
+      } else if (m_Frame - entry.lastSeen > kFeedbackHoldFrames) {
+        entry.wantedMip = entry.tailMip;
+      }
+    }
+    entry.frameMip = entry.mipCount;
+  }
+  ChooseTargets();
+
+  // Every tail is requested before any texture is refined
+  for (uint32_t i = 0; i < m_Entries.size(); ++i) {
+    Entry &entry = m_Entries[i];
+    if (entry.mipCount > 0 && !entry.busy && entry.residentMip >= entry.mipCount &&
+        m_DecodesInFlight < kMaxDecodesInFlight) {
+      RequestDecode(i, entry.tailMip);
+    }
+  }
+  for (uint32_t i = 0; i < m_Entries.size(); ++i) {
+    Entry &entry = m_Entries[i];
+    if (entry.mipCount == 0 || entry.busy || entry.residentMip >= entry.mipCount) {
+      continue;
+    }
+    if (entry.targetMip > entry.allocatedMip) {
+      // Lowering needs no decode; the coarser levels are already on the GPU
+      Reallocate(encoder, entry, entry.targetMip);
+    } else if (entry.targetMip < entry.residentMip &&
+               m_DecodesInFlight < kMaxDecodesInFlight) {
+      RequestDecode(i, entry.targetMip);
+    }
+  }
+
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, nullptr);
+  wgpuQueueSubmit(m_Queue, 1, &commands);
+  wgpuCommandBufferRelease(commands);
+  wgpuCommandEncoderRelease(encoder);
+
+  // Remap the staging buffers used this frame once their copies retire, and
+  // retry those whose last map failed so the ring doesn't shrink
+  for (Staging &staging : m_Staging) {
+    if (staging.buffer && staging.failed.exchange(false)) {
+      used.push_back(&staging);
+    }
+  }
+  for (Staging *staging : used) {
+    WGPUBufferMapCallbackInfo callbackInfo = {};
+    callbackInfo.mode = WGPUCallbackMode_AllowSpontaneous;
+    callbackInfo.callback = OnStagingMapped;
+    callbackInfo.userdata1 = this;
+    callbackInfo.userdata2 = staging;
+    wgpuBufferMapAsync(staging->buffer, WGPUMapMode_Write, 0, kStagingSize,
+                       callbackInfo);
+  }
+
+  m_Stats.textures = static_cast<uint32_t>(m_Entries.size());
+  m_Stats.budgetBytes = m_Budget;
+  m_Stats.residentBytes = 0;
+  m_Stats.compressedTextures = 0;
+  m_Stats.uncompressedBytes = 0;
+  for (const Entry &entry : m_Entries) {
+    const uint64_t bytes = ResidentBytes(entry);
+    m_Stats.residentBytes += bytes;
+    if (entry.mipCount > 0 &&
+        GetTextureFormatInfo(entry.format).blockWidth > 1) {
+      m_Stats.compressedTextures++;
+    }
+    m_Stats.uncompressedBytes +=
+        entry.texture ? GetMipChainSize(WGPUTextureFormat_RGBA8UnormSrgb,
+                                        entry.width, entry.height,
+                                        entry.allocatedMip)
+                      : 0;
+  }
+  m_Stats.pendingRequests = m_DecodesInFlight;
+  m_Stats.pendingUploads = static_cast<uint32_t>(m_Uploads.size());
+}
+
+void TextureStreamer::OnStagingMapped(WGPUMapAsyncStatus status,
+                                      WGPUStringView message, void *,
+                                      void *userdata2) {
+  auto *staging = static_cast<Staging *>(userdata2);
+  if (status != WGPUMapAsyncStatus_Success) {
+    // Shutdown aborts pending maps on purpose
+    if (status != WGPUMapAsyncStatus_Aborted) {
+      fprintf(stderr, "Failed to map texture staging buffer: %s\n",
+              message.data ? message.data : "");
+    }
+    staging->failed = true;
+    return;
+  }
+  staging->mapped = true;
+}
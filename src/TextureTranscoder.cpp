@@ -0,0 +1,280 @@
+#include "TextureTranscoder.h"
+#include <algorithm>
+#include <basisu/transcoder/basisu_transcoder.h>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+
+namespace {
+
+constexpr uint8_t kKtx2Identifier[12] = {0xAB, 'K',  'T',  'X',  ' ',  '2',
+                                         '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+
+// Bump the version whenever the layout or the transcode targets change
+constexpr uint32_t kCacheMagic = 0x43585452; // "RTXC"
+constexpr uint32_t kCacheVersion = 1;
+
+struct CacheHeader {
+  uint32_t magic = kCacheMagic;
+  uint32_t version = kCacheVersion;
+  uint64_t key = 0;
+  uint32_t format = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mipCount = 0;
+};
+
+struct Target {
+  basist::transcoder_texture_format transcoder;
+  WGPUTextureFormat format;
+};
+
+void InitTranscoder() {
+  static std::once_flag once;
+  std::call_once(once, [] { basist::basisu_transcoder_init(); });
+}
+
+bool Open(const std::string &name, const std::vector<uint8_t> &data,
+          basist::ktx2_transcoder &ktx2) {
+  InitTranscoder();
+  if (!ktx2.init(data.data(), static_cast<uint32_t>(data.size()))) {
+    fprintf(stderr, "Texture %s is not a Basis Universal KTX2 file\n",
+            name.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Opaque ETC1S maps onto the 4 bpp formats at no loss; UASTC and alpha need
+// the 8 bpp ones
+Target ChooseTarget(const TextureDecodeOptions &options,
+                    const basist::ktx2_transcoder &ktx2) {
+  using basist::transcoder_texture_format;
+  const bool rgba = ktx2.get_has_alpha() ||
+                    ktx2.get_format() != basist::basis_tex_format::cETC1S;
+  Target target = {transcoder_texture_format::cTFRGBA32,
+                   WGPUTextureFormat_RGBA8UnormSrgb};
+  if (options.bc) {
+    target = rgba ? Target{transcoder_texture_format::cTFBC7_RGBA,
+                           WGPUTextureFormat_BC7RGBAUnormSrgb}
+                  : Target{transcoder_texture_format::cTFBC1_RGB,
+                           WGPUTextureFormat_BC1RGBAUnormSrgb};
+  } else if (options.astc) {
+    target = {transcoder_texture_format::cTFASTC_4x4_RGBA,
+              WGPUTextureFormat_ASTC4x4UnormSrgb};
+  } else if (options.etc2) {
+    // ETC1 is a subset of ETC2 RGB8
+    target = rgba ? Target{transcoder_texture_format::cTFETC2_RGBA,
+                           WGPUTextureFormat_ETC2RGBA8UnormSrgb}
+                  : Target{transcoder_texture_format::cTFETC1_RGB,
+                           WGPUTextureFormat_ETC2RGB8UnormSrgb};
+  }
+
+  // A block texture needs its whole chain and whole blocks at level 0; the
+  // RGBA8 path rebuilds the chain from level 0 instead
+  const TextureFormatInfo info = GetTextureFormatInfo(target.format);
+  const uint32_t width = ktx2.get_width();
+  const uint32_t height = ktx2.get_height();
+  if (std::max(1u, ktx2.get_levels()) != GetMipCount(width, height) ||
+      width % info.blockWidth != 0 || height % info.blockHeight != 0) {
+    target = {transcoder_texture_format::cTFRGBA32,
+              WGPUTextureFormat_RGBA8UnormSrgb};
+  }
+  return target;
+}
+
+bool TranscodeLevel(const std::string &name, basist::ktx2_transcoder &ktx2,
+                    uint32_t level, const Target &target, TextureMip &mip) {
+  basist::ktx2_image_level_info info;
+  if (!ktx2.get_image_level_info(info, level, 0, 0)) {
+    fprintf(stderr, "Texture %s has no level %u\n", name.c_str(), level);
+    return false;
+  }
+  mip.width = info.m_orig_width;
+  mip.height = info.m_orig_height;
+  // Sized in pixels for uncompressed targets and in blocks otherwise
+  const uint32_t units =
+      basist::basis_transcoder_format_is_uncompressed(target.transcoder)
+          ? info.m_orig_width * info.m_orig_height
+          : info.m_total_blocks;
+  mip.data.resize(size_t(units) *
+                  basist::basis_get_bytes_per_block_or_pixel(target.transcoder));
+  if (!ktx2.transcode_image_level(level, 0, 0, mip.data.data(), units,
+                                  target.transcoder)) {
+    fprintf(stderr, "Failed to transcode level %u of texture %s\n", level,
+            name.c_str());
+    return false;
+  }
+  return true;
+}
+
+uint64_t HashBytes(const uint8_t *data, size_t size) {
+  // FNV-1a over 8-byte words, with an extra fold since words mix poorly
+  uint64_t hash = 0xcbf29ce484222325ull ^ size;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ull;
+    hash ^= hash >> 29;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+bool ReadCache(const std::filesystem::path &path, const CacheHeader &expected,
+               uint32_t firstMip, DecodedTexture &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  CacheHeader header;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+    return false;
+  }
+
+  const auto format = static_cast<WGPUTextureFormat>(header.format);
+  const uint64_t skipped = GetMipChainSize(format, header.width, header.height, 0) -
+                           GetMipChainSize(format, header.width, header.height,
+                                           firstMip);
+  file.seekg(static_cast<std::streamoff>(sizeof(header) + skipped));
+  out.mips.clear();
+  for (uint32_t level = firstMip; level < header.mipCount; ++level) {
+    TextureMip mip;
+    mip.width = std::max(1u, header.width >> level);
+    mip.height = std::max(1u, header.height >> level);
+    mip.data.resize(GetMipSize(format, mip.width, mip.height));
+    file.read(reinterpret_cast<char *>(mip.data.data()),
+              static_cast<std::streamsize>(mip.data.size()));
+    out.mips.push_back(std::move(mip));
+  }
+  return static_cast<bool>(file);
+}
+
+void WriteCache(const std::filesystem::path &path, const CacheHeader &header,
+                const std::vector<TextureMip> &mips) {
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+
+  // Written under a per-thread name and renamed into place, so readers and
+  // other decodes of the same image never see a partial file
+  std::filesystem::path temp = path;
+  temp += "." +
+          std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+          ".tmp";
+  {
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const TextureMip &mip : mips) {
+      file.write(reinterpret_cast<const char *>(mip.data.data()),
+                 static_cast<std::streamsize>(mip.data.size()));
+    }
+    if (!file) {
+      file.close();
+      std::filesystem::remove(temp, error);
+      fprintf(stderr, "Failed to write texture cache %s\n",
+              temp.string().c_str());
+      return;
+    }
+  }
+  std::filesystem::rename(temp, path, error);
+  if (error) {
+    std::filesystem::remove(temp, error);
+  }
+}
+
+} // namespace
+
+bool IsKtx2(const uint8_t *data, size_t size) {
+  return size >= sizeof(kKtx2Identifier) &&
+         std::memcmp(data, kKtx2Identifier, sizeof(kKtx2Identifier)) == 0;
+}
+
+bool ProbeKtx2(const std::string &name, const std::vector<uint8_t> &data,
+               const TextureDecodeOptions &options, uint32_t &width,
+               uint32_t &height, WGPUTextureFormat &format) {
+  basist::ktx2_transcoder ktx2;
+  if (!Open(name, data, ktx2)) {
+    return false;
+  }
+  width = ktx2.get_width();
+  height = ktx2.get_height();
+  format = ChooseTarget(options, ktx2).format;
+  return width > 0 && height > 0;
+}
+
+bool TranscodeKtx2(const std::string &name, const std::vector<uint8_t> &data,
+                   const TextureDecodeOptions &options, uint32_t firstMip,
+                   DecodedTexture &out) {
+  basist::ktx2_transcoder ktx2;
+  if (!Open(name, data, ktx2)) {
+    return false;
+  }
+  const Target target = ChooseTarget(options, ktx2);
+  out.format = target.format;
+  out.width = ktx2.get_width();
+  out.height = ktx2.get_height();
+  out.firstMip = 0;
+  out.mips.clear();
+
+  if (target.format == WGPUTextureFormat_RGBA8UnormSrgb) {
+    TextureMip level;
+    if (!ktx2.start_transcoding() ||
+        !TranscodeLevel(name, ktx2, 0, target, level)) {
+      return false;
+    }
+    out.mips.push_back(std::move(level));
+    return true;
+  }
+
+  const uint32_t mipCount = GetMipCount(out.width, out.height);
+  out.firstMip = std::min(firstMip, mipCount - 1);
+
+  std::filesystem::path cachePath;
+  CacheHeader header;
+  if (!options.cacheDirectory.empty()) {
+    header.key = HashBytes(data.data(), data.size()) * 31 +
+                 static_cast<uint64_t>(target.transcoder);
+    header.format = static_cast<uint32_t>(target.format);
+    header.width = out.width;
+    header.height = out.height;
+    header.mipCount = mipCount;
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "%016llx.texcache",
+             static_cast<unsigned long long>(header.key));
+    cachePath = options.cacheDirectory / fileName;
+    if (ReadCache(cachePath, header, out.firstMip, out)) {
+      return true;
+    }
+  }
+
+  if (!ktx2.start_transcoding()) {
+    fprintf(stderr, "Failed to start transcoding texture %s\n", name.c_str());
+    return false;
+  }
+  // A cache miss transcodes the whole chain once so every later residency
+  // change is a plain read
+  const uint32_t first = cachePath.empty() ? out.firstMip : 0;
+  std::vector<TextureMip> mips;
+  mips.reserve(mipCount - first);
+  for (uint32_t level = first; level < mipCount; ++level) {
+    TextureMip mip;
+    if (!TranscodeLevel(name, ktx2, level, target, mip)) {
+      return false;
+    }
+    mips.push_back(std::move(mip));
+  }
+  if (!cachePath.empty()) {
+    WriteCache(cachePath, header, mips);
+  }
+  out.mips.assign(std::make_move_iterator(mips.begin() + (out.firstMip - first)),
+                  std::make_move_iterator(mips.end()));
+  return true;
+}
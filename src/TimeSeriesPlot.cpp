@@ -0,0 +1,726 @@
+#include "TimeSeriesPlot.h"
+#include "GpuTimer.h"
+#include "imgui.h"
+#include "imgui_impl_wgpu.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdio.h>
+
+namespace {
+
+// One workgroup per pixel column reduces that column's slice of the visible
+// samples to their min and max. With fewer samples than columns each column
+// instead spans the line interpolated across it. A second, single-workgroup
+// dispatch then folds the columns into the range of the visible window.
+const char *kReduceShader = R"(
+struct Params {
+  base : u32,
+  first : u32,
+  count : u32,
+  columns : u32,
+  capacity : u32,
+};
+
+@group(0) @binding(0) var<uniform> params : Params;
+@group(0) @binding(1) var<storage, read> samples : array<f32>;
+@group(0) @binding(2) var<storage, read_write> columns : array<vec2<f32>>;
+@group(0) @binding(3) var<storage, read_write> range : vec2<f32>;
+
+var<workgroup> lows : array<f32, 64>;
+var<workgroup> highs : array<f32, 64>;
+
+fn load(i : u32) -> f32 {
+  return samples[(params.base + params.first + i) % params.capacity];
+}
+
+fn interpolate(x : f32) -> f32 {
+  let i = min(u32(x), params.count - 1u);
+  return mix(load(i), load(min(i + 1u, params.count - 1u)), fract(x));
+}
+
+@compute @workgroup_size(64)
+fn reduce_main(@builtin(workgroup_id) group : vec3<u32>,
+               @builtin(local_invocation_index) lane : u32) {
+  let column = group.x;
+  let perColumn = params.count / params.columns;
+  if (perColumn == 0u) {
+    if (lane == 0u) {
+      let spacing = f32(params.count - 1u) / f32(params.columns);
+      let a = interpolate(f32(column) * spacing);
+      let b = interpolate(f32(column + 1u) * spacing);
+      columns[column] = vec2<f32>(min(a, b), max(a, b));
+    }
+    return;
+  }
+
+  // Spread the remainder over the first columns
+  let remainder = params.count % params.columns;
+  let begin = column * perColumn + min(column, remainder);
+  let end = begin + perColumn + select(0u, 1u, column < remainder);
+  var low = 3.4e38;
+  var high = -3.4e38;
+  for (var i = begin + lane; i < end; i += 64u) {
+    let value = load(i);
+    low = min(low, value);
+    high = max(high, value);
+  }
+  lows[lane] = low;
+  highs[lane] = high;
+  workgroupBarrier();
+
+  for (var stride = 32u; stride > 0u; stride >>= 1u) {
+    if (lane < stride) {
+      lows[lane] = min(lows[lane], lows[lane + stride]);
+      highs[lane] = max(highs[lane], highs[lane + stride]);
+    }
+    workgroupBarrier();
+  }
+  if (lane == 0u) {
+    columns[column] = vec2<f32>(lows[0], highs[0]);
+  }
+}
+
+@compute @workgroup_size(64)
+fn range_main(@builtin(local_invocation_index) lane : u32) {
+  var low = 3.4e38;
+  var high = -3.4e38;
+  for (var i = lane; i < params.columns; i += 64u) {
+    low = min(low, columns[i].x);
+    high = max(high, columns[i].y);
+  }
+  lows[lane] = low;
+  highs[lane] = high;
+  workgroupBarrier();
+
+  for (var stride = 32u; stride > 0u; stride >>= 1u) {
+    if (lane < stride) {
+      lows[lane] = min(lows[lane], lows[lane + stride]);
+      highs[lane] = max(highs[lane], highs[lane + stride]);
+    }
+    workgroupBarrier();
+  }
+  if (lane == 0u) {
+    range = vec2<f32>(lows[0], highs[0]);
+  }
+}
+)";
+
+// A quad over the plot rect; each fragment is lit if its value lies within
+// its column's span, widened to meet the previous column so steep edges
+// stay connected. The visible range spans the height with a little headroom.
+const char *kDrawShader = R"(
+struct Params {
+  rect : vec4<f32>,
+  color : vec4<f32>,
+  columns : u32,
+  height : f32,
+};
+
+@group(0) @binding(0) var<uniform> params : Params;
+@group(0) @binding(1) var<storage, read> columns : array<vec2<f32>>;
+@group(0) @binding(2) var<storage, read> range : vec2<f32>;
+
+struct VertexOutput {
+  @builtin(position) position : vec4<f32>,
+  @location(0) uv : vec2<f32>,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index : u32) -> VertexOutput {
+  let corner = vec2<f32>(f32(index & 1u), f32(index >> 1u));
+  var out : VertexOutput;
+  out.position = vec4<f32>(mix(params.rect.x, params.rect.z, corner.x),
+                           mix(params.rect.y, params.rect.w, corner.y), 0.0,
+                           1.0);
+  out.uv = corner;
+  return out;
+}
+
+@fragment
+fn fs_main(in : VertexOutput) -> @location(0) vec4<f32> {
+  let column = min(u32(in.uv.x * f32(params.columns)), params.columns - 1u);
+  var span = columns[column];
+  if (column > 0u) {
+    let previous = columns[column - 1u];
+    span = vec2<f32>(min(span.x, previous.y), max(span.y, previous.x));
+  }
+  let margin = select(0.5, (range.y - range.x) * 0.05, range.y > range.x);
+  let low = range.x - margin;
+  let high = range.y + margin;
+  let value = mix(high, low, in.uv.y);
+  let halfWidth = 0.75 * (high - low) / params.height;
+  if (value < span.x - halfWidth || value > span.y + halfWidth) {
+    discard;
+  }
+  return params.color;
+}
+)";
+
+template <typename T> void Release(T &handle, void (*release)(T)) {
+  if (handle) {
+    release(handle);
+    handle = nullptr;
+  }
+}
+
+WGPUShaderModule CreateShaderModule(WGPUDevice device, const char *label,
+                                    const char *code) {
+  WGPUShaderSourceWGSL wgsl = {};
+  wgsl.chain.sType = WGPUSType_ShaderSourceWGSL;
+  wgsl.code = {code, WGPU_STRLEN};
+  WGPUShaderModuleDescriptor desc = {};
+  desc.nextInChain = &wgsl.chain;
+  desc.label = {label, WGPU_STRLEN};
+  return wgpuDeviceCreateShaderModule(device, &desc);
+}
+
+WGPUBuffer CreateBuffer(WGPUDevice device, const char *label, uint64_t size,
+                        WGPUBufferUsage usage) {
+  WGPUBufferDescriptor desc = {};
+  desc.label = {label, WGPU_STRLEN};
+  desc.size = size;
+  desc.usage = usage;
+  return wgpuDeviceCreateBuffer(device, &desc);
+}
+
+} // namespace
+
+TimeSeriesPlot::TimeSeriesPlot() {}
+
+TimeSeriesPlot::~TimeSeriesPlot() { Shutdown(); }
+
+bool TimeSeriesPlot::Initialize(WGPUDevice device, WGPUQueue queue,
+                                WGPUTextureFormat targetFormat) {
+  m_Device = device;
+  m_Queue = queue;
+  // Colours are given in display space, like ImGui's
+  m_Gamma = targetFormat == WGPUTextureFormat_RGBA8UnormSrgb ||
+                    targetFormat == WGPUTextureFormat_BGRA8UnormSrgb
+                ? 2.2f
+                : 1.0f;
+
+  m_ReduceUniforms =
+      CreateBuffer(m_Device, "Plot reduce params", sizeof(ReduceParams),
+                   WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst);
+  m_DrawUniforms =
+      CreateBuffer(m_Device, "Plot draw params", sizeof(DrawParams),
+                   WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst);
+  m_Columns = CreateBuffer(m_Device, "Plot columns",
+                           uint64_t(kMaxColumns) * 2 * sizeof(float),
+                           WGPUBufferUsage_Storage);
+  m_Range = CreateBuffer(m_Device, "Plot range", 2 * sizeof(float),
+                         WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc);
+  m_RangeReadback =
+      CreateBuffer(m_Device, "Plot range readback", 2 * sizeof(float),
+                   WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst);
+  if (!m_ReduceUniforms || !m_DrawUniforms || !m_Columns || !m_Range ||
+      !m_RangeReadback || !CreatePipelines(targetFormat)) {
+    fprintf(stderr, "Failed to create time series plot resources\n");
+    return false;
+  }
+
+  WGPUBindGroupEntry entries[3] = {};
+  entries[0].binding = 0;
+  entries[0].buffer = m_DrawUniforms;
+  entries[0].size = sizeof(DrawParams);
+  entries[1].binding = 1;
+  entries[1].buffer = m_Columns;
+  entries[1].size = WGPU_WHOLE_SIZE;
+  entries[2].binding = 2;
+  entries[2].buffer = m_Range;
+  entries[2].size = WGPU_WHOLE_SIZE;
+  WGPUBindGroupDescriptor groupDesc = {};
+  groupDesc.label = {"Plot draw", WGPU_STRLEN};
+  groupDesc.layout = m_DrawLayout;
+  groupDesc.entryCount = 3;
+  groupDesc.entries = entries;
+  m_DrawBindGroup = wgpuDeviceCreateBindGroup(m_Device, &groupDesc);
+  return m_DrawBindGroup != nullptr;
+}
+
+void TimeSeriesPlot::Shutdown() {
+  Release(m_ReduceBindGroup, wgpuBindGroupRelease);
+  Release(m_DrawBindGroup, wgpuBindGroupRelease);
+  Release(m_Samples, wgpuBufferRelease);
+  Release(m_Columns, wgpuBufferRelease);
+  Release(m_Range, wgpuBufferRelease);
+  if (m_RangeReadback && m_ReadbackBusy) {
+    // Aborts the pending map so its callback can't outlive this object
+    wgpuBufferDestroy(m_RangeReadback);
+  }
+  Release(m_RangeReadback, wgpuBufferRelease);
+  m_ReadbackBusy = false;
+  m_RangeStale = false;
+  Release(m_ReduceUniforms, wgpuBufferRelease);
+  Release(m_DrawUniforms, wgpuBufferRelease);
+  Release(m_ReducePipeline, wgpuComputePipelineRelease);
+  Release(m_RangePipeline, wgpuComputePipelineRelease);
+  Release(m_DrawPipeline, wgpuRenderPipelineRelease);
+  Release(m_ReduceLayout, wgpuBindGroupLayoutRelease);
+  Release(m_DrawLayout, wgpuBindGroupLayoutRelease);
+  m_Capacity = 0;
+  m_Stored = 0;
+  m_Head = 0;
+  m_Frame = {};
+  m_Device = nullptr;
+  m_Queue = nullptr;
+}
+
+bool TimeSeriesPlot::CreatePipelines(WGPUTextureFormat targetFormat) {
+  WGPUBindGroupLayoutEntry reduceEntries[4] = {};
+  reduceEntries[0].binding = 0;
+  reduceEntries[0].visibility = WGPUShaderStage_Compute;
+  reduceEntries[0].buffer.type = WGPUBufferBindingType_Uniform;
+  reduceEntries[1].binding = 1;
+  reduceEntries[1].visibility = WGPUShaderStage_Compute;
+  reduceEntries[1].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+  reduceEntries[2].binding = 2;
+  reduceEntries[2].visibility = WGPUShaderStage_Compute;
+  reduceEntries[2].buffer.type = WGPUBufferBindingType_Storage;
+  reduceEntries[3].binding = 3;
+  reduceEntries[3].visibility = WGPUShaderStage_Compute;
+  reduceEntries[3].buffer.type = WGPUBufferBindingType_Storage;
+  WGPUBindGroupLayoutDescriptor reduceDesc = {};
+  reduceDesc.label = {"Plot reduce layout", WGPU_STRLEN};
+  reduceDesc.entryCount = 4;
+  reduceDesc.entries = reduceEntries;
+  m_ReduceLayout = wgpuDeviceCreateBindGroupLayout(m_Device, &reduceDesc);
+
+  WGPUBindGroupLayoutEntry drawEntries[3] = {};
+  drawEntries[0].binding = 0;
+  drawEntries[0].visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment;
+  drawEntries[0].buffer.type = WGPUBufferBindingType_Uniform;
+  drawEntries[1].binding = 1;
+  drawEntries[1].visibility = WGPUShaderStage_Fragment;
+  drawEntries[1].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+  drawEntries[2].binding = 2;
+  drawEntries[2].visibility = WGPUShaderStage_Fragment;
+  drawEntries[2].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+  WGPUBindGroupLayoutDescriptor drawDesc = {};
+  drawDesc.label = {"Plot draw layout", WGPU_STRLEN};
+  drawDesc.entryCount = 3;
+  drawDesc.entries = drawEntries;
+  m_DrawLayout = wgpuDeviceCreateBindGroupLayout(m_Device, &drawDesc);
+
+  WGPUShaderModule reduce =
+      CreateShaderModule(m_Device, "Plot reduce shader", kReduceShader);
+  WGPUShaderModule draw =
+      CreateShaderModule(m_Device, "Plot draw shader", kDrawShader);
+  if (m_ReduceLayout && m_DrawLayout && reduce && draw) {
+    WGPUPipelineLayoutDescriptor layoutDesc = {};
+    layoutDesc.bindGroupLayoutCount = 1;
+    layoutDesc.bindGroupLayouts = &m_ReduceLayout;
+    WGPUPipelineLayout reduceLayout =
+        wgpuDeviceCreatePipelineLayout(m_Device, &layoutDesc);
+    WGPUComputePipelineDescriptor computeDesc = {};
+    computeDesc.label = {"Plot reduce pipeline", WGPU_STRLEN};
+    computeDesc.layout = reduceLayout;
+    computeDesc.compute.module = reduce;
+    computeDesc.compute.entryPoint = {"reduce_main", WGPU_STRLEN};
+    m_ReducePipeline = wgpuDeviceCreateComputePipeline(m_Device, &computeDesc);
+    computeDesc.label = {"Plot range pipeline", WGPU_STRLEN};
+    computeDesc.compute.entryPoint = {"range_main", WGPU_STRLEN};
+    m_RangePipeline = wgpuDeviceCreateComputePipeline(m_Device, &computeDesc);
+    wgpuPipelineLayoutRelease(reduceLayout);
+
+    layoutDesc.bindGroupLayouts = &m_DrawLayout;
+    WGPUPipelineLayout drawLayout =
+        wgpuDeviceCreatePipelineLayout(m_Device, &layoutDesc);
+
+    WGPUBlendState blend = {};
+    blend.color.operation = WGPUBlendOperation_Add;
+    blend.color.srcFactor = WGPUBlendFactor_SrcAlpha;
+    blend.color.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha;
+    blend.alpha.operation = WGPUBlendOperation_Add;
+    blend.alpha.srcFactor = WGPUBlendFactor_One;
+    blend.alpha.dstFactor = WGPUBlendFactor_OneMinusSrcAlpha;
+    WGPUColorTargetState colorTarget = {};
+    colorTarget.format = targetFormat;
+    colorTarget.blend = &blend;
+    colorTarget.writeMask = WGPUColorWriteMask_All;
+    WGPUFragmentState fragment = {};
+    fragment.module = draw;
+    fragment.entryPoint = {"fs_main", WGPU_STRLEN};
+    fragment.targetCount = 1;
+    fragment.targets = &colorTarget;
+
+    WGPURenderPipelineDescriptor renderDesc = {};
+    renderDesc.label = {"Plot draw pipeline", WGPU_STRLEN};
+    renderDesc.layout = drawLayout;
+    renderDesc.vertex.module = draw;
+    renderDesc.vertex.entryPoint = {"vs_main", WGPU_STRLEN};
+    renderDesc.primitive.topology = WGPUPrimitiveTopology_TriangleStrip;
+    renderDesc.primitive.cullMode = WGPUCullMode_None;
+    renderDesc.multisample.count = 1;
+    renderDesc.multisample.mask = 0xFFFFFFFF;
+    renderDesc.fragment = &fragment;
+    m_DrawPipeline = wgpuDeviceCreateRenderPipeline(m_Device, &renderDesc);
+    wgpuPipelineLayoutRelease(drawLayout);
+  }
+  if (reduce) {
+    wgpuShaderModuleRelease(reduce);
+  }
+  if (draw) {
+    wgpuShaderModuleRelease(draw);
+  }
+  return m_ReducePipeline && m_RangePipeline && m_DrawPipeline;
+}
+
+void TimeSeriesPlot::Append(const float *values, size_t count) {
+  std::lock_guard<std::mutex> lock(m_PendingMutex);
+  m_Pending.insert(m_Pending.end(), values, values + count);
+}
+
+void TimeSeriesPlot::Clear() {
+  std::lock_guard<std::mutex> lock(m_PendingMutex);
+  m_Pending.clear();
+  m_ClearRequested = true;
+}
+
+void TimeSeriesPlot::SetColor(float r, float g, float b, float a) {
+  m_Color[0] = r;
+  m_Color[1] = g;
+  m_Color[2] = b;
+  m_Color[3] = a;
+}
+
+void TimeSeriesPlot::EnsureCapacity(uint32_t samples) {
+  if (samples <= m_Capacity && m_Samples) {
+    return;
+  }
+  uint32_t capacity = std::max(m_Capacity, 1u << 16);
+  while (capacity < samples) {
+    capacity = std::min(capacity * 2, kMaxSamples);
+  }
+
+  WGPUBuffer buffer =
+      CreateBuffer(m_Device, "Plot samples", uint64_t(capacity) * sizeof(float),
+                   WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst |
+                       WGPUBufferUsage_CopySrc);
+  if (!buffer) {
+    fprintf(stderr, "Failed to grow plot samples to %u\n", capacity);
+    return;
+  }
+
+  // Submitted now so the copy lands before the new samples are written
+  if (m_Samples && m_Stored > 0) {
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.label = {"Plot grow", WGPU_STRLEN};
+    WGPUCommandEncoder encoder =
+        wgpuDeviceCreateCommandEncoder(m_Device, &encoderDesc);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, m_Samples, 0, buffer, 0,
+                                         uint64_t(m_Stored) * sizeof(float));
+    WGPUCommandBufferDescriptor commandDesc = {};
+    WGPUCommandBuffer commands =
+        wgpuCommandEncoderFinish(encoder, &commandDesc);
+    wgpuQueueSubmit(m_Queue, 1, &commands);
+    wgpuCommandBufferRelease(commands);
+    wgpuCommandEncoderRelease(encoder);
+  }
+  Release(m_Samples, wgpuBufferRelease);
+  m_Samples = buffer;
+  m_Capacity = capacity;
+  // Growth only happens before the first wrap, so the samples are linear
+  m_Head = m_Stored;
+
+  Release(m_ReduceBindGroup, wgpuBindGroupRelease);
+  WGPUBindGroupEntry entries[4] = {};
+  entries[0].binding = 0;
+  entries[0].buffer = m_ReduceUniforms;
+  entries[0].size = sizeof(ReduceParams);
+  entries[1].binding = 1;
+  entries[1].buffer = m_Samples;
+  entries[1].size = WGPU_WHOLE_SIZE;
+  entries[2].binding = 2;
+  entries[2].buffer = m_Columns;
+  entries[2].size = WGPU_WHOLE_SIZE;
+  entries[3].binding = 3;
+  entries[3].buffer = m_Range;
+  entries[3].size = WGPU_WHOLE_SIZE;
+  WGPUBindGroupDescriptor groupDesc = {};
+  groupDesc.label = {"Plot reduce", WGPU_STRLEN};
+  groupDesc.layout = m_ReduceLayout;
+  groupDesc.entryCount = 4;
+  groupDesc.entries = entries;
+  m_ReduceBindGroup = wgpuDeviceCreateBindGroup(m_Device, &groupDesc);
+  // The bindings changed even if the parameters didn't
+  m_LastReduce = {};
+}
+
+void TimeSeriesPlot::Upload(const std::vector<float> &values) {
+  // Only the newest kMaxSamples can be kept
+  const size_t skip = values.size() > kMaxSamples ? values.size() - kMaxSamples
+                                                  : 0;
+  const float *data = values.data() + skip;
+  const uint32_t count = static_cast<uint32_t>(values.size() - skip);
+  m_Stats.appended += values.size();
+
+  EnsureCapacity(static_cast<uint32_t>(
+      std::min<uint64_t>(uint64_t(m_Stored) + count, kMaxSamples)));
+  if (!m_Samples) {
+    return;
+  }
+  // Two writes when the ring wraps
+  uint32_t written = 0;
+  while (written < count) {
+    const uint32_t chunk = std::min(count - written, m_Capacity - m_Head);
+    wgpuQueueWriteBuffer(m_Queue, m_Samples, uint64_t(m_Head) * sizeof(float),
+                         data + written, uint64_t(chunk) * sizeof(float));
+    m_Head = (m_Head + chunk) % m_Capacity;
+    written += chunk;
+  }
+  m_Stored = static_cast<uint32_t>(
+      std::min<uint64_t>(uint64_t(m_Stored) + count, m_Capacity));
+}
+
+void TimeSeriesPlot::Plot(const char *label, float width, float height) {
+  ImGui::PushID(label);
+  const ImVec2 available = ImGui::GetContentRegionAvail();
+  const ImVec2 size(width > 0.0f ? width : available.x,
+                    height > 0.0f ? height : ImGui::GetFrameHeight() * 8.0f);
+  m_Frame.visible = false;
+  m_Frame.ready = false;
+  if (size.x < 1.0f || size.y < 1.0f) {
+    ImGui::PopID();
+    return;
+  }
+
+  const ImVec2 min = ImGui::GetCursorScreenPos();
+  const ImVec2 max(min.x + size.x, min.y + size.y);
+  ImGui::InvisibleButton("plot", size);
+  const bool hovered = ImGui::IsItemHovered();
+  ImGuiIO &io = ImGui::GetIO();
+
+  // Zoom around the cursor, pan by dragging
+  const double total = static_cast<double>(m_Stored);
+  double count = m_ViewCount > 0.0 ? std::min(m_ViewCount, total) : total;
+  double first = m_Follow ? total - count : m_ViewFirst;
+  if (hovered) {
+    ImGui::SetItemKeyOwner(ImGuiKey_MouseWheelY);
+    if (io.MouseWheel != 0.0f && total > 0.0) {
+      const double anchor = (io.MousePos.x - min.x) / size.x;
+      const double center = first + anchor * count;
+      count = std::clamp(count * std::pow(0.8, io.MouseWheel),
+                         std::min(16.0, total), total);
+      first = center - anchor * count;
+      m_Follow = false;
+    }
+    if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+      count = total;
+      m_Follow = true;
+    }
+  }
+  if (ImGui::IsItemActive() && io.MouseDelta.x != 0.0f) {
+    first -= io.MouseDelta.x / size.x * count;
+    m_Follow = false;
+  }
+  first = std::clamp(first, 0.0, total - count);
+  // Panning or zooming to the newest sample starts following again
+  m_Follow = m_Follow || first + count >= total;
+  m_ViewFirst = first;
+  m_ViewCount = count >= total ? 0.0 : count;
+
+  const ImVec2 scale = io.DisplayFramebufferScale;
+  m_Frame.rect[0] = min.x * scale.x;
+  m_Frame.rect[1] = min.y * scale.y;
+  m_Frame.rect[2] = max.x * scale.x;
+  m_Frame.rect[3] = max.y * scale.y;
+  m_Frame.framebuffer[0] = io.DisplaySize.x * scale.x;
+  m_Frame.framebuffer[1] = io.DisplaySize.y * scale.y;
+  m_Frame.first = static_cast<uint32_t>(first);
+  m_Frame.count = std::min(static_cast<uint32_t>(std::ceil(count)),
+                           m_Stored - m_Frame.first);
+  m_Frame.columns = std::clamp(static_cast<uint32_t>(size.x * scale.x), 1u,
+                               kMaxColumns);
+  m_Frame.visible = m_Frame.count >= 2 && ImGui::IsItemVisible();
+
+  ImDrawList *drawList = ImGui::GetWindowDrawList();
+  drawList->AddRectFilled(min, max, ImGui::GetColorU32(ImGuiCol_FrameBg));
+  if (m_Frame.visible) {
+    // The callback binds its own pipeline; the renderer restores its state
+    drawList->AddCallback(DrawCallback, this);
+    drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+  }
+  char text[64];
+  const ImU32 textColor = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+  snprintf(text, sizeof(text), "%.4g", m_LabelMax.load());
+  drawList->AddText(ImVec2(min.x + 4.0f, min.y + 2.0f), textColor, text);
+  snprintf(text, sizeof(text), "%.4g", m_LabelMin.load());
+  drawList->AddText(
+      ImVec2(min.x + 4.0f, max.y - ImGui::GetTextLineHeight() - 2.0f),
+      textColor, text);
+  snprintf(text, sizeof(text), "%s: %u of %u", label, m_Frame.count, m_Stored);
+  const ImVec2 textSize = ImGui::CalcTextSize(text);
+  drawList->AddText(ImVec2(max.x - textSize.x - 4.0f, min.y + 2.0f), textColor,
+                    text);
+  ImGui::PopID();
+}
+
+void TimeSeriesPlot::Prepare(GpuTimer *timer, uint32_t scope) {
+  if (!m_Device) {
+    return;
+  }
+  bool clear = false;
+  {
+    std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_Uploading.swap(m_Pending);
+    m_Pending.clear();
+    clear = m_ClearRequested;
+    m_ClearRequested = false;
+  }
+  if (clear) {
+    m_Stored = 0;
+    m_Head = 0;
+    m_ViewFirst = 0.0;
+    m_ViewCount = 0.0;
+    m_Follow = true;
+    m_LastReduce = {};
+    m_Stats.appended = 0;
+    m_LabelMin = 0.0f;
+    m_LabelMax = 0.0f;
+    // Plotted before the clear; nothing left to draw
+    m_Frame.visible = false;
+  }
+  if (!m_Uploading.empty()) {
+    Upload(m_Uploading);
+    m_Uploading.clear();
+  }
+
+  const bool visible = m_Frame.visible;
+  m_Frame.visible = false;
+  m_Stats.stored = m_Stored;
+  m_Stats.bufferBytes = uint64_t(m_Capacity) * sizeof(float);
+  if (!visible || !m_ReduceBindGroup ||
+      uint64_t(m_Frame.first) + m_Frame.count > m_Stored) {
+    return;
+  }
+  m_Stats.visible = m_Frame.count;
+  m_Stats.columns = m_Frame.columns;
+
+  const float *rect = m_Frame.rect;
+  const float *framebuffer = m_Frame.framebuffer;
+  DrawParams draw = {};
+  draw.rect[0] = rect[0] / framebuffer[0] * 2.0f - 1.0f;
+  draw.rect[1] = 1.0f - rect[1] / framebuffer[1] * 2.0f;
+  draw.rect[2] = rect[2] / framebuffer[0] * 2.0f - 1.0f;
+  draw.rect[3] = 1.0f - rect[3] / framebuffer[1] * 2.0f;
+  for (int i = 0; i < 3; ++i) {
+    draw.color[i] = std::pow(m_Color[i], m_Gamma);
+  }
+  draw.color[3] = m_Color[3];
+  draw.columns = m_Frame.columns;
+  draw.height = std::max(rect[3] - rect[1], 1.0f);
+  wgpuQueueWriteBuffer(m_Queue, m_DrawUniforms, 0, &draw, sizeof(draw));
+  m_Frame.ready = true;
+
+  // Samples inside a fixed window never change until the ring wraps, which
+  // moves the base, so unchanged parameters mean unchanged columns
+  ReduceParams reduce = {};
+  reduce.base = m_Stored == m_Capacity ? m_Head : 0;
+  reduce.first = m_Frame.first;
+  reduce.count = m_Frame.count;
+  reduce.columns = m_Frame.columns;
+  reduce.capacity = m_Capacity;
+  const bool changed = std::memcmp(&reduce, &m_LastReduce, sizeof(reduce)) != 0;
+  if (!changed && (!m_RangeStale || m_ReadbackBusy)) {
+    return;
+  }
+
+  WGPUCommandEncoderDescriptor encoderDesc = {};
+  encoderDesc.label = {"Plot reduce", WGPU_STRLEN};
+  WGPUCommandEncoder encoder =
+      wgpuDeviceCreateCommandEncoder(m_Device, &encoderDesc);
+  if (changed) {
+    m_LastReduce = reduce;
+    wgpuQueueWriteBuffer(m_Queue, m_ReduceUniforms, 0, &reduce, sizeof(reduce));
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.label = {"Plot reduce", WGPU_STRLEN};
+    passDesc.timestampWrites = timer ? timer->GetPassWrites(scope) : nullptr;
+    WGPUComputePassEncoder pass =
+        wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, m_ReduceBindGroup, 0, nullptr);
+    wgpuComputePassEncoderSetPipeline(pass, m_ReducePipeline);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, reduce.columns, 1, 1);
+    wgpuComputePassEncoderSetPipeline(pass, m_RangePipeline);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, 1, 1, 1);
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+    m_RangeStale = true;
+    m_Stats.reductions++;
+  }
+  // One readback at a time; a range reduced meanwhile is read after it
+  const bool readRange = m_RangeStale && !m_ReadbackBusy;
+  if (readRange) {
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, m_Range, 0, m_RangeReadback,
+                                         0, 2 * sizeof(float));
+    m_RangeStale = false;
+  }
+
+  // Submitted ahead of the frame, whose UI pass reads the columns
+  WGPUCommandBufferDescriptor commandDesc = {};
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, &commandDesc);
+  wgpuQueueSubmit(m_Queue, 1, &commands);
+  wgpuCommandBufferRelease(commands);
+  wgpuCommandEncoderRelease(encoder);
+
+  if (readRange) {
+    m_ReadbackBusy = true;
+    WGPUBufferMapCallbackInfo callbackInfo = {};
+    callbackInfo.mode = WGPUCallbackMode_AllowSpontaneous;
+    callbackInfo.callback = OnRangeMapped;
+    callbackInfo.userdata1 = this;
+    wgpuBufferMapAsync(m_RangeReadback, WGPUMapMode_Read, 0, 2 * sizeof(float),
+                       callbackInfo);
+  }
+}
+
+void TimeSeriesPlot::OnRangeMapped(WGPUMapAsyncStatus status, WGPUStringView,
+                                   void *userdata1, void *) {
+  auto *self = static_cast<TimeSeriesPlot *>(userdata1);
+  if (status == WGPUMapAsyncStatus_Success) {
+    const auto *range = static_cast<const float *>(wgpuBufferGetConstMappedRange(
+        self->m_RangeReadback, 0, 2 * sizeof(float)));
+    if (range) {
+      self->m_LabelMin.store(range[0], std::memory_order_relaxed);
+      self->m_LabelMax.store(range[1], std::memory_order_relaxed);
+    }
+    wgpuBufferUnmap(self->m_RangeReadback);
+  }
+  self->m_ReadbackBusy = false;
+}
+
+void TimeSeriesPlot::DrawCallback(const ImDrawList *, const ImDrawCmd *cmd) {
+  // Set by both the stock backend and ImGuiRenderer while they render
+  auto *state = static_cast<ImGui_ImplWGPU_RenderState *>(
+      ImGui::GetPlatformIO().Renderer_RenderState);
+  if (state) {
+    static_cast<TimeSeriesPlot *>(cmd->UserCallbackData)
+        ->Draw(state->RenderPassEncoder, cmd);
+  }
+}
+
+void TimeSeriesPlot::Draw(WGPURenderPassEncoder pass, const ImDrawCmd *cmd) {
+  if (!m_Frame.ready) {
+    return;
+  }
+  // The window's clip rect, inside the plot and the framebuffer
+  const ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
+  const float x0 = std::max({cmd->ClipRect.x * scale.x, m_Frame.rect[0], 0.0f});
+  const float y0 = std::max({cmd->ClipRect.y * scale.y, m_Frame.rect[1], 0.0f});
+  const float x1 = std::min(
+      {cmd->ClipRect.z * scale.x, m_Frame.rect[2], m_Frame.framebuffer[0]});
+  const float y1 = std::min(
+      {cmd->ClipRect.w * scale.y, m_Frame.rect[3], m_Frame.framebuffer[1]});
+  if (x1 <= x0 || y1 <= y0) {
+    return;
+  }
+  const uint32_t left = static_cast<uint32_t>(x0);
+  const uint32_t top = static_cast<uint32_t>(y0);
+  wgpuRenderPassEncoderSetPipeline(pass, m_DrawPipeline);
+  wgpuRenderPassEncoderSetBindGroup(pass, 0, m_DrawBindGroup, 0, nullptr);
+  wgpuRenderPassEncoderSetScissorRect(pass, left, top,
+                                      static_cast<uint32_t>(x1) - left,
+                                      static_cast<uint32_t>(y1) - top);
+  wgpuRenderPassEncoderDraw(pass, 4, 1, 0, 0);
+}
@@ -12,6 +12,12 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  // Optional model path; without one a procedural test scene is generated
+  if (!app.LoadScene(argc > 1 ? argv[1] : nullptr)) {
+    fprintf(stderr, "Failed to load scene\n");
+    return 1;
+  }
+
   app.Run();
   // Destructor will call Shutdown() automatically
 
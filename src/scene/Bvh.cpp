@@ -0,0 +1,518 @@
+#include "scene/Bvh.h"
+#include "utilities/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+
+namespace {
+
+constexpr int kBinCount = 16;
+
+using Clock = std::chrono::high_resolution_clock;
+
+double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+Bvh::Bvh() {}
+
+Bvh::~Bvh() {}
+
+void Bvh::Build(const std::vector<Aabb> &bounds) {
+  const auto start = Clock::now();
+
+  m_Nodes.clear();
+  m_Leaves.clear();
+  m_ObjectCount = static_cast<uint32_t>(bounds.size());
+  m_Stats = {};
+  m_Stats.totalObjects = m_ObjectCount;
+  if (m_ObjectCount == 0) {
+    m_ObjectIds.clear();
+    return;
+  }
+
+  std::vector<Vec3> centroids(bounds.size());
+  for (size_t i = 0; i < bounds.size(); ++i) {
+    centroids[i] = bounds[i].Center();
+  }
+  std::vector<uint32_t> ids(bounds.size());
+  for (uint32_t i = 0; i < m_ObjectCount; ++i) {
+    ids[i] = i;
+  }
+
+  std::vector<BuildNode> tree;
+  tree.reserve(2 * bounds.size() / kMaxLeafSize + 1);
+  BuildBinary(tree, ids, bounds, centroids);
+
+  m_Nodes.reserve(tree.size() / 2 + 1);
+  if (tree[0].left < 0) {
+    // Whole scene fits one leaf: give it a root node of its own
+    m_Nodes.emplace_back();
+    Node &root = m_Nodes.back();
+    for (int s = 0; s < 4; ++s) {
+      SetChildBounds(root, s, Aabb{});
+      root.child[s] = kEmptyChild;
+    }
+    root.parent = UINT32_MAX;
+    root.slotInParent = 0;
+    m_Leaves.push_back({tree[0].first, tree[0].count, 0, 0});
+    root.child[0] = ~0;
+    SetChildBounds(root, 0, tree[0].bounds);
+  } else {
+    Collapse(tree, 0, UINT32_MAX, 0);
+  }
+
+  // Leaf-ordered SoA copies of the object bounds, padded so the wide test
+  // can always load a full register
+  m_ObjectIds = std::move(ids);
+  const size_t padded = m_ObjectCount + simd::kWideWidth;
+  for (auto *array : {&m_ObjMinX, &m_ObjMinY, &m_ObjMinZ, &m_ObjMaxX,
+                      &m_ObjMaxY, &m_ObjMaxZ}) {
+    array->assign(padded, 0.0f);
+  }
+  m_ObjectLeaf.assign(m_ObjectCount, 0);
+  m_ObjectPosition.assign(m_ObjectCount, 0);
+  for (uint32_t l = 0; l < m_Leaves.size(); ++l) {
+    const Leaf &leaf = m_Leaves[l];
+    for (uint32_t p = leaf.first; p < leaf.first + leaf.count; ++p) {
+      const uint32_t id = m_ObjectIds[p];
+      const Aabb &b = bounds[id];
+      m_ObjMinX[p] = b.min.x;
+      m_ObjMinY[p] = b.min.y;
+      m_ObjMinZ[p] = b.min.z;
+      m_ObjMaxX[p] = b.max.x;
+      m_ObjMaxY[p] = b.max.y;
+      m_ObjMaxZ[p] = b.max.z;
+      m_ObjectLeaf[id] = l;
+      m_ObjectPosition[id] = p;
+    }
+  }
+  m_NodeDirty.assign(m_Nodes.size(), 0);
+
+  m_Stats.buildMs = ElapsedMs(start);
+}
+
+void Bvh::BuildBinary(std::vector<BuildNode> &tree,
+                      std::vector<uint32_t> &ids,
+                      const std::vector<Aabb> &bounds,
+                      const std::vector<Vec3> &centroids) {
+  tree.push_back({});
+  tree[0].first = 0;
+  tree[0].count = static_cast<uint32_t>(ids.size());
+
+  std::vector<int32_t> stack{0};
+  while (!stack.empty()) {
+    const int32_t index = stack.back();
+    stack.pop_back();
+
+    const uint32_t first = tree[index].first;
+    const uint32_t count = tree[index].count;
+    Aabb nodeBounds, centroidBounds;
+    for (uint32_t i = first; i < first + count; ++i) {
+      nodeBounds.Expand(bounds[ids[i]]);
+      centroidBounds.Expand(centroids[ids[i]]);
+    }
+    tree[index].bounds = nodeBounds;
+    if (count <= kMaxLeafSize) {
+      continue;
+    }
+
+    const Vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (extent.y > extent[axis])
+      axis = 1;
+    if (extent.z > extent[axis])
+      axis = 2;
+
+    uint32_t mid = first + count / 2;
+    if (extent[axis] > 0.0f) {
+      // Binned SAH along the widest centroid axis
+      struct Bin {
+        Aabb bounds;
+        uint32_t count = 0;
+      } bins[kBinCount];
+      const float scale = kBinCount / extent[axis];
+      const float origin = centroidBounds.min[axis];
+      auto binOf = [&](uint32_t id) {
+        int b = static_cast<int>((centroids[id][axis] - origin) * scale);
+        return std::min(b, kBinCount - 1);
+      };
+      for (uint32_t i = first; i < first + count; ++i) {
+        Bin &bin = bins[binOf(ids[i])];
+        bin.bounds.Expand(bounds[ids[i]]);
+        bin.count++;
+      }
+
+      float rightArea[kBinCount];
+      uint32_t rightCount[kBinCount];
+      Aabb acc;
+      uint32_t accCount = 0;
+      for (int b = kBinCount - 1; b > 0; --b) {
+        acc.Expand(bins[b].bounds);
+        accCount += bins[b].count;
+        rightArea[b] = acc.SurfaceArea();
+        rightCount[b] = accCount;
+      }
+
+      float bestCost = FLT_MAX;
+      int bestSplit = -1;
+      acc = Aabb{};
+      accCount = 0;
+      for (int b = 1; b < kBinCount; ++b) {
+        acc.Expand(bins[b - 1].bounds);
+        accCount += bins[b - 1].count;
+        if (accCount == 0 || rightCount[b] == 0) {
+          continue;
+        }
+        const float cost =
+            acc.SurfaceArea() * accCount + rightArea[b] * rightCount[b];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestSplit = b;
+        }
+      }
+
+      if (bestSplit > 0) {
+        auto it = std::partition(ids.begin() + first,
+                                 ids.begin() + first + count,
+                                 [&](uint32_t id) { return binOf(id) < bestSplit; });
+        mid = static_cast<uint32_t>(it - ids.begin());
+      }
+    }
+    if (mid == first || mid == first + count) {
+      // Coincident centroids: fall back to an object median split
+      mid = first + count / 2;
+      std::nth_element(ids.begin() + first, ids.begin() + mid,
+                       ids.begin() + first + count, [&](uint32_t a, uint32_t b) {
+                         return centroids[a][axis] < centroids[b][axis];
+                       });
+    }
+
+    const int32_t left = static_cast<int32_t>(tree.size());
+    tree.push_back({});
+    tree.push_back({});
+    tree[left].first = first;
+    tree[left].count = mid - first;
+    tree[left + 1].first = mid;
+    tree[left + 1].count = first + count - mid;
+    tree[index].left = left;
+    tree[index].right = left + 1;
+    stack.push_back(left);
+    stack.push_back(left + 1);
+  }
+}
+
+int32_t Bvh::Collapse(const std::vector<BuildNode> &tree, int32_t root,
+                      uint32_t parent, uint32_t slot) {
+  // Pull grandchildren up until the node has four children, always opening
+  // the largest inner child first
+  int32_t candidates[4] = {tree[root].left, tree[root].right, -1, -1};
+  int candidateCount = 2;
+  while (candidateCount < 4) {
+    int best = -1;
+    float bestArea = -1.0f;
+    for (int c = 0; c < candidateCount; ++c) {
+      const BuildNode &n = tree[candidates[c]];
+      if (n.left >= 0 && n.bounds.SurfaceArea() > bestArea) {
+        bestArea = n.bounds.SurfaceArea();
+        best = c;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+    const BuildNode &opened = tree[candidates[best]];
+    candidates[best] = opened.left;
+    candidates[candidateCount++] = opened.right;
+  }
+
+  const uint32_t index = static_cast<uint32_t>(m_Nodes.size());
+  m_Nodes.emplace_back();
+  {
+    Node &node = m_Nodes.back();
+    for (int s = 0; s < 4; ++s) {
+      SetChildBounds(node, s, Aabb{});
+      node.child[s] = kEmptyChild;
+    }
+    node.parent = parent;
+    node.slotInParent = slot;
+  }
+
+  for (int s = 0; s < candidateCount; ++s) {
+    const BuildNode &c = tree[candidates[s]];
+    int32_t child;
+    if (c.left < 0) {
+      child = ~static_cast<int32_t>(m_Leaves.size());
+      m_Leaves.push_back({c.first, c.count, index, static_cast<uint32_t>(s)});
+    } else {
+      // Recursion may reallocate m_Nodes, so re-index afterwards
+      child = Collapse(tree, candidates[s], index, static_cast<uint32_t>(s));
+    }
+    m_Nodes[index].child[s] = child;
+    SetChildBounds(m_Nodes[index], s, c.bounds);
+  }
+  return static_cast<int32_t>(index);
+}
+
+void Bvh::SetChildBounds(Node &node, int slot, const Aabb &box) {
+  node.minX[slot] = box.min.x;
+  node.minY[slot] = box.min.y;
+  node.minZ[slot] = box.min.z;
+  node.maxX[slot] = box.max.x;
+  node.maxY[slot] = box.max.y;
+  node.maxZ[slot] = box.max.z;
+}
+
+Aabb Bvh::LeafBounds(const Leaf &leaf) const {
+  Aabb box;
+  for (uint32_t p = leaf.first; p < leaf.first + leaf.count; ++p) {
+    box.Expand(Vec3{m_ObjMinX[p], m_ObjMinY[p], m_ObjMinZ[p]});
+    box.Expand(Vec3{m_ObjMaxX[p], m_ObjMaxY[p], m_ObjMaxZ[p]});
+  }
+  return box;
+}
+
+Aabb Bvh::NodeBounds(const Node &node) {
+  Aabb box;
+  for (int s = 0; s < 4; ++s) {
+    if (node.child[s] != kEmptyChild) {
+      box.Expand(Vec3{node.minX[s], node.minY[s], node.minZ[s]});
+      box.Expand(Vec3{node.maxX[s], node.maxY[s], node.maxZ[s]});
+    }
+  }
+  return box;
+}
+
+void Bvh::Refit(const std::vector<Aabb> &bounds,
+                const std::vector<uint32_t> &moved) {
+  m_Stats.refitObjects = static_cast<uint32_t>(moved.size());
+  m_Stats.refitMs = 0.0;
+  if (moved.empty() || m_Nodes.empty()) {
+    return;
+  }
+  const auto start = Clock::now();
+
+  for (uint32_t id : moved) {
+    const uint32_t p = m_ObjectPosition[id];
+    const Aabb &b = bounds[id];
+    m_ObjMinX[p] = b.min.x;
+    m_ObjMinY[p] = b.min.y;
+    m_ObjMinZ[p] = b.min.z;
+    m_ObjMaxX[p] = b.max.x;
+    m_ObjMaxY[p] = b.max.y;
+    m_ObjMaxZ[p] = b.max.z;
+  }
+  for (uint32_t id : moved) {
+    const Leaf &leaf = m_Leaves[m_ObjectLeaf[id]];
+    SetChildBounds(m_Nodes[leaf.node], static_cast<int>(leaf.slot),
+                   LeafBounds(leaf));
+    m_NodeDirty[leaf.node] = 1;
+  }
+
+  // Children are always stored after their parent, so one reverse sweep
+  // settles every ancestor
+  for (size_t n = m_Nodes.size() - 1; n > 0; --n) {
+    if (!m_NodeDirty[n]) {
+      continue;
+    }
+    m_NodeDirty[n] = 0;
+    const Node &node = m_Nodes[n];
+    SetChildBounds(m_Nodes[node.parent], static_cast<int>(node.slotInParent),
+                   NodeBounds(node));
+    m_NodeDirty[node.parent] = 1;
+  }
+  m_NodeDirty[0] = 0;
+
+  m_Stats.refitMs = ElapsedMs(start);
+}
+
+namespace {
+
+// Per-plane p/n-vertex test of four boxes. Returns the lanes that are not
+// outside any plane in `visible`, and of those the lanes fully inside every
+// plane in `inside`.
+inline void TestBoxes4(const Frustum &frustum, simd::f4 minX, simd::f4 minY,
+                       simd::f4 minZ, simd::f4 maxX, simd::f4 maxY,
+                       simd::f4 maxZ, int &visible, int &inside) {
+  using namespace simd;
+  f4 outside = Zero();
+  f4 partial = Zero();
+  const f4 zero = Zero();
+  for (const Vec4 &p : frustum.planes) {
+    const f4 nx = Splat(p.x), ny = Splat(p.y), nz = Splat(p.z), d = Splat(p.w);
+    const f4 px = p.x > 0.0f ? maxX : minX;
+    const f4 py = p.y > 0.0f ? maxY : minY;
+    const f4 pz = p.z > 0.0f ? maxZ : minZ;
+    const f4 qx = p.x > 0.0f ? minX : maxX;
+    const f4 qy = p.y > 0.0f ? minY : maxY;
+    const f4 qz = p.z > 0.0f ? minZ : maxZ;
+    const f4 farDist = MulAdd(nx, px, MulAdd(ny, py, MulAdd(nz, pz, d)));
+    const f4 nearDist = MulAdd(nx, qx, MulAdd(ny, qy, MulAdd(nz, qz, d)));
+    outside = Or(outside, CmpLt(farDist, zero));
+    partial = Or(partial, CmpLt(nearDist, zero));
+  }
+  visible = ~MoveMask(outside) & 0xF;
+  inside = ~MoveMask(partial) & visible;
+}
+
+} // namespace
+
+void Bvh::EmitLeaf(const Frustum &frustum, const Leaf &leaf, bool fullyInside,
+                   std::vector<uint32_t> &out) const {
+  if (fullyInside) {
+    out.insert(out.end(), m_ObjectIds.begin() + leaf.first,
+               m_ObjectIds.begin() + leaf.first + leaf.count);
+    return;
+  }
+
+  using namespace simd;
+  constexpr int W = kWideWidth;
+  const fw zero = WideSplat(0.0f);
+  for (uint32_t base = leaf.first; base < leaf.first + leaf.count; base += W) {
+    const fw minX = WideLoad(&m_ObjMinX[base]), maxX = WideLoad(&m_ObjMaxX[base]);
+    const fw minY = WideLoad(&m_ObjMinY[base]), maxY = WideLoad(&m_ObjMaxY[base]);
+    const fw minZ = WideLoad(&m_ObjMinZ[base]), maxZ = WideLoad(&m_ObjMaxZ[base]);
+    fw outside = zero;
+    for (const Vec4 &p : frustum.planes) {
+      const fw px = p.x > 0.0f ? maxX : minX;
+      const fw py = p.y > 0.0f ? maxY : minY;
+      const fw pz = p.z > 0.0f ? maxZ : minZ;
+      const fw dist = WideMulAdd(
+          WideSplat(p.x), px,
+          WideMulAdd(WideSplat(p.y), py,
+                     WideMulAdd(WideSplat(p.z), pz, WideSplat(p.w))));
+      outside = WideOr(outside, WideCmpLt(dist, zero));
+    }
+    const uint32_t lanes = std::min<uint32_t>(W, leaf.first + leaf.count - base);
+    int mask = ~WideMoveMask(outside) & ((1 << lanes) - 1);
+    while (mask) {
+      const int lane = std::countr_zero(static_cast<unsigned>(mask));
+      out.push_back(m_ObjectIds[base + lane]);
+      mask &= mask - 1;
+    }
+  }
+}
+
+void Bvh::Traverse(const Frustum &frustum, TraversalItem start,
+                   std::vector<uint32_t> &out, uint32_t &nodesVisited) const {
+  TraversalItem stack[128];
+  std::vector<TraversalItem> overflow;
+  int top = 0;
+  stack[top++] = start;
+
+  while (top > 0 || !overflow.empty()) {
+    TraversalItem item;
+    if (!overflow.empty()) {
+      item = overflow.back();
+      overflow.pop_back();
+    } else {
+      item = stack[--top];
+    }
+    const Node &node = m_Nodes[item.node];
+    nodesVisited++;
+
+    int visible = 0xF, inside = 0xF;
+    if (!item.fullyInside) {
+      TestBoxes4(frustum, simd::Load(node.minX), simd::Load(node.minY),
+                 simd::Load(node.minZ), simd::Load(node.maxX),
+                 simd::Load(node.maxY), simd::Load(node.maxZ), visible, inside);
+    }
+
+    for (int s = 0; s < 4; ++s) {
+      const int32_t child = node.child[s];
+      if (child == kEmptyChild || !(visible & (1 << s))) {
+        continue;
+      }
+      const bool childInside = (inside & (1 << s)) != 0;
+      if (child < 0) {
+        EmitLeaf(frustum, m_Leaves[~child], childInside, out);
+      } else if (top < 128) {
+        stack[top++] = {static_cast<uint32_t>(child), childInside};
+      } else {
+        overflow.push_back({static_cast<uint32_t>(child), childInside});
+      }
+    }
+  }
+}
+
+void Bvh::Cull(const Frustum &frustum, std::vector<uint32_t> &visible,
+               ThreadPool *pool) {
+  const auto start = Clock::now();
+  visible.clear();
+  m_Stats.totalObjects = m_ObjectCount;
+  m_Stats.nodesVisited = 0;
+  if (m_Nodes.empty()) {
+    m_Stats.visibleObjects = 0;
+    m_Stats.cullMs = 0.0;
+    return;
+  }
+
+  // Small trees are not worth the fan-out
+  constexpr size_t kParallelNodeThreshold = 2048;
+  if (!pool || pool->size() == 0 || m_Nodes.size() < kParallelNodeThreshold) {
+    uint32_t visited = 0;
+    Traverse(frustum, {0, false}, visible, visited);
+    m_Stats.nodesVisited = visited;
+  } else {
+    // Expand the top of the tree breadth-first until there are a few
+    // subtrees per worker; leaves met on the way are emitted directly
+    const size_t target = pool->size() * 4;
+    std::vector<TraversalItem> frontier{{0, false}};
+    std::vector<TraversalItem> next;
+    uint32_t visited = 0;
+    while (!frontier.empty() && frontier.size() < target) {
+      next.clear();
+      for (const TraversalItem &item : frontier) {
+        const Node &node = m_Nodes[item.node];
+        visited++;
+        int vis = 0xF, inside = 0xF;
+        if (!item.fullyInside) {
+          TestBoxes4(frustum, simd::Load(node.minX), simd::Load(node.minY),
+                     simd::Load(node.minZ), simd::Load(node.maxX),
+                     simd::Load(node.maxY), simd::Load(node.maxZ), vis, inside);
+        }
+        for (int s = 0; s < 4; ++s) {
+          const int32_t child = node.child[s];
+          if (child == kEmptyChild || !(vis & (1 << s))) {
+            continue;
+          }
+          const bool childInside = (inside & (1 << s)) != 0;
+          if (child < 0) {
+            EmitLeaf(frustum, m_Leaves[~child], childInside, visible);
+          } else {
+            next.push_back({static_cast<uint32_t>(child), childInside});
+          }
+        }
+      }
+      frontier.swap(next);
+    }
+
+    m_TaskResults.resize(frontier.size());
+    std::atomic<uint32_t> taskVisited{0};
+    pool->parallel_for(0, frontier.size(), 1, [&](size_t b, size_t e) {
+      uint32_t local = 0;
+      for (size_t i = b; i < e; ++i) {
+        m_TaskResults[i].clear();
+        Traverse(frustum, frontier[i], m_TaskResults[i], local);
+      }
+      taskVisited.fetch_add(local, std::memory_order_relaxed);
+    });
+
+    size_t total = visible.size();
+    for (size_t i = 0; i < frontier.size(); ++i) {
+      total += m_TaskResults[i].size();
+    }
+    visible.reserve(total);
+    for (size_t i = 0; i < frontier.size(); ++i) {
+      visible.insert(visible.end(), m_TaskResults[i].begin(),
+                     m_TaskResults[i].end());
+    }
+    m_Stats.nodesVisited = visited + taskVisited.load();
+  }
+
+  m_Stats.visibleObjects = static_cast<uint32_t>(visible.size());
+  m_Stats.cullMs = ElapsedMs(start);
+}
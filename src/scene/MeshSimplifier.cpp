@@ -0,0 +1,508 @@
+#include "scene/MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// Weight of the planes that hold borders and seams in place, relative to the
+// area-weighted triangle planes
+constexpr double kEdgeWeight = 10.0;
+
+struct Quadric {
+  double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+  double b0 = 0, b1 = 0, b2 = 0;
+  double c = 0;
+  double weight = 0;
+
+  // Plane n.p + d = 0 with unit normal n
+  void AddPlane(Vec3 n, double d, double w) {
+    a00 += w * n.x * n.x;
+    a11 += w * n.y * n.y;
+    a22 += w * n.z * n.z;
+    a01 += w * n.x * n.y;
+    a02 += w * n.x * n.z;
+    a12 += w * n.y * n.z;
+    b0 += w * n.x * d;
+    b1 += w * n.y * d;
+    b2 += w * n.z * d;
+    c += w * d * d;
+    weight += w;
+  }
+
+  void Add(const Quadric &q) {
+    a00 += q.a00;
+    a11 += q.a11;
+    a22 += q.a22;
+    a01 += q.a01;
+    a02 += q.a02;
+    a12 += q.a12;
+    b0 += q.b0;
+    b1 += q.b1;
+    b2 += q.b2;
+    c += q.c;
+    weight += q.weight;
+  }
+
+  // Weighted sum of squared distances to the planes
+  double Evaluate(Vec3 p) const {
+    const double x = p.x, y = p.y, z = p.z;
+    return a00 * x * x + a11 * y * y + a22 * z * z +
+           2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+           2.0 * (b0 * x + b1 * y + b2 * z) + c;
+  }
+};
+
+enum class VertexKind : uint8_t { Manifold, Border, Seam, Locked };
+
+// One triangle's view of an edge between two positions
+struct HalfEdge {
+  uint64_t key; // lower position << 32 | higher position
+  uint32_t lo;  // vertices the triangle uses at the lower/higher position
+  uint32_t hi;
+  uint32_t triangle;
+};
+
+struct Edge {
+  uint32_t a; // positions
+  uint32_t b;
+  bool border;
+  bool seam;
+};
+
+struct Candidate {
+  uint32_t from; // positions
+  uint32_t to;
+  double error;
+};
+
+// Edge collapse over welded positions: vertices that share a position (UV or
+// normal seams) move together, and triangles keep referencing the original
+// vertices so attributes survive
+class Simplifier {
+public:
+  explicit Simplifier(const MeshData &mesh);
+
+  // Collapse edges until at most `targetTriangles` remain or every remaining
+  // collapse would exceed `maxError`
+  void Run(size_t targetTriangles, double maxError);
+
+  size_t GetTriangleCount() const { return m_Indices.size() / 3; }
+  const std::vector<uint32_t> &GetIndices() const { return m_Indices; }
+  double GetError() const { return m_Error; }
+
+private:
+  bool RunPass(size_t targetTriangles, double maxError);
+  void BuildAdjacency();
+  void BuildEdges();
+  bool CanCollapse(uint32_t from, uint32_t to, const Edge &edge) const;
+  bool FlipsTriangle(uint32_t from, uint32_t to) const;
+  uint32_t ClosestVertex(uint32_t position, uint32_t vertex) const;
+  Vec3 TriangleNormal(uint32_t triangle) const;
+
+  const std::vector<Vertex> &m_Vertices;
+  std::vector<uint32_t> m_Indices;
+
+  // Welding: vertex -> position, and the vertices of each position
+  std::vector<uint32_t> m_Position;
+  std::vector<uint32_t> m_FirstVertex; // per position, into m_PositionVertices
+  std::vector<uint32_t> m_PositionVertices;
+  std::vector<Vec3> m_Points;
+
+  std::vector<Quadric> m_Quadrics; // per position
+  std::vector<VertexKind> m_Kinds;
+  std::vector<uint32_t> m_Remap; // vertex -> vertex it collapsed into
+
+  // Rebuilt every pass
+  std::vector<uint32_t> m_FirstTriangle; // per position, into m_Triangles
+  std::vector<uint32_t> m_Triangles;
+  std::vector<Edge> m_Edges;
+
+  double m_Error = 0.0;
+};
+
+Simplifier::Simplifier(const MeshData &mesh)
+    : m_Vertices(mesh.vertices), m_Indices(mesh.indices) {
+  // Weld by exact position
+  const uint32_t vertexCount = static_cast<uint32_t>(m_Vertices.size());
+  std::vector<uint32_t> order(vertexCount);
+  std::iota(order.begin(), order.end(), 0u);
+  auto less = [&](uint32_t a, uint32_t b) {
+    const Vec3 &p = m_Vertices[a].position;
+    const Vec3 &q = m_Vertices[b].position;
+    return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+  };
+  std::sort(order.begin(), order.end(), less);
+
+  m_Position.resize(vertexCount);
+  m_PositionVertices = order;
+  for (uint32_t i = 0; i < vertexCount; ++i) {
+    if (i == 0 || less(order[i - 1], order[i])) {
+      m_FirstVertex.push_back(i);
+      m_Points.push_back(m_Vertices[order[i]].position);
+    }
+    m_Position[order[i]] = static_cast<uint32_t>(m_Points.size() - 1);
+  }
+  m_FirstVertex.push_back(vertexCount);
+
+  m_Remap.resize(vertexCount);
+  std::iota(m_Remap.begin(), m_Remap.end(), 0u);
+  m_Quadrics.resize(m_Points.size());
+
+  // Drop triangles that are degenerate once welded
+  size_t kept = 0;
+  for (size_t i = 0; i + 2 < m_Indices.size(); i += 3) {
+    const uint32_t a = m_Position[m_Indices[i]];
+    const uint32_t b = m_Position[m_Indices[i + 1]];
+    const uint32_t c = m_Position[m_Indices[i + 2]];
+    if (a != b && b != c && a != c) {
+      std::copy_n(&m_Indices[i], 3, &m_Indices[kept]);
+      kept += 3;
+    }
+  }
+  m_Indices.resize(kept);
+
+  // Area-weighted planes of the surrounding triangles
+  for (uint32_t t = 0; t < GetTriangleCount(); ++t) {
+    const Vec3 p0 = m_Points[m_Position[m_Indices[t * 3]]];
+    const Vec3 cross = Cross(m_Points[m_Position[m_Indices[t * 3 + 1]]] - p0,
+                             m_Points[m_Position[m_Indices[t * 3 + 2]]] - p0);
+    const float length = Length(cross);
+    if (length <= 0.0f) {
+      continue;
+    }
+    const Vec3 n = cross / length;
+    for (int k = 0; k < 3; ++k) {
+      m_Quadrics[m_Position[m_Indices[t * 3 + k]]].AddPlane(n, -Dot(n, p0),
+                                                             length * 0.5);
+    }
+  }
+
+  // Planes through border and seam edges, perpendicular to the surface, keep
+  // them from drifting
+  BuildAdjacency();
+  BuildEdges();
+  for (const Edge &edge : m_Edges) {
+    if (!edge.border && !edge.seam) {
+      continue;
+    }
+    const Vec3 pa = m_Points[edge.a];
+    const Vec3 pb = m_Points[edge.b];
+    // Any triangle on the edge gives the surface normal
+    Vec3 normal{0.0f, 0.0f, 0.0f};
+    for (uint32_t i = m_FirstTriangle[edge.a]; i < m_FirstTriangle[edge.a + 1];
+         ++i) {
+      const uint32_t t = m_Triangles[i];
+      for (int k = 0; k < 3; ++k) {
+        if (m_Position[m_Indices[t * 3 + k]] == edge.b) {
+          normal = TriangleNormal(t);
+        }
+      }
+    }
+    const Vec3 direction = pb - pa;
+    const Vec3 cross = Cross(direction, normal);
+    const float length = Length(cross);
+    if (length <= 0.0f) {
+      continue;
+    }
+    const Vec3 n = cross / length;
+    const double weight = kEdgeWeight * Dot(direction, direction);
+    m_Quadrics[edge.a].AddPlane(n, -Dot(n, pa), weight);
+    m_Quadrics[edge.b].AddPlane(n, -Dot(n, pa), weight);
+  }
+}
+
+Vec3 Simplifier::TriangleNormal(uint32_t triangle) const {
+  const Vec3 p0 = m_Points[m_Position[m_Indices[triangle * 3]]];
+  const Vec3 p1 = m_Points[m_Position[m_Indices[triangle * 3 + 1]]];
+  const Vec3 p2 = m_Points[m_Position[m_Indices[triangle * 3 + 2]]];
+  return Normalize(Cross(p1 - p0, p2 - p0));
+}
+
+void Simplifier::BuildAdjacency() {
+  m_FirstTriangle.assign(m_Points.size() + 1, 0);
+  for (uint32_t index : m_Indices) {
+    m_FirstTriangle[m_Position[index] + 1]++;
+  }
+  std::partial_sum(m_FirstTriangle.begin(), m_FirstTriangle.end(),
+                   m_FirstTriangle.begin());
+  m_Triangles.resize(m_Indices.size());
+  std::vector<uint32_t> cursor(m_FirstTriangle.begin(), m_FirstTriangle.end() - 1);
+  for (uint32_t i = 0; i < m_Indices.size(); ++i) {
+    m_Triangles[cursor[m_Position[m_Indices[i]]]++] = i / 3;
+  }
+}
+
+void Simplifier::BuildEdges() {
+  std::vector<HalfEdge> halfEdges;
+  halfEdges.reserve(m_Indices.size());
+  for (uint32_t t = 0; t < GetTriangleCount(); ++t) {
+    for (int k = 0; k < 3; ++k) {
+      uint32_t v0 = m_Indices[t * 3 + k];
+      uint32_t v1 = m_Indices[t * 3 + (k + 1) % 3];
+      if (m_Position[v0] > m_Position[v1]) {
+        std::swap(v0, v1);
+      }
+      halfEdges.push_back(
+          {(uint64_t(m_Position[v0]) << 32) | m_Position[v1], v0, v1, t});
+    }
+  }
+  std::sort(halfEdges.begin(), halfEdges.end(),
+            [](const HalfEdge &a, const HalfEdge &b) { return a.key < b.key; });
+
+  // Count border and seam edges per position; more than two triangles on an
+  // edge locks both ends
+  std::vector<uint8_t> borderCount(m_Points.size(), 0);
+  std::vector<uint8_t> seamCount(m_Points.size(), 0);
+  std::vector<bool> complex(m_Points.size(), false);
+  m_Edges.clear();
+  for (size_t i = 0; i < halfEdges.size();) {
+    size_t end = i + 1;
+    while (end < halfEdges.size() && halfEdges[end].key == halfEdges[i].key) {
+      end++;
+    }
+    Edge edge;
+    edge.a = static_cast<uint32_t>(halfEdges[i].key >> 32);
+    edge.b = static_cast<uint32_t>(halfEdges[i].key);
+    edge.border = end - i == 1;
+    edge.seam = end - i == 2 && (halfEdges[i].lo != halfEdges[i + 1].lo ||
+                                 halfEdges[i].hi != halfEdges[i + 1].hi);
+    if (end - i > 2) {
+      complex[edge.a] = complex[edge.b] = true;
+    }
+    for (uint32_t p : {edge.a, edge.b}) {
+      borderCount[p] = static_cast<uint8_t>(std::min(borderCount[p] + edge.border, 255));
+      seamCount[p] = static_cast<uint8_t>(std::min(seamCount[p] + edge.seam, 255));
+    }
+    m_Edges.push_back(edge);
+    i = end;
+  }
+
+  // A border or seam can only be followed through a vertex with exactly two
+  // such edges; corners and vertices on both stay put
+  m_Kinds.resize(m_Points.size());
+  for (size_t p = 0; p < m_Points.size(); ++p) {
+    VertexKind kind = VertexKind::Manifold;
+    if (complex[p] || (borderCount[p] > 0 && seamCount[p] > 0)) {
+      kind = VertexKind::Locked;
+    } else if (borderCount[p] > 0) {
+      kind = borderCount[p] == 2 ? VertexKind::Border : VertexKind::Locked;
+    } else if (seamCount[p] > 0) {
+      kind = seamCount[p] == 2 ? VertexKind::Seam : VertexKind::Locked;
+    }
+    m_Kinds[p] = kind;
+  }
+}
+
+bool Simplifier::CanCollapse(uint32_t from, uint32_t to, const Edge &edge) const {
+  switch (m_Kinds[from]) {
+  case VertexKind::Manifold:
+    return true;
+  case VertexKind::Border:
+    return edge.border && (m_Kinds[to] == VertexKind::Border ||
+                           m_Kinds[to] == VertexKind::Locked);
+  case VertexKind::Seam:
+    return edge.seam && (m_Kinds[to] == VertexKind::Seam ||
+                         m_Kinds[to] == VertexKind::Locked);
+  case VertexKind::Locked:
+    break;
+  }
+  return false;
+}
+
+bool Simplifier::FlipsTriangle(uint32_t from, uint32_t to) const {
+  const Vec3 target = m_Points[to];
+  for (uint32_t i = m_FirstTriangle[from]; i < m_FirstTriangle[from + 1]; ++i) {
+    const uint32_t t = m_Triangles[i];
+    Vec3 p[3];
+    Vec3 moved[3];
+    bool removed = false;
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t position = m_Position[m_Indices[t * 3 + k]];
+      removed |= position == to;
+      p[k] = m_Points[position];
+      moved[k] = position == from ? target : p[k];
+    }
+    if (removed) {
+      continue;
+    }
+    const Vec3 before = Cross(p[1] - p[0], p[2] - p[0]);
+    const Vec3 after = Cross(moved[1] - moved[0], moved[2] - moved[0]);
+    if (Dot(before, after) <= 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The vertex at `position` whose attributes best continue `vertex`, so a
+// collapse lands on the same side of a seam
+uint32_t Simplifier::ClosestVertex(uint32_t position, uint32_t vertex) const {
+  const Vertex &source = m_Vertices[vertex];
+  uint32_t best = m_PositionVertices[m_FirstVertex[position]];
+  float bestDistance = INFINITY;
+  for (uint32_t i = m_FirstVertex[position]; i < m_FirstVertex[position + 1];
+       ++i) {
+    const Vertex &candidate = m_Vertices[m_PositionVertices[i]];
+    const float du = candidate.uv[0] - source.uv[0];
+    const float dv = candidate.uv[1] - source.uv[1];
+    const Vec3 dn = candidate.normal - source.normal;
+    const float distance = du * du + dv * dv + Dot(dn, dn);
+    if (distance < bestDistance) {
+      bestDistance = distance;
+      best = m_PositionVertices[i];
+    }
+  }
+  return best;
+}
+
+bool Simplifier::RunPass(size_t targetTriangles, double maxError) {
+  BuildAdjacency();
+  BuildEdges();
+
+  std::vector<Candidate> candidates;
+  candidates.reserve(m_Edges.size());
+  for (const Edge &edge : m_Edges) {
+    Candidate best{0, 0, INFINITY};
+    for (int direction = 0; direction < 2; ++direction) {
+      const uint32_t from = direction == 0 ? edge.a : edge.b;
+      const uint32_t to = direction == 0 ? edge.b : edge.a;
+      if (!CanCollapse(from, to, edge)) {
+        continue;
+      }
+      Quadric q = m_Quadrics[from];
+      q.Add(m_Quadrics[to]);
+      const double error =
+          q.weight > 0.0
+              ? std::sqrt(std::max(q.Evaluate(m_Points[to]), 0.0) / q.weight)
+              : 0.0;
+      if (error < best.error) {
+        best = {from, to, error};
+      }
+    }
+    if (best.error <= maxError) {
+      candidates.push_back(best);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              return a.error < b.error;
+            });
+
+  // Cheapest first. A collapse locks both one-rings for the rest of the pass,
+  // so every triangle a later collapse checks is still unchanged.
+  std::vector<bool> locked(m_Points.size(), false);
+  size_t triangles = GetTriangleCount();
+  size_t collapses = 0;
+  for (const Candidate &candidate : candidates) {
+    if (triangles <= targetTriangles) {
+      break;
+    }
+    if (locked[candidate.from] || locked[candidate.to] ||
+        FlipsTriangle(candidate.from, candidate.to)) {
+      continue;
+    }
+
+    for (uint32_t i = m_FirstTriangle[candidate.from];
+         i < m_FirstTriangle[candidate.from + 1]; ++i) {
+      const uint32_t t = m_Triangles[i];
+      for (int k = 0; k < 3; ++k) {
+        triangles -= m_Position[m_Indices[t * 3 + k]] == candidate.to;
+      }
+    }
+    for (uint32_t i = m_FirstVertex[candidate.from];
+         i < m_FirstVertex[candidate.from + 1]; ++i) {
+      const uint32_t vertex = m_PositionVertices[i];
+      m_Remap[vertex] = ClosestVertex(candidate.to, vertex);
+    }
+    m_Quadrics[candidate.to].Add(m_Quadrics[candidate.from]);
+    m_Error = std::max(m_Error, candidate.error);
+
+    for (uint32_t p : {candidate.from, candidate.to}) {
+      for (uint32_t i = m_FirstTriangle[p]; i < m_FirstTriangle[p + 1]; ++i) {
+        const uint32_t t = m_Triangles[i];
+        for (int k = 0; k < 3; ++k) {
+          locked[m_Position[m_Indices[t * 3 + k]]] = true;
+        }
+      }
+    }
+    collapses++;
+  }
+  if (collapses == 0) {
+    return false;
+  }
+
+  // Apply the pass and drop the triangles that collapsed
+  size_t kept = 0;
+  for (size_t i = 0; i < m_Indices.size(); i += 3) {
+    const uint32_t v0 = m_Remap[m_Indices[i]];
+    const uint32_t v1 = m_Remap[m_Indices[i + 1]];
+    const uint32_t v2 = m_Remap[m_Indices[i + 2]];
+    const uint32_t a = m_Position[v0];
+    const uint32_t b = m_Position[v1];
+    const uint32_t c = m_Position[v2];
+    if (a != b && b != c && a != c) {
+      m_Indices[kept++] = v0;
+      m_Indices[kept++] = v1;
+      m_Indices[kept++] = v2;
+    }
+  }
+  m_Indices.resize(kept);
+  return true;
+}
+
+void Simplifier::Run(size_t targetTriangles, double maxError) {
+  while (GetTriangleCount() > targetTriangles &&
+         RunPass(targetTriangles, maxError)) {
+  }
+}
+
+} // namespace
+
+uint32_t GenerateLods(MeshData &mesh, const LodSettings &settings) {
+  const uint32_t baseIndexCount = static_cast<uint32_t>(mesh.indices.size());
+  mesh.lods.assign(1, MeshLod{0, baseIndexCount, 0.0f});
+
+  Aabb bounds = mesh.bounds;
+  if (bounds.IsEmpty()) {
+    for (const Vertex &v : mesh.vertices) {
+      bounds.Expand(v.position);
+    }
+  }
+  const double diagonal = bounds.IsEmpty() ? 0.0 : Length(bounds.max - bounds.min);
+  size_t previous = baseIndexCount / 3;
+  if (settings.maxLods < 2 || previous <= settings.minTriangles ||
+      diagonal <= 0.0) {
+    return 1;
+  }
+
+  // Levels are snapshots of one run, so each continues from the last and the
+  // error only grows
+  Simplifier simplifier(mesh);
+  double maxError = settings.firstError * diagonal;
+  for (uint32_t level = 1; level < settings.maxLods; ++level, maxError *= 2.0) {
+    const size_t target = std::max<size_t>(
+        settings.minTriangles, static_cast<size_t>(previous * settings.reduction));
+    simplifier.Run(target, maxError);
+
+    // Too little progress under this bound; a looser one may do better
+    const size_t triangles = simplifier.GetTriangleCount();
+    if (triangles == 0 ||
+        triangles > previous * (1.0 - settings.minReduction)) {
+      continue;
+    }
+
+    MeshLod lod;
+    lod.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+    lod.indexCount = static_cast<uint32_t>(triangles * 3);
+    lod.error = static_cast<float>(simplifier.GetError());
+    mesh.indices.insert(mesh.indices.end(), simplifier.GetIndices().begin(),
+                        simplifier.GetIndices().end());
+    mesh.lods.push_back(lod);
+    previous = triangles;
+    if (triangles <= settings.minTriangles) {
+      break;
+    }
+  }
+  return static_cast<uint32_t>(mesh.lods.size());
+}
@@ -0,0 +1,259 @@
+#include "scene/Scene.h"
+#include "scene/MeshSimplifier.h"
+#include "utilities/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+Scene::Scene() {}
+
+Scene::~Scene() {}
+
+uint32_t Scene::AddMesh(MeshData mesh) {
+  if (mesh.bounds.IsEmpty()) {
+    for (const Vertex &v : mesh.vertices) {
+      mesh.bounds.Expand(v.position);
+    }
+  }
+  if (mesh.lods.empty()) {
+    mesh.lods.push_back(
+        {0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+  }
+  m_Meshes.push_back(std::move(mesh));
+  m_TopologyVersion++;
+  return static_cast<uint32_t>(m_Meshes.size() - 1);
+}
+
+uint32_t Scene::AddMaterial(Material material) {
+  m_Materials.push_back(std::move(material));
+  return static_cast<uint32_t>(m_Materials.size() - 1);
+}
+
+uint32_t Scene::AddTexture(TextureSource texture) {
+  m_Textures.push_back(std::move(texture));
+  return static_cast<uint32_t>(m_Textures.size() - 1);
+}
+
+uint32_t Scene::AddObject(TransformHandle transform, uint32_t mesh,
+                          uint32_t material) {
+  m_Objects.push_back({transform, mesh, material});
+  m_WorldBounds.emplace_back();
+  m_TopologyVersion++;
+  return static_cast<uint32_t>(m_Objects.size() - 1);
+}
+
+void Scene::Clear() {
+  m_Transforms = TransformHierarchy();
+  m_Meshes.clear();
+  m_Materials.clear();
+  m_Textures.clear();
+  m_Objects.clear();
+  m_WorldBounds.clear();
+  m_MovedObjects.clear();
+  m_TopologyVersion++;
+}
+
+void Scene::Update(ThreadPool *pool) {
+  m_Transforms.Update(pool);
+  m_MovedObjects.clear();
+
+  if (m_Transforms.GetStats().updatedCount == 0) {
+    return;
+  }
+
+  // Each chunk collects its moved objects locally and appends under a lock,
+  // so the list is unordered but every entry is unique
+  std::mutex movedMutex;
+  auto refresh = [&](size_t begin, size_t end) {
+    std::vector<uint32_t> moved;
+    for (size_t i = begin; i < end; ++i) {
+      const SceneObject &object = m_Objects[i];
+      if (!m_Transforms.WasUpdated(object.transform)) {
+        continue;
+      }
+      m_WorldBounds[i] = TransformAabb(m_Transforms.GetWorldMatrix(object.transform),
+                                       m_Meshes[object.mesh].bounds);
+      moved.push_back(static_cast<uint32_t>(i));
+    }
+    if (!moved.empty()) {
+      std::lock_guard<std::mutex> lock(movedMutex);
+      m_MovedObjects.insert(m_MovedObjects.end(), moved.begin(), moved.end());
+    }
+  };
+
+  if (pool) {
+    pool->parallel_for(0, m_Objects.size(), 8192, refresh);
+  } else {
+    refresh(0, m_Objects.size());
+  }
+}
+
+Aabb Scene::ComputeBounds() const {
+  Aabb bounds;
+  for (const Aabb &b : m_WorldBounds) {
+    bounds.Expand(b);
+  }
+  return bounds;
+}
+
+std::vector<uint32_t> MatchMeshes(const Scene &previous, const Scene &next) {
+  auto sameGeometry = [](const MeshData &a, const MeshData &b) {
+    if (a.vertices.size() != b.vertices.size() ||
+        a.indices.size() != b.indices.size() || a.lods.size() != b.lods.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < a.lods.size(); ++i) {
+      if (a.lods[i].firstIndex != b.lods[i].firstIndex ||
+          a.lods[i].indexCount != b.lods[i].indexCount ||
+          a.lods[i].error != b.lods[i].error) {
+        return false;
+      }
+    }
+    // Bitwise, as that is what the GPU copy holds
+    return std::memcmp(a.vertices.data(), b.vertices.data(),
+                       a.vertices.size() * sizeof(Vertex)) == 0 &&
+           std::memcmp(a.indices.data(), b.indices.data(),
+                       a.indices.size() * sizeof(uint32_t)) == 0;
+  };
+
+  // Names narrow the candidates down so only likely matches are compared
+  const auto &previousMeshes = previous.GetMeshes();
+  std::unordered_multimap<std::string_view, uint32_t> byName;
+  for (size_t i = 0; i < previousMeshes.size(); ++i) {
+    byName.emplace(previousMeshes[i].name, static_cast<uint32_t>(i));
+  }
+  std::vector<uint32_t> matches(next.GetMeshes().size(), UINT32_MAX);
+  for (size_t i = 0; i < matches.size(); ++i) {
+    const MeshData &mesh = next.GetMeshes()[i];
+    auto [first, last] = byName.equal_range(mesh.name);
+    for (auto it = first; it != last; ++it) {
+      if (sameGeometry(previousMeshes[it->second], mesh)) {
+        matches[i] = it->second;
+        byName.erase(it);
+        break;
+      }
+    }
+  }
+  return matches;
+}
+
+void BuildProceduralScene(Scene &scene, int objectCount) {
+  // Unit cube with per-face normals
+  MeshData cube;
+  cube.name = "cube";
+  const Vec3 normals[6] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                           {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+  for (const Vec3 &n : normals) {
+    // Two axes spanning the face
+    Vec3 u = std::fabs(n.y) > 0.5f ? Vec3{1, 0, 0} : Vec3{0, 1, 0};
+    Vec3 v = Cross(n, u);
+    const uint32_t base = static_cast<uint32_t>(cube.vertices.size());
+    const float corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    for (const auto &c : corners) {
+      Vertex vertex;
+      vertex.position = (n + u * c[0] + v * c[1]) * 0.5f;
+      vertex.normal = n;
+      vertex.uv[0] = c[0] * 0.5f + 0.5f;
+      vertex.uv[1] = c[1] * 0.5f + 0.5f;
+      cube.vertices.push_back(vertex);
+    }
+    for (uint32_t i : {0u, 1u, 2u, 0u, 2u, 3u}) {
+      cube.indices.push_back(base + i);
+    }
+  }
+  const uint32_t cubeMesh = scene.AddMesh(std::move(cube));
+
+  // UV sphere dense enough for its LOD chain to matter
+  MeshData sphere;
+  sphere.name = "sphere";
+  const uint32_t segments = 48;
+  const uint32_t rings = 24;
+  for (uint32_t r = 0; r <= rings; ++r) {
+    const float theta = kPi * r / rings;
+    for (uint32_t s = 0; s <= segments; ++s) {
+      const float phi = 2.0f * kPi * s / segments;
+      Vertex vertex;
+      vertex.normal = {std::sin(theta) * std::cos(phi), std::cos(theta),
+                       std::sin(theta) * std::sin(phi)};
+      vertex.position = vertex.normal * 0.5f;
+      vertex.uv[0] = static_cast<float>(s) / segments;
+      vertex.uv[1] = static_cast<float>(r) / rings;
+      sphere.vertices.push_back(vertex);
+    }
+  }
+  for (uint32_t r = 0; r < rings; ++r) {
+    for (uint32_t s = 0; s < segments; ++s) {
+      const uint32_t a = r * (segments + 1) + s;
+      const uint32_t b = a + segments + 1;
+      // The pole rows collapse to triangles
+      if (r != 0) {
+        sphere.indices.insert(sphere.indices.end(), {a, a + 1, b});
+      }
+      if (r != rings - 1) {
+        sphere.indices.insert(sphere.indices.end(), {a + 1, b + 1, b});
+      }
+    }
+  }
+  GenerateLods(sphere);
+  const uint32_t sphereMesh = scene.AddMesh(std::move(sphere));
+
+  const Vec4 palette[4] = {{0.80f, 0.30f, 0.25f, 1.0f},
+                           {0.25f, 0.60f, 0.80f, 1.0f},
+                           {0.35f, 0.75f, 0.35f, 1.0f},
+                           {0.85f, 0.75f, 0.30f, 1.0f}};
+  // Checker textures tinted by the palette, with a size per material so the
+  // streamer sees a mix of mip chains
+  const uint32_t textureSizes[4] = {2048, 1024, 1024, 512};
+  uint32_t materials[4];
+  for (int i = 0; i < 4; ++i) {
+    TextureSource texture;
+    texture.name = "checker" + std::to_string(i);
+    texture.width = textureSizes[i];
+    texture.height = textureSizes[i];
+    texture.pixels.resize(size_t(texture.width) * texture.height * 4);
+    const uint32_t cell = texture.width / 8;
+    for (uint32_t y = 0; y < texture.height; ++y) {
+      for (uint32_t x = 0; x < texture.width; ++x) {
+        // Fine grid lines inside the cells show which mip is resident
+        const bool dark = ((x / cell) + (y / cell)) % 2 != 0;
+        const bool line = (x % 16) == 0 || (y % 16) == 0;
+        uint8_t value = dark ? 150 : 255;
+        value = line ? static_cast<uint8_t>(value - 60) : value;
+        uint8_t *p = &texture.pixels[(size_t(y) * texture.width + x) * 4];
+        p[0] = p[1] = p[2] = value;
+        p[3] = 255;
+      }
+    }
+
+    Material material;
+    material.name = "procedural" + std::to_string(i);
+    material.baseColor = palette[i];
+    material.baseColorTexture = scene.AddTexture(std::move(texture));
+    materials[i] = scene.AddMaterial(material);
+  }
+
+  // Square grid in XZ, grouped under one root per row so the hierarchy has
+  // some depth
+  TransformHierarchy &transforms = scene.GetTransforms();
+  transforms.Reserve(transforms.Size() + objectCount + 1024);
+  const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(objectCount))));
+  const float spacing = 2.5f;
+  int created = 0;
+  for (int row = 0; row < side && created < objectCount; ++row) {
+    TransformHandle rowRoot = transforms.Create();
+    transforms.SetLocalPosition(
+        rowRoot, {0.0f, 0.0f, (row - side * 0.5f) * spacing});
+    for (int col = 0; col < side && created < objectCount; ++col, ++created) {
+      TransformHandle t = transforms.Create(rowRoot);
+      float height = 0.5f + static_cast<float>((row * 7 + col * 13) % 5) * 0.5f;
+      transforms.SetLocal(t, {(col - side * 0.5f) * spacing, height * 0.5f, 0.0f},
+                          Quat::FromAxisAngle({0, 1, 0}, 0.1f * (col % 16)),
+                          {1.0f, height, 1.0f});
+      const uint32_t mesh = (row * 3 + col) % 4 == 0 ? sphereMesh : cubeMesh;
+      scene.AddObject(t, mesh, materials[(row + col) % 4]);
+    }
+  }
+}
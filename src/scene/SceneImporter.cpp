@@ -0,0 +1,229 @@
+#include "scene/MeshSimplifier.h"
+#include "scene/Scene.h"
+#include "utilities/ThreadPool.h"
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <filesystem>
+#include <stdio.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// Records the files the importer opens, for hot reload
+class RecordingIOSystem : public Assimp::DefaultIOSystem {
+public:
+  explicit RecordingIOSystem(std::vector<std::string> &files)
+      : m_Files(files) {}
+
+  Assimp::IOStream *Open(const char *file, const char *mode) override {
+    Assimp::IOStream *stream = DefaultIOSystem::Open(file, mode);
+    if (stream) {
+      std::error_code error;
+      const std::filesystem::path path =
+          std::filesystem::weakly_canonical(file, error);
+      m_Files.push_back(error ? std::string(file) : path.string());
+    }
+    return stream;
+  }
+
+private:
+  std::vector<std::string> &m_Files;
+};
+
+MeshData ConvertMesh(const aiMesh *src) {
+  MeshData mesh;
+  mesh.name = src->mName.C_Str();
+  mesh.vertices.resize(src->mNumVertices);
+  for (unsigned i = 0; i < src->mNumVertices; ++i) {
+    Vertex &v = mesh.vertices[i];
+    v.position = {src->mVertices[i].x, src->mVertices[i].y, src->mVertices[i].z};
+    if (src->HasNormals()) {
+      v.normal = {src->mNormals[i].x, src->mNormals[i].y, src->mNormals[i].z};
+    }
+    if (src->HasTextureCoords(0)) {
+      v.uv[0] = src->mTextureCoords[0][i].x;
+      v.uv[1] = src->mTextureCoords[0][i].y;
+    }
+    mesh.bounds.Expand(v.position);
+  }
+
+  mesh.indices.reserve(static_cast<size_t>(src->mNumFaces) * 3);
+  for (unsigned f = 0; f < src->mNumFaces; ++f) {
+    const aiFace &face = src->mFaces[f];
+    // Triangulate guarantees triangles; points/lines are dropped by SortByPType
+    if (face.mNumIndices != 3) {
+      continue;
+    }
+    mesh.indices.push_back(face.mIndices[0]);
+    mesh.indices.push_back(face.mIndices[1]);
+    mesh.indices.push_back(face.mIndices[2]);
+  }
+  return mesh;
+}
+
+// Adds each referenced image to the scene once, keyed by its reference string
+class TextureTable {
+public:
+  TextureTable(const aiScene *src, const char *scenePath, Scene &scene)
+      : m_Src(src), m_Scene(scene),
+        m_Directory(std::filesystem::path(scenePath).parent_path()) {}
+
+  uint32_t Get(const char *reference) {
+    auto it = m_Indices.find(reference);
+    if (it != m_Indices.end()) {
+      return it->second;
+    }
+
+    TextureSource texture;
+    texture.name = reference;
+    if (const aiTexture *embedded = m_Src->GetEmbeddedTexture(reference)) {
+      if (embedded->mHeight == 0) {
+        // Compressed file stored whole; mWidth is its size in bytes
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(embedded->pcData);
+        texture.encoded.assign(bytes, bytes + embedded->mWidth);
+      } else {
+        texture.width = embedded->mWidth;
+        texture.height = embedded->mHeight;
+        texture.pixels.resize(size_t(texture.width) * texture.height * 4);
+        for (size_t i = 0; i < size_t(texture.width) * texture.height; ++i) {
+          const aiTexel &t = embedded->pcData[i];
+          uint8_t *p = &texture.pixels[i * 4];
+          p[0] = t.r;
+          p[1] = t.g;
+          p[2] = t.b;
+          p[3] = t.a;
+        }
+      }
+    } else {
+      texture.path = (m_Directory / reference).string();
+    }
+
+    uint32_t index = m_Scene.AddTexture(std::move(texture));
+    m_Indices.emplace(reference, index);
+    return index;
+  }
+
+private:
+  const aiScene *m_Src;
+  Scene &m_Scene;
+  std::filesystem::path m_Directory;
+  std::unordered_map<std::string, uint32_t> m_Indices;
+};
+
+Material ConvertMaterial(const aiMaterial *src, TextureTable &textures) {
+  Material material;
+  aiString name;
+  if (src->Get(AI_MATKEY_NAME, name) == AI_SUCCESS) {
+    material.name = name.C_Str();
+  }
+  aiColor4D diffuse;
+  if (aiGetMaterialColor(src, AI_MATKEY_COLOR_DIFFUSE, &diffuse) == AI_SUCCESS) {
+    material.baseColor = {diffuse.r, diffuse.g, diffuse.b, diffuse.a};
+  }
+  aiString texture;
+  if (src->GetTexture(aiTextureType_BASE_COLOR, 0, &texture) == AI_SUCCESS ||
+      src->GetTexture(aiTextureType_DIFFUSE, 0, &texture) == AI_SUCCESS) {
+    material.baseColorTexture = textures.Get(texture.C_Str());
+  }
+  return material;
+}
+
+void ImportNode(const aiNode *node, TransformHandle parent, uint32_t meshBase,
+                uint32_t materialBase, const aiScene *src, Scene &scene) {
+  aiVector3D scaling, position;
+  aiQuaternion rotation;
+  node->mTransformation.Decompose(scaling, rotation, position);
+
+  TransformHierarchy &transforms = scene.GetTransforms();
+  TransformHandle handle = transforms.Create(parent);
+  transforms.SetLocal(handle, {position.x, position.y, position.z},
+                      {rotation.x, rotation.y, rotation.z, rotation.w},
+                      {scaling.x, scaling.y, scaling.z});
+
+  for (unsigned i = 0; i < node->mNumMeshes; ++i) {
+    const unsigned meshIndex = node->mMeshes[i];
+    scene.AddObject(handle, meshBase + meshIndex,
+                    materialBase + src->mMeshes[meshIndex]->mMaterialIndex);
+  }
+
+  for (unsigned i = 0; i < node->mNumChildren; ++i) {
+    ImportNode(node->mChildren[i], handle, meshBase, materialBase, src, scene);
+  }
+}
+
+} // namespace
+
+bool ImportScene(const char *path, Scene &scene, ThreadPool *pool,
+                 std::vector<std::string> *files) {
+  std::vector<std::string> opened;
+  Assimp::Importer importer;
+  if (files) {
+    // Owned and deleted by the importer
+    importer.SetIOHandler(new RecordingIOSystem(opened));
+  }
+  // Drop points and lines so every mesh is a plain triangle list
+  importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                              aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+
+  const aiScene *src = importer.ReadFile(
+      path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+                aiProcess_GenSmoothNormals | aiProcess_SortByPType |
+                aiProcess_ImproveCacheLocality | aiProcess_FlipUVs);
+  if (!src || (src->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !src->mRootNode) {
+    fprintf(stderr, "Failed to import %s: %s\n", path, importer.GetErrorString());
+    return false;
+  }
+
+  const uint32_t meshBase = static_cast<uint32_t>(scene.GetMeshes().size());
+  const uint32_t materialBase =
+      static_cast<uint32_t>(scene.GetMaterials().size());
+
+  std::vector<MeshData> meshes(src->mNumMeshes);
+  auto convert = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      meshes[i] = ConvertMesh(src->mMeshes[i]);
+      GenerateLods(meshes[i]);
+    }
+  };
+  if (pool) {
+    pool->parallel_for(0, meshes.size(), 1, convert);
+  } else {
+    convert(0, meshes.size());
+  }
+  size_t baseTriangles = 0;
+  size_t lodTriangles = 0;
+  size_t lodCount = 0;
+  for (MeshData &mesh : meshes) {
+    baseTriangles += mesh.lods[0].indexCount / 3;
+    lodTriangles += (mesh.indices.size() - mesh.lods[0].indexCount) / 3;
+    lodCount += mesh.lods.size() - 1;
+    scene.AddMesh(std::move(mesh));
+  }
+  TextureTable textures(src, path, scene);
+  for (unsigned i = 0; i < src->mNumMaterials; ++i) {
+    scene.AddMaterial(ConvertMaterial(src->mMaterials[i], textures));
+  }
+  if (src->mNumMaterials == 0) {
+    scene.AddMaterial(Material{"default"});
+  }
+
+  ImportNode(src->mRootNode, kInvalidTransform, meshBase, materialBase, src,
+             scene);
+
+  if (files) {
+    // Formats that re-open their source for each stage list it repeatedly
+    std::sort(opened.begin(), opened.end());
+    opened.erase(std::unique(opened.begin(), opened.end()), opened.end());
+    *files = std::move(opened);
+  }
+
+  printf("Imported %s: %u meshes, %u materials, %zu textures, %zu objects\n",
+         path, src->mNumMeshes, src->mNumMaterials, scene.GetTextures().size(),
+         scene.GetObjects().size());
+  printf("Generated %zu LODs: %zu base triangles, %zu in simplified levels\n",
+         lodCount, baseTriangles, lodTriangles);
+  return true;
+}
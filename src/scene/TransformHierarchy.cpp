@@ -0,0 +1,389 @@
+#include "scene/TransformHierarchy.h"
+#include "utilities/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Levels smaller than this are cheaper to process inline than to fan out
+constexpr size_t kParallelThreshold = 4096;
+constexpr size_t kParallelGrain = 2048;
+
+template <class T>
+void Permute(std::vector<T> &data, const std::vector<uint32_t> &order) {
+  std::vector<T> sorted(order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    sorted[i] = data[order[i]];
+  }
+  data.swap(sorted);
+}
+
+} // namespace
+
+TransformHierarchy::TransformHierarchy() {}
+
+TransformHierarchy::~TransformHierarchy() {}
+
+TransformHandle TransformHierarchy::Create(TransformHandle parent) {
+  TransformHandle handle;
+  if (!m_FreeHandles.empty()) {
+    handle = m_FreeHandles.back();
+    m_FreeHandles.pop_back();
+  } else {
+    handle = static_cast<TransformHandle>(m_HandleToSlot.size());
+    m_HandleToSlot.push_back(kInvalidSlot);
+    m_HandleParent.push_back(kInvalidTransform);
+    m_HandleAlive.push_back(0);
+  }
+
+  const uint32_t slot = static_cast<uint32_t>(m_SlotToHandle.size());
+  m_HandleToSlot[handle] = slot;
+  m_HandleParent[handle] = IsValid(parent) ? parent : kInvalidTransform;
+  m_HandleAlive[handle] = 1;
+
+  m_SlotToHandle.push_back(handle);
+  m_ParentSlot.push_back(kInvalidSlot); // resolved by Rebuild
+  m_PosX.push_back(0.0f);
+  m_PosY.push_back(0.0f);
+  m_PosZ.push_back(0.0f);
+  m_RotX.push_back(0.0f);
+  m_RotY.push_back(0.0f);
+  m_RotZ.push_back(0.0f);
+  m_RotW.push_back(1.0f);
+  m_ScaleX.push_back(1.0f);
+  m_ScaleY.push_back(1.0f);
+  m_ScaleZ.push_back(1.0f);
+  m_World.emplace_back();
+  m_Dirty.push_back(1);
+  m_Updated.push_back(0);
+
+  m_NeedsRebuild = true;
+  m_AnyDirty = true;
+  return handle;
+}
+
+void TransformHierarchy::Destroy(TransformHandle handle) {
+  if (!IsValid(handle)) {
+    return;
+  }
+  // The slot is reclaimed (and descendants found) by the next Rebuild
+  m_HandleAlive[handle] = 0;
+  m_NeedsRebuild = true;
+}
+
+bool TransformHierarchy::IsValid(TransformHandle handle) const {
+  return handle < m_HandleAlive.size() && m_HandleAlive[handle];
+}
+
+bool TransformHierarchy::SetParent(TransformHandle handle,
+                                   TransformHandle parent) {
+  if (!IsValid(handle)) {
+    return false;
+  }
+  if (!IsValid(parent)) {
+    parent = kInvalidTransform;
+  }
+  for (TransformHandle p = parent; p != kInvalidTransform;
+       p = m_HandleParent[p]) {
+    if (p == handle) {
+      return false;
+    }
+  }
+  if (m_HandleParent[handle] != parent) {
+    m_HandleParent[handle] = parent;
+    m_NeedsRebuild = true;
+    MarkDirty(handle);
+  }
+  return true;
+}
+
+TransformHandle TransformHierarchy::GetParent(TransformHandle handle) const {
+  return m_HandleParent[handle];
+}
+
+void TransformHierarchy::SetLocal(TransformHandle handle, Vec3 position,
+                                  const Quat &rotation, Vec3 scale) {
+  const uint32_t slot = m_HandleToSlot[handle];
+  m_PosX[slot] = position.x;
+  m_PosY[slot] = position.y;
+  m_PosZ[slot] = position.z;
+  m_RotX[slot] = rotation.x;
+  m_RotY[slot] = rotation.y;
+  m_RotZ[slot] = rotation.z;
+  m_RotW[slot] = rotation.w;
+  m_ScaleX[slot] = scale.x;
+  m_ScaleY[slot] = scale.y;
+  m_ScaleZ[slot] = scale.z;
+  MarkDirty(handle);
+}
+
+void TransformHierarchy::SetLocalPosition(TransformHandle handle,
+                                          Vec3 position) {
+  const uint32_t slot = m_HandleToSlot[handle];
+  m_PosX[slot] = position.x;
+  m_PosY[slot] = position.y;
+  m_PosZ[slot] = position.z;
+  MarkDirty(handle);
+}
+
+void TransformHierarchy::SetLocalRotation(TransformHandle handle,
+                                          const Quat &rotation) {
+  const uint32_t slot = m_HandleToSlot[handle];
+  m_RotX[slot] = rotation.x;
+  m_RotY[slot] = rotation.y;
+  m_RotZ[slot] = rotation.z;
+  m_RotW[slot] = rotation.w;
+  MarkDirty(handle);
+}
+
+void TransformHierarchy::SetLocalScale(TransformHandle handle, Vec3 scale) {
+  const uint32_t slot = m_HandleToSlot[handle];
+  m_ScaleX[slot] = scale.x;
+  m_ScaleY[slot] = scale.y;
+  m_ScaleZ[slot] = scale.z;
+  MarkDirty(handle);
+}
+
+Vec3 TransformHierarchy::GetLocalPosition(TransformHandle handle) const {
+  const uint32_t slot = m_HandleToSlot[handle];
+  return {m_PosX[slot], m_PosY[slot], m_PosZ[slot]};
+}
+
+Quat TransformHierarchy::GetLocalRotation(TransformHandle handle) const {
+  const uint32_t slot = m_HandleToSlot[handle];
+  return {m_RotX[slot], m_RotY[slot], m_RotZ[slot], m_RotW[slot]};
+}
+
+Vec3 TransformHierarchy::GetLocalScale(TransformHandle handle) const {
+  const uint32_t slot = m_HandleToSlot[handle];
+  return {m_ScaleX[slot], m_ScaleY[slot], m_ScaleZ[slot]};
+}
+
+const Mat4 &TransformHierarchy::GetWorldMatrix(TransformHandle handle) const {
+  return m_World[m_HandleToSlot[handle]];
+}
+
+bool TransformHierarchy::WasUpdated(TransformHandle handle) const {
+  return m_Updated[m_HandleToSlot[handle]] != 0;
+}
+
+void TransformHierarchy::Reserve(size_t count) {
+  m_HandleToSlot.reserve(count);
+  m_HandleParent.reserve(count);
+  m_HandleAlive.reserve(count);
+  m_SlotToHandle.reserve(count);
+  m_ParentSlot.reserve(count);
+  for (auto *array : {&m_PosX, &m_PosY, &m_PosZ, &m_RotX, &m_RotY, &m_RotZ,
+                      &m_RotW, &m_ScaleX, &m_ScaleY, &m_ScaleZ}) {
+    array->reserve(count);
+  }
+  m_World.reserve(count);
+  m_Dirty.reserve(count);
+  m_Updated.reserve(count);
+}
+
+void TransformHierarchy::MarkDirty(TransformHandle handle) {
+  m_Dirty[m_HandleToSlot[handle]] = 1;
+  m_AnyDirty = true;
+}
+
+void TransformHierarchy::Rebuild() {
+  const size_t handleCount = m_HandleToSlot.size();
+
+  // Depth of every live handle; a node under a destroyed ancestor dies too
+  constexpr int32_t kUnknown = -1;
+  constexpr int32_t kDead = -2;
+  std::vector<int32_t> depth(handleCount, kUnknown);
+  std::vector<TransformHandle> chain;
+  for (TransformHandle h = 0; h < handleCount; ++h) {
+    if (m_HandleToSlot[h] == kInvalidSlot) {
+      continue; // already free
+    }
+    chain.clear();
+    TransformHandle cur = h;
+    int32_t base = kUnknown;
+    while (cur != kInvalidTransform) {
+      if (depth[cur] != kUnknown) {
+        base = depth[cur];
+        break;
+      }
+      if (!m_HandleAlive[cur]) {
+        base = kDead;
+        depth[cur] = kDead;
+        break;
+      }
+      chain.push_back(cur);
+      cur = m_HandleParent[cur];
+    }
+    // Walked to a root without meeting a known depth
+    int32_t d = base == kUnknown ? -1 : base;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      depth[*it] = d == kDead ? kDead : ++d;
+    }
+  }
+
+  // Stable counting sort of the surviving slots by depth
+  int32_t maxDepth = -1;
+  for (TransformHandle h : m_SlotToHandle) {
+    maxDepth = std::max(maxDepth, depth[h]);
+  }
+  m_LevelOffsets.assign(static_cast<size_t>(maxDepth + 2), 0);
+  for (TransformHandle h : m_SlotToHandle) {
+    if (depth[h] >= 0) {
+      m_LevelOffsets[depth[h] + 1]++;
+    }
+  }
+  for (size_t i = 1; i < m_LevelOffsets.size(); ++i) {
+    m_LevelOffsets[i] += m_LevelOffsets[i - 1];
+  }
+
+  const uint32_t liveCount = m_LevelOffsets.back();
+  std::vector<uint32_t> order(liveCount);
+  std::vector<uint32_t> cursor(m_LevelOffsets.begin(), m_LevelOffsets.end() - 1);
+  for (uint32_t slot = 0; slot < m_SlotToHandle.size(); ++slot) {
+    const TransformHandle h = m_SlotToHandle[slot];
+    if (depth[h] >= 0) {
+      order[cursor[depth[h]]++] = slot;
+    } else {
+      // Destroyed: release the handle for reuse
+      m_HandleToSlot[h] = kInvalidSlot;
+      m_HandleAlive[h] = 0;
+      m_HandleParent[h] = kInvalidTransform;
+      m_FreeHandles.push_back(h);
+    }
+  }
+
+  Permute(m_SlotToHandle, order);
+  for (auto *array : {&m_PosX, &m_PosY, &m_PosZ, &m_RotX, &m_RotY, &m_RotZ,
+                      &m_RotW, &m_ScaleX, &m_ScaleY, &m_ScaleZ}) {
+    Permute(*array, order);
+  }
+  Permute(m_World, order);
+  Permute(m_Dirty, order);
+  m_Updated.assign(liveCount, 0);
+
+  for (uint32_t slot = 0; slot < liveCount; ++slot) {
+    m_HandleToSlot[m_SlotToHandle[slot]] = slot;
+  }
+  m_ParentSlot.resize(liveCount);
+  for (uint32_t slot = 0; slot < liveCount; ++slot) {
+    const TransformHandle parent = m_HandleParent[m_SlotToHandle[slot]];
+    m_ParentSlot[slot] =
+        parent == kInvalidTransform ? kInvalidSlot : m_HandleToSlot[parent];
+  }
+
+  m_NeedsRebuild = false;
+}
+
+uint32_t TransformHierarchy::UpdateRange(size_t begin, size_t end) {
+  // Parents live in earlier levels whose flags are already final
+  for (size_t i = begin; i < end; ++i) {
+    const uint32_t parent = m_ParentSlot[i];
+    if (parent != kInvalidSlot) {
+      m_Dirty[i] |= m_Dirty[parent];
+    }
+  }
+
+  constexpr int W = simd::kWideWidth;
+  alignas(32) float cols[9][W];
+  uint32_t updated = 0;
+
+  for (size_t base = begin; base < end; base += W) {
+    const size_t count = std::min<size_t>(W, end - base);
+
+    bool anyDirty = false;
+    for (size_t lane = 0; lane < count; ++lane) {
+      anyDirty |= m_Dirty[base + lane] != 0;
+    }
+    if (!anyDirty) {
+      continue;
+    }
+
+    if (count == static_cast<size_t>(W)) {
+      // Rotation * scale for W nodes at once
+      using namespace simd;
+      const fw rx = WideLoad(&m_RotX[base]), ry = WideLoad(&m_RotY[base]);
+      const fw rz = WideLoad(&m_RotZ[base]), rw = WideLoad(&m_RotW[base]);
+      const fw sx = WideLoad(&m_ScaleX[base]);
+      const fw sy = WideLoad(&m_ScaleY[base]);
+      const fw sz = WideLoad(&m_ScaleZ[base]);
+      const fw one = WideSplat(1.0f), two = WideSplat(2.0f);
+
+      const fw xx = WideMul(rx, rx), yy = WideMul(ry, ry), zz = WideMul(rz, rz);
+      const fw xy = WideMul(rx, ry), xz = WideMul(rx, rz), yz = WideMul(ry, rz);
+      const fw wx = WideMul(rw, rx), wy = WideMul(rw, ry), wz = WideMul(rw, rz);
+
+      WideStore(cols[0], WideMul(WideSub(one, WideMul(two, WideAdd(yy, zz))), sx));
+      WideStore(cols[1], WideMul(WideMul(two, WideAdd(xy, wz)), sx));
+      WideStore(cols[2], WideMul(WideMul(two, WideSub(xz, wy)), sx));
+      WideStore(cols[3], WideMul(WideMul(two, WideSub(xy, wz)), sy));
+      WideStore(cols[4], WideMul(WideSub(one, WideMul(two, WideAdd(xx, zz))), sy));
+      WideStore(cols[5], WideMul(WideMul(two, WideAdd(yz, wx)), sy));
+      WideStore(cols[6], WideMul(WideMul(two, WideAdd(xz, wy)), sz));
+      WideStore(cols[7], WideMul(WideMul(two, WideSub(yz, wx)), sz));
+      WideStore(cols[8], WideMul(WideSub(one, WideMul(two, WideAdd(xx, yy))), sz));
+    }
+
+    for (size_t lane = 0; lane < count; ++lane) {
+      const size_t i = base + lane;
+      if (!m_Dirty[i]) {
+        continue;
+      }
+
+      Mat4 local;
+      if (count == static_cast<size_t>(W)) {
+        local.SetCol(0, simd::Set(cols[0][lane], cols[1][lane], cols[2][lane], 0.0f));
+        local.SetCol(1, simd::Set(cols[3][lane], cols[4][lane], cols[5][lane], 0.0f));
+        local.SetCol(2, simd::Set(cols[6][lane], cols[7][lane], cols[8][lane], 0.0f));
+        local.SetCol(3, simd::Set(m_PosX[i], m_PosY[i], m_PosZ[i], 1.0f));
+      } else {
+        local = Mat4::FromTRS({m_PosX[i], m_PosY[i], m_PosZ[i]},
+                              {m_RotX[i], m_RotY[i], m_RotZ[i], m_RotW[i]},
+                              {m_ScaleX[i], m_ScaleY[i], m_ScaleZ[i]});
+      }
+
+      const uint32_t parent = m_ParentSlot[i];
+      m_World[i] = parent == kInvalidSlot ? local : m_World[parent] * local;
+      updated++;
+    }
+  }
+
+  return updated;
+}
+
+void TransformHierarchy::Update(ThreadPool *pool) {
+  m_Stats.rebuilt = false;
+  if (m_NeedsRebuild) {
+    Rebuild();
+    m_Stats.rebuilt = true;
+  }
+
+  m_Stats.nodeCount = static_cast<uint32_t>(m_SlotToHandle.size());
+  m_Stats.levelCount =
+      m_LevelOffsets.empty() ? 0 : static_cast<uint32_t>(m_LevelOffsets.size() - 1);
+  m_Stats.updatedCount = 0;
+
+  if (!m_AnyDirty) {
+    std::fill(m_Updated.begin(), m_Updated.end(), 0);
+    return;
+  }
+
+  std::atomic<uint32_t> updated{0};
+  for (size_t level = 0; level + 1 < m_LevelOffsets.size(); ++level) {
+    const size_t begin = m_LevelOffsets[level];
+    const size_t end = m_LevelOffsets[level + 1];
+    if (pool && end - begin >= kParallelThreshold) {
+      pool->parallel_for(begin, end, kParallelGrain, [&](size_t b, size_t e) {
+        updated.fetch_add(UpdateRange(b, e), std::memory_order_relaxed);
+      });
+    } else {
+      updated.fetch_add(UpdateRange(begin, end), std::memory_order_relaxed);
+    }
+  }
+
+  // This frame's dirty set becomes the "updated" set for consumers
+  m_Updated.swap(m_Dirty);
+  m_Dirty.assign(m_Updated.size(), 0);
+  m_AnyDirty = false;
+  m_Stats.updatedCount = updated.load();
+}